@@ -0,0 +1,215 @@
+#!/usr/bin/env lua
+-- MoonAL benchmarks: bench.lua
+--
+-- Measures the throughput of the most frequently used MoonAL functions, and prints
+-- the results as tab-separated values (one line per benchmark, with a header line
+-- starting with '#'), or as JSON if the '-j' option is given.
+--
+-- Usage: lua bench.lua [-j] [-s scale] [filter]
+--   -j:       output JSON instead of TSV
+--   -s scale: multiply the default number of iterations by scale (default: 1)
+--   filter:   run only the benchmarks whose name contains this string
+--
+-- The benchmarks run on a loopback device (no audio output), if ALC_SOFT_loopback
+-- is supported, or on the default playback device otherwise. To run them headless
+-- with OpenAL Soft, set ALSOFT_DRIVERS=null (this is done by 'make bench').
+-- To measure the overhead of the bindings alone, run them on the stub OpenAL library
+-- (see ../stub/ and 'make bench STUB=1').
+
+local al = require("moonal")
+
+local json, scale, filter = false, 1, nil
+local i = 1
+while i <= #arg do
+   if arg[i] == '-j' then json = true
+   elseif arg[i] == '-s' then i = i + 1; scale = tonumber(arg[i])
+   else filter = arg[i]
+   end
+   i = i + 1
+end
+
+local FREQ = 48000
+local MAXFRAMES, FRAMESIZE = 4096, 8 -- stereo float32
+
+-- Open the device and create the contexts ----------------------------------
+
+local device, context, context2, loopback
+local ok = pcall(function()
+   device = al.loopback_open_device(nil, MAXFRAMES, FRAMESIZE)
+end)
+if ok then
+   loopback = true
+   local attr = { format_type='float', format_channels='stereo', frequency=FREQ }
+   context = al.create_context(device, attr)
+   context2 = al.create_context(device, attr)
+else
+   device = al.open_device()
+   context = al.create_context(device)
+   context2 = al.create_context(device)
+end
+
+-- Utilities ----------------------------------------------------------------
+
+local results = {}
+
+local function bench(name, n, func)
+-- Executes func(n) and records the elapsed time for n operations.
+   if filter and not string.find(name, filter, 1, true) then return end
+   n = math.max(1, math.floor(n*scale))
+   collectgarbage()
+   collectgarbage('stop')
+   local t0 = al.now()
+   func(n)
+   local dt = al.since(t0)
+   collectgarbage('restart')
+   results[#results+1] = { name=name, ops=n, seconds=dt, ops_per_sec=n/dt, ns_per_op=dt*1e9/n }
+end
+
+local function has_efx()
+   return al.is_extension_present(context, "ALC_EXT_EFX")
+end
+
+-- Benchmarks ---------------------------------------------------------------
+
+-- Module load time, as measured by luaopen_moonal() for this process:
+if not filter or string.find('module_load', filter, 1, true) then
+   local t = al.stats().load_time
+   results[#results+1] = { name='module_load', ops=1, seconds=t, ops_per_sec=1/t, ns_per_op=t*1e9 }
+end
+
+-- Startup time of a short-lived process that loads the module (net of the
+-- startup time of the bare interpreter):
+local interp = arg[-1]
+if interp and (not filter or string.find('process_startup', filter, 1, true)) then
+   local N = math.max(1, math.floor(50*scale))
+   local function spawn(code)
+      local t0 = al.now()
+      for i = 1, N do os.execute(string.format("%s -e %q", interp, code)) end
+      return al.since(t0)
+   end
+   local dt = spawn("require('moonal')") - spawn("")
+   results[#results+1] = { name='process_startup', ops=N, seconds=dt, ops_per_sec=N/dt, ns_per_op=dt*1e9/N }
+end
+
+for _, what in ipairs({ 'buffer', 'source', 'effect', 'filter', 'auxslot' }) do
+   if what == 'buffer' or what == 'source' or has_efx() then
+      local create, delete = al['create_'..what], al['delete_'..what]
+      bench(what..'_create_delete', 20000, function(n)
+         for i = 1, n do delete(create(context)) end
+      end)
+   end
+end
+
+bench('context_create_delete', 500, function(n)
+   for i = 1, n do al.delete_context(al.create_context(device)) end
+end)
+al.current_context(context) -- deleting the current context leaves no current context
+
+do
+   local source = al.create_source(context)
+   bench('source_set_float', 200000, function(n)
+      for i = 1, n do source:set('gain', 0.5) end
+   end)
+   bench('source_get_float', 200000, function(n)
+      for i = 1, n do source:get('gain') end
+   end)
+   bench('source_set_float3', 200000, function(n)
+      for i = 1, n do source:set('position', {1, 2, 3}) end
+   end)
+   bench('source_get_float3', 200000, function(n)
+      for i = 1, n do source:get('position') end
+   end)
+   bench('source_get_state', 200000, function(n)
+      for i = 1, n do source:get('state') end
+   end)
+   source:delete()
+end
+
+do
+   local N = 48000
+   local t = {}
+   for i = 1, N do t[i] = math.sin(i/10) end
+   local data = al.pack('float', t)
+   bench('pack_float_48k', 200, function(n)
+      for i = 1, n do al.pack('float', t) end
+   end)
+   bench('unpack_float_48k', 200, function(n)
+      for i = 1, n do al.unpack('float', data) end
+   end)
+   bench('buffer_data_float_48k', 2000, function(n)
+      local buffer = al.create_buffer(context)
+      for i = 1, n do al.buffer_data(buffer, 'mono float32', data, FREQ) end
+      buffer:delete()
+   end)
+end
+
+do
+   local COUNT = 1000 -- buffers queued per iteration
+   local data = al.pack('short', { 0, 0, 0, 0 })
+   local source = al.create_source(context)
+   local buffers = {}
+   for i = 1, COUNT do
+      buffers[i] = al.create_buffer(context)
+      al.buffer_data(buffers[i], 'mono16', data, FREQ)
+   end
+   -- some more buffers, so that the search by name has something to scan:
+   local extra = {}
+   for i = 1, 5000 do extra[i] = al.create_buffer(context) end
+   bench('unqueue_buffers_1000', 20, function(n)
+      for i = 1, n do
+         al.source_queue_buffers(source, buffers)
+         al.source_unqueue_buffers(source, COUNT)
+      end
+   end)
+   for i = 1, #extra do extra[i]:delete() end
+   for i = 1, COUNT do buffers[i]:delete() end
+   source:delete()
+end
+
+do
+   local listener, listener2 = context:listener(), context2:listener()
+   bench('context_switch', 100000, function(n)
+      for i = 1, n, 2 do
+         listener:get('gain')
+         listener2:get('gain')
+      end
+   end)
+end
+
+if loopback then
+   local FRAMES = 1024
+   local source = al.create_source(context)
+   local t = {}
+   for i = 1, FREQ do t[i] = math.sin(i/10) end
+   local buffer = al.create_buffer(context)
+   al.buffer_data(buffer, 'mono float32', al.pack('float', t), FREQ)
+   source:set('buffer', buffer)
+   source:set('looping', true)
+   al.source_play(source)
+   bench('loopback_render_1024', 2000, function(n)
+      for i = 1, n do device:render(FRAMES, FRAMESIZE) end
+   end)
+   source:delete()
+   buffer:delete()
+end
+
+-- Output -------------------------------------------------------------------
+
+if json then
+   local items = {}
+   for _, r in ipairs(results) do
+      items[#items+1] = string.format(
+         '{"name":"%s","ops":%d,"seconds":%.6f,"ops_per_sec":%.1f,"ns_per_op":%.1f}',
+         r.name, r.ops, r.seconds, r.ops_per_sec, r.ns_per_op)
+   end
+   print('['..table.concat(items, ',\n')..']')
+else
+   print("#name\tops\tseconds\tops_per_sec\tns_per_op")
+   for _, r in ipairs(results) do
+      print(string.format("%s\t%d\t%.6f\t%.1f\t%.1f",
+         r.name, r.ops, r.seconds, r.ops_per_sec, r.ns_per_op))
+   end
+end
+
+al.delete_context(context2)
+al.close_device(device)
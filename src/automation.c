@@ -0,0 +1,439 @@
+/* The MIT License (MIT)
+ *
+ * Copyright (c) 2018 Stefano Trettel
+ *
+ * Software repository: MoonAL, https://github.com/stetre/moonal
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "internal.h"
+#include <math.h>
+
+/*------------------------------------------------------------------------------*
+ | Parameter automation                                                         |
+ *------------------------------------------------------------------------------*/
+
+/* Ramps on float (or float vector) parameters of sources, listeners, effects,
+ * filters and auxiliary effect slots. They are kept in a flat array per context
+ * (referenced by the context's info, see ctxinfo_t) and evaluated by ramps_tick()
+ * with a single error check and within a deferred-updates window.
+ */
+
+typedef struct {
+    ud_t *ud;           /* ud of the target object */
+    ud_t *context_ud;   /* ud of the context the target belongs to */
+    ALuint name;        /* AL name of the target (0 for the listener) */
+    ALenum param;
+    int target;         /* RAMP_XXX (internal.h) */
+    int curve;          /* NONAL_CURVE_XXX */
+    int n;              /* no. of components (1 or 3) */
+    double from[3];
+    double to[3];
+    double duration;
+    double elapsed;
+    ud_t *attach_ud;    /* effect: auxslot to reload, filter: source to re-attach to (or NULL) */
+    ALuint attach;      /* AL name of the attach_ud object */
+} ramp_t;
+
+struct moonal_ramplist_s {
+    ramp_t *ramps;
+    size_t n;
+    size_t max;
+};
+
+#define RAMPLIST(context_ud) (CTXINFO(context_ud)->ramps)
+
+static ramp_t *searchramp(ramplist_t *rl, ud_t *ud, ALenum param)
+    {
+    size_t i;
+    for(i = 0; i < rl->n; i++)
+        if(rl->ramps[i].ud == ud && rl->ramps[i].param == param) return &rl->ramps[i];
+    return NULL;
+    }
+
+static ramp_t *newramp(lua_State *L, ramplist_t *rl)
+    {
+    ramp_t *ramps;
+    size_t n;
+    if(rl->n == rl->max)
+        {
+        n = rl->max ? 2*rl->max : 32;
+        ramps = (ramp_t*)Malloc(L, n*sizeof(ramp_t));
+        if(rl->ramps)
+            {
+            memcpy(ramps, rl->ramps, rl->n*sizeof(ramp_t));
+            Free(L, rl->ramps);
+            }
+        rl->ramps = ramps;
+        rl->max = n;
+        }
+    memset(&rl->ramps[rl->n], 0, sizeof(ramp_t));
+    return &rl->ramps[rl->n++];
+    }
+
+static void delramp(ramplist_t *rl, size_t i)
+/* swap-remove (the order of evaluation does not matter) */
+    {
+    rl->n--;
+    if(i < rl->n) rl->ramps[i] = rl->ramps[rl->n];
+    }
+
+void ramps_forget(lua_State *L, ud_t *ud)
+/* called by freeuserdata() for objects marked as 'ramped' */
+    {
+    size_t i = 0;
+    ramplist_t *rl = RAMPLIST(ud->parent_ud);
+    (void)L;
+    if(!rl) return;
+    while(i < rl->n)
+        {
+        if(rl->ramps[i].ud == ud) { delramp(rl, i); continue; }
+        if(rl->ramps[i].attach_ud == ud) rl->ramps[i].attach_ud = NULL;
+        i++;
+        }
+    }
+
+void ramps_free(lua_State *L, ud_t *context_ud)
+/* called by freecontext(), after its children have been released */
+    {
+    ramplist_t *rl = RAMPLIST(context_ud);
+    if(!rl) return;
+    if(rl->ramps) Free(L, rl->ramps);
+    Free(L, rl);
+    RAMPLIST(context_ud) = NULL;
+    }
+
+/*------------------------------------------------------------------------------*
+ | Target access                                                                |
+ *------------------------------------------------------------------------------*/
+
+static void *testtarget(lua_State *L, int arg, ud_t **udp, int *target)
+    {
+    void *obj;
+    if((obj = testsource(L, arg, udp))) { *target = RAMP_SOURCE; return obj; }
+    if((obj = testlistener(L, arg, udp))) { *target = RAMP_LISTENER; return obj; }
+    if((obj = testeffect(L, arg, udp))) { *target = RAMP_EFFECT; return obj; }
+    if((obj = testfilter(L, arg, udp))) { *target = RAMP_FILTER; return obj; }
+    if((obj = testauxslot(L, arg, udp))) { *target = RAMP_AUXSLOT; return obj; }
+    luaL_argerror(L, arg, "source, listener, effect, filter or auxslot expected");
+    return NULL;
+    }
+
+static ALenum checkparam(lua_State *L, int arg, int target, ud_t *ud)
+    {
+    switch(target)
+        {
+        case RAMP_EFFECT: return checkeffectparam(L, arg, ud);
+        case RAMP_FILTER: return checkfilterparam(L, arg, ud);
+        case RAMP_AUXSLOT: return checkeffectslotparam(L, arg);
+        default: break;
+        }
+    return checkalparam(L, arg);
+    }
+
+static int checkpfns(lua_State *L, int target, ud_t *ud, int n)
+    {
+    switch(target)
+        {
+        case RAMP_EFFECT:
+            CheckDevicePfn(L, ud, Effectf);
+            CheckDevicePfn(L, ud, Effectfv);
+            CheckDevicePfn(L, ud, GetEffectf);
+            CheckDevicePfn(L, ud, GetEffectfv);
+            break;
+        case RAMP_FILTER:
+            CheckDevicePfn(L, ud, Filterf);
+            CheckDevicePfn(L, ud, GetFilterf);
+            if(n != 1) return luaL_argerror(L, 3, "number expected");
+            break;
+        case RAMP_AUXSLOT:
+            CheckDevicePfn(L, ud, AuxiliaryEffectSlotf);
+            CheckDevicePfn(L, ud, GetAuxiliaryEffectSlotf);
+            if(n != 1) return luaL_argerror(L, 3, "number expected");
+            break;
+        default: break;
+        }
+    return 0;
+    }
+
+static void getvalue(ramp_t *r, double val[3])
+    {
+    ALfloat v[3];
+    switch(r->target)
+        {
+        case RAMP_SOURCE:
+            if(r->n == 1) al.GetSourcef(r->name, r->param, v); else al.GetSourcefv(r->name, r->param, v);
+            break;
+        case RAMP_LISTENER:
+            if(r->n == 1) al.GetListenerf(r->param, v); else al.GetListenerfv(r->param, v);
+            break;
+        case RAMP_EFFECT:
+            if(r->n == 1) r->ud->ddt->GetEffectf(r->name, r->param, v);
+            else r->ud->ddt->GetEffectfv(r->name, r->param, v);
+            break;
+        case RAMP_FILTER:
+            r->ud->ddt->GetFilterf(r->name, r->param, v);
+            break;
+        case RAMP_AUXSLOT:
+            r->ud->ddt->GetAuxiliaryEffectSlotf(r->name, r->param, v);
+            break;
+        default: return;
+        }
+    val[0] = v[0];
+    if(r->n == 3) { val[1] = v[1]; val[2] = v[2]; }
+    }
+
+static void setvalue(ramp_t *r, const double val[3])
+    {
+    ALfloat v[3];
+    v[0] = val[0];
+    if(r->n == 3) { v[1] = val[1]; v[2] = val[2]; }
+    switch(r->target)
+        {
+        case RAMP_SOURCE:
+            if(r->n == 1) al.Sourcef(r->name, r->param, v[0]); else al.Sourcefv(r->name, r->param, v);
+            if(r->param == AL_POSITION) spatial_position(r->ud, v);
+            if(IsShadowed(r->ud)) shadow_store(r->ud, r->param, v);
+            break;
+        case RAMP_LISTENER:
+            if(r->n == 1) al.Listenerf(r->param, v[0]); else al.Listenerfv(r->param, v);
+            if(r->param == AL_POSITION) spatial_listener(r->context_ud, v);
+            if(IsShadowed(r->ud)) shadow_store(r->ud, r->param, v);
+            break;
+        case RAMP_EFFECT:
+            if(r->n == 1) r->ud->ddt->Effectf(r->name, r->param, v[0]);
+            else r->ud->ddt->Effectfv(r->name, r->param, v);
+            /* effect parameters are copied into the slot only when the effect is loaded */
+            if(r->attach_ud)
+                r->ud->ddt->AuxiliaryEffectSloti(r->attach, AL_EFFECTSLOT_EFFECT, r->name);
+            break;
+        case RAMP_FILTER:
+            r->ud->ddt->Filterf(r->name, r->param, v[0]);
+            /* ditto for filters, which are copied when attached to the source */
+            if(r->attach_ud)
+                al.Sourcei(r->attach, AL_DIRECT_FILTER, r->name);
+            break;
+        case RAMP_AUXSLOT:
+            r->ud->ddt->AuxiliaryEffectSlotf(r->name, r->param, v[0]);
+            break;
+        default: return;
+        }
+    }
+
+static double interpolate(int curve, double a, double b, double t)
+    {
+    switch(curve)
+        {
+        case NONAL_CURVE_EXPONENTIAL: return a * pow(b/a, t);
+        case NONAL_CURVE_SMOOTH: t = t*t*(3.0 - 2.0*t); break;
+        default: break;
+        }
+    return a + (b - a)*t;
+    }
+
+/*------------------------------------------------------------------------------*
+ | Lua functions                                                                |
+ *------------------------------------------------------------------------------*/
+
+void ramps_add(lua_State *L, ud_t *ud, int target, ALenum param, int n, const double from[3],
+                const double to[3], double duration, int curve, ud_t *attach_ud)
+/* schedules a ramp (replacing any ramp on the same object and parameter) */
+    {
+    int i;
+    ramp_t *r = NULL;
+    ramplist_t *rl = RAMPLIST(ud->parent_ud);
+    if(!rl)
+        rl = RAMPLIST(ud->parent_ud) = (ramplist_t*)Malloc(L, sizeof(ramplist_t));
+    else
+        r = searchramp(rl, ud, param);
+    if(!r) r = newramp(L, rl);
+    r->ud = ud;
+    r->context_ud = ud->parent_ud;
+    r->name = target == RAMP_LISTENER ? 0 : ((object_t*)ud->handle)->name;
+    r->param = param;
+    r->target = target;
+    r->curve = curve;
+    r->n = n;
+    r->duration = duration;
+    r->elapsed = 0;
+    r->attach_ud = attach_ud;
+    r->attach = attach_ud ? ((object_t*)attach_ud->handle)->name : 0;
+    for(i = 0; i < n; i++)
+        { r->from[i] = from[i]; r->to[i] = to[i]; }
+    MarkRamped(ud);
+    if(attach_ud) MarkRamped(attach_ud);
+    }
+
+int ramps_start(lua_State *L)
+/* ramp(object, param, value, duration, [curve], [from], [attachto]) */
+    {
+    int err, target, i, n;
+    ud_t *ud, *attach_ud = NULL;
+    ramp_t tmp;
+    ALfloat val[3];
+    double to[3], from[3];
+    context_t old_context;
+    ALenum param;
+    double duration;
+    int curve;
+
+    testtarget(L, 1, &ud, &target);
+    param = checkparam(L, 2, target, ud);
+    duration = luaL_checknumber(L, 4);
+    curve = testcurve(L, 5, &err);
+    if(lua_type(L, 3) == LUA_TTABLE)
+        { checkfloat3(L, 3, val); n = 3; }
+    else
+        { val[0] = luaL_checknumber(L, 3); n = 1; }
+    for(i = 0; i < n; i++) to[i] = val[i];
+    if(duration < 0)
+        return luaL_argerror(L, 4, errstring(ERR_VALUE));
+    if(err == ERR_NOTPRESENT)
+        curve = NONAL_CURVE_LINEAR;
+    else if(err)
+        return luaL_argerror(L, 5, errstring(err));
+    if(!lua_isnoneornil(L, 7))
+        {
+        if(target == RAMP_EFFECT)
+            checkauxslot(L, 7, &attach_ud);
+        else if(target == RAMP_FILTER)
+            checksource(L, 7, &attach_ud);
+        else
+            return luaL_argerror(L, 7, "unexpected argument");
+        if(attach_ud->parent_ud != ud->parent_ud)
+            return luaL_argerror(L, 7, "object belongs to another context");
+        if(target == RAMP_EFFECT) CheckDevicePfn(L, ud, AuxiliaryEffectSloti);
+        }
+    checkpfns(L, target, ud, n);
+
+    if(lua_isnoneornil(L, 6))
+        {
+        /* start from the current value */
+        tmp.ud = ud;
+        tmp.target = target;
+        tmp.name = target == RAMP_LISTENER ? 0 : ((object_t*)ud->handle)->name;
+        tmp.param = param;
+        tmp.n = n;
+        old_context = current_context(L);
+        make_context_current(L, ud->context);
+        getvalue(&tmp, from);
+        CheckErrorRestoreAl(L, old_context);
+        make_context_current(L, old_context);
+        }
+    else
+        {
+        if(n == 3) checkfloat3(L, 6, val);
+        else val[0] = luaL_checknumber(L, 6);
+        for(i = 0; i < n; i++) from[i] = val[i];
+        }
+
+    if(curve == NONAL_CURVE_EXPONENTIAL)
+        {
+        for(i = 0; i < n; i++)
+            if(from[i] <= 0 || to[i] <= 0)
+                return luaL_argerror(L, 5, "exponential ramps need positive values");
+        }
+    ramps_add(L, ud, target, param, n, from, to, duration, curve, attach_ud);
+    return 0;
+    }
+
+int ramps_cancel(lua_State *L)
+/* count = cancel_ramps(object, [param]) */
+    {
+    ud_t *ud;
+    ramplist_t *rl;
+    int target, count = 0;
+    size_t i = 0;
+    ALenum param = 0;
+    testtarget(L, 1, &ud, &target);
+    if(!lua_isnoneornil(L, 2))
+        param = checkparam(L, 2, target, ud);
+    rl = RAMPLIST(ud->parent_ud);
+    while(rl && i < rl->n)
+        {
+        if(rl->ramps[i].ud == ud && (param == 0 || rl->ramps[i].param == param))
+            { delramp(rl, i); count++; continue; }
+        i++;
+        }
+    lua_pushinteger(L, count);
+    return 1;
+    }
+
+int ramps_tick(lua_State *L)
+/* active = tick(context, dt) */
+    {
+    ud_t *ud;
+    ramp_t *r;
+    ALenum ec;
+    size_t i = 0;
+    int j, window, active = 0;
+    double t, val[3];
+    ramplist_t *rl;
+    context_t context = checkcontext(L, 1, &ud);
+    double dt = luaL_checknumber(L, 2);
+    context_t old_context = alc.GetCurrentContext();
+    TRACE_CALL_START;
+    if(dt < 0)
+        return luaL_argerror(L, 2, errstring(ERR_VALUE));
+    rl = RAMPLIST(ud);
+    if(!rl || rl->n == 0)
+        { lua_pushinteger(L, 0); return 1; }
+    if(old_context != context) make_context_current(L, context);
+    window = begin_deferred(ud);
+    while(i < rl->n)
+        {
+        r = &rl->ramps[i];
+        r->elapsed += dt;
+        t = (r->duration > 0) ? r->elapsed/r->duration : 1.0;
+        if(t > 1.0) t = 1.0;
+        for(j = 0; j < r->n; j++)
+            val[j] = (t < 1.0) ? interpolate(r->curve, r->from[j], r->to[j], t) : r->to[j];
+        setvalue(r, val);
+        if(t >= 1.0) { delramp(rl, i); continue; }
+        active++;
+        i++;
+        }
+    end_deferred(ud, window);
+    ec = al.GetError(); /* of the ticked context, before it is switched */
+    if(old_context != context)
+        {
+        if(old_context) make_context_current(L, old_context);
+        else set_current_context(NULL);
+        }
+    TRACE_CALL_STOP("tick", context, active);
+    if(ec) { pushalerror(L, ec); return lua_error(L); }
+    lua_pushinteger(L, active);
+    return 1;
+    }
+
+static const struct luaL_Reg Functions[] =
+    {
+        { "ramp", ramps_start },
+        { "cancel_ramps", ramps_cancel },
+        { "tick", ramps_tick },
+        { NULL, NULL } /* sentinel */
+    };
+
+void moonal_open_automation(lua_State *L)
+    {
+    luaL_setfuncs(L, Functions, 0);
+    }
+
+
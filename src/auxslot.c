@@ -25,10 +25,26 @@
 
 #include "internal.h"
 
+typedef struct {
+    ud_t *partner_ud;   /* the other slot of an A/B pair (NULL if not paired) */
+    int active;         /* 1 if this is the audible slot of the pair */
+    ALfloat gain;       /* nominal gain of the pair */
+} slotinfo_t;
+
+#define SLOTINFO(ud) ((slotinfo_t*)(ud)->info)
+
+static void unpair(ud_t *ud)
+    {
+    if(!ud->info || !SLOTINFO(ud)->partner_ud) return;
+    SLOTINFO(SLOTINFO(ud)->partner_ud)->partner_ud = NULL;
+    SLOTINFO(ud)->partner_ud = NULL;
+    }
+
 static int freeauxslot(lua_State *L, ud_t *ud)
     {
     auxslot_t auxslot = (auxslot_t)ud->handle;
     LPALDELETEAUXILIARYEFFECTSLOTS DeleteAuxiliaryEffectSlots = ud->ddt->DeleteAuxiliaryEffectSlots;
+    if(IsValid(ud)) unpair(ud);
     if(!freeuserdata(L, ud)) return 0;
     TRACE_DELETE(auxslot, "auxslot");
     DeleteAuxiliaryEffectSlots(1, &auxslot->name);
@@ -76,7 +92,7 @@ static int FuncName(lua_State *L, auxslot_t auxslot)    \
     {                                                   \
     ALint name;                                         \
     what##_t obj;                                       \
-    ud_t *ud = userdata(auxslot);                       \
+    ud_t *ud = userdata(L, auxslot);                       \
     CheckDevicePfn(L, ud, GetAuxiliaryEffectSloti);     \
     ud->ddt->GetAuxiliaryEffectSloti(auxslot->name, param, &name);\
     CheckErrorAl(L);                                    \
@@ -95,7 +111,7 @@ static int FuncName(lua_State *L, auxslot_t auxslot)    \
     {                                                   \
     ALint name;                                         \
     what##_t obj;                                       \
-    ud_t *ud = userdata(auxslot);                       \
+    ud_t *ud = userdata(L, auxslot);                       \
     CheckDevicePfn(L, ud, AuxiliaryEffectSloti);        \
     obj = test##what(L, 3, NULL);                       \
     name = obj ? obj->name : 0;                         \
@@ -113,7 +129,7 @@ SET_OBJECT_FUNC(SetEffect, AL_EFFECTSLOT_EFFECT, effect)
 static int GetBoolean(lua_State *L, auxslot_t auxslot, ALenum param)
     {
     ALint val;
-    ud_t *ud = userdata(auxslot);
+    ud_t *ud = userdata(L, auxslot);
     CheckDevicePfn(L, ud, AuxiliaryEffectSloti);
     ud->ddt->GetAuxiliaryEffectSloti(auxslot->name, param, &val);
     CheckErrorAl(L);
@@ -124,7 +140,7 @@ static int GetBoolean(lua_State *L, auxslot_t auxslot, ALenum param)
 static int SetBoolean(lua_State *L, auxslot_t auxslot, ALenum param)
     {
     ALint val;
-    ud_t *ud = userdata(auxslot);
+    ud_t *ud = userdata(L, auxslot);
     val = checkboolean(L, 3);
     CheckDevicePfn(L, ud, AuxiliaryEffectSloti);
     ud->ddt->AuxiliaryEffectSloti(auxslot->name, param, val);
@@ -135,7 +151,7 @@ static int SetBoolean(lua_State *L, auxslot_t auxslot, ALenum param)
 static int GetFloat(lua_State *L, auxslot_t auxslot, ALenum param)
     {
     ALfloat val;
-    ud_t *ud = userdata(auxslot);
+    ud_t *ud = userdata(L, auxslot);
     CheckDevicePfn(L, ud, AuxiliaryEffectSlotf);
     ud->ddt->GetAuxiliaryEffectSlotf(auxslot->name, param, &val);
     CheckErrorAl(L);
@@ -146,7 +162,7 @@ static int GetFloat(lua_State *L, auxslot_t auxslot, ALenum param)
 static int SetFloat(lua_State *L, auxslot_t auxslot, ALenum param)
     {
     ALfloat val;
-    ud_t *ud = userdata(auxslot);
+    ud_t *ud = userdata(L, auxslot);
     val = luaL_checknumber(L, 3);
     CheckDevicePfn(L, ud, AuxiliaryEffectSlotf);
     ud->ddt->AuxiliaryEffectSlotf(auxslot->name, param, val);
@@ -157,7 +173,7 @@ static int SetFloat(lua_State *L, auxslot_t auxslot, ALenum param)
 static int GetAuxslot(lua_State *L)
     {
     auxslot_t auxslot = checkauxslot(L, 1, NULL);
-    ALenum param = checkalparam(L, 2);
+    ALenum param = checkeffectslotparam(L, 2);
     switch(param)
         {
         case AL_EFFECTSLOT_GAIN:
@@ -174,7 +190,7 @@ static int GetAuxslot(lua_State *L)
 static int SetAuxslot(lua_State *L)
     {
     auxslot_t auxslot = checkauxslot(L, 1, NULL);
-    ALenum param = checkalparam(L, 2);
+    ALenum param = checkeffectslotparam(L, 2);
     switch(param)
         {
         case AL_EFFECTSLOT_GAIN:
@@ -188,6 +204,107 @@ static int SetAuxslot(lua_State *L)
     return 0;
     }
 
+/*------------------------------------------------------------------------------*
+ | A/B pairs                                                                    |
+ *------------------------------------------------------------------------------*/
+
+/* Two slots fed by the same sources (on two different sends), of which only one
+ * is audible at any time. A new effect is loaded into the silent slot, and the
+ * slot gains are then crossfaded by the automation engine (see automation.c),
+ * so that the reconfiguration of the effect state stays off the audible path.
+ */
+
+static int PairAuxslots(lua_State *L)
+    {
+    ud_t *ud1, *ud2;
+    auxslot_t auxslot1 = checkauxslot(L, 1, &ud1);
+    auxslot_t auxslot2 = checkauxslot(L, 2, &ud2);
+    ALfloat gain = luaL_optnumber(L, 3, 1.0);
+    if(ud1 == ud2)
+        return luaL_argerror(L, 2, "cannot pair an auxslot with itself");
+    if(ud1->context != ud2->context)
+        return luaL_argerror(L, 2, "auxslots belong to different contexts");
+    CheckDevicePfn(L, ud1, AuxiliaryEffectSlotf);
+    if(!ud1->info) ud1->info = Malloc(L, sizeof(slotinfo_t));
+    if(!ud2->info) ud2->info = Malloc(L, sizeof(slotinfo_t));
+    unpair(ud1);
+    unpair(ud2);
+    ud1->ddt->AuxiliaryEffectSlotf(auxslot1->name, AL_EFFECTSLOT_GAIN, gain);
+    ud2->ddt->AuxiliaryEffectSlotf(auxslot2->name, AL_EFFECTSLOT_GAIN, 0.0f);
+    CheckErrorAl(L);
+    SLOTINFO(ud1)->partner_ud = ud2;
+    SLOTINFO(ud1)->active = 1;
+    SLOTINFO(ud1)->gain = gain;
+    SLOTINFO(ud2)->partner_ud = ud1;
+    SLOTINFO(ud2)->active = 0;
+    SLOTINFO(ud2)->gain = gain;
+    return 0;
+    }
+
+static int Crossfade(lua_State *L)
+    {
+    int err, window;
+    ud_t *ud, *active_ud, *idle_ud;
+    auxslot_t idle;
+    ALfloat gain;
+    double from[3], to[3];
+    context_t old_context;
+    auxslot_t auxslot = checkauxslot(L, 1, &ud);
+    effect_t effect = testeffect(L, 2, NULL);
+    double duration = luaL_checknumber(L, 3);
+    int curve = testcurve(L, 4, &err);
+    TRACE_CALL_START;
+    (void)auxslot;
+    if(err == ERR_NOTPRESENT)
+        curve = NONAL_CURVE_LINEAR;
+    else if(err)
+        return luaL_argerror(L, 4, errstring(err));
+    if(curve == NONAL_CURVE_EXPONENTIAL)
+        return luaL_argerror(L, 4, "exponential curves cannot fade to or from silence");
+    if(duration < 0)
+        return luaL_argerror(L, 3, errstring(ERR_VALUE));
+    if(!ud->info || !SLOTINFO(ud)->partner_ud)
+        return luaL_argerror(L, 1, "auxslot is not paired");
+    CheckDevicePfn(L, ud, AuxiliaryEffectSloti);
+    CheckDevicePfn(L, ud, AuxiliaryEffectSlotf);
+    CheckDevicePfn(L, ud, GetAuxiliaryEffectSlotf);
+    active_ud = SLOTINFO(ud)->active ? ud : SLOTINFO(ud)->partner_ud;
+    idle_ud = SLOTINFO(active_ud)->partner_ud;
+    idle = (auxslot_t)idle_ud->handle;
+
+    old_context = current_context(L);
+    make_context_current(L, ud->context);
+    ud->ddt->GetAuxiliaryEffectSlotf(((auxslot_t)active_ud->handle)->name, AL_EFFECTSLOT_GAIN, &gain);
+    window = begin_deferred(userdata(L, ud->context));
+    /* If a previous crossfade is still in progress, its tail is cut here */
+    ud->ddt->AuxiliaryEffectSlotf(idle->name, AL_EFFECTSLOT_GAIN, 0.0f);
+    ud->ddt->AuxiliaryEffectSloti(idle->name, AL_EFFECTSLOT_EFFECT, effect ? effect->name : 0);
+    end_deferred(userdata(L, ud->context), window);
+    CheckErrorRestoreAl(L, old_context);
+    make_context_current(L, old_context);
+
+    from[0] = gain; to[0] = 0;
+    ramps_add(L, active_ud, RAMP_AUXSLOT, AL_EFFECTSLOT_GAIN, 1, from, to, duration, curve, NULL);
+    from[0] = 0; to[0] = SLOTINFO(idle_ud)->gain;
+    ramps_add(L, idle_ud, RAMP_AUXSLOT, AL_EFFECTSLOT_GAIN, 1, from, to, duration, curve, NULL);
+    SLOTINFO(active_ud)->active = 0;
+    SLOTINFO(idle_ud)->active = 1;
+    TRACE_CALL_STOP("crossfade", idle, 0);
+    pushauxslot(L, idle);
+    return 1;
+    }
+
+static int ActiveAuxslot(lua_State *L)
+    {
+    ud_t *ud;
+    auxslot_t auxslot = checkauxslot(L, 1, &ud);
+    if(!ud->info || !SLOTINFO(ud)->partner_ud)
+        return luaL_argerror(L, 1, "auxslot is not paired");
+    if(!SLOTINFO(ud)->active) auxslot = (auxslot_t)SLOTINFO(ud)->partner_ud->handle;
+    pushauxslot(L, auxslot);
+    return 1;
+    }
+
 RAW_FUNC(auxslot)
 TYPE_FUNC(auxslot)
 PARENT_FUNC(auxslot)
@@ -201,6 +318,10 @@ static const struct luaL_Reg Methods[] =
         { "delete", Delete },
         { "get", GetAuxslot },
         { "set", SetAuxslot },
+        { "ramp", ramps_start },
+        { "cancel_ramps", ramps_cancel },
+        { "crossfade", Crossfade },
+        { "active", ActiveAuxslot },
         { NULL, NULL } /* sentinel */
     };
 
@@ -216,6 +337,9 @@ static const struct luaL_Reg Functions[] =
         { "delete_auxslot", Delete },
         { "auxslot_get", GetAuxslot },
         { "auxslot_set", SetAuxslot },
+        { "pair_auxslots", PairAuxslots },
+        { "auxslot_crossfade", Crossfade },
+        { "active_auxslot", ActiveAuxslot },
         { NULL, NULL } /* sentinel */
     };
 
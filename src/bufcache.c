@@ -0,0 +1,297 @@
+/* The MIT License (MIT)
+ *
+ * Copyright (c) 2018 Stefano Trettel
+ *
+ * Software repository: MoonAL, https://github.com/stetre/moonal
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+
+#include "internal.h"
+
+/*------------------------------------------------------------------------------*
+ | Content-addressed buffer cache                                               |
+ *------------------------------------------------------------------------------*/
+
+/* buffer_data_cached() looks up the content (format, frequency and data) in a per-context
+ * cache (referenced by the context's info, see ctxinfo_t) and returns the buffer that
+ * already holds it, if any, instead of creating a new one. Entries are keyed by a 64-bit
+ * hash of the data (XXH64) together with its format, frequency and size, are kept in a
+ * red-black tree, and are reference counted: the buffer is deleted when the last reference
+ * is released with release_buffer().
+ */
+
+struct moonal_cacheentry_s {
+    RB_ENTRY(moonal_cacheentry_s) entry;
+    uint64_t hash;  /* search key: hash, format, freq, size */
+    ALenum format;
+    ALsizei freq;
+    size_t size;
+    ud_t *ud;       /* the buffer */
+    int refs;
+};
+
+static int cmp(cacheentry_t *e1, cacheentry_t *e2)
+    {
+    if(e1->hash != e2->hash) return e1->hash < e2->hash ? -1 : 1;
+    if(e1->format != e2->format) return e1->format < e2->format ? -1 : 1;
+    if(e1->freq != e2->freq) return e1->freq < e2->freq ? -1 : 1;
+    return (e1->size < e2->size ? -1 : e1->size > e2->size);
+    }
+
+RB_HEAD(cachetree_s, moonal_cacheentry_s);
+RB_PROTOTYPE_STATIC(cachetree_s, moonal_cacheentry_s, entry, cmp)
+RB_GENERATE_STATIC(cachetree_s, moonal_cacheentry_s, entry, cmp)
+
+struct moonal_bufcache_s {
+    struct cachetree_s head;
+    size_t entries;
+    size_t bytes;       /* bytes stored in cached buffers */
+    size_t saved;       /* bytes not uploaded thanks to cache hits */
+    uint64_t hits;
+    uint64_t misses;
+};
+
+#define BUFCACHE(context_ud) (CTXINFO(context_ud)->bufcache)
+
+/*------------------------------------------------------------------------------*
+ | XXH64                                                                        |
+ *------------------------------------------------------------------------------*/
+
+#define P1 0x9E3779B185EBCA87ULL
+#define P2 0xC2B2AE3D27D4EB4FULL
+#define P3 0x165667B19E3779F9ULL
+#define P4 0x85EBCA77C2B2AE63ULL
+#define P5 0x27D4EB2F165667C5ULL
+
+#define ROTL(x, r) (((x) << (r)) | ((x) >> (64 - (r))))
+
+static uint64_t read64(const unsigned char *p)
+    { uint64_t v; memcpy(&v, p, 8); return v; } /* little-endian hosts only */
+
+static uint32_t read32(const unsigned char *p)
+    { uint32_t v; memcpy(&v, p, 4); return v; }
+
+static uint64_t round64(uint64_t acc, uint64_t input)
+    {
+    acc += input * P2;
+    acc = ROTL(acc, 31);
+    return acc * P1;
+    }
+
+static uint64_t merge64(uint64_t acc, uint64_t val)
+    {
+    acc ^= round64(0, val);
+    return acc * P1 + P4;
+    }
+
+static uint64_t xxh64(const void *data, size_t len, uint64_t seed)
+    {
+    const unsigned char *p = (const unsigned char*)data;
+    const unsigned char *end = p + len;
+    uint64_t h, v1, v2, v3, v4;
+    if(len >= 32)
+        {
+        v1 = seed + P1 + P2;
+        v2 = seed + P2;
+        v3 = seed;
+        v4 = seed - P1;
+        do {
+            v1 = round64(v1, read64(p)); p += 8;
+            v2 = round64(v2, read64(p)); p += 8;
+            v3 = round64(v3, read64(p)); p += 8;
+            v4 = round64(v4, read64(p)); p += 8;
+        } while(p + 32 <= end);
+        h = ROTL(v1, 1) + ROTL(v2, 7) + ROTL(v3, 12) + ROTL(v4, 18);
+        h = merge64(h, v1);
+        h = merge64(h, v2);
+        h = merge64(h, v3);
+        h = merge64(h, v4);
+        }
+    else
+        h = seed + P5;
+    h += (uint64_t)len;
+    for( ; p + 8 <= end; p += 8)
+        {
+        h ^= round64(0, read64(p));
+        h = ROTL(h, 27) * P1 + P4;
+        }
+    if(p + 4 <= end)
+        {
+        h ^= (uint64_t)read32(p) * P1;
+        h = ROTL(h, 23) * P2 + P3;
+        p += 4;
+        }
+    for( ; p < end; p++)
+        {
+        h ^= (*p) * P5;
+        h = ROTL(h, 11) * P1;
+        }
+    h ^= h >> 33;
+    h *= P2;
+    h ^= h >> 29;
+    h *= P3;
+    h ^= h >> 32;
+    return h;
+    }
+
+/*------------------------------------------------------------------------------*
+ | Entries                                                                      |
+ *------------------------------------------------------------------------------*/
+
+static void delentry(lua_State *L, bufcache_t *cache, cacheentry_t *e)
+    {
+    RB_REMOVE(cachetree_s, &cache->head, e);
+    cache->entries--;
+    cache->bytes -= e->size;
+    BUFINFO(e->ud)->cached = NULL;
+    CancelCached(e->ud);
+    Free(L, e);
+    }
+
+void bufcache_forget(lua_State *L, ud_t *ud)
+/* called by freeuserdata() for cached buffers, and when their data is replaced */
+    {
+    cacheentry_t *e = BUFINFO(ud)->cached;
+    if(e) delentry(L, BUFCACHE(ud->parent_ud), e);
+    }
+
+void bufcache_free(lua_State *L, ud_t *context_ud)
+/* called by freecontext(), after its buffers have been released */
+    {
+    bufcache_t *cache = BUFCACHE(context_ud);
+    if(!cache) return;
+    /* the tree is empty, since the entries are removed with their buffers */
+    Free(L, cache);
+    BUFCACHE(context_ud) = NULL;
+    }
+
+/*------------------------------------------------------------------------------*
+ | Lua functions                                                                |
+ *------------------------------------------------------------------------------*/
+
+int bufcache_data(lua_State *L)
+/* buffer = buffer_data_cached(context, format, data, freq) */
+    {
+    size_t size;
+    ud_t *context_ud, *ud;
+    ALuint name;
+    ALenum ec;
+    bufcache_t *cache;
+    cacheentry_t key, *e;
+    context_t old_context = current_context(L);
+    context_t context = checkcontext(L, 1, &context_ud);
+    ALenum format = checkformat(L, 2);
+    const char* data = luaL_checklstring(L, 3, &size);
+    ALsizei freq = luaL_checkinteger(L, 4);
+    TRACE_CALL_START;
+
+    cache = BUFCACHE(context_ud);
+    if(!cache)
+        {
+        cache = BUFCACHE(context_ud) = (bufcache_t*)Malloc(L, sizeof(bufcache_t));
+        RB_INIT(&cache->head);
+        }
+    key.hash = xxh64(data, size, 0);
+    key.format = format;
+    key.freq = freq;
+    key.size = size;
+    e = RB_FIND(cachetree_s, &cache->head, &key);
+    if(e)
+        {
+        e->refs++;
+        cache->hits++;
+        cache->saved += size;
+        TRACE_CALL_STOP("buffer_data_cached", e->ud->handle, 0);
+        return pushbuffer(L, e->ud->handle);
+        }
+
+    make_context_current(L, context);
+    al.GenBuffers(1, &name);
+    CheckErrorRestoreAl(L, old_context);
+    ud = userdata(L, newbuffer(L, context_ud, name));
+    ec = buffer_upload(ud, format, data, size, freq);
+    make_context_current(L, old_context);
+    if(ec)
+        {
+        ud->destructor(L, ud);
+        pushalerror(L, ec);
+        return lua_error(L);
+        }
+    e = (cacheentry_t*)Malloc(L, sizeof(cacheentry_t));
+    *e = key;
+    e->ud = ud;
+    e->refs = 1;
+    RB_INSERT(cachetree_s, &cache->head, e);
+    cache->entries++;
+    cache->bytes += size;
+    cache->misses++;
+    BUFINFO(ud)->cached = e;
+    MarkCached(ud);
+    TRACE_CALL_STOP("buffer_data_cached", ud->handle, size);
+    return 1;
+    }
+
+int bufcache_release(lua_State *L)
+/* refs = release_buffer(buffer) */
+    {
+    ud_t *ud;
+    cacheentry_t *e;
+    checkbuffer(L, 1, &ud);
+    e = BUFINFO(ud)->cached;
+    if(!e || --e->refs == 0)
+        {
+        ud->destructor(L, ud); /* also removes the entry */
+        lua_pushinteger(L, 0);
+        return 1;
+        }
+    lua_pushinteger(L, e->refs);
+    return 1;
+    }
+
+int bufcache_stats(lua_State *L)
+/* stats = buffer_cache_stats(context) */
+    {
+    ud_t *ud;
+    bufcache_t *cache;
+    checkcontext(L, 1, &ud);
+    cache = BUFCACHE(ud);
+    lua_newtable(L);
+    lua_pushinteger(L, cache ? cache->entries : 0); lua_setfield(L, -2, "entries");
+    lua_pushinteger(L, cache ? cache->bytes : 0); lua_setfield(L, -2, "bytes");
+    lua_pushinteger(L, cache ? cache->saved : 0); lua_setfield(L, -2, "bytes_saved");
+    lua_pushinteger(L, cache ? cache->hits : 0); lua_setfield(L, -2, "hits");
+    lua_pushinteger(L, cache ? cache->misses : 0); lua_setfield(L, -2, "misses");
+    return 1;
+    }
+
+static const struct luaL_Reg Functions[] =
+    {
+        { "buffer_data_cached", bufcache_data },
+        { "release_buffer", bufcache_release },
+        { "buffer_cache_stats", bufcache_stats },
+        { NULL, NULL } /* sentinel */
+    };
+
+void moonal_open_bufcache(lua_State *L)
+    {
+    luaL_setfuncs(L, Functions, 0);
+    }
+
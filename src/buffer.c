@@ -28,7 +28,11 @@
 static int freebuffer(lua_State *L, ud_t *ud)
     {
     buffer_t buffer = (buffer_t)ud->handle;
+    bufinfo_t *info = IsValid(ud) ? BUFINFO(ud) : NULL;
+    size_t size = info ? info->size : 0;
+    freechildren(L, MAPPING_MT, ud);
     if(!freeuserdata(L, ud)) return 0;
+    stats_buffer_bytes(size, 0);
     TRACE_DELETE(buffer, "buffer");
     al.DeleteBuffers(1, &buffer->name);
     Free(L, buffer);
@@ -36,52 +40,124 @@ static int freebuffer(lua_State *L, ud_t *ud)
     return 0;
     }
 
-static int Create(lua_State *L)
+buffer_t newbuffer(lua_State *L, ud_t *context_ud, ALuint name)
+/* Binds the AL buffer 'name' to a new buffer object child of context_ud, and pushes
+ * it on the stack. */
     {
-    ALuint name;
-    buffer_t buffer;
-    ud_t *ud, *context_ud;
-    context_t old_context = current_context(L);
-    context_t context = checkcontext(L, 1, &context_ud);
-    
-    al.GenBuffers(1, &name);
-    CheckErrorRestoreAl(L, old_context);
-
-    buffer = (object_t*)MallocNoErr(L, sizeof(object_t));
+    ud_t *ud;
+    buffer_t buffer = (object_t*)MallocNoErr(L, sizeof(object_t));
     if(!buffer)
         {
-        make_context_current(L, old_context);
         al.DeleteBuffers(1, &name);
-        return luaL_error(L, errstring(ERR_MEMORY));
+        luaL_error(L, errstring(ERR_MEMORY));
+        return NULL;
         }
-    
     buffer->name = name;
-    
     ud = newuserdata(L, buffer, BUFFER_MT);
-    ud->context = context;
+    ud->context = (context_t)context_ud->handle;
     ud->device = context_ud->device;
     ud->parent_ud = context_ud;
     ud->ddt = context_ud->ddt;
     ud->cdt = context_ud->cdt;
     ud->destructor = freebuffer;
+    ud->info = MallocNoErr(L, sizeof(bufinfo_t));
+    if(!ud->info)
+        { luaL_error(L, errstring(ERR_MEMORY)); return NULL; }
     TRACE_CREATE(buffer, "buffer");
+    return buffer;
+    }
+
+static int Create(lua_State *L)
+    {
+    ALuint name;
+    ud_t *context_ud;
+    context_t old_context = current_context(L);
+    (void)checkcontext(L, 1, &context_ud);
+    
+    al.GenBuffers(1, &name);
+    CheckErrorRestoreAl(L, old_context);
+    newbuffer(L, context_ud, name);
     make_context_current(L, old_context);
     return 1;
     }
 
+ALenum buffer_upload(ud_t *ud, ALenum format, const void *data, size_t size, ALsizei freq)
+/* Stores data in the buffer and keeps count of its size (the buffer's context must be
+ * current). Returns the AL error code. */
+    {
+    return buffer_storage(ud, format, data, size, freq, 0);
+    }
+
+ALenum buffer_storage(ud_t *ud, ALenum format, const void *data, size_t size, ALsizei freq, ALbitfieldSOFT flags)
+/* Same as buffer_upload(), with AL_SOFT_map_buffer storage flags (if flags is not 0,
+ * the caller must have checked that the extension is available). */
+    {
+    ALenum ec;
+    size_t oldsize;
+    bufinfo_t *info = BUFINFO(ud);
+    if(flags)
+        ud->cdt->BufferStorageSOFT(((buffer_t)ud->handle)->name, format, data, size, freq, flags);
+    else
+        al.BufferData(((buffer_t)ud->handle)->name, format, data, size, freq);
+    ec = al.GetError();
+    if(ec) return ec;
+    stats_buffer_bytes(info->size, size);
+    oldsize = info->size;
+    info->size = size;
+    info->format = format;
+    info->freq = freq;
+    if(IsManaged(ud))
+        residency_update(ud, oldsize);
+    return AL_NO_ERROR;
+    }
+
 static int BufferData(lua_State *L)
     {
     size_t size;
     ud_t *ud;
+    ALenum ec;
     buffer_t buffer = checkbuffer(L, 1, &ud);
     ALenum format = checkformat(L, 2);
     const char* data = luaL_checklstring(L, 3, &size);
     ALsizei freq = luaL_checkinteger(L, 4);
-    al.BufferData(buffer->name, format, data, size, freq);
-    CheckErrorAl(L);
+    TRACE_CALL_START;
+    if(IsCached(ud))
+        bufcache_forget(L, ud); /* its content no longer matches the key */
+    ec = buffer_upload(ud, format, data, size, freq);
+    if(ec) { pushalerror(L, ec); return lua_error(L); }
+    TRACE_CALL_STOP("buffer_data", buffer, size);
     return 0;
     }
 
+static int BufferStorage(lua_State *L)
+/* buffer_storage(buffer, format, data|size, freq, [{mapflag}]) */
+    {
+    size_t size;
+    ud_t *ud;
+    ALenum ec;
+    ALbitfieldSOFT flags;
+    const char* data = NULL;
+    buffer_t buffer = checkbuffer(L, 1, &ud);
+    ALenum format = checkformat(L, 2);
+    ALsizei freq = luaL_checkinteger(L, 4);
+    TRACE_CALL_START;
+    CheckContextPfn(L, ud, BufferStorageSOFT);
+    if(lua_type(L, 3) == LUA_TNUMBER)
+        {
+        lua_Integer n = luaL_checkinteger(L, 3);
+        if(n < 0) return luaL_argerror(L, 3, errstring(ERR_VALUE));
+        size = (size_t)n;
+        }
+    else
+        data = luaL_checklstring(L, 3, &size);
+    flags = mapping_checkflags(L, 5, 0);
+    if(IsCached(ud))
+        bufcache_forget(L, ud); /* its content no longer matches the key */
+    ec = buffer_storage(ud, format, data, size, freq, flags);
+    if(ec) { pushalerror(L, ec); return lua_error(L); }
+    TRACE_CALL_STOP("buffer_storage", buffer, size);
+    return 0;
+    }
 
 #if 0 
 /* Note: AL_SOFT_buffer_samples and AL_SOFT_buffer_sub_data are removed since v 1.17.2 */
@@ -137,7 +213,7 @@ static int IsBufferFormatSupported(lua_State *L) //NO: extension removed
     {
     ALboolean res;
     context_t context = current_context(L);
-    ud_t *ud = userdata(context);
+    ud_t *ud = userdata(L, context);
     ALenum format = checkformat(L, 1);
     CheckContextPfn(L, ud, IsBufferFormatSupportedSOFT);
     res = ud->cdt->IsBufferFormatSupportedSOFT(format);
@@ -284,8 +360,14 @@ static const struct luaL_Reg Methods[] =
         { "parent", Parent },
         { "delete", Delete },
         { "data", BufferData },
+        { "storage", BufferStorage },
+        { "map", mapping_map },
         { "get", GetBuffer },
         { "set", SetBuffer },
+        { "load_status", loader_status },
+        { "release", bufcache_release },
+        { "manage", residency_manage },
+        { "ensure_resident", residency_ensure },
         { NULL, NULL } /* sentinel */
     };
 
@@ -300,6 +382,7 @@ static const struct luaL_Reg Functions[] =
         { "create_buffer", Create},
         { "delete_buffer", Delete },
         { "buffer_data", BufferData },
+        { "buffer_storage", BufferStorage },
 //      { "buffer_sub_data", BufferSubData },
 //      { "buffer_samples", BufferSamples },
 //      { "buffer_sub_samples", BufferSubSamples },
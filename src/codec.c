@@ -0,0 +1,214 @@
+/* The MIT License (MIT)
+ *
+ * Copyright (c) 2018 Stefano Trettel
+ *
+ * Software repository: MoonAL, https://github.com/stetre/moonal
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+
+#include "internal.h"
+#include "codec.h"
+
+/*------------------------------------------------------------------------------*
+ | Compressed audio decoding                                                    |
+ *------------------------------------------------------------------------------*/
+
+/* Compressed files (FLAC, Ogg Vorbis, MP3) are decoded by the decoders in flac.c,
+ * vorbis.c and mp3.c, so that no external library is needed.
+ *
+ * The encoded data is read from a FILE* (owned by the caller), within a given range of
+ * it, so that it may be embedded in a larger file. It is decoded, a block at a time, to
+ * 16 bit PCM. Decoders use malloc() and do not touch the Lua state, so they can be used
+ * by the loader's workers (see loader.c), each decoder by one thread at a time.
+ */
+
+/*------------------------------------------------------------------------------*
+ | Input                                                                        |
+ *------------------------------------------------------------------------------*/
+
+int codec_refill(decoder_t *dec)
+/* Refills the input buffer. Returns its first byte, or -1 at the end of the data. */
+    {
+    long left;
+    dec->pos += (long)dec->inlen;
+    dec->inpos = dec->inlen = 0;
+    left = dec->length - dec->pos;
+    if(left <= 0) return -1;
+    dec->inlen = fread(dec->in, 1, left < INPUTSIZE ? (size_t)left : INPUTSIZE, dec->f);
+    if(dec->inlen == 0) return -1;
+    return dec->in[dec->inpos++];
+    }
+
+size_t codec_input(decoder_t *dec, void *dst, size_t n)
+/* Reads up to n bytes of encoded data. Returns the number of bytes read. */
+    {
+    size_t k, done = 0;
+    int c;
+    while(done < n)
+        {
+        if(dec->inpos == dec->inlen)
+            {
+            if((c = codec_refill(dec)) < 0) break;
+            dec->inpos--;
+            }
+        k = dec->inlen - dec->inpos;
+        if(k > n - done) k = n - done;
+        memcpy((unsigned char*)dst + done, dec->in + dec->inpos, k);
+        dec->inpos += k;
+        done += k;
+        }
+    return done;
+    }
+
+int codec_seek(decoder_t *dec, long pos)
+/* Moves to the given position of the encoded data. Returns 0 on success. */
+    {
+    if(pos < 0 || pos > dec->length) return -1;
+    if(pos >= dec->pos && pos <= dec->pos + (long)dec->inlen)
+        { dec->inpos = (size_t)(pos - dec->pos); return 0; }
+    if(fseek(dec->f, dec->start + pos, SEEK_SET) != 0) return -1;
+    dec->pos = pos;
+    dec->inpos = dec->inlen = 0;
+    return 0;
+    }
+
+long codec_tell(decoder_t *dec)
+    { return dec->pos + (long)dec->inpos; }
+
+short *codec_pcm(decoder_t *dec, size_t frames)
+/* Returns room for a decoded block of the given number of frames (NULL if out of memory). */
+    {
+    short *pcm;
+    if(frames > dec->maxpcm)
+        {
+        if(!(pcm = (short*)realloc(dec->pcm, frames * dec->channels * sizeof(short))))
+            return NULL;
+        dec->pcm = pcm;
+        dec->maxpcm = frames;
+        }
+    return dec->pcm;
+    }
+
+/*------------------------------------------------------------------------------*
+ | Decoders                                                                     |
+ *------------------------------------------------------------------------------*/
+
+int codec_probe(FILE *f)
+/* Checks if the data at the current position of f starts with the signature of an Ogg,
+ * FLAC or MP3 file, and leaves f where it was. */
+    {
+    unsigned char sig[4];
+    long pos = ftell(f);
+    size_t n = fread(sig, 1, 4, f);
+    if(pos < 0 || fseek(f, pos, SEEK_SET) != 0 || n < 4) return 0;
+    return memcmp(sig, "OggS", 4) == 0 || memcmp(sig, "fLaC", 4) == 0 ||
+           memcmp(sig, "ID3", 3) == 0 || (sig[0] == 0xff && (sig[1] & 0xe0) == 0xe0);
+    }
+
+decoder_t *codec_open(FILE *f, long length, ALenum *format, ALsizei *freq, size_t *size, const char **errmsg)
+/* Opens a decoder for the encoded data starting at the current position of f (and
+ * going on for length bytes, or up to the end of the file if length=-1). Sets the AL
+ * format and the frequency of the decoded data, and its size in bytes (0 if unknown).
+ * On error, returns NULL and sets *errmsg to a message with a '%s' for the file name.
+ */
+    {
+    unsigned char sig[4];
+    decoder_t *dec;
+    long start = ftell(f);
+    if(start < 0 || (length < 0 && (fseek(f, 0, SEEK_END) != 0 ||
+        (length = ftell(f) - start) < 0 || fseek(f, start, SEEK_SET) != 0)))
+        { *errmsg = "cannot seek '%s'"; return NULL; }
+    dec = (decoder_t*)calloc(1, sizeof(decoder_t));
+    if(!dec)
+        { *errmsg = CODEC_NOMEM; return NULL; }
+    dec->f = f;
+    dec->start = start;
+    dec->length = length;
+    if(codec_input(dec, sig, 4) < 4 || codec_seek(dec, 0) != 0)
+        { free(dec); *errmsg = CODEC_INVALID; return NULL; }
+    if(memcmp(sig, "fLaC", 4) == 0)
+        dec->codec = &flac_codec;
+    else if(memcmp(sig, "OggS", 4) == 0)
+        dec->codec = &vorbis_codec;
+    else
+        dec->codec = &mp3_codec;
+    if((*errmsg = dec->codec->open(dec)) != NULL)
+        { codec_close(dec); return NULL; }
+    if(dec->channels != 1 && dec->channels != 2)
+        { codec_close(dec); *errmsg = "unsupported number of channels in '%s'"; return NULL; }
+    if(dec->rate <= 0 || dec->rate > 0x7fffffff)
+        { codec_close(dec); *errmsg = "unsupported sample rate in '%s'"; return NULL; }
+    *format = dec->channels == 2 ? AL_FORMAT_STEREO16 : AL_FORMAT_MONO16;
+    *freq = (ALsizei)dec->rate;
+    /* the count of frames is only an estimate for some formats (e.g. MP3) */
+    *size = (dec->frames > 0 && dec->frames < (uint64_t)(SIZE_MAX / 4)) ?
+                (size_t)dec->frames * dec->channels * sizeof(short) : 0;
+    return dec;
+    }
+
+size_t codec_read(decoder_t *dec, void *dst, size_t size, const char **errmsg)
+/* Decodes up to size bytes (rounded down to whole frames) of PCM data into dst.
+ * Returns the number of bytes decoded. It returns 0 at the end of the data, with
+ * *errmsg set to NULL, and on error, with *errmsg set to a message with a '%s' for
+ * the file name (frames decoded before an error are returned first). */
+    {
+    size_t n, done = 0, framesize = dec->channels * sizeof(short);
+    size_t frames = size / framesize;
+    *errmsg = NULL;
+    while(done < frames)
+        {
+        if(dec->pcmpos == dec->npcm)
+            {
+            if(dec->errmsg || dec->eof) break;
+            dec->npcm = dec->pcmpos = 0;
+            if((dec->errmsg = dec->codec->decode(dec)) != NULL) break;
+            if(dec->npcm == 0) { dec->eof = 1; break; }
+            }
+        n = dec->npcm - dec->pcmpos;
+        if(n > frames - done) n = frames - done;
+        memcpy((char*)dst + done * framesize, dec->pcm + dec->pcmpos * dec->channels, n * framesize);
+        dec->pcmpos += n;
+        done += n;
+        }
+    if(done == 0) *errmsg = dec->errmsg;
+    return done * framesize;
+    }
+
+int codec_rewind(decoder_t *dec)
+/* Moves back to the start of the decoded data. Returns 0 on success, or -1 (leaving
+ * the decoder at its end, or failed) on error. */
+    {
+    dec->npcm = dec->pcmpos = 0;
+    dec->eof = 0;
+    if(dec->errmsg) return -1; /* corrupt data: it would fail again */
+    if(dec->codec->rewind(dec) != NULL)
+        { dec->eof = 1; return -1; }
+    return 0;
+    }
+
+void codec_close(decoder_t *dec)
+/* Closes the decoder (but not its file) */
+    {
+    if(dec->codec) dec->codec->close(dec);
+    free(dec->pcm);
+    free(dec);
+    }
+
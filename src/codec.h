@@ -0,0 +1,103 @@
+/* The MIT License (MIT)
+ *
+ * Copyright (c) 2018 Stefano Trettel
+ *
+ * Software repository: MoonAL, https://github.com/stetre/moonal
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/********************************************************************************
+ * Compressed audio decoding - interface between codec.c and the decoders       *
+ ********************************************************************************/
+
+#ifndef codecDEFINED
+#define codecDEFINED
+
+/* A decoder reads the encoded data from a range of a FILE*, through a small buffer
+ * (see codec_input() and codec_seek()), and decodes it one block (i.e. one FLAC frame,
+ * Vorbis packet, or MP3 frame) at a time into dec->pcm, as interleaved 16 bit samples.
+ * codec.c hands the decoded frames out to codec_read() and asks for the next block when
+ * they are exhausted.
+ *
+ * Each format is implemented by a codec_t (flac.c, vorbis.c, mp3.c), whose functions
+ * report errors by returning an error message with a '%s' for the file name.
+ */
+
+#define INPUTSIZE 4096
+
+#define CODEC_INVALID       "cannot decode '%s' (invalid or unsupported data)"
+#define CODEC_UNSUPPORTED   "cannot decode '%s' (unsupported encoding)"
+#define CODEC_CORRUPT       "corrupt data in '%s'"
+#define CODEC_TRUNCATED     "unexpected end of file '%s'"
+#define CODEC_NOMEM         "out of memory decoding '%s'"
+
+struct moonal_decoder_s {
+    const struct moonal_codec_s *codec;
+    void *state;            /* the format-specific state */
+    FILE *f;
+    long start;             /* position of the encoded data in f */
+    long length;            /* length of the encoded data */
+    long pos;               /* position of in[] in the data */
+    size_t inpos, inlen;
+    unsigned char in[INPUTSIZE];
+    int channels;           /* set by open() */
+    long rate;
+    uint64_t frames;        /* total frames, or 0 if unknown */
+    short *pcm;             /* decoded block (see codec_pcm()) */
+    size_t npcm;            /* frames in it */
+    size_t maxpcm;
+    size_t pcmpos;          /* frames already handed out */
+    const char *errmsg;     /* decoding failed */
+    int eof;
+};
+
+typedef struct moonal_codec_s {
+    const char *(*open)(decoder_t *dec);    /* parses the headers */
+    const char *(*decode)(decoder_t *dec);  /* decodes the next block, if any (npcm = 0 at the end) */
+    const char *(*rewind)(decoder_t *dec);  /* seeks back to the first block */
+    void (*close)(decoder_t *dec);
+} codec_t;
+
+/* codec.c */
+#define codec_byte(dec) ((dec)->inpos < (dec)->inlen ? (dec)->in[(dec)->inpos++] : codec_refill(dec))
+#define codec_refill moonal_codec_refill
+int codec_refill(decoder_t *dec); /* returns the next byte, or -1 at the end of the data */
+#define codec_input moonal_codec_input
+size_t codec_input(decoder_t *dec, void *dst, size_t n);
+#define codec_seek moonal_codec_seek
+int codec_seek(decoder_t *dec, long pos);
+#define codec_tell moonal_codec_tell
+long codec_tell(decoder_t *dec);
+#define codec_pcm moonal_codec_pcm
+short *codec_pcm(decoder_t *dec, size_t frames);
+
+/* flac.c */
+#define flac_codec moonal_flac_codec
+extern const codec_t flac_codec;
+
+/* vorbis.c */
+#define vorbis_codec moonal_vorbis_codec
+extern const codec_t vorbis_codec;
+
+/* mp3.c */
+#define mp3_codec moonal_mp3_codec
+extern const codec_t mp3_codec;
+
+#endif /* codecDEFINED */
@@ -32,11 +32,24 @@ context_t current_context(lua_State *L)
     return context;
     }
 
+ALCboolean set_current_context(context_t context)
+/* Makes context current for the calling thread if the implementation supports
+ * ALC_EXT_thread_local_context, otherwise for the whole process. All context switches
+ * go through here, so that Lua states running in different threads do not change
+ * each other's current context.
+ */
+    {
+    if(alc.SetThreadContext)
+        return alc.SetThreadContext(context);
+    return alc.MakeContextCurrent(context);
+    }
+
 int make_context_current(lua_State *L, context_t context)
     {
-    (void)L;
-    alc.MakeContextCurrent(context);
-    CheckErrorAlc(L, userdata(context)->device);
+    TRACE_CALL_START;
+    set_current_context(context);
+    CheckErrorAlc(L, userdata(L, context)->device);
+    TRACE_CALL_STOP("make_context_current", context, 0);
     return 0;
     }
 
@@ -50,12 +63,27 @@ static int freecontext(lua_State *L, ud_t *ud)
     {
     context_t context = (context_t)ud->handle;
     device_t device = ud->device;
+    freechildren(L, VOICEPOOL_MT, ud); /* before sources, since it owns some */
     freechildren(L, AUXSLOT_MT, ud);
     freechildren(L, FILTER_MT, ud);
     freechildren(L, EFFECT_MT, ud);
     freechildren(L, SOURCE_MT, ud);
     freechildren(L, BUFFER_MT, ud);
     freechildren(L, LISTENER_MT, ud);
+    if(ud->info)
+        {
+        spatial_free(L, ud);
+        ramps_free(L, ud);
+        virtual_free(L, ud);
+        shadow_free(L, ud);
+        loader_free(L, ud);
+        bufcache_free(L, ud);
+        residency_free(L, ud);
+        events_free(L, ud);
+        notify_free(L, ud);
+        schedule_free(L, ud);
+        telemetry_free(L, ud);
+        }
     if(!freeuserdata(L, ud)) return 0;
     TRACE_DELETE(context, "context");
     alc.DestroyContext(context);
@@ -76,7 +104,7 @@ static int CreateContext(lua_State *L)
     context = alc.CreateContext(device, attrlist);
     if(attrlist) Free(L, attrlist);
     CheckErrorAlc(L, device);
-    alc.MakeContextCurrent(context);
+    set_current_context(context);
     CheckErrorAlc(L, device);
     ud = newuserdata(L, context, CONTEXT_MT);
     ud->device = device;
@@ -85,6 +113,8 @@ static int CreateContext(lua_State *L)
     ud->destructor = freecontext;
     ud->ddt = device_ud->ddt;
     ud->cdt = getproc_context(L, context);
+    ud->info = Malloc(L, sizeof(ctxinfo_t));
+    spatial_init(L, ud);
     TRACE_CREATE(context, "context");
     return 1;
     }
@@ -120,7 +150,7 @@ static int CurrentContext(lua_State *L)
         return 1;
         }
     context = checkcontext(L, 1, &ud);
-    res = alc.MakeContextCurrent(context);
+    res = set_current_context(context);
     CheckErrorAlc(L, ud->device);
     lua_pushboolean(L, res);
     return 1;
@@ -222,6 +252,7 @@ static int GetFloat(lua_State *L, ALenum param)
 static int SetDopplerFactor(lua_State *L)
     {
     ALfloat val;
+    CheckAlPfn(L, DopplerFactor);
     val = luaL_checknumber(L, 3);
     al.DopplerFactor(val);
     return 0;
@@ -231,6 +262,7 @@ static int SetDopplerFactor(lua_State *L)
 static int SetDopplerVelocity(lua_State *L)
     {
     ALfloat val;
+    CheckAlPfn(L, DopplerVelocity);
     val = luaL_checknumber(L, 3);
     al.DopplerVelocity(val);
     return 0;
@@ -240,6 +272,7 @@ static int SetDopplerVelocity(lua_State *L)
 static int SetSpeedOfSound(lua_State *L)
     {
     ALfloat val;
+    CheckAlPfn(L, SpeedOfSound);
     val = luaL_checknumber(L, 3);
     al.SpeedOfSound(val);
     return 0;
@@ -255,6 +288,7 @@ static int GetDistanceModel(lua_State *L)
 static int SetDistanceModel(lua_State *L)
     {
     ALenum val = checkdistancemodel(L, 3);
+    CheckAlPfn(L, DistanceModel);
     al.DistanceModel(val);
     return 0;
     }
@@ -455,9 +489,6 @@ static int GetAllAttributes(lua_State *L)
     }
 #endif
 
-//@@TODO? ALC_EXT_thread_local_context
-//ALCboolean  alcSetThreadContext(ALCcontext *context);
-//ALCcontext* alcGetThreadContext(void);
 
 static int DeferUpdates(lua_State *L)
     {
@@ -472,15 +503,34 @@ static int DeferUpdates(lua_State *L)
     }
 
 
+/* Opens a deferred-updates window on the current context, unless the extension
+ * is not available or the application has already deferred updates itself.
+ * Returns 1 if the window must be closed with end_deferred().
+ */
+int begin_deferred(ud_t *context_ud)
+    {
+    if(!context_ud->cdt->DeferUpdatesSOFT || !context_ud->cdt->ProcessUpdatesSOFT) return 0;
+    if(al.GetBoolean(AL_DEFERRED_UPDATES_SOFT)) return 0;
+    context_ud->cdt->DeferUpdatesSOFT();
+    return 1;
+    }
+
+void end_deferred(ud_t *context_ud, int opened)
+    {
+    if(opened) context_ud->cdt->ProcessUpdatesSOFT();
+    }
+
 static int ProcessUpdates(lua_State *L)
     {
     ud_t *ud;
     context_t old_context = current_context(L);
     context_t context = checkcontext(L, 1, &ud);
+    TRACE_CALL_START;
     CheckContextPfn(L, ud, ProcessUpdatesSOFT);
     make_context_current(L, context);
     ud->cdt->ProcessUpdatesSOFT();
     make_context_current(L, old_context);
+    TRACE_CALL_STOP("process_updates", context, 0);
     return 0;
     }
 
@@ -510,6 +560,26 @@ static const struct luaL_Reg Methods[] =
         { "get_attribute", GetAttribute },
         { "defer_updates", DeferUpdates },
         { "process_updates", ProcessUpdates },
+        { "tick", ramps_tick },
+        { "cull", virtual_cull },
+        { "query_sources", spatial_query },
+        { "nearest", spatial_nearest },
+        { "set_spatial_grid", spatial_grid },
+        { "commit", shadow_commit },
+        { "load_async", loader_async },
+        { "poll_loads", loader_poll },
+        { "buffer_data_cached", bufcache_data },
+        { "buffer_cache_stats", bufcache_stats },
+        { "set_residency_budget", residency_budget },
+        { "residency_stats", residency_stats },
+        { "event_control", events_control },
+        { "drain_events", events_drain },
+        { "event_fd", notify_eventfd },
+        { "start_telemetry", telemetry_start },
+        { "stop_telemetry", telemetry_stop },
+        { "telemetry_stats", telemetry_stats },
+        { "telemetry_samples", telemetry_samples },
+        { "update_streams", stream_updateall },
         { NULL, NULL } /* sentinel */
     };
 
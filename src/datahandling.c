@@ -25,7 +25,7 @@
 
 #include "internal.h"
     
-static size_t sizeoftype(int type)
+size_t sizeoftype(int type)
     {
     switch(type)
         {
@@ -136,24 +136,30 @@ static int FlattenTable(lua_State *L)
 
 /*-----------------------------------------------------------------------------*/
 
+/* Elements are copied with memcpy(), since dst and data need not be aligned for T
+ * (e.g. when they point at an arbitrary offset in a mapped buffer, see mapping.c).
+ */
+
 #define PACK(T, what) /* what= number or integer */ \
 static int Pack##T(lua_State *L, size_t n, void *dst, size_t dstsize, int *faulty_element)  \
     {                                       \
     int isnum;                              \
     size_t i;                               \
-    T *data = (T*)dst;                      \
+    T val;                                  \
+    char *data = (char*)dst;                \
     if(faulty_element) *faulty_element = 0; \
     if(dstsize < (n * sizeof(T)))           \
         return ERR_LENGTH;                  \
     for(i = 0; i < n; i++)                  \
         {                                   \
         lua_rawgeti(L, -1, i+1);            \
-        data[i] = lua_to##what##x(L, -1, &isnum); \
+        val = (T)lua_to##what##x(L, -1, &isnum); \
         if(!isnum)                          \
             {                               \
             if(faulty_element) *faulty_element = i+1;   \
             return ERR_TYPE; /* element i+1 is not a #what */ \
             }                               \
+        memcpy(data + i*sizeof(T), &val, sizeof(T)); \
         lua_pop(L, 1);                      \
         }                                   \
     return 0;                               \
@@ -212,6 +218,38 @@ static int Pack(lua_State *L)
     return 1;
     }
 
+size_t datahandling_pack(lua_State *L, int type, int arg, void *dst, size_t dstsize, int *err)
+/* Same as pack(), but packs the values at arg, arg+1, ... directly in the given
+ * memory area (see mapping.c). Returns the number of bytes written, or 0 with *err
+ * set on error. Leaves the Lua stack as it found it.
+ */
+    {
+    size_t len = 0;
+    int top = lua_gettop(L);
+    size_t n = toflattable(L, arg);
+    switch(type)
+        {
+#define P(T) do { *err = Pack##T(L, n, dst, dstsize, NULL); len = n * sizeof(T); } while(0)
+        case NONAL_TYPE_CHAR:   P(int8_t); break;
+        case NONAL_TYPE_UCHAR:  P(uint8_t); break;
+        case NONAL_TYPE_BYTE:   P(int8_t); break;
+        case NONAL_TYPE_UBYTE:  P(uint8_t); break;
+        case NONAL_TYPE_SHORT:  P(int16_t); break;
+        case NONAL_TYPE_USHORT: P(uint16_t); break;
+        case NONAL_TYPE_INT:    P(int32_t); break;
+        case NONAL_TYPE_UINT:   P(uint32_t); break;
+        case NONAL_TYPE_LONG:   P(int64_t); break;
+        case NONAL_TYPE_ULONG:  P(uint64_t); break;
+        case NONAL_TYPE_FLOAT:  P(float); break;
+        case NONAL_TYPE_DOUBLE: P(double); break;
+        default:
+            *err = ERR_VALUE; break;
+#undef P
+        }
+    lua_settop(L, top);
+    return *err ? 0 : len;
+    }
+
 /*-----------------------------------------------------------------------------*/
 
 #define UNPACK(T, what) /* what= number or integer */   \
@@ -219,13 +257,15 @@ static int Unpack##T(lua_State *L, const void* data, size_t len) \
     {                                                   \
     size_t n;                                           \
     size_t i=0;                                         \
+    T val;                                              \
     if((len < sizeof(T)) || (len % sizeof(T)) != 0)     \
         return ERR_LENGTH;                              \
     n = len / sizeof(T);                                \
     lua_newtable(L);                                    \
     for(i = 0; i < n; i++)                              \
         {                                               \
-        lua_push##what(L, ((T*)data)[i]);               \
+        memcpy(&val, (const char*)data + i*sizeof(T), sizeof(T)); \
+        lua_push##what(L, val);                         \
         lua_rawseti(L, -2, i+1);                        \
         }                                               \
     return 0;                                           \
@@ -246,7 +286,7 @@ UNPACK_INTEGERS(uint32_t)
 UNPACK_INTEGERS(int64_t)
 UNPACK_INTEGERS(uint64_t)
 
-static int Unpack_(lua_State *L, int type, const void *data, size_t len)
+int datahandling_unpack(lua_State *L, int type, const void *data, size_t len)
     {
     int err = 0;
     switch(type)
@@ -277,7 +317,7 @@ static int Unpack(lua_State *L)
     size_t len;
     int type = checktype(L, 1);
     const void *data = luaL_checklstring(L, 2, &len);
-    return Unpack_(L, type, data, len);
+    return datahandling_unpack(L, type, data, len);
     }
 
 static int FormatSize(lua_State *L)
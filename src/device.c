@@ -94,6 +94,12 @@ static int CaptureOpenDevice(lua_State *L)
     ALCsizei maxframes = luaL_checkinteger(L, 4); /* buffersize in no. of frames */
     if(maxframes <= 0)
         return luaL_argerror(L, 4, errstring(ERR_VALUE));
+    /* all the capture functions are resolved here (capture devices cannot exist otherwise) */
+    CheckAlcPfn(L, CaptureOpenDevice);
+    CheckAlcPfn(L, CaptureCloseDevice);
+    CheckAlcPfn(L, CaptureStart);
+    CheckAlcPfn(L, CaptureStop);
+    CheckAlcPfn(L, CaptureSamples);
     udinfo = (udinfo_t*)Malloc(L, sizeof(udinfo_t));
     if(!udinfo)
         { return luaL_error(L, errstring(ERR_MEMORY)); }
@@ -149,6 +155,7 @@ static int CaptureSamples(lua_State *L)
     device_t device = checkdevice(L, 1, &ud);
     udinfo_t *udinfo = (udinfo_t*)ud->info;
     ALCsizei frames = luaL_checkinteger(L, 2); 
+    TRACE_CALL_START;
     if(!IsCaptureDevice(ud)) 
         return luaL_argerror(L, 1, "not a capture device");
     if(frames > udinfo->maxframes) /* check that frames fit in buffer */
@@ -159,6 +166,7 @@ static int CaptureSamples(lua_State *L)
         return 0; /* not enough available frames */
     alc.CaptureSamples(device, udinfo->buffer, frames);
     CheckErrorAlc(L, device);
+    TRACE_CALL_STOP("capture_samples", device, frames);
     lua_pushlstring(L, (const char*)udinfo->buffer, frames * udinfo->framesize);
     return 1;
     }
@@ -173,11 +181,13 @@ static int LoopbackOpenDevice(lua_State *L)
     const ALCchar *devicename = luaL_optstring(L, 1, NULL);
     ALCsizei maxframes = luaL_checkinteger(L, 2);
     ALCsizei maxframesize = luaL_checkinteger(L, 3);
-    ALCsizei maxbytes = luaL_checkinteger(L, 2);
+    ALCsizei maxbytes = maxframes * maxframesize;
     if(maxbytes <= 0)
         return luaL_argerror(L, 2, errstring(ERR_VALUE));
 
     CheckAlcPfn(L, LoopbackOpenDeviceSOFT); 
+    CheckAlcPfn(L, IsRenderFormatSupportedSOFT); 
+    CheckAlcPfn(L, RenderSamplesSOFT); 
 
     udinfo = (udinfo_t*)Malloc(L, sizeof(udinfo_t));
     if(!udinfo)
@@ -229,6 +239,7 @@ static int RenderSamples(lua_State *L)
     ALCsizei frames = luaL_checkinteger(L, 2);
     ALCsizei framesize = luaL_checkinteger(L, 3);
     ALCsizei bytes = frames * framesize;
+    TRACE_CALL_START;
 
     if(!IsLoopbackDevice(ud)) 
         return luaL_argerror(L, 1, "not a loopback device");
@@ -236,10 +247,11 @@ static int RenderSamples(lua_State *L)
 
     if(bytes > udinfo->buffersize)
         return luaL_argerror(L, 2, "requested too many bytes of data");
-    memset(udinfo->buffer, 0, frames);
+    memset(udinfo->buffer, 0, bytes);
     alc.RenderSamplesSOFT(device, udinfo->buffer, frames);
     CheckErrorAlc(L, device);
-    lua_pushlstring(L, (const char*)udinfo->buffer, frames);
+    TRACE_CALL_STOP("render_samples", device, frames);
+    lua_pushlstring(L, (const char*)udinfo->buffer, bytes);
     return 1;
     }
 
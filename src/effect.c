@@ -24,6 +24,13 @@
  */
 
 #include "internal.h"
+#include "include/efx-presets.h"
+
+typedef struct {
+    ALenum type; /* cached AL_EFFECT_TYPE (set only via set_type) */
+} effinfo_t;
+
+#define EFFECTTYPE(ud) (((effinfo_t*)(ud)->info)->type)
 
 static int freeeffect(lua_State *L, ud_t *ud)
     {
@@ -42,6 +49,7 @@ static int Create(lua_State *L)
     {
     ALuint name;
     effect_t effect;
+    effinfo_t *info;
     ud_t *ud, *context_ud;
     context_t old_context = current_context(L);
     context_t context = checkcontext(L, 1, &context_ud);
@@ -52,10 +60,13 @@ static int Create(lua_State *L)
     CheckErrorRestoreAl(L, old_context);
 
     effect = (object_t*)MallocNoErr(L, sizeof(object_t));
-    if(!effect)
+    info = (effinfo_t*)MallocNoErr(L, sizeof(effinfo_t));
+    if(!effect || !info)
         {
         make_context_current(L, old_context);
         context_ud->ddt->DeleteEffects(1, &name);
+        if(effect) Free(L, effect);
+        if(info) Free(L, info);
         return luaL_error(L, errstring(ERR_MEMORY));
         }
     
@@ -65,6 +76,7 @@ static int Create(lua_State *L)
     ud->device = context_ud->device;
     ud->parent_ud = context_ud;
     ud->destructor = freeeffect;
+    ud->info = info; /* type is AL_EFFECT_NULL (=0) on generation */
     ud->ddt = context_ud->ddt;
     ud->cdt = context_ud->cdt;
     TRACE_CREATE(effect, "effect");
@@ -77,7 +89,7 @@ static int Create(lua_State *L)
 static int GetInteger(lua_State *L, effect_t effect, ALenum param)
     {
     ALint val;
-    ud_t *ud = userdata(effect);
+    ud_t *ud = userdata(L, effect);
     CheckDevicePfn(L, ud, GetEffecti);
     ud->ddt->GetEffecti(effect->name, param, &val);
     CheckErrorAl(L);
@@ -85,21 +97,17 @@ static int GetInteger(lua_State *L, effect_t effect, ALenum param)
     return 1;
     }
 
-static int SetInteger(lua_State *L, effect_t effect, ALenum param)
+static int SetInteger(lua_State *L, ud_t *ud, effect_t effect, ALenum param)
     {
-    ALint val;
-    ud_t *ud = userdata(effect);
-    CheckDevicePfn(L, ud, Effecti);
-    val = luaL_checknumber(L, 3);
+    ALint val = luaL_checknumber(L, 3);
     ud->ddt->Effecti(effect->name, param, val);
-    CheckErrorAl(L);
     return 0;
     }
 
 static int GetFloat(lua_State *L, effect_t effect, ALenum param)
     {
     ALfloat val;
-    ud_t *ud = userdata(effect);
+    ud_t *ud = userdata(L, effect);
     CheckDevicePfn(L, ud, GetEffectf);
     ud->ddt->GetEffectf(effect->name, param, &val);
     CheckErrorAl(L);
@@ -107,21 +115,17 @@ static int GetFloat(lua_State *L, effect_t effect, ALenum param)
     return 1;
     }
 
-static int SetFloat(lua_State *L, effect_t effect, ALenum param)
+static int SetFloat(lua_State *L, ud_t *ud, effect_t effect, ALenum param)
     {
-    ALfloat val;
-    ud_t *ud = userdata(effect);
-    CheckDevicePfn(L, ud, Effectf);
-    val = luaL_checknumber(L, 3);
+    ALfloat val = luaL_checknumber(L, 3);
     ud->ddt->Effectf(effect->name, param, val);
-    CheckErrorAl(L);
     return 0;
     }
 
 static int GetFloat3(lua_State *L, effect_t effect, ALenum param)
     {
     ALfloat val[3];
-    ud_t *ud = userdata(effect);
+    ud_t *ud = userdata(L, effect);
     CheckDevicePfn(L, ud, GetEffectfv);
     ud->ddt->GetEffectfv(effect->name, param, val);
     CheckErrorAl(L);
@@ -129,14 +133,11 @@ static int GetFloat3(lua_State *L, effect_t effect, ALenum param)
     return 1;
     }
 
-static int SetFloat3(lua_State *L, effect_t effect, ALenum param)
+static int SetFloat3(lua_State *L, ud_t *ud, effect_t effect, ALenum param)
     {
     ALfloat val[3];
-    ud_t *ud = userdata(effect);
-    CheckDevicePfn(L, ud, Effectfv);
     checkfloat3(L, 3, val);
     ud->ddt->Effectfv(effect->name, param, val);
-    CheckErrorAl(L);
     return 0;
     }
 
@@ -144,7 +145,7 @@ static int SetFloat3(lua_State *L, effect_t effect, ALenum param)
 static int FuncName(lua_State *L, effect_t effect)  \
     {                                               \
     ALenum val;                                     \
-    ud_t *ud = userdata(effect);                    \
+    ud_t *ud = userdata(L, effect);                    \
     CheckDevicePfn(L, ud, GetEffecti);              \
     ud->ddt->GetEffecti(effect->name, param, &val); \
     CheckErrorAl(L);                                \
@@ -161,13 +162,10 @@ GET_ENUM_FUNC(GetCompressorOnoff, AL_COMPRESSOR_ONOFF, compressoronoff)
 
 
 #define SET_ENUM_FUNC(FuncName, param, enumtype)        \
-static int FuncName(lua_State *L, effect_t effect)      \
+static int FuncName(lua_State *L, ud_t *ud, effect_t effect) \
     {                                                   \
-    ud_t *ud = userdata(effect);                        \
     ALenum val = check##enumtype(L, 3);                 \
-    CheckDevicePfn(L, ud, Effecti);                     \
     ud->ddt->Effecti(effect->name, param, val);         \
-    CheckErrorAl(L);                                    \
     return 0;                                           \
     }
 
@@ -197,19 +195,19 @@ static int GetEffectChorus(lua_State *L, effect_t effect)
     return 0;
     }
 
-static int SetEffectChorus(lua_State *L, effect_t effect)
+static int SetEffectChorus(lua_State *L, ud_t *ud, effect_t effect)
     {
     ALenum param = checkchorusparam(L, 2);
     switch(param)
         {
-        case AL_CHORUS_WAVEFORM: return SetChorusWaveform(L, effect);
+        case AL_CHORUS_WAVEFORM: return SetChorusWaveform(L, ud, effect);
         case AL_CHORUS_RATE:
         case AL_CHORUS_DEPTH:
         case AL_CHORUS_FEEDBACK:
         case AL_CHORUS_DELAY:
-                            return SetFloat(L, effect, param);
+                            return SetFloat(L, ud, effect, param);
         case AL_CHORUS_PHASE:
-                            return SetInteger(L, effect, param);
+                            return SetInteger(L, ud, effect, param);
         default:
             return erralparam(L, 2);
         }
@@ -243,7 +241,7 @@ static int GetEffectReverb(lua_State *L, effect_t effect)
     return 0;
     }
 
-static int SetEffectReverb(lua_State *L, effect_t effect)
+static int SetEffectReverb(lua_State *L, ud_t *ud, effect_t effect)
     {
     ALenum param = checkreverbparam(L, 2);
     switch(param)
@@ -260,9 +258,9 @@ static int SetEffectReverb(lua_State *L, effect_t effect)
         case AL_REVERB_LATE_REVERB_DELAY:
         case AL_REVERB_AIR_ABSORPTION_GAINHF:
         case AL_REVERB_ROOM_ROLLOFF_FACTOR:
-                            return SetFloat(L, effect, param);
+                            return SetFloat(L, ud, effect, param);
         case AL_REVERB_DECAY_HFLIMIT:
-                            return SetInteger(L, effect, param);
+                            return SetInteger(L, ud, effect, param);
         default:
             return erralparam(L, 2);
         }
@@ -287,7 +285,7 @@ static int GetEffectDistortion(lua_State *L, effect_t effect)
     return 0;
     }
 
-static int SetEffectDistortion(lua_State *L, effect_t effect)
+static int SetEffectDistortion(lua_State *L, ud_t *ud, effect_t effect)
     {
     ALenum param = checkdistortionparam(L, 2);
     switch(param)
@@ -297,7 +295,7 @@ static int SetEffectDistortion(lua_State *L, effect_t effect)
         case AL_DISTORTION_LOWPASS_CUTOFF:
         case AL_DISTORTION_EQCENTER:
         case AL_DISTORTION_EQBANDWIDTH:
-                            return SetFloat(L, effect, param);
+                            return SetFloat(L, ud, effect, param);
         default:
             return erralparam(L, 2);
         }
@@ -321,7 +319,7 @@ static int GetEffectEcho(lua_State *L, effect_t effect)
     return 0;
     }
 
-static int SetEffectEcho(lua_State *L, effect_t effect)
+static int SetEffectEcho(lua_State *L, ud_t *ud, effect_t effect)
     {
     ALenum param = checkechoparam(L, 2);
     switch(param)
@@ -331,7 +329,7 @@ static int SetEffectEcho(lua_State *L, effect_t effect)
         case AL_ECHO_DAMPING:
         case AL_ECHO_FEEDBACK:
         case AL_ECHO_SPREAD:
-                            return SetFloat(L, effect, param);
+                            return SetFloat(L, ud, effect, param);
         default:
             return erralparam(L, 2);
         }
@@ -358,19 +356,19 @@ static int GetEffectFlanger(lua_State *L, effect_t effect)
     return 0;
     }
 
-static int SetEffectFlanger(lua_State *L, effect_t effect)
+static int SetEffectFlanger(lua_State *L, ud_t *ud, effect_t effect)
     {
     ALenum param = checkflangerparam(L, 2);
     switch(param)
         {
-        case AL_FLANGER_WAVEFORM: return SetFlangerWaveform(L, effect);
+        case AL_FLANGER_WAVEFORM: return SetFlangerWaveform(L, ud, effect);
         case AL_FLANGER_RATE:
         case AL_FLANGER_DEPTH:
         case AL_FLANGER_FEEDBACK:
         case AL_FLANGER_DELAY:
-                            return SetFloat(L, effect, param);
+                            return SetFloat(L, ud, effect, param);
         case AL_FLANGER_PHASE:
-                            return SetInteger(L, effect, param);
+                            return SetInteger(L, ud, effect, param);
         default:
             return erralparam(L, 2);
         }
@@ -393,15 +391,15 @@ static int GetEffectRingModulator(lua_State *L, effect_t effect)
     return 0;
     }
 
-static int SetEffectRingModulator(lua_State *L, effect_t effect)
+static int SetEffectRingModulator(lua_State *L, ud_t *ud, effect_t effect)
     {
     ALenum param = checkringmodulatorparam(L, 2);
     switch(param)
         {
-        case AL_RING_MODULATOR_WAVEFORM: return SetRingModulatorWaveform(L, effect);
+        case AL_RING_MODULATOR_WAVEFORM: return SetRingModulatorWaveform(L, ud, effect);
         case AL_RING_MODULATOR_FREQUENCY:
         case AL_RING_MODULATOR_HIGHPASS_CUTOFF:
-                            return SetFloat(L, effect, param);
+                            return SetFloat(L, ud, effect, param);
         default:
             return erralparam(L, 2);
         }
@@ -422,13 +420,13 @@ static int GetEffectCompressor(lua_State *L, effect_t effect)
     return 0;
     }
 
-static int SetEffectCompressor(lua_State *L, effect_t effect)
+static int SetEffectCompressor(lua_State *L, ud_t *ud, effect_t effect)
     {
     ALenum param = checkcompressorparam(L, 2);
     switch(param)
         {
-        case AL_COMPRESSOR_ONOFF: return SetCompressorOnoff(L, effect);
-                            return SetFloat(L, effect, param);
+        case AL_COMPRESSOR_ONOFF: return SetCompressorOnoff(L, ud, effect);
+                            return SetFloat(L, ud, effect, param);
         default:
             return erralparam(L, 2);
         }
@@ -458,7 +456,7 @@ static int GetEffectEqualizer(lua_State *L, effect_t effect)
     return 0;
     }
 
-static int SetEffectEqualizer(lua_State *L, effect_t effect)
+static int SetEffectEqualizer(lua_State *L, ud_t *ud, effect_t effect)
     {
     ALenum param = checkequalizerparam(L, 2);
     switch(param)
@@ -473,7 +471,7 @@ static int SetEffectEqualizer(lua_State *L, effect_t effect)
         case AL_EQUALIZER_MID2_WIDTH:
         case AL_EQUALIZER_HIGH_GAIN:
         case AL_EQUALIZER_HIGH_CUTOFF:
-                            return SetFloat(L, effect, param);
+                            return SetFloat(L, ud, effect, param);
         default:
             return erralparam(L, 2);
         }
@@ -517,7 +515,7 @@ static int GetEffectEaxreverb(lua_State *L, effect_t effect)
     return 0;
     }
 
-static int SetEffectEaxreverb(lua_State *L, effect_t effect)
+static int SetEffectEaxreverb(lua_State *L, ud_t *ud, effect_t effect)
     {
     ALenum param = checkeaxreverbparam(L, 2);
     switch(param)
@@ -544,9 +542,9 @@ static int SetEffectEaxreverb(lua_State *L, effect_t effect)
         case AL_EAXREVERB_LFREFERENCE:
         case AL_EAXREVERB_ROOM_ROLLOFF_FACTOR:
         case AL_EAXREVERB_LATE_REVERB_PAN:
-                            return SetFloat(L, effect, param);
+                            return SetFloat(L, ud, effect, param);
         case AL_EAXREVERB_REFLECTIONS_PAN:
-                            return SetFloat3(L, effect, param);
+                            return SetFloat3(L, ud, effect, param);
         default:
             return erralparam(L, 2);
         }
@@ -567,13 +565,13 @@ static int GetEffectDedicated(lua_State *L, effect_t effect)
     return 0;
     }
 
-static int SetEffectDedicated(lua_State *L, effect_t effect)
+static int SetEffectDedicated(lua_State *L, ud_t *ud, effect_t effect)
     {
     ALenum param = checkdedicatedparam(L, 2);
     switch(param)
         {
         case AL_DEDICATED_GAIN:
-                            return SetFloat(L, effect, param);
+                            return SetFloat(L, ud, effect, param);
         default:
             return erralparam(L, 2);
         }
@@ -581,26 +579,11 @@ static int SetEffectDedicated(lua_State *L, effect_t effect)
     }
 
 
-static ALenum EffectType(lua_State *L, effect_t effect)
-    {
-    ALenum val;
-    ud_t *ud = userdata(effect);
-    CheckDevicePfn(L, ud, GetEffecti);
-    ud->ddt->GetEffecti(effect->name, AL_EFFECT_TYPE, &val);
-    CheckErrorAl(L);
-    return val;
-    }
-
-
 static int GetEffectType(lua_State *L)
     {
-    ALenum val;
     ud_t *ud;
-    effect_t effect = checkeffect(L, 1, &ud);
-    CheckDevicePfn(L, ud, GetEffecti);
-    ud->ddt->GetEffecti(effect->name, AL_EFFECT_TYPE, &val);
-    CheckErrorAl(L);
-    pusheffecttype(L, val);
+    checkeffect(L, 1, &ud);
+    pusheffecttype(L, EFFECTTYPE(ud));
     return 1;
     }
 
@@ -612,14 +595,39 @@ static int SetEffectType(lua_State *L)
     CheckDevicePfn(L, ud, Effecti);
     ud->ddt->Effecti(effect->name, AL_EFFECT_TYPE, val);
     CheckErrorAl(L);
+    EFFECTTYPE(ud) = val;
     return 0;
     }
 
 
+ALenum checkeffectparam(lua_State *L, int arg, ud_t *ud)
+/* checks a parameter name for the current type of the effect (see automation.c) */
+    {
+    switch(EFFECTTYPE(ud))
+        {
+        case AL_EFFECT_REVERB:  return checkreverbparam(L, arg);
+        case AL_EFFECT_CHORUS:  return checkchorusparam(L, arg);
+        case AL_EFFECT_DISTORTION:  return checkdistortionparam(L, arg);
+        case AL_EFFECT_ECHO:    return checkechoparam(L, arg);
+        case AL_EFFECT_FLANGER: return checkflangerparam(L, arg);
+        case AL_EFFECT_RING_MODULATOR:  return checkringmodulatorparam(L, arg);
+        case AL_EFFECT_COMPRESSOR:  return checkcompressorparam(L, arg);
+        case AL_EFFECT_EQUALIZER:   return checkequalizerparam(L, arg);
+        case AL_EFFECT_EAXREVERB:   return checkeaxreverbparam(L, arg);
+        case AL_EFFECT_DEDICATED_DIALOGUE:
+        case AL_EFFECT_DEDICATED_LOW_FREQUENCY_EFFECT:  return checkdedicatedparam(L, arg);
+        case AL_EFFECT_NULL:
+        default:
+            return luaL_argerror(L, 1, "undefined effect type");
+        }
+    return 0;
+    }
+
 static int GetEffect(lua_State *L)
     {
-    effect_t effect = checkeffect(L, 1, NULL);
-    ALenum effect_type = EffectType(L, effect);
+    ud_t *ud;
+    effect_t effect = checkeffect(L, 1, &ud);
+    ALenum effect_type = EFFECTTYPE(ud);
 
     switch(effect_type)
         {
@@ -645,37 +653,344 @@ static int GetEffect(lua_State *L)
     return 0;
     }
 
-static int SetEffect(lua_State *L)
-    {
-    effect_t effect = checkeffect(L, 1, NULL);
-    ALenum effect_type = EffectType(L, effect);
+typedef int (*setter_t)(lua_State *L, ud_t *ud, effect_t effect);
 
-    switch(effect_type)
+static setter_t setter(lua_State *L, ud_t *ud)
+/* returns the parameter setter for the current type of the effect */
+    {
+    switch(EFFECTTYPE(ud))
         {
-        case AL_EFFECT_REVERB:  return SetEffectReverb(L, effect);
-        case AL_EFFECT_CHORUS:  return SetEffectChorus(L, effect);
-        case AL_EFFECT_DISTORTION:  return SetEffectDistortion(L, effect);
-        case AL_EFFECT_ECHO:    return SetEffectEcho(L, effect);
-        case AL_EFFECT_FLANGER: return SetEffectFlanger(L, effect);
-//      case AL_EFFECT_FREQUENCY_SHIFTER:   return SetEffectFrequencyShifter(L, effect);
-//      case AL_EFFECT_VOCAL_MORPHER:   return SetEffectVocalMorpher(L, effect);
-//      case AL_EFFECT_PITCH_SHIFTER:   return SetEffectPitchShifter(L, effect);
-        case AL_EFFECT_RING_MODULATOR:  return SetEffectRingModulator(L, effect);
-//      case AL_EFFECT_AUTOWAH: return SetEffectAutowah(L, effect);
-        case AL_EFFECT_COMPRESSOR:  return SetEffectCompressor(L, effect);
-        case AL_EFFECT_EQUALIZER:   return SetEffectEqualizer(L, effect);
-        case AL_EFFECT_EAXREVERB:   return SetEffectEaxreverb(L, effect);
+        case AL_EFFECT_REVERB:  return SetEffectReverb;
+        case AL_EFFECT_CHORUS:  return SetEffectChorus;
+        case AL_EFFECT_DISTORTION:  return SetEffectDistortion;
+        case AL_EFFECT_ECHO:    return SetEffectEcho;
+        case AL_EFFECT_FLANGER: return SetEffectFlanger;
+//      case AL_EFFECT_FREQUENCY_SHIFTER:   return SetEffectFrequencyShifter;
+//      case AL_EFFECT_VOCAL_MORPHER:   return SetEffectVocalMorpher;
+//      case AL_EFFECT_PITCH_SHIFTER:   return SetEffectPitchShifter;
+        case AL_EFFECT_RING_MODULATOR:  return SetEffectRingModulator;
+//      case AL_EFFECT_AUTOWAH: return SetEffectAutowah;
+        case AL_EFFECT_COMPRESSOR:  return SetEffectCompressor;
+        case AL_EFFECT_EQUALIZER:   return SetEffectEqualizer;
+        case AL_EFFECT_EAXREVERB:   return SetEffectEaxreverb;
         case AL_EFFECT_DEDICATED_DIALOGUE:
-        case AL_EFFECT_DEDICATED_LOW_FREQUENCY_EFFECT:  return SetEffectDedicated(L, effect);
+        case AL_EFFECT_DEDICATED_LOW_FREQUENCY_EFFECT:  return SetEffectDedicated;
         case AL_EFFECT_NULL:
         default:
-            return luaL_argerror(L, 1, "undefined effect type");
+            luaL_argerror(L, 1, "undefined effect type");
         }
+    return NULL;
+    }
 
+static int SetEffect(lua_State *L)
+    {
+    ud_t *ud;
+    effect_t effect = checkeffect(L, 1, &ud);
+    setter_t set = setter(L, ud);
+    CheckDevicePfn(L, ud, Effecti);
+    CheckDevicePfn(L, ud, Effectf);
+    CheckDevicePfn(L, ud, Effectfv);
+    set(L, ud, effect);
+    CheckErrorAl(L);
     return 0;
     }
 
 
+/*------------------------------------------------------------------------------*
+ | Bulk upload (set_all, load_preset)                                           |
+ *------------------------------------------------------------------------------*/
+
+/* Reverb presets from efx-presets.h, sorted by name for bsearch(). */
+typedef struct {
+    const char *name;
+    EFXEAXREVERBPROPERTIES props;
+} preset_t;
+
+static const preset_t Presets[] = 
+    {
+        { "alley", EFX_REVERB_PRESET_ALLEY },
+        { "arena", EFX_REVERB_PRESET_ARENA },
+        { "auditorium", EFX_REVERB_PRESET_AUDITORIUM },
+        { "bathroom", EFX_REVERB_PRESET_BATHROOM },
+        { "carpetedhallway", EFX_REVERB_PRESET_CARPETEDHALLWAY },
+        { "castle alcove", EFX_REVERB_PRESET_CASTLE_ALCOVE },
+        { "castle courtyard", EFX_REVERB_PRESET_CASTLE_COURTYARD },
+        { "castle cupboard", EFX_REVERB_PRESET_CASTLE_CUPBOARD },
+        { "castle hall", EFX_REVERB_PRESET_CASTLE_HALL },
+        { "castle largeroom", EFX_REVERB_PRESET_CASTLE_LARGEROOM },
+        { "castle longpassage", EFX_REVERB_PRESET_CASTLE_LONGPASSAGE },
+        { "castle mediumroom", EFX_REVERB_PRESET_CASTLE_MEDIUMROOM },
+        { "castle shortpassage", EFX_REVERB_PRESET_CASTLE_SHORTPASSAGE },
+        { "castle smallroom", EFX_REVERB_PRESET_CASTLE_SMALLROOM },
+        { "cave", EFX_REVERB_PRESET_CAVE },
+        { "chapel", EFX_REVERB_PRESET_CHAPEL },
+        { "city", EFX_REVERB_PRESET_CITY },
+        { "city abandoned", EFX_REVERB_PRESET_CITY_ABANDONED },
+        { "city library", EFX_REVERB_PRESET_CITY_LIBRARY },
+        { "city museum", EFX_REVERB_PRESET_CITY_MUSEUM },
+        { "city streets", EFX_REVERB_PRESET_CITY_STREETS },
+        { "city subway", EFX_REVERB_PRESET_CITY_SUBWAY },
+        { "city underpass", EFX_REVERB_PRESET_CITY_UNDERPASS },
+        { "concerthall", EFX_REVERB_PRESET_CONCERTHALL },
+        { "dizzy", EFX_REVERB_PRESET_DIZZY },
+        { "dome saintpauls", EFX_REVERB_PRESET_DOME_SAINTPAULS },
+        { "dome tomb", EFX_REVERB_PRESET_DOME_TOMB },
+        { "driving commentator", EFX_REVERB_PRESET_DRIVING_COMMENTATOR },
+        { "driving emptygrandstand", EFX_REVERB_PRESET_DRIVING_EMPTYGRANDSTAND },
+        { "driving fullgrandstand", EFX_REVERB_PRESET_DRIVING_FULLGRANDSTAND },
+        { "driving incar luxury", EFX_REVERB_PRESET_DRIVING_INCAR_LUXURY },
+        { "driving incar racer", EFX_REVERB_PRESET_DRIVING_INCAR_RACER },
+        { "driving incar sports", EFX_REVERB_PRESET_DRIVING_INCAR_SPORTS },
+        { "driving pitgarage", EFX_REVERB_PRESET_DRIVING_PITGARAGE },
+        { "driving tunnel", EFX_REVERB_PRESET_DRIVING_TUNNEL },
+        { "drugged", EFX_REVERB_PRESET_DRUGGED },
+        { "dustyroom", EFX_REVERB_PRESET_DUSTYROOM },
+        { "factory alcove", EFX_REVERB_PRESET_FACTORY_ALCOVE },
+        { "factory courtyard", EFX_REVERB_PRESET_FACTORY_COURTYARD },
+        { "factory cupboard", EFX_REVERB_PRESET_FACTORY_CUPBOARD },
+        { "factory hall", EFX_REVERB_PRESET_FACTORY_HALL },
+        { "factory largeroom", EFX_REVERB_PRESET_FACTORY_LARGEROOM },
+        { "factory longpassage", EFX_REVERB_PRESET_FACTORY_LONGPASSAGE },
+        { "factory mediumroom", EFX_REVERB_PRESET_FACTORY_MEDIUMROOM },
+        { "factory shortpassage", EFX_REVERB_PRESET_FACTORY_SHORTPASSAGE },
+        { "factory smallroom", EFX_REVERB_PRESET_FACTORY_SMALLROOM },
+        { "forest", EFX_REVERB_PRESET_FOREST },
+        { "generic", EFX_REVERB_PRESET_GENERIC },
+        { "hallway", EFX_REVERB_PRESET_HALLWAY },
+        { "hangar", EFX_REVERB_PRESET_HANGAR },
+        { "icepalace alcove", EFX_REVERB_PRESET_ICEPALACE_ALCOVE },
+        { "icepalace courtyard", EFX_REVERB_PRESET_ICEPALACE_COURTYARD },
+        { "icepalace cupboard", EFX_REVERB_PRESET_ICEPALACE_CUPBOARD },
+        { "icepalace hall", EFX_REVERB_PRESET_ICEPALACE_HALL },
+        { "icepalace largeroom", EFX_REVERB_PRESET_ICEPALACE_LARGEROOM },
+        { "icepalace longpassage", EFX_REVERB_PRESET_ICEPALACE_LONGPASSAGE },
+        { "icepalace mediumroom", EFX_REVERB_PRESET_ICEPALACE_MEDIUMROOM },
+        { "icepalace shortpassage", EFX_REVERB_PRESET_ICEPALACE_SHORTPASSAGE },
+        { "icepalace smallroom", EFX_REVERB_PRESET_ICEPALACE_SMALLROOM },
+        { "livingroom", EFX_REVERB_PRESET_LIVINGROOM },
+        { "mood heaven", EFX_REVERB_PRESET_MOOD_HEAVEN },
+        { "mood hell", EFX_REVERB_PRESET_MOOD_HELL },
+        { "mood memory", EFX_REVERB_PRESET_MOOD_MEMORY },
+        { "mountains", EFX_REVERB_PRESET_MOUNTAINS },
+        { "outdoors backyard", EFX_REVERB_PRESET_OUTDOORS_BACKYARD },
+        { "outdoors creek", EFX_REVERB_PRESET_OUTDOORS_CREEK },
+        { "outdoors deepcanyon", EFX_REVERB_PRESET_OUTDOORS_DEEPCANYON },
+        { "outdoors rollingplains", EFX_REVERB_PRESET_OUTDOORS_ROLLINGPLAINS },
+        { "outdoors valley", EFX_REVERB_PRESET_OUTDOORS_VALLEY },
+        { "paddedcell", EFX_REVERB_PRESET_PADDEDCELL },
+        { "parkinglot", EFX_REVERB_PRESET_PARKINGLOT },
+        { "pipe large", EFX_REVERB_PRESET_PIPE_LARGE },
+        { "pipe longthin", EFX_REVERB_PRESET_PIPE_LONGTHIN },
+        { "pipe resonant", EFX_REVERB_PRESET_PIPE_RESONANT },
+        { "pipe small", EFX_REVERB_PRESET_PIPE_SMALL },
+        { "plain", EFX_REVERB_PRESET_PLAIN },
+        { "prefab caravan", EFX_REVERB_PRESET_PREFAB_CARAVAN },
+        { "prefab outhouse", EFX_REVERB_PRESET_PREFAB_OUTHOUSE },
+        { "prefab practiseroom", EFX_REVERB_PRESET_PREFAB_PRACTISEROOM },
+        { "prefab schoolroom", EFX_REVERB_PRESET_PREFAB_SCHOOLROOM },
+        { "prefab workshop", EFX_REVERB_PRESET_PREFAB_WORKSHOP },
+        { "psychotic", EFX_REVERB_PRESET_PSYCHOTIC },
+        { "quarry", EFX_REVERB_PRESET_QUARRY },
+        { "room", EFX_REVERB_PRESET_ROOM },
+        { "sewerpipe", EFX_REVERB_PRESET_SEWERPIPE },
+        { "smallwaterroom", EFX_REVERB_PRESET_SMALLWATERROOM },
+        { "spacestation alcove", EFX_REVERB_PRESET_SPACESTATION_ALCOVE },
+        { "spacestation cupboard", EFX_REVERB_PRESET_SPACESTATION_CUPBOARD },
+        { "spacestation hall", EFX_REVERB_PRESET_SPACESTATION_HALL },
+        { "spacestation largeroom", EFX_REVERB_PRESET_SPACESTATION_LARGEROOM },
+        { "spacestation longpassage", EFX_REVERB_PRESET_SPACESTATION_LONGPASSAGE },
+        { "spacestation mediumroom", EFX_REVERB_PRESET_SPACESTATION_MEDIUMROOM },
+        { "spacestation shortpassage", EFX_REVERB_PRESET_SPACESTATION_SHORTPASSAGE },
+        { "spacestation smallroom", EFX_REVERB_PRESET_SPACESTATION_SMALLROOM },
+        { "sport emptystadium", EFX_REVERB_PRESET_SPORT_EMPTYSTADIUM },
+        { "sport fullstadium", EFX_REVERB_PRESET_SPORT_FULLSTADIUM },
+        { "sport gymnasium", EFX_REVERB_PRESET_SPORT_GYMNASIUM },
+        { "sport largeswimmingpool", EFX_REVERB_PRESET_SPORT_LARGESWIMMINGPOOL },
+        { "sport smallswimmingpool", EFX_REVERB_PRESET_SPORT_SMALLSWIMMINGPOOL },
+        { "sport squashcourt", EFX_REVERB_PRESET_SPORT_SQUASHCOURT },
+        { "sport stadiumtannoy", EFX_REVERB_PRESET_SPORT_STADIUMTANNOY },
+        { "stonecorridor", EFX_REVERB_PRESET_STONECORRIDOR },
+        { "stoneroom", EFX_REVERB_PRESET_STONEROOM },
+        { "underwater", EFX_REVERB_PRESET_UNDERWATER },
+        { "wooden alcove", EFX_REVERB_PRESET_WOODEN_ALCOVE },
+        { "wooden courtyard", EFX_REVERB_PRESET_WOODEN_COURTYARD },
+        { "wooden cupboard", EFX_REVERB_PRESET_WOODEN_CUPBOARD },
+        { "wooden hall", EFX_REVERB_PRESET_WOODEN_HALL },
+        { "wooden largeroom", EFX_REVERB_PRESET_WOODEN_LARGEROOM },
+        { "wooden longpassage", EFX_REVERB_PRESET_WOODEN_LONGPASSAGE },
+        { "wooden mediumroom", EFX_REVERB_PRESET_WOODEN_MEDIUMROOM },
+        { "wooden shortpassage", EFX_REVERB_PRESET_WOODEN_SHORTPASSAGE },
+        { "wooden smallroom", EFX_REVERB_PRESET_WOODEN_SMALLROOM },
+    };
+
+#define N_PRESETS (sizeof(Presets)/sizeof(Presets[0]))
+
+static int cmppreset(const void *key, const void *elem)
+    { return strcmp((const char*)key, ((const preset_t*)elem)->name); }
+
+static const EFXEAXREVERBPROPERTIES *checkpreset(lua_State *L, int arg)
+    {
+    const char *name = luaL_checkstring(L, arg);
+    const preset_t *p = (const preset_t*)bsearch(name, Presets, N_PRESETS, sizeof(preset_t), cmppreset);
+    if(!p)
+        { luaL_argerror(L, arg, lua_pushfstring(L, "unknown preset '%s'", name)); return NULL; }
+    return &p->props;
+    }
+
+static void reloadslot(ud_t *ud, effect_t effect, auxslot_t auxslot)
+    {
+    /* Effect parameters are copied into the slot when the effect is attached,
+     * so the slot must be reloaded for the new parameters to be heard. */
+    if(auxslot)
+        ud->ddt->AuxiliaryEffectSloti(auxslot->name, AL_EFFECTSLOT_EFFECT, effect->name);
+    }
+
+static void uploadpreset(ud_t *ud, effect_t effect, const EFXEAXREVERBPROPERTIES *r)
+    {
+    ALuint name = effect->name;
+    if(EFFECTTYPE(ud) == AL_EFFECT_EAXREVERB)
+        {
+        ud->ddt->Effectf(name, AL_EAXREVERB_DENSITY, r->flDensity);
+        ud->ddt->Effectf(name, AL_EAXREVERB_DIFFUSION, r->flDiffusion);
+        ud->ddt->Effectf(name, AL_EAXREVERB_GAIN, r->flGain);
+        ud->ddt->Effectf(name, AL_EAXREVERB_GAINHF, r->flGainHF);
+        ud->ddt->Effectf(name, AL_EAXREVERB_GAINLF, r->flGainLF);
+        ud->ddt->Effectf(name, AL_EAXREVERB_DECAY_TIME, r->flDecayTime);
+        ud->ddt->Effectf(name, AL_EAXREVERB_DECAY_HFRATIO, r->flDecayHFRatio);
+        ud->ddt->Effectf(name, AL_EAXREVERB_DECAY_LFRATIO, r->flDecayLFRatio);
+        ud->ddt->Effectf(name, AL_EAXREVERB_REFLECTIONS_GAIN, r->flReflectionsGain);
+        ud->ddt->Effectf(name, AL_EAXREVERB_REFLECTIONS_DELAY, r->flReflectionsDelay);
+        ud->ddt->Effectfv(name, AL_EAXREVERB_REFLECTIONS_PAN, r->flReflectionsPan);
+        ud->ddt->Effectf(name, AL_EAXREVERB_LATE_REVERB_GAIN, r->flLateReverbGain);
+        ud->ddt->Effectf(name, AL_EAXREVERB_LATE_REVERB_DELAY, r->flLateReverbDelay);
+        ud->ddt->Effectfv(name, AL_EAXREVERB_LATE_REVERB_PAN, r->flLateReverbPan);
+        ud->ddt->Effectf(name, AL_EAXREVERB_ECHO_TIME, r->flEchoTime);
+        ud->ddt->Effectf(name, AL_EAXREVERB_ECHO_DEPTH, r->flEchoDepth);
+        ud->ddt->Effectf(name, AL_EAXREVERB_MODULATION_TIME, r->flModulationTime);
+        ud->ddt->Effectf(name, AL_EAXREVERB_MODULATION_DEPTH, r->flModulationDepth);
+        ud->ddt->Effectf(name, AL_EAXREVERB_AIR_ABSORPTION_GAINHF, r->flAirAbsorptionGainHF);
+        ud->ddt->Effectf(name, AL_EAXREVERB_HFREFERENCE, r->flHFReference);
+        ud->ddt->Effectf(name, AL_EAXREVERB_LFREFERENCE, r->flLFReference);
+        ud->ddt->Effectf(name, AL_EAXREVERB_ROOM_ROLLOFF_FACTOR, r->flRoomRolloffFactor);
+        ud->ddt->Effecti(name, AL_EAXREVERB_DECAY_HFLIMIT, r->iDecayHFLimit);
+        return;
+        }
+    /* standard reverb: the subset of properties it supports */
+    ud->ddt->Effectf(name, AL_REVERB_DENSITY, r->flDensity);
+    ud->ddt->Effectf(name, AL_REVERB_DIFFUSION, r->flDiffusion);
+    ud->ddt->Effectf(name, AL_REVERB_GAIN, r->flGain);
+    ud->ddt->Effectf(name, AL_REVERB_GAINHF, r->flGainHF);
+    ud->ddt->Effectf(name, AL_REVERB_DECAY_TIME, r->flDecayTime);
+    ud->ddt->Effectf(name, AL_REVERB_DECAY_HFRATIO, r->flDecayHFRatio);
+    ud->ddt->Effectf(name, AL_REVERB_REFLECTIONS_GAIN, r->flReflectionsGain);
+    ud->ddt->Effectf(name, AL_REVERB_REFLECTIONS_DELAY, r->flReflectionsDelay);
+    ud->ddt->Effectf(name, AL_REVERB_LATE_REVERB_GAIN, r->flLateReverbGain);
+    ud->ddt->Effectf(name, AL_REVERB_LATE_REVERB_DELAY, r->flLateReverbDelay);
+    ud->ddt->Effectf(name, AL_REVERB_AIR_ABSORPTION_GAINHF, r->flAirAbsorptionGainHF);
+    ud->ddt->Effectf(name, AL_REVERB_ROOM_ROLLOFF_FACTOR, r->flRoomRolloffFactor);
+    ud->ddt->Effecti(name, AL_REVERB_DECAY_HFLIMIT, r->iDecayHFLimit);
+    }
+
+static int LoadPreset(lua_State *L)
+    {
+    int window;
+    ud_t *ud, *context_ud;
+    context_t old_context;
+    effect_t effect = checkeffect(L, 1, &ud);
+    const EFXEAXREVERBPROPERTIES *props = checkpreset(L, 2);
+    auxslot_t auxslot = testauxslot(L, 3, NULL);
+    TRACE_CALL_START;
+    if(EFFECTTYPE(ud) != AL_EFFECT_REVERB && EFFECTTYPE(ud) != AL_EFFECT_EAXREVERB)
+        return luaL_argerror(L, 1, "effect type must be 'reverb' or 'eaxreverb'");
+    CheckDevicePfn(L, ud, Effectf);
+    CheckDevicePfn(L, ud, Effectfv);
+    CheckDevicePfn(L, ud, Effecti);
+    if(auxslot) CheckDevicePfn(L, ud, AuxiliaryEffectSloti);
+    context_ud = userdata(L, ud->context);
+    old_context = current_context(L);
+    make_context_current(L, ud->context);
+    window = begin_deferred(context_ud);
+    uploadpreset(ud, effect, props);
+    reloadslot(ud, effect, auxslot);
+    end_deferred(context_ud, window);
+    CheckErrorRestoreAl(L, old_context);
+    make_context_current(L, old_context);
+    TRACE_CALL_STOP("load_preset", effect, 0);
+    return 0;
+    }
+
+static int SetAllPairs(lua_State *L)
+/* effect, nil, nil, tbl, auxslot (protected, see SetAll) */
+    {
+    ud_t *ud = userdata(L, lua_touserdata(L, lua_upvalueindex(1)));
+    effect_t effect = (effect_t)ud->handle;
+    setter_t set = setter(L, ud);
+    lua_pushnil(L);
+    while(lua_next(L, 4))
+        {
+        /* move the pair where the setters expect the parameter and its value */
+        lua_copy(L, -2, 2);
+        lua_copy(L, -1, 3);
+        lua_pop(L, 1);
+        set(L, ud, effect);
+        }
+    reloadslot(ud, effect, testauxslot(L, 5, NULL));
+    return 0;
+    }
+
+static int SetAll(lua_State *L)
+    {
+    int window, rc;
+    ud_t *ud, *context_ud;
+    context_t old_context;
+    effect_t effect = checkeffect(L, 1, &ud);
+    auxslot_t auxslot = testauxslot(L, 3, NULL);
+    TRACE_CALL_START;
+    luaL_checktype(L, 2, LUA_TTABLE);
+    CheckDevicePfn(L, ud, Effecti);
+    CheckDevicePfn(L, ud, Effectf);
+    CheckDevicePfn(L, ud, Effectfv);
+    if(auxslot) CheckDevicePfn(L, ud, AuxiliaryEffectSloti);
+    lua_settop(L, 3);
+    lua_pushnil(L);
+    lua_pushnil(L);
+    lua_rotate(L, 2, 2); /* effect, nil, nil, tbl, auxslot */
+    /* The parameters are set in a protected call so that the deferred-updates window
+     * is always closed and the current context restored. AL errors are checked once,
+     * at the end. */
+    lua_pushlightuserdata(L, effect);
+    lua_pushcclosure(L, SetAllPairs, 1);
+    lua_insert(L, 1);
+    context_ud = userdata(L, ud->context);
+    old_context = current_context(L);
+    make_context_current(L, ud->context);
+    window = begin_deferred(context_ud);
+    rc = lua_pcall(L, 5, 0, 0);
+    end_deferred(context_ud, window);
+    if(rc != LUA_OK)
+        {
+        (void)al.GetError();
+        make_context_current(L, old_context);
+        return lua_error(L);
+        }
+    CheckErrorRestoreAl(L, old_context);
+    make_context_current(L, old_context);
+    TRACE_CALL_STOP("set_all", effect, 0);
+    return 0;
+    }
+
+static int ReverbPresets(lua_State *L)
+    {
+    size_t i;
+    lua_newtable(L);
+    for(i = 0; i < N_PRESETS; i++)
+        {
+        lua_pushstring(L, Presets[i].name);
+        lua_rawseti(L, -2, i+1);
+        }
+    return 1;
+    }
+
 
 #if 0
 
@@ -727,6 +1042,10 @@ static const struct luaL_Reg Methods[] =
         { "set", SetEffect },
         { "get_type", GetEffectType },
         { "set_type", SetEffectType },
+        { "set_all", SetAll },
+        { "load_preset", LoadPreset },
+        { "ramp", ramps_start },
+        { "cancel_ramps", ramps_cancel },
         { NULL, NULL } /* sentinel */
     };
 
@@ -744,6 +1063,9 @@ static const struct luaL_Reg Functions[] =
         { "effect_set", SetEffect },
         { "get_effect_type", GetEffectType },
         { "set_effect_type", SetEffectType },
+        { "effect_set_all", SetAll },
+        { "effect_load_preset", LoadPreset },
+        { "reverb_presets", ReverbPresets },
         { NULL, NULL } /* sentinel */
     };
 
@@ -27,8 +27,6 @@
 #define enumsDEFINED
 
 /* enums.c */
-#define enums_free_all moonal_enums_free_all
-void enums_free_all(lua_State *L);
 #define enums_test moonal_enums_test
 uint32_t enums_test(lua_State *L, uint32_t domain, int arg, int *err);
 #define enums_check moonal_enums_check
@@ -64,6 +62,8 @@ void enums_freelist(lua_State *L, uint32_t *list);
 #define DOMAIN_AL_COMPRESSOR_ONOFF          17
 #define DOMAIN_AL_FILTER_TYPE               18
 #define DOMAIN_ALC_HRTF_STATUS              19
+#define DOMAIN_AL_EVENT_TYPE                20
+#define DOMAIN_AL_MAP_FLAG                  21
 #define DOMAIN_AL_CHORUS_PARAM              30
 #define DOMAIN_AL_REVERB_PARAM              31
 #define DOMAIN_AL_DISTORTION_PARAM          32
@@ -80,6 +80,7 @@ void enums_freelist(lua_State *L, uint32_t *list);
 #define DOMAIN_AL_EFFECTSLOT_PARAM          71
 /* NONAL additions */
 #define DOMAIN_NONAL_TYPE                  101
+#define DOMAIN_NONAL_CURVE                 102
 
 /* Types for al.sizeof() & friends */
 #define NONAL_TYPE_CHAR         1
@@ -101,6 +102,16 @@ void enums_freelist(lua_State *L, uint32_t *list);
 #define pushtype(L, val) enums_push((L), DOMAIN_NONAL_TYPE, (uint32_t)(val))
 #define valuestype(L) enums_values((L), DOMAIN_NONAL_TYPE)
 
+/* Ramp curves (see automation.c) */
+#define NONAL_CURVE_LINEAR      1
+#define NONAL_CURVE_EXPONENTIAL 2
+#define NONAL_CURVE_SMOOTH      3
+
+#define testcurve(L, arg, err) (int)enums_test((L), DOMAIN_NONAL_CURVE, (arg), (err))
+#define checkcurve(L, arg) (int)enums_check((L), DOMAIN_NONAL_CURVE, (arg))
+#define pushcurve(L, val) enums_push((L), DOMAIN_NONAL_CURVE, (uint32_t)(val))
+#define valuescurve(L) enums_values((L), DOMAIN_NONAL_CURVE)
+
 #define testchannels(L, arg, err) (ALCenum)enums_test((L), DOMAIN_ALC_CHANNELS_SOFT, (arg), (err))
 #define checkchannels(L, arg) (ALCenum)enums_check((L), DOMAIN_ALC_CHANNELS_SOFT, (arg))
 #define pushchannels(L, val) enums_push((L), DOMAIN_ALC_CHANNELS_SOFT, (uint32_t)(val))
@@ -153,6 +164,16 @@ void enums_freelist(lua_State *L, uint32_t *list);
 #define pushsourcestate(L, val) enums_push((L), DOMAIN_AL_SOURCE_STATE, (uint32_t)(val))
 #define valuessourcestate(L) enums_values((L), DOMAIN_AL_SOURCE_STATE)
 
+#define testeventtype(L, arg, err) (ALenum)enums_test((L), DOMAIN_AL_EVENT_TYPE, (arg), (err))
+#define checkeventtype(L, arg) (ALenum)enums_check((L), DOMAIN_AL_EVENT_TYPE, (arg))
+#define pusheventtype(L, val) enums_push((L), DOMAIN_AL_EVENT_TYPE, (uint32_t)(val))
+#define valueseventtype(L) enums_values((L), DOMAIN_AL_EVENT_TYPE)
+
+#define testmapflag(L, arg, err) (ALbitfieldSOFT)enums_test((L), DOMAIN_AL_MAP_FLAG, (arg), (err))
+#define checkmapflag(L, arg) (ALbitfieldSOFT)enums_check((L), DOMAIN_AL_MAP_FLAG, (arg))
+#define pushmapflag(L, val) enums_push((L), DOMAIN_AL_MAP_FLAG, (uint32_t)(val))
+#define valuesmapflag(L) enums_values((L), DOMAIN_AL_MAP_FLAG)
+
 #define testeffecttype(L, arg, err) (ALenum)enums_test((L), DOMAIN_AL_EFFECT_TYPE, (arg), (err))
 #define checkeffecttype(L, arg) (ALenum)enums_check((L), DOMAIN_AL_EFFECT_TYPE, (arg))
 #define pusheffecttype(L, val) enums_push((L), DOMAIN_AL_EFFECT_TYPE, (uint32_t)(val))
@@ -0,0 +1,216 @@
+/* The MIT License (MIT)
+ *
+ * Copyright (c) 2018 Stefano Trettel
+ *
+ * Software repository: MoonAL, https://github.com/stetre/moonal
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+
+#include "internal.h"
+
+/*------------------------------------------------------------------------------*
+ | Native events (AL_SOFT_events)                                               |
+ *------------------------------------------------------------------------------*/
+
+/* The native callback is invoked by OpenAL on its own event thread, where it can not
+ * touch the Lua state. It copies the event in a per-context ring (referenced by the
+ * context's info, see ctxinfo_t), from which drain_events() collects them on the owning
+ * thread. There is a single producer (the callback) and a single consumer (the owning
+ * thread), so the ring needs no lock: each side advances only its own index, with
+ * release semantics, and reads the other's with acquire semantics. Events that find the
+ * ring full are dropped and counted.
+ */
+
+#define RINGSIZE 256    /* must be a power of 2 */
+#define MSGLEN 96
+
+typedef struct {
+    ALenum type;
+    ALuint object;
+    ALuint param;
+    char message[MSGLEN];
+} event_t;
+
+struct moonal_evqueue_s {
+    size_t head;        /* next slot to write (producer) */
+    size_t tail;        /* next slot to read (consumer) */
+    size_t dropped;
+    int fd;             /* event descriptor to signal (-1 if none), see notify.c */
+    event_t ring[RINGSIZE];
+};
+
+#define EVQUEUE(context_ud) (CTXINFO(context_ud)->events)
+
+static void AL_APIENTRY Callback(ALenum type, ALuint object, ALuint param,
+                                 ALsizei length, const ALchar *message, void *userparam)
+    {
+    evqueue_t *q = (evqueue_t*)userparam;
+    size_t head = q->head;
+    event_t *ev;
+    if(head - ATOMIC_ACQUIRE(q->tail) >= RINGSIZE)
+        { ATOMIC_ADD(q->dropped, 1); return; }
+    ev = &q->ring[head & (RINGSIZE - 1)];
+    ev->type = type;
+    ev->object = object;
+    ev->param = param;
+    if(length < 0 || !message) length = 0;
+    if(length >= MSGLEN) length = MSGLEN - 1;
+    if(length > 0) memcpy(ev->message, message, length);
+    ev->message[length] = '\0';
+    ATOMIC_RELEASE(q->head, head + 1);
+    notify_signal(ATOMIC_ACQUIRE(q->fd));
+    }
+
+int events_pending(ud_t *context_ud)
+    {
+    evqueue_t *q = EVQUEUE(context_ud);
+    return q && ATOMIC_ACQUIRE(q->head) != q->tail;
+    }
+
+void events_setfd(ud_t *context_ud, int fd)
+    {
+    evqueue_t *q = EVQUEUE(context_ud);
+    if(q) ATOMIC_RELEASE(q->fd, fd);
+    }
+
+void events_free(lua_State *L, ud_t *context_ud)
+/* called by freecontext(), before the context is destroyed */
+    {
+    context_t context = (context_t)context_ud->handle;
+    context_t old_context;
+    evqueue_t *q = EVQUEUE(context_ud);
+    if(!q) return;
+    /* unregister the callback, so that it is not invoked with a dangling queue */
+    old_context = alc.GetCurrentContext();
+    if(old_context != context) set_current_context(context);
+    context_ud->cdt->EventCallbackSOFT(NULL, NULL);
+    if(old_context != context) set_current_context(old_context);
+    Free(L, q);
+    EVQUEUE(context_ud) = NULL;
+    }
+
+/*------------------------------------------------------------------------------*
+ | Lua functions                                                                |
+ *------------------------------------------------------------------------------*/
+
+int events_control(lua_State *L)
+/* event_control(context, {eventtype}, enable) */
+    {
+    int err;
+    ud_t *ud;
+    evqueue_t *q;
+    uint32_t count;
+    uint32_t *types;
+    context_t old_context = current_context(L);
+    context_t context = checkcontext(L, 1, &ud);
+    ALboolean enable = lua_toboolean(L, 3) ? AL_TRUE : AL_FALSE;
+    CheckContextPfn(L, ud, EventControlSOFT);
+    types = enums_checklist(L, DOMAIN_AL_EVENT_TYPE, 2, &count, &err);
+    if(err)
+        return luaL_argerror(L, 2, errstring(err));
+    q = EVQUEUE(ud);
+    make_context_current(L, context);
+    if(!q && enable)
+        {
+        q = EVQUEUE(ud) = (evqueue_t*)MallocNoErr(L, sizeof(evqueue_t));
+        if(!q)
+            {
+            Free(L, types);
+            make_context_current(L, old_context);
+            return luaL_error(L, errstring(ERR_MEMORY));
+            }
+        memset(q, 0, sizeof(evqueue_t));
+        q->fd = notify_fd(ud);
+        ud->cdt->EventCallbackSOFT(Callback, q);
+        }
+    ud->cdt->EventControlSOFT((ALsizei)count, (ALenum*)types, enable);
+    Free(L, types);
+    CheckErrorRestoreAl(L, old_context);
+    make_context_current(L, old_context);
+    return 0;
+    }
+
+int events_drain(lua_State *L)
+/* {event}, dropped = drain_events(context, [maxevents]) */
+    {
+    ud_t *ud;
+    event_t *ev;
+    ud_t *source_ud;
+    size_t head, tail, dropped, n = 0;
+    lua_Integer maxevents;
+    evqueue_t *q;
+    checkcontext(L, 1, &ud);
+    maxevents = luaL_optinteger(L, 2, 0); /* 0 = all */
+    q = EVQUEUE(ud);
+    lua_newtable(L);
+    if(!q)
+        { lua_pushinteger(L, 0); return 2; }
+    head = ATOMIC_ACQUIRE(q->head);
+    tail = q->tail;
+    for( ; tail != head && (maxevents <= 0 || (lua_Integer)n < maxevents); tail++)
+        {
+        ev = &q->ring[tail & (RINGSIZE - 1)];
+        lua_newtable(L);
+        pusheventtype(L, ev->type);
+        lua_setfield(L, -2, "type");
+        switch(ev->type)
+            {
+            case AL_EVENT_TYPE_SOURCE_STATE_CHANGED_SOFT:
+                pushsourcestate(L, ev->param);
+                lua_setfield(L, -2, "state");
+                break;
+            case AL_EVENT_TYPE_BUFFER_COMPLETED_SOFT:
+                lua_pushinteger(L, ev->param);
+                lua_setfield(L, -2, "buffers");
+                break;
+            default:
+                break;
+            }
+        if(ev->type != AL_EVENT_TYPE_DISCONNECTED_SOFT &&
+                (source_ud = spatial_source(ud, ev->object)) != NULL)
+            {
+            pushsource(L, (source_t)source_ud->handle);
+            lua_setfield(L, -2, "source");
+            }
+        lua_pushstring(L, ev->message);
+        lua_setfield(L, -2, "message");
+        lua_rawseti(L, -2, ++n);
+        }
+    ATOMIC_RELEASE(q->tail, tail);
+    dropped = ATOMIC_LOAD(q->dropped);
+    ATOMIC_SUB(q->dropped, dropped); /* reset, but keep those dropped meanwhile */
+    notify_update(ud);
+    lua_pushinteger(L, dropped);
+    return 2;
+    }
+
+static const struct luaL_Reg Functions[] =
+    {
+        { "event_control", events_control },
+        { "drain_events", events_drain },
+        { NULL, NULL } /* sentinel */
+    };
+
+void moonal_open_events(lua_State *L)
+    {
+    luaL_setfuncs(L, Functions, 0);
+    }
+
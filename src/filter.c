@@ -25,6 +25,12 @@
 
 #include "internal.h"
 
+typedef struct {
+    ALenum type; /* cached AL_FILTER_TYPE (set only via set_type) */
+} fltinfo_t;
+
+#define FILTERTYPE(ud) (((fltinfo_t*)(ud)->info)->type)
+
 static int freefilter(lua_State *L, ud_t *ud)
     {
     filter_t filter = (filter_t)ud->handle;
@@ -42,6 +48,7 @@ static int Create(lua_State *L)
     {
     ALuint name;
     filter_t filter;
+    fltinfo_t *info;
     ud_t *ud, *context_ud;
     context_t old_context = current_context(L);
     context_t context = checkcontext(L, 1, &context_ud);
@@ -52,10 +59,13 @@ static int Create(lua_State *L)
     CheckErrorRestoreAl(L, old_context);
 
     filter = (object_t*)MallocNoErr(L, sizeof(object_t));
-    if(!filter)
+    info = (fltinfo_t*)MallocNoErr(L, sizeof(fltinfo_t));
+    if(!filter || !info)
         {
         make_context_current(L, old_context);
         context_ud->ddt->DeleteFilters(1, &name);
+        if(filter) Free(L, filter);
+        if(info) Free(L, info);
         return luaL_error(L, errstring(ERR_MEMORY));
         }
     
@@ -65,6 +75,7 @@ static int Create(lua_State *L)
     ud->device = context_ud->device;
     ud->parent_ud = context_ud;
     ud->destructor = freefilter;
+    ud->info = info; /* type is AL_FILTER_NULL (=0) on generation */
     ud->ddt = context_ud->ddt;
     ud->cdt = context_ud->cdt;
     TRACE_CREATE(filter, "filter");
@@ -75,7 +86,7 @@ static int Create(lua_State *L)
 static int GetFloat(lua_State *L, filter_t filter, ALenum param)
     {
     ALfloat val;
-    ud_t *ud = userdata(filter);
+    ud_t *ud = userdata(L, filter);
     CheckDevicePfn(L, ud, GetFilterf);
     ud->ddt->GetFilterf(filter->name, param, &val);
     CheckErrorAl(L);
@@ -86,7 +97,7 @@ static int GetFloat(lua_State *L, filter_t filter, ALenum param)
 static int SetFloat(lua_State *L, filter_t filter, ALenum param)
     {
     ALfloat val;
-    ud_t *ud = userdata(filter);
+    ud_t *ud = userdata(L, filter);
     CheckDevicePfn(L, ud, Filterf);
     val = luaL_checknumber(L, 3);
     ud->ddt->Filterf(filter->name, param, val);
@@ -95,26 +106,11 @@ static int SetFloat(lua_State *L, filter_t filter, ALenum param)
     }
 
 
-static ALenum FilterType(lua_State *L, filter_t filter)
-    {
-    ALenum val;
-    ud_t *ud = userdata(filter);
-    CheckDevicePfn(L, ud, GetFilteri);
-    ud->ddt->GetFilteri(filter->name, AL_FILTER_TYPE, &val);
-    CheckErrorAl(L);
-    return val;
-    }
-
-
 static int GetFilterType(lua_State *L)
     {
-    ALenum val;
     ud_t *ud;
-    filter_t filter = checkfilter(L, 1, &ud);
-    CheckDevicePfn(L, ud, GetFilteri);
-    ud->ddt->GetFilteri(filter->name, AL_FILTER_TYPE, &val);
-    CheckErrorAl(L);
-    pushfiltertype(L, val);
+    checkfilter(L, 1, &ud);
+    pushfiltertype(L, FILTERTYPE(ud));
     return 1;
     }
 
@@ -126,6 +122,7 @@ static int SetFilterType(lua_State *L)
     CheckDevicePfn(L, ud, Filteri);
     ud->ddt->Filteri(filter->name, AL_FILTER_TYPE, val);
     CheckErrorAl(L);
+    FILTERTYPE(ud) = val;
     return 0;
     }
 
@@ -218,10 +215,26 @@ static int SetBandpass(lua_State *L, filter_t filter)
     }
 
 
+ALenum checkfilterparam(lua_State *L, int arg, ud_t *ud)
+/* checks a parameter name for the current type of the filter (see automation.c) */
+    {
+    switch(FILTERTYPE(ud))
+        {
+        case AL_FILTER_LOWPASS:     return checklowpassparam(L, arg);
+        case AL_FILTER_HIGHPASS:    return checkhighpassparam(L, arg);
+        case AL_FILTER_BANDPASS:    return checkbandpassparam(L, arg);
+        case AL_FILTER_NULL:
+        default:
+            return luaL_argerror(L, 1, "undefined filter type");
+        }
+    return 0;
+    }
+
 static int GetFilter(lua_State *L)
     {
-    filter_t filter = checkfilter(L, 1, NULL);
-    ALenum filter_type = FilterType(L, filter);
+    ud_t *ud;
+    filter_t filter = checkfilter(L, 1, &ud);
+    ALenum filter_type = FILTERTYPE(ud);
 
     switch(filter_type)
         {
@@ -237,8 +250,9 @@ static int GetFilter(lua_State *L)
 
 static int SetFilter(lua_State *L)
     {
-    filter_t filter = checkfilter(L, 1, NULL);
-    ALenum filter_type = FilterType(L, filter);
+    ud_t *ud;
+    filter_t filter = checkfilter(L, 1, &ud);
+    ALenum filter_type = FILTERTYPE(ud);
 
     switch(filter_type)
         {
@@ -269,6 +283,8 @@ static const struct luaL_Reg Methods[] =
         { "set", SetFilter },
         { "get_type", GetFilterType },
         { "set_type", SetFilterType },
+        { "ramp", ramps_start },
+        { "cancel_ramps", ramps_cancel },
         { NULL, NULL } /* sentinel */
     };
 
@@ -0,0 +1,390 @@
+/* The MIT License (MIT)
+ *
+ * Copyright (c) 2018 Stefano Trettel
+ *
+ * Software repository: MoonAL, https://github.com/stetre/moonal
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+
+#include "internal.h"
+#include "codec.h"
+
+/*------------------------------------------------------------------------------*
+ | FLAC decoder                                                                 |
+ *------------------------------------------------------------------------------*/
+
+/* Decodes native FLAC streams ('fLaC' followed by the metadata blocks and the frames),
+ * with all the subframe types and channel decorrelations, and up to 24 bits per sample
+ * (the samples are reduced to 16 bits). Frame headers are validated with their CRC-8,
+ * which is also used to find the next frame when the data is not where expected (e.g.
+ * after a tag appended to the file). The CRC-16 of the frames is not checked.
+ */
+
+#define MAXCHANNELS 8
+
+typedef struct {
+    long first;         /* position of the first frame */
+    unsigned bps;       /* bits per sample, from STREAMINFO */
+    uint64_t cache;     /* bit reader */
+    int nbits;
+    int eod;            /* the data ended while reading bits */
+    int32_t *samples;   /* MAXCHANNELS x maxsamples */
+    size_t maxsamples;
+} flac_t;
+
+typedef struct {
+    unsigned blocksize;
+    unsigned channels;
+    unsigned assignment; /* 0-7 = independent, 8 = left/side, 9 = side/right, 10 = mid/side */
+    unsigned bps;
+} frame_t;
+
+/*------------------------------------------------------------------------------*
+ | Bit reader                                                                   |
+ *------------------------------------------------------------------------------*/
+
+static uint32_t getbits(decoder_t *dec, flac_t *st, int n)
+/* reads n (<= 32) bits, msb first */
+    {
+    int c;
+    if(n == 0) return 0;
+    while(st->nbits < n)
+        {
+        if((c = codec_byte(dec)) < 0) { st->eod = 1; c = 0; }
+        st->cache = (st->cache << 8) | (unsigned)c;
+        st->nbits += 8;
+        }
+    st->nbits -= n;
+    return (uint32_t)((st->cache >> st->nbits) & ((((uint64_t)1) << n) - 1));
+    }
+
+static int32_t getsbits(decoder_t *dec, flac_t *st, int n)
+/* reads a signed n bits value */
+    {
+    uint32_t v = getbits(dec, st, n);
+    if(n == 0 || n == 32) return (int32_t)v;
+    return (v >> (n - 1)) ? (int32_t)((int64_t)v - ((int64_t)1 << n)) : (int32_t)v;
+    }
+
+static uint32_t getunary(decoder_t *dec, flac_t *st)
+/* counts the 0 bits up to the next 1 bit (and consumes it) */
+    {
+    uint32_t n = 0;
+    uint64_t v;
+    int c, hi;
+    for(;;)
+        {
+        v = st->cache & ((((uint64_t)1) << st->nbits) - 1);
+        if(v != 0)
+            {
+            hi = 63 - __builtin_clzll(v);
+            n += st->nbits - 1 - hi;
+            st->nbits = hi;
+            return n;
+            }
+        n += st->nbits;
+        if((c = codec_byte(dec)) < 0) { st->eod = 1; st->nbits = 0; return n; }
+        st->cache = (unsigned)c;
+        st->nbits = 8;
+        }
+    }
+
+/*------------------------------------------------------------------------------*
+ | Frames                                                                       |
+ *------------------------------------------------------------------------------*/
+
+static const unsigned Bps[8] = { 0, 8, 12, 0, 16, 20, 24, 32 };
+
+static unsigned crc8(const unsigned char *p, int n)
+    {
+    unsigned crc = 0;
+    int i;
+    while(n-- > 0)
+        {
+        crc ^= *p++;
+        for(i = 0; i < 8; i++)
+            crc = (crc & 0x80) ? ((crc << 1) ^ 0x07) & 0xff : (crc << 1) & 0xff;
+        }
+    return crc;
+    }
+
+static int header(decoder_t *dec, flac_t *st, frame_t *h)
+/* Parses a frame header, whose first byte (0xff) has already been read.
+ * Returns 0 if it is a valid header, -1 otherwise. */
+    {
+    unsigned char b[16];
+    unsigned bscode, srcode, sscode;
+    int n = 0, c, k;
+#define NEXT() do { if((c = codec_byte(dec)) < 0) return -1; b[n++] = (unsigned char)c; } while(0)
+    b[n++] = 0xff;
+    NEXT();
+    if((c & 0xfe) != 0xf8) return -1; /* sync code, reserved bit, blocking strategy */
+    NEXT();
+    bscode = c >> 4;
+    srcode = c & 0x0f;
+    NEXT();
+    h->assignment = c >> 4;
+    sscode = (c >> 1) & 0x07;
+    if(bscode == 0 || srcode == 15 || h->assignment > 10 || sscode == 3 || (c & 1)) return -1;
+    NEXT(); /* frame or sample number, UTF-8 coded */
+    if((c & 0xc0) == 0x80 || c == 0xff) return -1;
+    for(k = 0; c & (0x80 >> k); k++);
+    while(k-- > 1)
+        {
+        NEXT();
+        if((c & 0xc0) != 0x80) return -1;
+        }
+    if(bscode == 1) h->blocksize = 192;
+    else if(bscode <= 5) h->blocksize = 576 << (bscode - 2);
+    else if(bscode == 6) { NEXT(); h->blocksize = c + 1; }
+    else if(bscode == 7) { NEXT(); NEXT(); h->blocksize = ((b[n-2] << 8) | b[n-1]) + 1; }
+    else h->blocksize = 256 << (bscode - 8);
+    if(srcode == 12) NEXT(); /* the sample rate of the stream is used anyway */
+    else if(srcode == 13 || srcode == 14) { NEXT(); NEXT(); }
+    NEXT();
+    if(crc8(b, n - 1) != b[n - 1]) return -1;
+#undef NEXT
+    h->channels = h->assignment < 8 ? h->assignment + 1 : 2;
+    h->bps = sscode == 0 ? st->bps : Bps[sscode];
+    if(h->channels != (unsigned)dec->channels) return -1;
+    return 0;
+    }
+
+static const char *residual(decoder_t *dec, flac_t *st, int32_t *s, unsigned n, unsigned order)
+/* decodes the residual of a subframe into s[order..n-1] */
+    {
+    unsigned method, porder, parts, p, k, bits, count, i = order, j;
+    uint32_t v;
+    method = getbits(dec, st, 2);
+    if(method > 1) return CODEC_CORRUPT;
+    porder = getbits(dec, st, 4);
+    parts = 1u << porder;
+    if((n & (parts - 1)) != 0 || (n >> porder) < order) return CODEC_CORRUPT;
+    for(p = 0; p < parts; p++)
+        {
+        count = (n >> porder) - (p == 0 ? order : 0);
+        k = getbits(dec, st, method == 0 ? 4 : 5);
+        if(k == (method == 0 ? 15u : 31u)) /* escape: unencoded samples */
+            {
+            bits = getbits(dec, st, 5);
+            for(j = 0; j < count; j++) s[i++] = getsbits(dec, st, (int)bits);
+            }
+        else
+            {
+            for(j = 0; j < count; j++)
+                {
+                v = (getunary(dec, st) << k) | getbits(dec, st, (int)k);
+                s[i++] = (int32_t)(v >> 1) ^ -(int32_t)(v & 1);
+                }
+            }
+        if(st->eod) return CODEC_TRUNCATED;
+        }
+    return NULL;
+    }
+
+static const char *subframe(decoder_t *dec, flac_t *st, int32_t *s, unsigned n, unsigned bps)
+/* decodes a subframe of n samples, bps bits each */
+    {
+    unsigned type, wasted = 0, order, precision, i, j;
+    int shift;
+    int32_t coef[32];
+    int64_t sum;
+    const char *errmsg;
+    if(getbits(dec, st, 1) != 0) return CODEC_CORRUPT;
+    type = getbits(dec, st, 6);
+    if(getbits(dec, st, 1)) /* wasted bits per sample */
+        {
+        wasted = getunary(dec, st) + 1;
+        if(wasted >= bps) return CODEC_CORRUPT;
+        bps -= wasted;
+        }
+    if(type == 0) /* constant */
+        {
+        s[0] = getsbits(dec, st, (int)bps);
+        for(i = 1; i < n; i++) s[i] = s[0];
+        }
+    else if(type == 1) /* verbatim */
+        {
+        for(i = 0; i < n; i++) s[i] = getsbits(dec, st, (int)bps);
+        }
+    else if(type >= 8 && type <= 12) /* fixed predictor */
+        {
+        order = type - 8;
+        if(order > n) return CODEC_CORRUPT;
+        for(i = 0; i < order; i++) s[i] = getsbits(dec, st, (int)bps);
+        if((errmsg = residual(dec, st, s, n, order)) != NULL) return errmsg;
+        switch(order)
+            {
+            case 1: for(i = 1; i < n; i++) s[i] += s[i-1]; break;
+            case 2: for(i = 2; i < n; i++) s[i] += 2*s[i-1] - s[i-2]; break;
+            case 3: for(i = 3; i < n; i++) s[i] += 3*s[i-1] - 3*s[i-2] + s[i-3]; break;
+            case 4: for(i = 4; i < n; i++) s[i] += 4*s[i-1] - 6*s[i-2] + 4*s[i-3] - s[i-4]; break;
+            default: break;
+            }
+        }
+    else if(type >= 32) /* linear predictor */
+        {
+        order = type - 31;
+        if(order > n) return CODEC_CORRUPT;
+        for(i = 0; i < order; i++) s[i] = getsbits(dec, st, (int)bps);
+        precision = getbits(dec, st, 4) + 1;
+        if(precision == 16) return CODEC_CORRUPT;
+        shift = getsbits(dec, st, 5);
+        if(shift < 0) return CODEC_CORRUPT;
+        for(i = 0; i < order; i++) coef[i] = getsbits(dec, st, (int)precision);
+        if((errmsg = residual(dec, st, s, n, order)) != NULL) return errmsg;
+        for(i = order; i < n; i++)
+            {
+            sum = 0;
+            for(j = 0; j < order; j++) sum += (int64_t)coef[j] * s[i-1-j];
+            s[i] += (int32_t)(sum >> shift);
+            }
+        }
+    else
+        return CODEC_CORRUPT;
+    if(st->eod) return CODEC_TRUNCATED;
+    if(wasted)
+        for(i = 0; i < n; i++) s[i] = (int32_t)((uint32_t)s[i] << wasted);
+    return NULL;
+    }
+
+static const char *Decode(decoder_t *dec)
+    {
+    flac_t *st = (flac_t*)dec->state;
+    frame_t h;
+    int32_t *s[MAXCHANNELS], l, r, m, d;
+    unsigned i, ch, bps;
+    long pos;
+    int c;
+    short *pcm;
+    const char *errmsg;
+    for(;;) /* look for the next frame header */
+        {
+        if((c = codec_byte(dec)) < 0) return NULL; /* end of data */
+        if(c != 0xff) continue;
+        pos = codec_tell(dec);
+        if(header(dec, st, &h) == 0) break;
+        if(codec_seek(dec, pos) != 0) return CODEC_CORRUPT;
+        }
+    if(h.bps == 0 || h.bps > 24) return CODEC_UNSUPPORTED;
+    if(h.blocksize > st->maxsamples)
+        {
+        free(st->samples);
+        st->maxsamples = 0;
+        if(!(st->samples = (int32_t*)malloc(MAXCHANNELS * h.blocksize * sizeof(int32_t))))
+            return CODEC_NOMEM;
+        st->maxsamples = h.blocksize;
+        }
+    st->nbits = 0;
+    st->eod = 0;
+    for(ch = 0; ch < h.channels; ch++)
+        {
+        s[ch] = st->samples + ch * st->maxsamples;
+        bps = h.bps;
+        if((h.assignment == 8 || h.assignment == 10) && ch == 1) bps++; /* side channel */
+        if(h.assignment == 9 && ch == 0) bps++;
+        if((errmsg = subframe(dec, st, s[ch], h.blocksize, bps)) != NULL) return errmsg;
+        }
+    st->nbits = 0; /* padding to the byte boundary */
+    if(codec_byte(dec) < 0 || codec_byte(dec) < 0) return CODEC_TRUNCATED; /* CRC-16 */
+    switch(h.assignment)
+        {
+        case 8: for(i = 0; i < h.blocksize; i++) s[1][i] = s[0][i] - s[1][i]; break;
+        case 9: for(i = 0; i < h.blocksize; i++) s[0][i] += s[1][i]; break;
+        case 10:
+            for(i = 0; i < h.blocksize; i++)
+                {
+                d = s[1][i];
+                m = (int32_t)(((uint32_t)s[0][i] << 1) | (d & 1));
+                l = (m + d) >> 1;
+                r = (m - d) >> 1;
+                s[0][i] = l;
+                s[1][i] = r;
+                }
+            break;
+        default: break;
+        }
+    if(!(pcm = codec_pcm(dec, h.blocksize))) return CODEC_NOMEM;
+    for(i = 0; i < h.blocksize; i++)
+        for(ch = 0; ch < h.channels; ch++)
+            *pcm++ = (short)(h.bps >= 16 ? s[ch][i] >> (h.bps - 16) : s[ch][i] << (16 - h.bps));
+    dec->npcm = h.blocksize;
+    return NULL;
+    }
+
+/*------------------------------------------------------------------------------*
+ | Stream                                                                       |
+ *------------------------------------------------------------------------------*/
+
+static const char *Open(decoder_t *dec)
+    {
+    unsigned char b[34];
+    unsigned type, len;
+    int last = 0, info = 0;
+    flac_t *st = (flac_t*)calloc(1, sizeof(flac_t));
+    if(!st) return CODEC_NOMEM;
+    dec->state = st;
+    if(codec_input(dec, b, 4) < 4 || memcmp(b, "fLaC", 4) != 0) return CODEC_INVALID;
+    while(!last) /* metadata blocks */
+        {
+        if(codec_input(dec, b, 4) < 4) return CODEC_INVALID;
+        last = b[0] & 0x80;
+        type = b[0] & 0x7f;
+        len = ((unsigned)b[1] << 16) | ((unsigned)b[2] << 8) | b[3];
+        if(type == 0) /* STREAMINFO */
+            {
+            if(len < 34 || codec_input(dec, b, 34) < 34) return CODEC_INVALID;
+            len -= 34;
+            dec->rate = ((long)b[10] << 12) | ((long)b[11] << 4) | (b[12] >> 4);
+            dec->channels = ((b[12] >> 1) & 0x07) + 1;
+            st->bps = (((b[12] & 0x01) << 4) | (b[13] >> 4)) + 1;
+            dec->frames = ((uint64_t)(b[13] & 0x0f) << 32) | ((uint64_t)b[14] << 24) |
+                          ((uint64_t)b[15] << 16) | ((uint64_t)b[16] << 8) | b[17];
+            info = 1;
+            }
+        else if(type == 127 || !info) /* invalid, or STREAMINFO is not the first block */
+            return CODEC_INVALID;
+        if(codec_seek(dec, codec_tell(dec) + (long)len) != 0) return CODEC_INVALID;
+        }
+    if(dec->rate == 0) return CODEC_INVALID;
+    if(st->bps > 24) return CODEC_UNSUPPORTED;
+    st->first = codec_tell(dec);
+    return NULL;
+    }
+
+static const char *Rewind(decoder_t *dec)
+    {
+    flac_t *st = (flac_t*)dec->state;
+    st->nbits = 0;
+    st->eod = 0;
+    return codec_seek(dec, st->first) == 0 ? NULL : CODEC_TRUNCATED;
+    }
+
+static void Close(decoder_t *dec)
+    {
+    flac_t *st = (flac_t*)dec->state;
+    if(!st) return;
+    free(st->samples);
+    free(st);
+    }
+
+const codec_t flac_codec = { Open, Decode, Rewind, Close };
+
@@ -54,26 +54,50 @@ static HMODULE Handle = NULL;
 static LPALGETPROCADDRESS AlGetProcAddress;
 static LPALCGETPROCADDRESS AlcGetProcAddress;
 
-static int Init(lua_State *L)
+/* The MOONAL_LIBOPENAL environment variable, if set, overrides the default
+ * library (e.g. to use the stub library in ../stub/).
+ */
+#define LIBENV "MOONAL_LIBOPENAL"
+
+static char ErrMsg[256];
+#define Error(...) do { snprintf(ErrMsg, sizeof(ErrMsg), __VA_ARGS__); return ErrMsg; } while(0)
+
+const char *moonal_init_getproc(void)
+/* Loads the library and fills the global dispatch tables, that are read-only from
+ * then on (except for the LAZY entries, see below). Executed once per process (see
+ * main.c), so it does not raise errors: it returns an error message, or NULL.
+ */
     {
+    const char *libname = getenv(LIBENV);
 #if defined(LINUX)
     char *err;
-    Handle = dlopen(LIBNAME, RTLD_LAZY | RTLD_LOCAL);
+    if(!libname) libname = LIBNAME;
+    Handle = dlopen(libname, RTLD_LAZY | RTLD_LOCAL);
     if(!Handle)
         {
         err = dlerror();
-        return luaL_error(L, err != NULL ? err : "cannot load " LIBNAME);
+        if(err) Error("%s", err);
+        Error("cannot load %s", libname);
         }
 
     FP(AlGetProcAddress) = dlsym(Handle, "alGetProcAddress");
     FP(AlcGetProcAddress) = dlsym(Handle, "alcGetProcAddress");
 
 #elif defined(MINGW)
-    Handle = LoadLibraryW(LLIBNAME);
-    if(!Handle)
-        Handle = LoadLibraryW(LLIBNAME1);
-    if(!Handle)
-        return luaL_error(L, "cannot load " LIBNAME " or " LIBNAME1);
+    if(libname)
+        {
+        Handle = LoadLibraryA(libname);
+        if(!Handle)
+            Error("cannot load %s", libname);
+        }
+    else
+        {
+        Handle = LoadLibraryW(LLIBNAME);
+        if(!Handle)
+            Handle = LoadLibraryW(LLIBNAME1);
+        if(!Handle)
+            Error("cannot load " LIBNAME " or " LIBNAME1);
+        }
 
     AlGetProcAddress = (LPALGETPROCADDRESS)GetProcAddress(Handle, "alGetProcAddress");
     AlcGetProcAddress = (LPALCGETPROCADDRESS)GetProcAddress(Handle, "alcGetProcAddress");
@@ -81,57 +105,63 @@ static int Init(lua_State *L)
 #endif
 
     if(!AlGetProcAddress)
-        return luaL_error(L, "cannot find alGetProcAddress");
+        Error("cannot find alGetProcAddress");
     if(!AlcGetProcAddress)
-        return luaL_error(L, "cannot find alcGetProcAddress");
-
-    /* Fill the global dispatch tables */
+        Error("cannot find alcGetProcAddress");
+
+    /* Fill the global dispatch tables.
+     * Entry points marked with LAZY are rarely used and are resolved only on first use
+     * (see CheckAlPfn and CheckAlcPfn in getproc.h), to keep the module's load time short.
+     * The tables are shared by all the states and threads, so getproc_al/alc() publish
+     * each of them atomically and at most once.
+     */
+#define LAZY(fn)
 #define GET(fn) do {                                            \
     FP(al.fn) = AlGetProcAddress("al"#fn);                      \
-    if(!al.fn) return luaL_error(L, "cannot find al"#fn);       \
+    if(!al.fn) Error("cannot find al"#fn);                      \
 } while(0)
     GET(Enable);
     GET(Disable);
     GET(IsEnabled);
     GET(GetString);
-    GET(GetBooleanv);
-    GET(GetIntegerv);
-    GET(GetFloatv);
-    GET(GetDoublev);
+    LAZY(GetBooleanv);
+    LAZY(GetIntegerv);
+    LAZY(GetFloatv);
+    LAZY(GetDoublev);
     GET(GetBoolean);
     GET(GetInteger);
     GET(GetFloat);
-    GET(GetDouble);
+    LAZY(GetDouble);
     GET(GetError);
     GET(IsExtensionPresent);
-    GET(GetProcAddress);
-    GET(GetEnumValue);
+    LAZY(GetProcAddress);
+    LAZY(GetEnumValue);
     GET(Listenerf);
-    GET(Listener3f);
+    LAZY(Listener3f);
     GET(Listenerfv);
-    GET(Listeneri);
-    GET(Listener3i);
-    GET(Listeneriv);
+    LAZY(Listeneri);
+    LAZY(Listener3i);
+    LAZY(Listeneriv);
     GET(GetListenerf);
-    GET(GetListener3f);
+    LAZY(GetListener3f);
     GET(GetListenerfv);
-    GET(GetListeneri);
-    GET(GetListener3i);
-    GET(GetListeneriv);
+    LAZY(GetListeneri);
+    LAZY(GetListener3i);
+    LAZY(GetListeneriv);
     GET(GenSources);
     GET(DeleteSources);
-    GET(IsSource);
+    LAZY(IsSource);
     GET(Sourcef);
-    GET(Source3f);
+    LAZY(Source3f);
     GET(Sourcefv);
     GET(Sourcei);
-    GET(Source3i);
+    LAZY(Source3i);
     GET(Sourceiv);
     GET(GetSourcef);
-    GET(GetSource3f);
+    LAZY(GetSource3f);
     GET(GetSourcefv);
     GET(GetSourcei);
-    GET(GetSource3i);
+    LAZY(GetSource3i);
     GET(GetSourceiv);
     GET(SourcePlayv);
     GET(SourceStopv);
@@ -145,29 +175,29 @@ static int Init(lua_State *L)
     GET(SourceUnqueueBuffers);
     GET(GenBuffers);
     GET(DeleteBuffers);
-    GET(IsBuffer);
+    LAZY(IsBuffer);
     GET(BufferData);
-    GET(Bufferf);
-    GET(Buffer3f);
-    GET(Bufferfv);
+    LAZY(Bufferf);
+    LAZY(Buffer3f);
+    LAZY(Bufferfv);
     GET(Bufferi);
-    GET(Buffer3i);
+    LAZY(Buffer3i);
     GET(Bufferiv);
     GET(GetBufferf);
-    GET(GetBuffer3f);
-    GET(GetBufferfv);
+    LAZY(GetBuffer3f);
+    LAZY(GetBufferfv);
     GET(GetBufferi);
-    GET(GetBuffer3i);
+    LAZY(GetBuffer3i);
     GET(GetBufferiv);
-    GET(DopplerFactor);
-    GET(DopplerVelocity);
-    GET(SpeedOfSound);
-    GET(DistanceModel);
+    LAZY(DopplerFactor);
+    LAZY(DopplerVelocity);
+    LAZY(SpeedOfSound);
+    LAZY(DistanceModel);
 #undef GET
 
 #define GET(fn) do {                                            \
     FP(alc.fn) = AlcGetProcAddress(NULL, "alc"#fn);             \
-    if(!alc.fn) return luaL_error(L, "cannot find alc"#fn);     \
+    if(!alc.fn) Error("cannot find alc"#fn);                    \
 } while(0)
 #define OPT(fn) do {                                            \
     FP(alc.fn) = AlcGetProcAddress(NULL, "alc"#fn);             \
@@ -178,29 +208,57 @@ static int Init(lua_State *L)
     GET(SuspendContext);
     GET(DestroyContext);
     GET(GetCurrentContext);
+    OPT(SetThreadContext);
+    OPT(GetThreadContext);
     GET(GetContextsDevice);
     GET(OpenDevice);
     GET(CloseDevice);
     GET(GetError);
     GET(IsExtensionPresent);
-    GET(GetProcAddress);
-    GET(GetEnumValue);
+    LAZY(GetProcAddress);
+    LAZY(GetEnumValue);
     GET(GetString);
     GET(GetIntegerv);
-    GET(CaptureOpenDevice);
-    GET(CaptureCloseDevice);
-    GET(CaptureStart);
-    GET(CaptureStop);
-    GET(CaptureSamples);
-//  IF("ALC_SOFT_loopback")
-//      {
-        GET(LoopbackOpenDeviceSOFT);
-        GET(IsRenderFormatSupportedSOFT);
-        GET(RenderSamplesSOFT);
-//      }
+    LAZY(CaptureOpenDevice);
+    LAZY(CaptureCloseDevice);
+    LAZY(CaptureStart);
+    LAZY(CaptureStop);
+    LAZY(CaptureSamples);
+    LAZY(LoopbackOpenDeviceSOFT); /* ALC_SOFT_loopback */
+    LAZY(IsRenderFormatSupportedSOFT);
+    LAZY(RenderSamplesSOFT);
 #undef OPT
 #undef GET
-    return 0;
+#undef LAZY
+    return NULL;
+    }
+#undef Error
+
+static void *publish(void **pp, void *p)
+/* Publishes a lazily resolved entry point. Concurrent first uses from different
+ * threads resolve the same address, and only the first of them writes it, so that
+ * once a caller has seen the slot set it is never written again.
+ */
+    {
+    void *expected = NULL;
+    if(p == NULL) return NULL;
+    if(!ATOMIC_PUBLISH(*pp, expected, p)) return expected; /* set by another thread */
+    return p;
+    }
+
+void *getproc_al(const char *name, void **pp)
+/* resolves a lazily loaded entry point */
+    {
+    void *p = ATOMIC_ACQUIRE(*pp);
+    if(p) return p;
+    return publish(pp, (void*)AlGetProcAddress(name));
+    }
+
+void *getproc_alc(const char *name, void **pp)
+    {
+    void *p = ATOMIC_ACQUIRE(*pp);
+    if(p) return p;
+    return publish(pp, (void*)AlcGetProcAddress(NULL, name));
     }
 
 /*----------------------------------------------------------------------------------*/
@@ -283,7 +341,7 @@ context_dt_t* getproc_context(lua_State *L, context_t context)
     {
     context_dt_t *dt = (context_dt_t*)Malloc(L, sizeof(context_dt_t));
     context_t old_context = alc.GetCurrentContext();
-    alc.MakeContextCurrent(context);
+    set_current_context(context);
 
 #define GET(fn) do {                                            \
     FP(dt->fn) = AlGetProcAddress("al"#fn);                     \
@@ -334,9 +392,26 @@ context_dt_t* getproc_context(lua_State *L, context_t context)
         {
         GET(GetStringiSOFT);
         }
+    IF("AL_SOFT_events")
+        {
+        GET(EventControlSOFT);
+        GET(EventCallbackSOFT);
+        }
+    IF("AL_SOFT_map_buffer")
+        {
+        GET(BufferStorageSOFT);
+        GET(MapBufferSOFT);
+        GET(UnmapBufferSOFT);
+        GET(FlushMappedBufferSOFT);
+        }
+    IF("AL_SOFT_source_start_delay")
+        {
+        GET(SourcePlayAtTimeSOFT);
+        GET(SourcePlayAtTimevSOFT);
+        }
 #undef IF
 #undef GET
-    alc.MakeContextCurrent(old_context);
+    set_current_context(old_context);
     return dt;
     }
  
@@ -429,7 +504,6 @@ static const struct luaL_Reg Functions[] =
 
 int moonal_open_getproc(lua_State *L)
     {
-    Init(L);
     luaL_setfuncs(L, Functions, 0);
     return 0;
     }
@@ -28,8 +28,13 @@
 
 #define TestDevicePfn(L, ud, pfn) ((ud)->ddt->pfn!=NULL)
 
+/* CheckAlPfn and CheckAlcPfn also resolve the entry points that are lazily loaded */
+#define CheckAlPfn(L, pfn) \
+    do { if(getproc_al("al"#pfn, (void**)&al.pfn)==NULL) return luaL_error((L),  \
+            ""#pfn" address not loaded (extension not available)"); } while(0)
+
 #define CheckAlcPfn(L, pfn) \
-    do { if(alc.pfn==NULL) return luaL_error((L),   \
+    do { if(getproc_alc("alc"#pfn, (void**)&alc.pfn)==NULL) return luaL_error((L), \
             ""#pfn" address not loaded (extension not available)"); } while(0)
 
 #define CheckDevicePfn(L, ud, pfn) \
@@ -125,6 +130,8 @@ typedef struct {
     LPALCSUSPENDCONTEXT SuspendContext;
     LPALCDESTROYCONTEXT DestroyContext;
     LPALCGETCURRENTCONTEXT GetCurrentContext;
+    PFNALCSETTHREADCONTEXTPROC SetThreadContext; /* ALC_EXT_thread_local_context (optional) */
+    PFNALCGETTHREADCONTEXTPROC GetThreadContext;
     LPALCGETCONTEXTSDEVICE GetContextsDevice;
     LPALCOPENDEVICE OpenDevice;
     LPALCCLOSEDEVICE CloseDevice;
@@ -217,6 +224,14 @@ typedef struct {
     LPALDEFERUPDATESSOFT DeferUpdatesSOFT;
     LPALPROCESSUPDATESSOFT ProcessUpdatesSOFT;
     LPALGETSTRINGISOFT GetStringiSOFT;
+    LPALEVENTCONTROLSOFT EventControlSOFT;
+    LPALEVENTCALLBACKSOFT EventCallbackSOFT;
+    LPALBUFFERSTORAGESOFT BufferStorageSOFT;
+    LPALMAPBUFFERSOFT MapBufferSOFT;
+    LPALUNMAPBUFFERSOFT UnmapBufferSOFT;
+    LPALFLUSHMAPPEDBUFFERSOFT FlushMappedBufferSOFT;
+    LPALSOURCEPLAYATTIMESOFT SourcePlayAtTimeSOFT;
+    LPALSOURCEPLAYATTIMEVSOFT SourcePlayAtTimevSOFT;
 } context_dt_t;
 
 #undef F
@@ -226,6 +241,10 @@ extern moonal_al_dt_t al;
 #define alc moonal_alc
 extern moonal_alc_dt_t alc;
 
+#define getproc_al moonal_getproc_al
+void *getproc_al(const char *name, void **pp);
+#define getproc_alc moonal_getproc_alc
+void *getproc_alc(const char *name, void **pp);
 #define getproc_device moonal_getproc_device
 device_dt_t* getproc_device(lua_State *L, device_t device);
 #define getproc_context moonal_getproc_context
@@ -31,6 +31,7 @@
 #define internalDEFINED
 
 #define _ISOC11_SOURCE /* see man aligned_alloc(3) */
+#include <stdio.h>
 #include <string.h>
 #include <stdlib.h>
 #include <time.h>
@@ -46,10 +47,42 @@ typedef struct { ALuint name; } object_t;
 #define effect_t object_t*
 #define filter_t object_t*
 #define auxslot_t object_t*
+#define voicepool_t struct moonal_voicepool_s*
+#define mapping_t struct moonal_mapping_s*
+#define stream_t struct moonal_stream_s*
+typedef struct moonal_shadow_s shadow_t;
+typedef struct moonal_spatial_s spatial_t;
+typedef struct moonal_ramplist_s ramplist_t;
+typedef struct moonal_vlist_s vlist_t;
+typedef struct moonal_pendlist_s pendlist_t;
+typedef struct moonal_loadqueue_s loadqueue_t;
+typedef struct moonal_loadjob_s loadjob_t;
+typedef struct moonal_decoder_s decoder_t;
+typedef struct moonal_bufcache_s bufcache_t;
+typedef struct moonal_cacheentry_s cacheentry_t;
+typedef struct moonal_residency_s residency_t;
+typedef struct moonal_resentry_s resentry_t;
+typedef struct moonal_evqueue_s evqueue_t;
+typedef struct moonal_notifier_s notifier_t;
+typedef struct moonal_scheduler_s scheduler_t;
+typedef struct moonal_telemetry_s telemetry_t;
 
 #define TOSTR_(x) #x
 #define TOSTR(x) TOSTR_(x)
 
+/* Atomic operations on process-wide counters (GCC builtins) */
+#define ATOMIC_ADD(var, n) __atomic_add_fetch(&(var), (n), __ATOMIC_RELAXED)
+#define ATOMIC_SUB(var, n) __atomic_sub_fetch(&(var), (n), __ATOMIC_RELAXED)
+#define ATOMIC_LOAD(var) __atomic_load_n(&(var), __ATOMIC_RELAXED)
+#define ATOMIC_CAS(var, expected, desired) __atomic_compare_exchange_n(&(var), &(expected), \
+                            (desired), 1, __ATOMIC_RELAXED, __ATOMIC_RELAXED)
+/* ... and on the indices of single-producer/single-consumer rings */
+#define ATOMIC_ACQUIRE(var) __atomic_load_n(&(var), __ATOMIC_ACQUIRE)
+#define ATOMIC_RELEASE(var, val) __atomic_store_n(&(var), (val), __ATOMIC_RELEASE)
+/* ... and on pointers that are set once and then only read */
+#define ATOMIC_PUBLISH(var, expected, desired) __atomic_compare_exchange_n(&(var), &(expected), \
+                            (desired), 0, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE)
+
 #include "tree.h"
 #include "getproc.h"
 #include "objects.h"
@@ -75,6 +108,10 @@ double now(void);
 #define since(t) (now() - (t))
 #define sleeep moonal_sleeep
 void sleeep(double seconds);
+#define tsadd moonal_tsadd
+void tsadd(struct timespec *ts, int64_t ns);
+#define tsdiff moonal_tsdiff
+int64_t tsdiff(const struct timespec *a, const struct timespec *b);
 #define notavailable moonal_notavailable
 int notavailable(lua_State *L, ...);
 #define tablelen moonal_tablelen
@@ -95,12 +132,16 @@ void *MallocNoErr(lua_State *L, size_t size);
 char *Strdup(lua_State *L, const char *s);
 #define Free moonal_Free
 void Free(lua_State *L, void *ptr);
+#define malloc_stats moonal_malloc_stats
+void malloc_stats(size_t *bytes, size_t *peak, size_t *blocks);
 #define checkboolean moonal_checkboolean
 int checkboolean(lua_State *L, int arg);
 #define testboolean moonal_testboolean
 int testboolean(lua_State *L, int arg, int *err);
 #define optboolean moonal_optboolean
 int optboolean(lua_State *L, int arg, int d);
+#define optfield moonal_optfield
+long optfield(lua_State *L, int arg, const char *name, long defval);
 #define checklightuserdata moonal_checklightuserdata
 void *checklightuserdata(lua_State *L, int arg);
 #define optlightuserdata moonal_optlightuserdata
@@ -141,16 +182,318 @@ size_t formatframesize(lua_State *L, ALenum fmt, ALsizei align);
 const char* errstring(int err);
 
 /* context.c */
+#define set_current_context moonal_set_current_context
+ALCboolean set_current_context(context_t context);
 #define make_context_current moonal_make_context_current
 int make_context_current(lua_State *L, context_t context);
 #define current_context moonal_current_context
 context_t current_context(lua_State *L);
 #define current_device moonal_current_device
 device_t current_device(lua_State *L);
+#define begin_deferred moonal_begin_deferred
+int begin_deferred(ud_t *context_ud);
+#define end_deferred moonal_end_deferred
+void end_deferred(ud_t *context_ud, int opened);
+typedef struct {
+    /* per-context state of the modules (NULL until needed) */
+    spatial_t *spatial;     /* see spatial.c */
+    ramplist_t *ramps;      /* see automation.c */
+    vlist_t *vsources;      /* see virtual.c */
+    pendlist_t *pending;    /* see shadow.c */
+    loadqueue_t *loads;     /* see loader.c */
+    bufcache_t *bufcache;   /* see bufcache.c */
+    residency_t *residency; /* see residency.c */
+    evqueue_t *events;      /* see events.c */
+    notifier_t *notifier;   /* see notify.c */
+    scheduler_t *scheduler; /* see schedule.c */
+    telemetry_t *telemetry; /* see telemetry.c */
+} ctxinfo_t;
+#define CTXINFO(context_ud) ((ctxinfo_t*)(context_ud)->info)
+
+/* buffer.c */
+#define newbuffer moonal_newbuffer
+buffer_t newbuffer(lua_State *L, ud_t *context_ud, ALuint name);
+#define buffer_upload moonal_buffer_upload
+ALenum buffer_upload(ud_t *ud, ALenum format, const void *data, size_t size, ALsizei freq);
+#define buffer_storage moonal_buffer_storage
+ALenum buffer_storage(ud_t *ud, ALenum format, const void *data, size_t size, ALsizei freq, ALbitfieldSOFT flags);
+typedef struct {
+    size_t size;        /* bytes of data currently stored in the buffer */
+    ALenum format;      /* format and frequency of the stored data */
+    ALsizei freq;
+    loadjob_t *job;     /* last asynchronous load, see loader.c */
+    cacheentry_t *cached; /* see bufcache.c */
+    resentry_t *resident; /* see residency.c */
+} bufinfo_t;
+#define BUFINFO(ud) ((bufinfo_t*)(ud)->info)
+
+/* source.c */
+#define newsource moonal_newsource
+source_t newsource(lua_State *L, ud_t *context_ud, ALuint name);
+typedef struct moonal_srcinfo_s {
+    RB_ENTRY(moonal_srcinfo_s) entry; /* name index of the context, see spatial.c */
+    ALuint name;
+    ud_t *ud;
+    size_t slot;    /* index in the spatial store of the context, see spatial.c */
+    shadow_t *shadow; /* see shadow.c */
+} srcinfo_t;
+#define SRCINFO(ud) ((srcinfo_t*)(ud)->info)
+
+/* listener.c */
+typedef struct {
+    shadow_t *shadow; /* see shadow.c */
+} lstinfo_t;
+#define LSTINFO(ud) ((lstinfo_t*)(ud)->info)
+
+/* effect.c */
+#define checkeffectparam moonal_checkeffectparam
+ALenum checkeffectparam(lua_State *L, int arg, ud_t *ud);
+
+/* filter.c */
+#define checkfilterparam moonal_checkfilterparam
+ALenum checkfilterparam(lua_State *L, int arg, ud_t *ud);
+
+/* automation.c */
+#define RAMP_SOURCE     1   /* ramp targets */
+#define RAMP_LISTENER   2
+#define RAMP_EFFECT     3
+#define RAMP_FILTER     4
+#define RAMP_AUXSLOT    5
+#define ramps_add moonal_ramps_add
+void ramps_add(lua_State *L, ud_t *ud, int target, ALenum param, int n, const double from[3],
+                const double to[3], double duration, int curve, ud_t *attach_ud);
+#define ramps_forget moonal_ramps_forget
+void ramps_forget(lua_State *L, ud_t *ud);
+#define ramps_free moonal_ramps_free
+void ramps_free(lua_State *L, ud_t *context_ud);
+#define ramps_start moonal_ramps_start
+int ramps_start(lua_State *L);
+#define ramps_cancel moonal_ramps_cancel
+int ramps_cancel(lua_State *L);
+#define ramps_tick moonal_ramps_tick
+int ramps_tick(lua_State *L);
+
+/* virtual.c */
+#define source_attenuation moonal_source_attenuation
+double source_attenuation(source_t source, const ALfloat listener[3], ALenum model);
+#define virtual_forget moonal_virtual_forget
+void virtual_forget(lua_State *L, ud_t *ud);
+#define virtual_free moonal_virtual_free
+void virtual_free(lua_State *L, ud_t *context_ud);
+#define virtual_set moonal_virtual_set
+int virtual_set(lua_State *L);
+#define virtual_is moonal_virtual_is
+int virtual_is(lua_State *L);
+#define virtual_cull moonal_virtual_cull
+int virtual_cull(lua_State *L);
+
+/* shadow.c */
+#define shadow_store moonal_shadow_store
+void shadow_store(ud_t *ud, ALenum param, const ALfloat *val);
+#define shadow_store_arg moonal_shadow_store_arg
+void shadow_store_arg(lua_State *L, ud_t *ud, ALenum param, int arg);
+#define shadow_get moonal_shadow_get
+int shadow_get(lua_State *L, ud_t *ud, ALenum param);
+#define shadow_forget moonal_shadow_forget
+void shadow_forget(lua_State *L, ud_t *ud);
+#define shadow_free moonal_shadow_free
+void shadow_free(lua_State *L, ud_t *context_ud);
+#define shadow_enable moonal_shadow_enable
+int shadow_enable(lua_State *L);
+#define shadow_enabled moonal_shadow_enabled
+int shadow_enabled(lua_State *L);
+#define shadow_defer moonal_shadow_defer
+int shadow_defer(lua_State *L, ud_t *ud, ALenum param, int arg);
+#define shadow_coalesce moonal_shadow_coalesce
+int shadow_coalesce(lua_State *L);
+#define shadow_coalesced moonal_shadow_coalesced
+int shadow_coalesced(lua_State *L);
+#define shadow_commit moonal_shadow_commit
+int shadow_commit(lua_State *L);
+
+/* spatial.c */
+#define spatial_init moonal_spatial_init
+void spatial_init(lua_State *L, ud_t *context_ud);
+#define spatial_add moonal_spatial_add
+void spatial_add(lua_State *L, ud_t *ud);
+#define spatial_forget moonal_spatial_forget
+void spatial_forget(lua_State *L, ud_t *ud);
+#define spatial_source moonal_spatial_source
+ud_t *spatial_source(ud_t *context_ud, ALuint name);
+#define spatial_free moonal_spatial_free
+void spatial_free(lua_State *L, ud_t *context_ud);
+#define spatial_position moonal_spatial_position
+void spatial_position(ud_t *ud, const ALfloat pos[3]);
+#define spatial_relative moonal_spatial_relative
+void spatial_relative(ud_t *ud, int relative);
+#define spatial_listener moonal_spatial_listener
+void spatial_listener(ud_t *context_ud, const ALfloat pos[3]);
+#define spatial_query moonal_spatial_query
+int spatial_query(lua_State *L);
+#define spatial_nearest moonal_spatial_nearest
+int spatial_nearest(lua_State *L);
+#define spatial_grid moonal_spatial_grid
+int spatial_grid(lua_State *L);
+
+/* loader.c */
+#define loader_forget moonal_loader_forget
+void loader_forget(lua_State *L, ud_t *ud);
+#define loader_free moonal_loader_free
+void loader_free(lua_State *L, ud_t *context_ud);
+#define loader_async moonal_loader_async
+int loader_async(lua_State *L);
+#define loader_poll moonal_loader_poll
+int loader_poll(lua_State *L);
+#define loader_status moonal_loader_status
+int loader_status(lua_State *L);
+#define loader_queue moonal_loader_queue
+int loader_queue(lua_State *L, ud_t *ud, const char *path, long offset, long length, ALenum format, ALsizei freq);
+#define loader_source moonal_loader_source
+const char *loader_source(ud_t *ud, long *offset, long *length, ALenum *format, ALsizei *freq);
+#define loader_ready moonal_loader_ready
+int loader_ready(ud_t *context_ud);
+#define loader_setfd moonal_loader_setfd
+void loader_setfd(ud_t *context_ud, int fd);
+#define loader_wavheader moonal_loader_wavheader
+const char *loader_wavheader(FILE *f, ALenum *format, ALsizei *freq, size_t *size, size_t *framesize, int *convert);
+#define loader_tofloat moonal_loader_tofloat
+size_t loader_tofloat(const void *src, size_t size, int bits, float *dst);
+
+/* codec.c */
+#define codec_probe moonal_codec_probe
+int codec_probe(FILE *f);
+#define codec_open moonal_codec_open
+decoder_t *codec_open(FILE *f, long length, ALenum *format, ALsizei *freq, size_t *size, const char **errmsg);
+#define codec_read moonal_codec_read
+size_t codec_read(decoder_t *dec, void *dst, size_t size, const char **errmsg);
+#define codec_rewind moonal_codec_rewind
+int codec_rewind(decoder_t *dec);
+#define codec_close moonal_codec_close
+void codec_close(decoder_t *dec);
+
+/* bufcache.c */
+#define bufcache_forget moonal_bufcache_forget
+void bufcache_forget(lua_State *L, ud_t *ud);
+#define bufcache_free moonal_bufcache_free
+void bufcache_free(lua_State *L, ud_t *context_ud);
+#define bufcache_data moonal_bufcache_data
+int bufcache_data(lua_State *L);
+#define bufcache_release moonal_bufcache_release
+int bufcache_release(lua_State *L);
+#define bufcache_stats moonal_bufcache_stats
+int bufcache_stats(lua_State *L);
+
+/* residency.c */
+#define residency_update moonal_residency_update
+void residency_update(ud_t *ud, size_t oldsize);
+#define residency_touch moonal_residency_touch
+void residency_touch(lua_State *L, ud_t *context_ud, const ALuint *sources, uint32_t count);
+#define residency_cancel moonal_residency_cancel
+void residency_cancel(lua_State *L, ud_t *context_ud, const ALuint *sources, uint32_t count);
+#define residency_loaded moonal_residency_loaded
+void residency_loaded(lua_State *L, ud_t *ud, int ok);
+#define residency_enforce moonal_residency_enforce
+void residency_enforce(lua_State *L, ud_t *context_ud);
+#define residency_forget moonal_residency_forget
+void residency_forget(lua_State *L, ud_t *ud);
+#define residency_free moonal_residency_free
+void residency_free(lua_State *L, ud_t *context_ud);
+#define residency_manage moonal_residency_manage
+int residency_manage(lua_State *L);
+#define residency_ensure moonal_residency_ensure
+int residency_ensure(lua_State *L);
+#define residency_budget moonal_residency_budget
+int residency_budget(lua_State *L);
+#define residency_stats moonal_residency_stats
+int residency_stats(lua_State *L);
+
+/* events.c */
+#define events_free moonal_events_free
+void events_free(lua_State *L, ud_t *context_ud);
+#define events_control moonal_events_control
+int events_control(lua_State *L);
+#define events_drain moonal_events_drain
+int events_drain(lua_State *L);
+#define events_pending moonal_events_pending
+int events_pending(ud_t *context_ud);
+#define events_setfd moonal_events_setfd
+void events_setfd(ud_t *context_ud, int fd);
+
+/* notify.c */
+#define notify_signal moonal_notify_signal
+void notify_signal(int fd);
+#define notify_fd moonal_notify_fd
+int notify_fd(ud_t *context_ud);
+#define notify_update moonal_notify_update
+void notify_update(ud_t *context_ud);
+#define notify_free moonal_notify_free
+void notify_free(lua_State *L, ud_t *context_ud);
+#define notify_eventfd moonal_notify_eventfd
+int notify_eventfd(lua_State *L);
+
+/* schedule.c */
+#define schedule_forget moonal_schedule_forget
+void schedule_forget(lua_State *L, ud_t *ud);
+#define schedule_cancel moonal_schedule_cancel
+void schedule_cancel(lua_State *L, ud_t *context_ud, const ALuint *sources, uint32_t count);
+#define schedule_free moonal_schedule_free
+void schedule_free(lua_State *L, ud_t *context_ud);
+#define schedule_play moonal_schedule_play
+int schedule_play(lua_State *L);
+
+/* telemetry.c */
+#define telemetry_forget moonal_telemetry_forget
+void telemetry_forget(lua_State *L, ud_t *ud);
+#define telemetry_free moonal_telemetry_free
+void telemetry_free(lua_State *L, ud_t *context_ud);
+#define telemetry_start moonal_telemetry_start
+int telemetry_start(lua_State *L);
+#define telemetry_stop moonal_telemetry_stop
+int telemetry_stop(lua_State *L);
+#define telemetry_stats moonal_telemetry_stats
+int telemetry_stats(lua_State *L);
+#define telemetry_samples moonal_telemetry_samples
+int telemetry_samples(lua_State *L);
+
+/* mapping.c */
+#define mapping_checkflags moonal_mapping_checkflags
+ALbitfieldSOFT mapping_checkflags(lua_State *L, int arg, int required);
+#define mapping_map moonal_mapping_map
+int mapping_map(lua_State *L);
+
+/* stream.c */
+#define stream_open moonal_stream_open
+int stream_open(lua_State *L);
+#define stream_updateall moonal_stream_updateall
+int stream_updateall(lua_State *L);
+
+/* datahandling.c */
+#define sizeoftype moonal_sizeoftype
+size_t sizeoftype(int type);
+#define datahandling_pack moonal_datahandling_pack
+size_t datahandling_pack(lua_State *L, int type, int arg, void *dst, size_t dstsize, int *err);
+#define datahandling_unpack moonal_datahandling_unpack
+int datahandling_unpack(lua_State *L, int type, const void *data, size_t len);
 
 /* tracing.c */
 #define trace_objects moonal_trace_objects
 extern int trace_objects;
+#define trace_calls moonal_trace_calls
+extern int trace_calls;
+#define trace_call moonal_trace_call
+void trace_call(const char *name, double t0, uint64_t id, double arg);
+#define trace_instant moonal_trace_instant
+void trace_instant(const char *name, uint64_t id);
+
+/* stats.c */
+#define mttoobjtype moonal_mttoobjtype
+int mttoobjtype(const char *mt);
+#define stats_created moonal_stats_created
+void stats_created(int type);
+#define stats_deleted moonal_stats_deleted
+void stats_deleted(int type);
+#define stats_buffer_bytes moonal_stats_buffer_bytes
+void stats_buffer_bytes(size_t oldsize, size_t newsize);
 
 /* structs.c */
 #define checkfloat3 moonal_checkfloat3
@@ -161,10 +504,27 @@ int pushfloat3(lua_State *L, const ALfloat dst[3]);
 ALCint *echeckdeviceattributeslist(lua_State *L, int arg, int *err);
 
 /* main.c */
+#define load_time moonal_load_time
+extern double load_time;
 int luaopen_moonal(lua_State *L);
 void moonal_utils_init(lua_State *L);
 void moonal_open_tracing(lua_State *L);
+void moonal_atexit_tracing(void);
+void moonal_open_stats(lua_State *L);
+void moonal_open_automation(lua_State *L);
+void moonal_open_virtual(lua_State *L);
+void moonal_open_spatial(lua_State *L);
+void moonal_open_shadow(lua_State *L);
+void moonal_open_loader(lua_State *L);
+void moonal_open_bufcache(lua_State *L);
+void moonal_open_residency(lua_State *L);
+void moonal_open_events(lua_State *L);
+void moonal_open_notify(lua_State *L);
+void moonal_open_schedule(lua_State *L);
+void moonal_open_telemetry(lua_State *L);
+void moonal_init_enums(void);
 void moonal_open_enums(lua_State *L);
+const char *moonal_init_getproc(void);
 int moonal_open_getproc(lua_State *L);
 void moonal_atexit_getproc(void);
 
@@ -173,11 +533,22 @@ void moonal_atexit_getproc(void);
  *------------------------------------------------------------------------------*/
 
 #define TRACE_CREATE(p, ttt) do {                                               \
-    if(trace_objects) { printf("create "ttt" %p\n", (void*)(uintptr_t)(p)); }   \
+    if(ATOMIC_LOAD(trace_objects)) { printf("create "ttt" %p\n", (void*)(uintptr_t)(p)); }   \
+    if(ATOMIC_LOAD(trace_calls)) trace_instant("create_"ttt, (uint64_t)(uintptr_t)(p));      \
 } while(0)
 
 #define TRACE_DELETE(p, ttt) do {                                               \
-    if(trace_objects) { printf("delete "ttt" %px\n", (void*)(uintptr_t)(p)); }  \
+    if(ATOMIC_LOAD(trace_objects)) { printf("delete "ttt" %px\n", (void*)(uintptr_t)(p)); }  \
+    if(ATOMIC_LOAD(trace_calls)) trace_instant("delete_"ttt, (uint64_t)(uintptr_t)(p));      \
+} while(0)
+
+/* Call tracing: TRACE_CALL_START goes with the declarations of the traced function,
+ * TRACE_CALL_STOP after the (successful) AL call. Calls that raise an error are not
+ * recorded. */
+#define TRACE_CALL_START double trace_t0_ = ATOMIC_LOAD(trace_calls) ? now() : 0
+#define TRACE_CALL_STOP(name, p, arg) do {                                      \
+    if(ATOMIC_LOAD(trace_calls))                                                \
+        trace_call((name), trace_t0_, (uint64_t)(uintptr_t)(p), (double)(arg)); \
 } while(0)
 
 
@@ -195,7 +566,7 @@ void moonal_atexit_getproc(void);
     /* restores old_context_ before raising an error */                     \
     ALCenum ec_ = alc.GetError(device_);                                    \
     if(ec_ != ALC_NO_ERROR) {                                               \
-        alc.MakeContextCurrent((old_context_));                             \
+        set_current_context((old_context_));                             \
         pushalcerror(L, ec_); return lua_error(L);                          \
     }                                                                       \
 } while(0)
@@ -204,7 +575,7 @@ void moonal_atexit_getproc(void);
     /* restores old_context_ before raising an error */                     \
     ALenum ec_ = al.GetError();                                             \
     if(ec_ != AL_NO_ERROR) {                                                \
-        alc.MakeContextCurrent((old_context_));                             \
+        set_current_context((old_context_));                             \
         pushalerror(L, ec_); return lua_error(L);                           \
     }                                                                       \
 } while(0)
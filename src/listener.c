@@ -38,7 +38,7 @@ int pushlistener(lua_State *L, context_t context)
     {
     ud_t *ud;
     listener_t listener;
-    ud_t *context_ud = userdata(context);
+    ud_t *context_ud = userdata(L, context);
 
     if(context_ud->listener) 
         return pushxxx(L, context_ud->listener);
@@ -50,6 +50,9 @@ int pushlistener(lua_State *L, context_t context)
     
     listener->name = 0;
     ud = newuserdata(L, listener, LISTENER_MT);
+    ud->info = MallocNoErr(L, sizeof(lstinfo_t));
+    if(!ud->info)
+        return luaL_error(L, errstring(ERR_MEMORY));
     ud->context = context;
     ud->device = context_ud->device;
     ud->parent_ud = context_ud;
@@ -85,9 +88,8 @@ static int GetFloat3(lua_State *L, ALenum param)
     return 1;
     }
 
-static int SetFloat3(lua_State *L, ALenum param)
+static int SetFloat3(lua_State *L, ALenum param, ALfloat val[3])
     {
-    ALfloat val[3];
     checkfloat3(L, 3, val);
     al.Listenerfv(param, val);
     return 0;
@@ -116,17 +118,20 @@ static int SetListener(lua_State *L)
     {
     int res;
     ud_t *ud;
+    ALfloat val[3];
     context_t old_context = current_context(L);
     listener_t listener = checklistener(L, 1, &ud);
     ALenum param = checkalparam(L, 2);
     (void)listener;
+    if(IsShadowed(ud) && shadow_defer(L, ud, param, 3))
+        return 0;
     make_context_current(L, ud->context);
     switch(param)
         {
         case AL_GAIN:
         case AL_METERS_PER_UNIT: res = SetFloat(L, param); break;
         case AL_POSITION:
-        case AL_VELOCITY: res = SetFloat3(L, param); break;
+        case AL_VELOCITY: res = SetFloat3(L, param, val); break;
         case AL_ORIENTATION: res = SetOrientation(L); break;
         default:
             make_context_current(L, old_context);
@@ -134,6 +139,10 @@ static int SetListener(lua_State *L)
         }
     make_context_current(L, old_context);
     CheckErrorAl(L);
+    if(param == AL_POSITION)
+        spatial_listener(userdata(L, ud->context), val);
+    if(IsShadowed(ud))
+        shadow_store_arg(L, ud, param, 3);
     return res;
     }
 
@@ -145,6 +154,8 @@ static int GetListener(lua_State *L)
     listener_t listener = checklistener(L, 1, &ud);
     ALenum param = checkalparam(L, 2);
     (void)listener;
+    if(IsShadowed(ud) && (res = shadow_get(L, ud, param)) > 0)
+        return res;
     make_context_current(L, ud->context);
     switch(param)
         {
@@ -176,6 +187,12 @@ static const struct luaL_Reg Methods[] =
         { "delete", Delete },
         { "get", GetListener },
         { "set", SetListener },
+        { "ramp", ramps_start },
+        { "cancel_ramps", ramps_cancel },
+        { "cache", shadow_enable },
+        { "is_cached", shadow_enabled },
+        { "coalesce", shadow_coalesce },
+        { "is_coalesced", shadow_coalesced },
         { NULL, NULL } /* sentinel */
     };
 
@@ -0,0 +1,650 @@
+/* The MIT License (MIT)
+ *
+ * Copyright (c) 2018 Stefano Trettel
+ *
+ * Software repository: MoonAL, https://github.com/stetre/moonal
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+
+#include "internal.h"
+#include <pthread.h>
+
+/*------------------------------------------------------------------------------*
+ | Asynchronous buffer loading                                                  |
+ *------------------------------------------------------------------------------*/
+
+/* load_async() creates an empty buffer and queues a job to a pool of worker threads,
+ * that read the file and convert its content to a format accepted by alBufferData().
+ * Completed jobs are put in the load queue of the context (see ctxinfo_t), and their
+ * data is stored in the buffers on the owning thread, by poll_loads().
+ *
+ * Jobs, queues and loaded data are shared with the workers, so they are allocated with
+ * malloc() instead of with the Lua state's allocator (which needs not be thread-safe).
+ * The pool is process-wide: it is started at the first load, and stopped (with its
+ * threads joined) when the last context having a load queue is released.
+ */
+
+#define NWORKERS 2
+#define ERRLEN 128
+
+#define LOAD_PENDING    1
+#define LOAD_LOADED     2
+#define LOAD_FAILED     3
+
+struct moonal_loadjob_s {
+    loadjob_t *next;
+    loadqueue_t *q;     /* queue of the context the buffer belongs to */
+    ud_t *ud;           /* ud of the buffer (NULL if deleted while the job was pending) */
+    int status;         /* LOAD_XXX */
+    /* request */
+    char *path;
+    long offset;        /* position in the file */
+    long length;        /* raw data only (-1 = up to the end of the file) */
+    int wav;            /* parse the WAV header (if not, the data is raw) */
+    ALenum format;      /* raw data only (for WAV files, set by the worker) */
+    ALsizei freq;
+    /* result, set by the worker */
+    int failed;
+    void *data;
+    size_t size;
+    char errmsg[ERRLEN];
+};
+
+struct moonal_loadqueue_s {
+    int refs;           /* 1 for the context + 1 for each job in the pool */
+    int closed;         /* the context was released */
+    loadjob_t *done;    /* completed jobs, yet to be polled */
+    loadjob_t *donetail;
+    size_t pending;     /* jobs yet to be polled */
+    int fd;             /* event descriptor to signal (-1 if none), see notify.c */
+};
+
+typedef struct {
+    pthread_t threads[NWORKERS];
+    int nthreads;
+    int stop;
+    loadjob_t *head;    /* jobs to do */
+    loadjob_t *tail;
+} pool_t;
+
+/* The pool, the job lists and the refs/closed/fd fields of the queues are protected by Lock.
+ * The other fields of a job are accessed by the worker only while the job is in progress,
+ * and by the owning thread only before and after.
+ */
+static pthread_mutex_t Lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t Wake = PTHREAD_COND_INITIALIZER;
+static pool_t *Pool = NULL;
+static int NQueues = 0; /* queues not yet closed */
+
+#define LOADQUEUE(context_ud) (CTXINFO(context_ud)->loads)
+
+static void freejob(loadjob_t *job)
+    {
+    free(job->path);
+    free(job->data);
+    free(job);
+    }
+
+/*------------------------------------------------------------------------------*
+ | File reading (worker side)                                                   |
+ *------------------------------------------------------------------------------*/
+
+static void fail(loadjob_t *job, const char *fmt, const char *s)
+    {
+    job->failed = 1;
+    snprintf(job->errmsg, ERRLEN, fmt, s);
+    free(job->data);
+    job->data = NULL;
+    job->size = 0;
+    }
+
+#define LE16(p) ((uint32_t)(p)[0] | ((uint32_t)(p)[1] << 8))
+#define LE32(p) (LE16(p) | ((uint32_t)(p)[2] << 16) | ((uint32_t)(p)[3] << 24))
+
+static void readdata(loadjob_t *job, FILE *f, size_t size)
+    {
+    job->data = malloc(size > 0 ? size : 1);
+    if(!job->data)
+        { fail(job, "%s", errstring(ERR_MEMORY)); return; }
+    job->size = size;
+    if(fread(job->data, 1, size, f) != size)
+        fail(job, "unexpected end of file '%s'", job->path);
+    }
+
+static void readraw(loadjob_t *job, FILE *f)
+    {
+    long length = job->length;
+    if(length < 0)
+        {
+        if(fseek(f, 0, SEEK_END) != 0 || (length = ftell(f) - job->offset) < 0 ||
+           fseek(f, job->offset, SEEK_SET) != 0)
+            { fail(job, "cannot seek '%s'", job->path); return; }
+        }
+    readdata(job, f, (size_t)length);
+    }
+
+static int toformat(unsigned tag, unsigned channels, unsigned bits, int *convert)
+/* returns the AL format for the given WAVE format, or 0 if not supported */
+    {
+    int stereo = channels == 2;
+    *convert = 0;
+    if(channels != 1 && channels != 2) return 0;
+    if(tag == 1) /* PCM */
+        {
+        switch(bits)
+            {
+            case 8: return stereo ? AL_FORMAT_STEREO8 : AL_FORMAT_MONO8;
+            case 16: return stereo ? AL_FORMAT_STEREO16 : AL_FORMAT_MONO16;
+            case 24:
+            case 32: *convert = bits; /* to float */
+                     return stereo ? AL_FORMAT_STEREO_FLOAT32 : AL_FORMAT_MONO_FLOAT32;
+            }
+        }
+    else if(tag == 3) /* IEEE float */
+        {
+        switch(bits)
+            {
+            case 32: return stereo ? AL_FORMAT_STEREO_FLOAT32 : AL_FORMAT_MONO_FLOAT32;
+            case 64: return stereo ? AL_FORMAT_STEREO_DOUBLE_EXT : AL_FORMAT_MONO_DOUBLE_EXT;
+            }
+        }
+    return 0;
+    }
+
+size_t loader_tofloat(const void *src_, size_t size, int bits, float *dst)
+/* Converts size bytes of 24 or 32 bit signed PCM to float, and returns the number of
+ * bytes written to dst (for 32 bit, dst may coincide with src). */
+    {
+    size_t i, n;
+    const unsigned char *p, *src = (const unsigned char*)src_;
+    if(bits == 32)
+        {
+        n = size / 4;
+        for(i = 0; i < n; i++)
+            dst[i] = (float)((int32_t)LE32(src + 4*i) / 2147483648.0);
+        return n * 4;
+        }
+    n = size / 3;
+    for(i = 0; i < n; i++)
+        {
+        p = src + 3*i;
+        dst[i] = (float)((int32_t)(((uint32_t)p[0] << 8) | ((uint32_t)p[1] << 16) |
+                        ((uint32_t)p[2] << 24)) / 2147483648.0);
+        }
+    return n * sizeof(float);
+    }
+
+static void converttofloat(loadjob_t *job, int bits)
+/* converts 24 or 32 bit signed PCM to float (in place for 32 bit) */
+    {
+    float *dst = (float*)job->data;
+    if(bits != 32)
+        {
+        dst = (float*)malloc(job->size / 3 * sizeof(float) + 1);
+        if(!dst)
+            { fail(job, "%s", errstring(ERR_MEMORY)); return; }
+        }
+    job->size = loader_tofloat(job->data, job->size, bits, dst);
+    if(dst != job->data)
+        {
+        free(job->data);
+        job->data = dst;
+        }
+    }
+
+const char *loader_wavheader(FILE *f, ALenum *format, ALsizei *freq, size_t *size, size_t *framesize, int *convert)
+/* Parses the header of a RIFF/WAVE file with PCM (8, 16, 24 or 32 bit) or float (32 or
+ * 64 bit) samples, mono or stereo, and leaves f at the start of the sample data. Samples
+ * are assumed to be little-endian as the host. On success, returns NULL and sets the AL
+ * format (float, if the samples need to be converted to float, in which case *convert is
+ * set to their size in bits), the frequency, and the size of the data and of its frames
+ * as in the file. On error, returns a message with a '%s' for the file name.
+ */
+    {
+    unsigned char hdr[12], fmt[40];
+    size_t n;
+    unsigned tag = 0, channels = 0, bits = 0;
+    int havefmt = 0;
+    if(fread(hdr, 1, 12, f) != 12 || memcmp(hdr, "RIFF", 4) != 0 || memcmp(hdr + 8, "WAVE", 4) != 0)
+        return "'%s' is not a WAV file (and no format was given)";
+    while(fread(hdr, 1, 8, f) == 8)
+        {
+        *size = LE32(hdr + 4);
+        if(memcmp(hdr, "fmt ", 4) == 0)
+            {
+            n = *size < sizeof(fmt) ? *size : sizeof(fmt);
+            if(n < 16 || fread(fmt, 1, n, f) != n)
+                break;
+            tag = LE16(fmt);
+            channels = LE16(fmt + 2);
+            *freq = (ALsizei)LE32(fmt + 4);
+            *framesize = LE16(fmt + 12);
+            bits = LE16(fmt + 14);
+            if(tag == 0xfffe && n >= 26) tag = LE16(fmt + 24); /* WAVE_FORMAT_EXTENSIBLE */
+            havefmt = 1;
+            *size -= n;
+            }
+        else if(memcmp(hdr, "data", 4) == 0)
+            {
+            if(!havefmt) break;
+            *format = toformat(tag, channels, bits, convert);
+            if(!*format || *framesize == 0)
+                return "unsupported WAV format in '%s'";
+            return NULL;
+            }
+        if(fseek(f, *size + (*size & 1), SEEK_CUR) != 0)
+            break;
+        }
+    return "invalid WAV file '%s'";
+    }
+
+static void readwav(loadjob_t *job, FILE *f)
+    {
+    size_t size, framesize;
+    int convert;
+    const char *errmsg = loader_wavheader(f, &job->format, &job->freq, &size, &framesize, &convert);
+    if(errmsg)
+        { fail(job, errmsg, job->path); return; }
+    readdata(job, f, size);
+    if(!job->failed && convert) converttofloat(job, convert);
+    }
+
+#define DECODECHUNK 65536
+
+static void readcodec(loadjob_t *job, FILE *f)
+/* decodes a compressed file a chunk at a time, growing the data as needed */
+    {
+    void *data;
+    size_t n, cap, estimate;
+    const char *errmsg;
+    decoder_t *dec = codec_open(f, job->length, &job->format, &job->freq, &estimate, &errmsg);
+    if(!dec)
+        { fail(job, errmsg, job->path); return; }
+    cap = estimate + DECODECHUNK; /* the estimate may be short, or 0 if unknown */
+    job->data = malloc(cap);
+    job->size = 0;
+    errmsg = NULL;
+    while(job->data && (n = codec_read(dec, (char*)job->data + job->size, cap - job->size, &errmsg)) > 0)
+        {
+        job->size += n;
+        if(cap - job->size < DECODECHUNK)
+            {
+            if(!(data = realloc(job->data, 2*cap))) break;
+            job->data = data;
+            cap *= 2;
+            }
+        }
+    if(!job->data || cap - job->size < DECODECHUNK)
+        fail(job, "%s", errstring(ERR_MEMORY));
+    else if(errmsg)
+        fail(job, errmsg, job->path);
+    codec_close(dec);
+    }
+
+static void load(loadjob_t *job)
+    {
+    FILE *f = fopen(job->path, "rb");
+    if(!f)
+        { fail(job, "cannot open '%s'", job->path); return; }
+    if(fseek(f, job->offset, SEEK_SET) != 0)
+        fail(job, "cannot seek '%s'", job->path);
+    else if(job->wav && codec_probe(f))
+        readcodec(job, f);
+    else if(job->wav)
+        readwav(job, f);
+    else
+        readraw(job, f);
+    fclose(f);
+    }
+
+static void *worker(void *arg)
+    {
+    pool_t *pool = (pool_t*)arg;
+    loadjob_t *job;
+    loadqueue_t *q;
+    pthread_mutex_lock(&Lock);
+    while(1)
+        {
+        while(!pool->head && !pool->stop)
+            pthread_cond_wait(&Wake, &Lock);
+        if(!pool->head) break; /* stopped, and nothing left to do */
+        job = pool->head;
+        pool->head = job->next;
+        if(!pool->head) pool->tail = NULL;
+        job->next = NULL;
+        q = job->q;
+        if(!q->closed)
+            {
+            pthread_mutex_unlock(&Lock);
+            load(job);
+            pthread_mutex_lock(&Lock);
+            }
+        if(q->closed)
+            freejob(job);
+        else
+            {
+            if(q->donetail) q->donetail->next = job;
+            else q->done = job;
+            q->donetail = job;
+            notify_signal(q->fd);
+            }
+        if(--q->refs == 0) free(q);
+        }
+    pthread_mutex_unlock(&Lock);
+    return NULL;
+    }
+
+static int startpool(void)
+/* starts the pool, if not running (called with Lock held) */
+    {
+    int i;
+    if(Pool) return 0;
+    Pool = (pool_t*)calloc(1, sizeof(pool_t));
+    if(!Pool) return -1;
+    for(i = 0; i < NWORKERS; i++)
+        {
+        if(pthread_create(&Pool->threads[i], NULL, worker, Pool) != 0) break;
+        Pool->nthreads++;
+        }
+    if(Pool->nthreads == 0)
+        { free(Pool); Pool = NULL; return -1; }
+    return 0;
+    }
+
+/*------------------------------------------------------------------------------*
+ | Owning thread side                                                           |
+ *------------------------------------------------------------------------------*/
+
+void loader_forget(lua_State *L, ud_t *ud)
+/* called by freeuserdata() for buffers marked as 'loading' */
+    {
+    loadjob_t *job = BUFINFO(ud)->job;
+    (void)L;
+    if(!job) return;
+    if(job->status == LOAD_PENDING)
+        job->ud = NULL; /* released by poll_loads() or loader_free() */
+    else
+        freejob(job);
+    BUFINFO(ud)->job = NULL;
+    }
+
+void loader_free(lua_State *L, ud_t *context_ud)
+/* called by freecontext(), after its buffers have been released */
+    {
+    int i, refs;
+    loadjob_t *job, *next;
+    pool_t *stopped = NULL;
+    loadqueue_t *q = LOADQUEUE(context_ud);
+    (void)L;
+    if(!q) return;
+    LOADQUEUE(context_ud) = NULL;
+    pthread_mutex_lock(&Lock);
+    q->closed = 1; /* jobs still in the pool are discarded by the workers */
+    job = q->done;
+    q->done = q->donetail = NULL;
+    refs = --q->refs;
+    if(--NQueues == 0 && Pool)
+        {
+        stopped = Pool;
+        Pool = NULL;
+        stopped->stop = 1;
+        pthread_cond_broadcast(&Wake);
+        }
+    pthread_mutex_unlock(&Lock);
+    for( ; job; job = next)
+        { next = job->next; freejob(job); }
+    if(refs == 0) free(q);
+    if(stopped)
+        {
+        for(i = 0; i < stopped->nthreads; i++)
+            pthread_join(stopped->threads[i], NULL);
+        free(stopped);
+        }
+    }
+
+static loadqueue_t *getqueue(lua_State *L, ud_t *context_ud)
+    {
+    loadqueue_t *q = LOADQUEUE(context_ud);
+    if(q) return q;
+    q = (loadqueue_t*)calloc(1, sizeof(loadqueue_t));
+    if(!q)
+        { luaL_error(L, errstring(ERR_MEMORY)); return NULL; }
+    q->refs = 1;
+    q->fd = notify_fd(context_ud);
+    pthread_mutex_lock(&Lock);
+    NQueues++;
+    pthread_mutex_unlock(&Lock);
+    LOADQUEUE(context_ud) = q;
+    return q;
+    }
+
+int loader_ready(ud_t *context_ud)
+/* returns 1 if the context has completed loads to be polled */
+    {
+    int ready;
+    loadqueue_t *q = LOADQUEUE(context_ud);
+    if(!q) return 0;
+    pthread_mutex_lock(&Lock);
+    ready = q->done != NULL;
+    pthread_mutex_unlock(&Lock);
+    return ready;
+    }
+
+void loader_setfd(ud_t *context_ud, int fd)
+    {
+    loadqueue_t *q = LOADQUEUE(context_ud);
+    if(!q) return;
+    pthread_mutex_lock(&Lock);
+    q->fd = fd;
+    pthread_mutex_unlock(&Lock);
+    }
+
+int loader_queue(lua_State *L, ud_t *ud, const char *path, long offset, long length, ALenum format, ALsizei freq)
+/* Queues the load of the buffer ud from the file path (format=0 for WAV files).
+ * Returns 0 if a load of the buffer is already pending (in which case nothing is done),
+ * or 1 if the job was queued. Raises an error on failure.
+ */
+    {
+    int err;
+    loadjob_t *job = BUFINFO(ud)->job;
+    loadqueue_t *q = getqueue(L, ud->parent_ud);
+    if(job)
+        {
+        if(job->status == LOAD_PENDING) return 0;
+        freejob(job);
+        BUFINFO(ud)->job = NULL;
+        }
+    pthread_mutex_lock(&Lock);
+    err = startpool(); /* the pool is not stopped while the queue is open */
+    pthread_mutex_unlock(&Lock);
+    if(err)
+        return luaL_error(L, "cannot start the loader threads");
+
+    job = (loadjob_t*)calloc(1, sizeof(loadjob_t));
+    if(job) job->path = (char*)malloc(strlen(path) + 1);
+    if(!job || !job->path)
+        { free(job); return luaL_error(L, errstring(ERR_MEMORY)); }
+    strcpy(job->path, path);
+    job->q = q;
+    job->ud = ud;
+    job->status = LOAD_PENDING;
+    job->offset = offset;
+    job->length = length;
+    job->wav = format == 0;
+    job->format = format;
+    job->freq = freq;
+    BUFINFO(ud)->job = job;
+    MarkLoading(ud);
+
+    pthread_mutex_lock(&Lock);
+    if(Pool->tail) Pool->tail->next = job;
+    else Pool->head = job;
+    Pool->tail = job;
+    q->refs++;
+    pthread_cond_signal(&Wake);
+    pthread_mutex_unlock(&Lock);
+    q->pending++;
+    return 1;
+    }
+
+const char *loader_source(ud_t *ud, long *offset, long *length, ALenum *format, ALsizei *freq)
+/* Retrieves the request of the last load of the buffer ud, if any.
+ * Returns the path, or NULL if the buffer was not loaded by load_async().
+ */
+    {
+    loadjob_t *job = BUFINFO(ud)->job;
+    if(!job) return NULL;
+    *offset = job->offset;
+    *length = job->length;
+    *format = job->wav ? 0 : job->format;
+    *freq = job->wav ? 0 : job->freq;
+    return job->path;
+    }
+
+int loader_async(lua_State *L)
+/* buffer = load_async(context, path, [opts]) */
+    {
+    int err;
+    ud_t *context_ud, *ud;
+    ALuint name;
+    ALenum format = 0;
+    long offset, length, freq = 0;
+    context_t old_context = current_context(L);
+    context_t context = checkcontext(L, 1, &context_ud);
+    const char *path = luaL_checkstring(L, 2);
+    TRACE_CALL_START;
+    if(!lua_isnoneornil(L, 3))
+        {
+        luaL_checktype(L, 3, LUA_TTABLE);
+        if(lua_getfield(L, 3, "format") != LUA_TNIL)
+            {
+            format = testformat(L, -1, &err);
+            if(err) return luaL_argerror(L, 3, "invalid field 'format'");
+            }
+        lua_pop(L, 1);
+        freq = optfield(L, 3, "frequency", 0);
+        if(format && freq == 0)
+            return luaL_argerror(L, 3, "missing field 'frequency'");
+        }
+    offset = lua_isnoneornil(L, 3) ? 0 : optfield(L, 3, "offset", 0);
+    length = lua_isnoneornil(L, 3) ? -1 : optfield(L, 3, "length", -1);
+    make_context_current(L, context);
+    al.GenBuffers(1, &name);
+    CheckErrorRestoreAl(L, old_context);
+    make_context_current(L, old_context);
+    ud = userdata(L, newbuffer(L, context_ud, name));
+    loader_queue(L, ud, path, offset, length, format, (ALsizei)freq);
+    TRACE_CALL_STOP("load_async", context, 0);
+    return 1;
+    }
+
+int loader_poll(lua_State *L)
+/* loaded, failed, pending = poll_loads(context) */
+    {
+    ud_t *ud;
+    ALenum ec;
+    loadjob_t *job, *next;
+    int nloaded = 0, nfailed = 0, switched = 0;
+    context_t context = checkcontext(L, 1, &ud);
+    context_t old_context = alc.GetCurrentContext();
+    loadqueue_t *q = LOADQUEUE(ud);
+    TRACE_CALL_START;
+    lua_newtable(L); /* loaded */
+    lua_newtable(L); /* failed */
+    if(!q)
+        { lua_pushinteger(L, 0); return 3; }
+    pthread_mutex_lock(&Lock);
+    job = q->done;
+    q->done = q->donetail = NULL;
+    pthread_mutex_unlock(&Lock);
+    if(job && old_context != context)
+        { make_context_current(L, context); switched = 1; }
+    for( ; job; job = next)
+        {
+        next = job->next;
+        job->next = NULL;
+        q->pending--;
+        if(!job->ud) /* the buffer was deleted */
+            { freejob(job); continue; }
+        if(!job->failed)
+            {
+            ec = buffer_upload(job->ud, job->format, job->data, job->size, job->freq);
+            if(ec)
+                {
+                pushalerror(L, ec);
+                fail(job, "alBufferData: %s", lua_tostring(L, -1));
+                lua_pop(L, 1);
+                }
+            }
+        free(job->data);
+        job->data = NULL;
+        job->status = job->failed ? LOAD_FAILED : LOAD_LOADED;
+        if(IsManaged(job->ud))
+            residency_loaded(L, job->ud, !job->failed);
+        pushbuffer(L, job->ud->handle);
+        if(job->failed)
+            lua_rawseti(L, -2, ++nfailed);
+        else
+            lua_rawseti(L, -3, ++nloaded);
+        }
+    if(nloaded > 0)
+        residency_enforce(L, ud);
+    if(switched)
+        {
+        if(old_context) make_context_current(L, old_context);
+        else set_current_context(NULL);
+        }
+    notify_update(ud);
+    lua_pushinteger(L, q->pending);
+    TRACE_CALL_STOP("poll_loads", context, nloaded + nfailed);
+    return 3;
+    }
+
+int loader_status(lua_State *L)
+/* status, [errmsg] = load_status(buffer) */
+    {
+    ud_t *ud;
+    loadjob_t *job;
+    checkbuffer(L, 1, &ud);
+    job = BUFINFO(ud)->job;
+    switch(job ? job->status : 0)
+        {
+        case LOAD_PENDING: lua_pushstring(L, "pending"); return 1;
+        case LOAD_LOADED: lua_pushstring(L, "loaded"); return 1;
+        case LOAD_FAILED: lua_pushstring(L, "failed"); lua_pushstring(L, job->errmsg); return 2;
+        default: lua_pushstring(L, "none"); return 1;
+        }
+    return 0;
+    }
+
+static const struct luaL_Reg Functions[] =
+    {
+        { "load_async", loader_async },
+        { "poll_loads", loader_poll },
+        { "buffer_load_status", loader_status },
+        { NULL, NULL } /* sentinel */
+    };
+
+void moonal_open_loader(lua_State *L)
+    {
+    luaL_setfuncs(L, Functions, 0);
+    }
+
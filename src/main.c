@@ -25,25 +25,58 @@
 
 #include "internal.h"
 
-static lua_State *moonal_L = NULL;
+double load_time = 0; /* time spent in luaopen_moonal() */
+
+/* The module can be loaded in several independent Lua states, possibly in different
+ * threads. Each state has its own objects (see udata.c), while the process-wide data
+ * (the dispatch tables and the enums) is initialized once and is read-only afterwards.
+ */
+static const char *InitError = NULL;
 
 static void AtExit(void)
     {
-    if(moonal_L)
-        {
-        enums_free_all(moonal_L);
-        moonal_atexit_getproc();
-        moonal_L = NULL;
-        }
+    moonal_atexit_tracing();
+    moonal_atexit_getproc();
     }
 
+static void Init(void)
+/* process-wide initializations (executed only once) */
+    {
+    InitError = moonal_init_getproc();
+    if(InitError) return;
+    moonal_init_enums();
+    atexit(AtExit);
+    }
+
+#if defined(LINUX)
+#include <pthread.h>
+static pthread_once_t InitOnce = PTHREAD_ONCE_INIT;
+#define init_once() pthread_once(&InitOnce, Init)
+
+#elif defined(MINGW)
+#include <windows.h>
+static INIT_ONCE InitOnce = INIT_ONCE_STATIC_INIT;
+static BOOL CALLBACK InitCallback(PINIT_ONCE once, PVOID param, PVOID *context)
+    {
+    (void)once; (void)param; (void)context;
+    Init();
+    return TRUE;
+    }
+#define init_once() InitOnceExecuteOnce(&InitOnce, InitCallback, NULL, NULL)
+
+#endif
+
 int luaopen_moonal(lua_State *L)
 /* Lua calls this function to load the module */
     {
-    moonal_L = L;
+    double t0;
 
     moonal_utils_init(L);
-    atexit(AtExit);
+    t0 = now();
+    init_once();
+    if(InitError)
+        return luaL_error(L, "%s", InitError);
+    udata_init(L);
 
     lua_newtable(L); /* the cl table */
 
@@ -52,6 +85,7 @@ int luaopen_moonal(lua_State *L)
     moonal_open_getproc(L);
     moonal_open_enums(L);
     moonal_open_tracing(L);
+    moonal_open_stats(L);
     moonal_open_device(L);
     moonal_open_context(L);
     moonal_open_listener(L);
@@ -60,6 +94,20 @@ int luaopen_moonal(lua_State *L)
     moonal_open_effect(L);
     moonal_open_filter(L);
     moonal_open_auxslot(L);
+    moonal_open_voicepool(L);
+    moonal_open_mapping(L);
+    moonal_open_stream(L);
+    moonal_open_automation(L);
+    moonal_open_virtual(L);
+    moonal_open_spatial(L);
+    moonal_open_shadow(L);
+    moonal_open_loader(L);
+    moonal_open_bufcache(L);
+    moonal_open_residency(L);
+    moonal_open_events(L);
+    moonal_open_notify(L);
+    moonal_open_schedule(L);
+    moonal_open_telemetry(L);
     moonal_open_datahandling(L);
     moonal_open_ranges(L);
 
@@ -70,6 +118,7 @@ int luaopen_moonal(lua_State *L)
     lua_pushnil(L);  lua_setglobal(L, "moonal");
 #endif
 
+    load_time = since(t0);
     return 1;
     }
 
@@ -0,0 +1,301 @@
+/* The MIT License (MIT)
+ *
+ * Copyright (c) 2018 Stefano Trettel
+ *
+ * Software repository: MoonAL, https://github.com/stetre/moonal
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+
+#include "internal.h"
+
+/* Mapped buffers (AL_SOFT_map_buffer).
+ *
+ * A mapping is a view on a range of a buffer's storage, as returned by alMapBufferSOFT().
+ * The pointer is never exposed to the script: all the accesses go through the mapping's
+ * methods, which check them against the mapped range and against the access flags the
+ * buffer was mapped with. The mapping is a child of the buffer, so it is unmapped when
+ * the buffer is deleted (and a deleted mapping can no longer be used).
+ */
+
+struct moonal_mapping_s {
+    unsigned char *ptr;     /* start of the mapped range */
+    ALsizei offset;         /* ... and its position in the buffer */
+    ALsizei size;
+    ALbitfieldSOFT access;
+};
+
+ALbitfieldSOFT mapping_checkflags(lua_State *L, int arg, int required)
+/* Checks a list of mapflags and returns them OR-ed together (or 0, if the list is
+ * not present and not required). */
+    {
+    int err;
+    uint32_t i, count;
+    ALbitfieldSOFT flags = 0;
+    uint32_t *list = enums_checklist(L, DOMAIN_AL_MAP_FLAG, arg, &count, &err);
+    if(err == ERR_NOTPRESENT && !required) return 0;
+    if(err) return (ALbitfieldSOFT)luaL_argerror(L, arg, errstring(err));
+    for(i = 0; i < count; i++) flags |= list[i];
+    Free(L, list);
+    return flags;
+    }
+
+static void unmap(ud_t *ud)
+/* unmaps the buffer, making its context current if it is not */
+    {
+    ud_t *buffer_ud = (ud_t*)ud->parent_ud;
+    context_t old_context = alc.GetCurrentContext();
+    if(old_context != ud->context) set_current_context(ud->context);
+    ud->cdt->UnmapBufferSOFT(((buffer_t)buffer_ud->handle)->name);
+    (void)al.GetError();
+    if(old_context != ud->context) set_current_context(old_context);
+    }
+
+static int freemapping(lua_State *L, ud_t *ud)
+    {
+    mapping_t mapping = (mapping_t)ud->handle;
+    if(!freeuserdata(L, ud)) return 0;
+    TRACE_DELETE(mapping, "mapping");
+    unmap(ud);
+    Free(L, mapping);
+    return 0;
+    }
+
+int mapping_map(lua_State *L)
+/* mapping = map_buffer(buffer, {mapflag}, [offset], [length]) */
+    {
+    ud_t *ud, *buffer_ud;
+    void *ptr;
+    ALenum ec;
+    lua_Integer offset, length;
+    mapping_t mapping;
+    context_t old_context;
+    buffer_t buffer = checkbuffer(L, 1, &buffer_ud);
+    bufinfo_t *info = BUFINFO(buffer_ud);
+    ALbitfieldSOFT access = mapping_checkflags(L, 2, 1);
+    TRACE_CALL_START;
+    CheckContextPfn(L, buffer_ud, MapBufferSOFT);
+    if(!(access & (AL_MAP_READ_BIT_SOFT | AL_MAP_WRITE_BIT_SOFT)))
+        return luaL_argerror(L, 2, "missing 'read' or 'write'");
+    offset = luaL_optinteger(L, 3, 0);
+    if(offset < 0 || (size_t)offset > info->size)
+        return luaL_argerror(L, 3, errstring(ERR_BOUNDARIES));
+    length = luaL_optinteger(L, 4, info->size - offset);
+    if(length <= 0 || (size_t)length > info->size - offset)
+        return luaL_argerror(L, 4, errstring(ERR_BOUNDARIES));
+    mapping = (mapping_t)Malloc(L, sizeof(struct moonal_mapping_s));
+
+    old_context = current_context(L);
+    make_context_current(L, buffer_ud->context);
+    ptr = buffer_ud->cdt->MapBufferSOFT(buffer->name, offset, length, access);
+    ec = al.GetError();
+    make_context_current(L, old_context);
+    if(ec || !ptr)
+        {
+        Free(L, mapping);
+        if(!ec) return luaL_error(L, "cannot map buffer");
+        pushalerror(L, ec);
+        return lua_error(L);
+        }
+    mapping->ptr = (unsigned char*)ptr;
+    mapping->offset = offset;
+    mapping->size = length;
+    mapping->access = access;
+
+    ud = newuserdata(L, mapping, MAPPING_MT);
+    ud->context = buffer_ud->context;
+    ud->device = buffer_ud->device;
+    ud->parent_ud = buffer_ud;
+    ud->destructor = freemapping;
+    ud->ddt = buffer_ud->ddt;
+    ud->cdt = buffer_ud->cdt;
+    TRACE_CREATE(mapping, "mapping");
+    TRACE_CALL_STOP("map_buffer", buffer, length);
+    return 1;
+    }
+
+/*------------------------------------------------------------------------------*
+ | Accesses                                                                     |
+ *------------------------------------------------------------------------------*/
+
+#define AVAILABLE(mapping, offset) /* bytes from offset to the end of the mapping */ \
+    (((offset) >= 0 && (offset) <= (mapping)->size) ? (size_t)((mapping)->size - (offset)) : 0)
+
+static size_t checkrange(lua_State *L, mapping_t mapping, int arg, lua_Integer offset, size_t len)
+/* checks that [offset, offset+len) is within the mapping, and returns offset */
+    {
+    if(offset < 0 || offset > mapping->size || len > AVAILABLE(mapping, offset))
+        return luaL_argerror(L, arg, errstring(ERR_BOUNDARIES));
+    return (size_t)offset;
+    }
+
+static void checkaccess(lua_State *L, mapping_t mapping, ALbitfieldSOFT bit)
+    {
+    if(!(mapping->access & bit))
+        luaL_error(L, "buffer not mapped for %s", bit == AL_MAP_READ_BIT_SOFT ? "read" : "write");
+    }
+
+static int Write(lua_State *L)
+/* write(mapping, offset, data) */
+    {
+    size_t len, offset;
+    mapping_t mapping = checkmapping(L, 1, NULL);
+    const char *data = luaL_checklstring(L, 3, &len);
+    checkaccess(L, mapping, AL_MAP_WRITE_BIT_SOFT);
+    offset = checkrange(L, mapping, 2, luaL_checkinteger(L, 2), len);
+    memcpy(mapping->ptr + offset, data, len);
+    return 0;
+    }
+
+static int Read(lua_State *L)
+/* data = read(mapping, [offset], [length]) */
+    {
+    size_t offset;
+    mapping_t mapping = checkmapping(L, 1, NULL);
+    lua_Integer offs = luaL_optinteger(L, 2, 0);
+    lua_Integer len = luaL_optinteger(L, 3, AVAILABLE(mapping, offs));
+    checkaccess(L, mapping, AL_MAP_READ_BIT_SOFT);
+    if(len < 0) return luaL_argerror(L, 3, errstring(ERR_VALUE));
+    offset = checkrange(L, mapping, 2, offs, len);
+    lua_pushlstring(L, (char*)mapping->ptr + offset, len);
+    return 1;
+    }
+
+static int Pack(lua_State *L)
+/* nbytes = pack(mapping, offset, type, val1, ...) (as al.pack(), but in place) */
+    {
+    int err;
+    size_t offset, nbytes;
+    mapping_t mapping = checkmapping(L, 1, NULL);
+    int type = checktype(L, 3);
+    checkaccess(L, mapping, AL_MAP_WRITE_BIT_SOFT);
+    offset = checkrange(L, mapping, 2, luaL_checkinteger(L, 2), 0);
+    nbytes = datahandling_pack(L, type, 4, mapping->ptr + offset, mapping->size - offset, &err);
+    if(err == ERR_LENGTH) return luaL_argerror(L, 2, errstring(ERR_BOUNDARIES));
+    if(err) return luaL_argerror(L, 4, errstring(err));
+    lua_pushinteger(L, nbytes);
+    return 1;
+    }
+
+static int Unpack(lua_State *L)
+/* {val} = unpack(mapping, offset, type, [count]) (as al.unpack(), but in place) */
+    {
+    size_t offset, len;
+    mapping_t mapping = checkmapping(L, 1, NULL);
+    lua_Integer offs = luaL_checkinteger(L, 2);
+    int type = checktype(L, 3);
+    size_t size = sizeoftype(type);
+    checkaccess(L, mapping, AL_MAP_READ_BIT_SOFT);
+    if(lua_isnoneornil(L, 4))
+        len = AVAILABLE(mapping, offs) / size * size;
+    else
+        {
+        lua_Integer count = luaL_checkinteger(L, 4);
+        if(count < 0 || (size_t)count > (size_t)mapping->size / size)
+            return luaL_argerror(L, 4, errstring(ERR_BOUNDARIES));
+        len = (size_t)count * size;
+        }
+    offset = checkrange(L, mapping, 2, offs, len);
+    return datahandling_unpack(L, type, mapping->ptr + offset, len);
+    }
+
+static int Flush(lua_State *L)
+/* flush(mapping, [offset], [length]) */
+    {
+    ud_t *ud;
+    ALenum ec;
+    lua_Integer offset, length;
+    context_t old_context;
+    mapping_t mapping = checkmapping(L, 1, &ud);
+    ud_t *buffer_ud = (ud_t*)ud->parent_ud;
+    checkaccess(L, mapping, AL_MAP_WRITE_BIT_SOFT);
+    offset = luaL_optinteger(L, 2, 0);
+    if(offset < 0 || offset > mapping->size)
+        return luaL_argerror(L, 2, errstring(ERR_BOUNDARIES));
+    length = luaL_optinteger(L, 3, mapping->size - offset);
+    if(length < 0 || length > mapping->size - offset)
+        return luaL_argerror(L, 3, errstring(ERR_BOUNDARIES));
+    CheckContextPfn(L, ud, FlushMappedBufferSOFT);
+    old_context = current_context(L);
+    make_context_current(L, ud->context);
+    ud->cdt->FlushMappedBufferSOFT(((buffer_t)buffer_ud->handle)->name,
+                        mapping->offset + offset, length);
+    ec = al.GetError();
+    make_context_current(L, old_context);
+    if(ec) { pushalerror(L, ec); return lua_error(L); }
+    return 0;
+    }
+
+static int Size(lua_State *L)
+/* size, offset = size(mapping) */
+    {
+    mapping_t mapping = checkmapping(L, 1, NULL);
+    lua_pushinteger(L, mapping->size);
+    lua_pushinteger(L, mapping->offset);
+    return 2;
+    }
+
+RAW_FUNC(mapping)
+TYPE_FUNC(mapping)
+PARENT_FUNC(mapping)
+DELETE_FUNC(mapping)
+
+static const struct luaL_Reg Methods[] =
+    {
+        { "raw", Raw },
+        { "type", Type },
+        { "parent", Parent },
+        { "delete", Delete },
+        { "unmap", Delete },
+        { "size", Size },
+        { "write", Write },
+        { "read", Read },
+        { "pack", Pack },
+        { "unpack", Unpack },
+        { "flush", Flush },
+        { NULL, NULL } /* sentinel */
+    };
+
+static const struct luaL_Reg MetaMethods[] =
+    {
+        { "__gc",  Delete },
+        { NULL, NULL } /* sentinel */
+    };
+
+static const struct luaL_Reg Functions[] =
+    {
+        { "map_buffer", mapping_map },
+        { "unmap_buffer", Delete },
+        { "mapping_size", Size },
+        { "mapping_write", Write },
+        { "mapping_read", Read },
+        { "mapping_pack", Pack },
+        { "mapping_unpack", Unpack },
+        { "flush_mapped_buffer", Flush },
+        { NULL, NULL } /* sentinel */
+    };
+
+
+void moonal_open_mapping(lua_State *L)
+    {
+    udata_define(L, MAPPING_MT, Methods, MetaMethods);
+    luaL_setfuncs(L, Functions, 0);
+    }
+
@@ -0,0 +1,1190 @@
+/* The MIT License (MIT)
+ *
+ * Copyright (c) 2018 Stefano Trettel
+ *
+ * Software repository: MoonAL, https://github.com/stetre/moonal
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "internal.h"
+#include "codec.h"
+#include <math.h>
+
+/*------------------------------------------------------------------------------*
+ | MP3 decoder                                                                  |
+ *------------------------------------------------------------------------------*/
+
+/* Decodes MPEG-1, MPEG-2 and MPEG-2.5 Layer III streams (ISO/IEC 11172-3 and 13818-3).
+ * Layers I and II, and free format streams, are not supported. ID3v2 tags at the start
+ * and any trailing data (e.g. an ID3v1 tag) are skipped. If the first frame carries a
+ * Xing/Info tag with the encoder delay and padding (as written by LAME), they are removed
+ * from the decoded data, together with the delay of the decoder, so that the data has
+ * the length of the original. Otherwise the count of frames is estimated from the size
+ * of the first frame.
+ */
+
+#define PI          3.14159265358979323846
+#define MAXFRAME    1441        /* 320 kbit/s at 32 kHz, with padding */
+#define RESERVOIR   511         /* largest main_data_begin */
+#define DECODERDELAY 529        /* delay of the synthesis filterbank (as assumed by LAME) */
+
+typedef struct {
+    int layer, lsf, mpeg25, sr;  /* sr = index in Rates[] */
+    int channels, mode, modeext, crc;
+    unsigned size;              /* frame size in bytes */
+} header_t;
+
+typedef struct {
+    unsigned part23, bigvalues, gain, sfcompress, switching, blocktype, mixed;
+    unsigned table[3], subgain[3], region0, region1, preflag, sfscale, count1;
+} granule_t;
+
+typedef struct {
+    unsigned start, width;
+    int window;                 /* -1 for long blocks */
+    unsigned sfb;
+    int is, ismax;              /* intensity stereo position, and its illegal value */
+    int e4;                     /* gain exponent (the gain is 2^(e4/4)) */
+} band_t;
+
+typedef struct {
+    const unsigned char *p;
+    size_t pos, end;            /* in bits */
+} bits_t;
+
+typedef struct {
+    header_t first;             /* header of the first frame */
+    long start;                 /* position of the first audio frame */
+    unsigned spf;               /* samples per frame */
+    int gapless, done;
+    uint64_t skip, total;       /* frames to drop at the start, and to keep (if gapless) */
+    uint64_t pos;               /* frames decoded so far */
+    unsigned char frame[MAXFRAME + 4];
+    unsigned char main[RESERVOIR + MAXFRAME + 4]; /* bit reservoir */
+    size_t mainlen;
+    unsigned scfsi[2];
+    int scf[2][22];             /* long block scalefactors of the first granule */
+    band_t bands[2][40];
+    unsigned nbands[2];
+    int ix[576];
+    float xr[2][576];
+    float overlap[2][576];
+    float sub[18][32];          /* subband samples */
+    float v[2][1024];
+    unsigned voff[2];
+    float pow43[8207];
+    float cos36[36*18], cos12[12*6], win[4][36], matrix[64*32], window[512];
+} mp3_t;
+
+static const long Rates[9] = { 11025, 12000, 8000, 22050, 24000, 16000, 44100, 48000, 32000 };
+
+static const unsigned short Kbps[2][15] = {
+    { 0, 32, 40, 48, 56, 64, 80, 96, 112, 128, 160, 192, 224, 256, 320 },
+    { 0, 8, 16, 24, 32, 40, 48, 56, 64, 80, 96, 112, 128, 144, 160 },
+    };
+
+/* scalefactor band boundaries, long and short blocks (same order as Rates[]) */
+static const unsigned short Long[9][23] = {
+    { 0,6,12,18,24,30,36,44,54,66,80,96,116,140,168,200,238,284,336,396,464,522,576 },
+    { 0,6,12,18,24,30,36,44,54,66,80,96,116,140,168,200,238,284,336,396,464,522,576 },
+    { 0,12,24,36,48,60,72,88,108,132,160,192,232,280,336,400,476,566,568,570,572,574,576 },
+    { 0,6,12,18,24,30,36,44,54,66,80,96,116,140,168,200,238,284,336,396,464,522,576 },
+    { 0,6,12,18,24,30,36,44,54,66,80,96,114,136,162,194,232,278,332,394,464,540,576 },
+    { 0,6,12,18,24,30,36,44,54,66,80,96,116,140,168,200,238,284,336,396,464,522,576 },
+    { 0,4,8,12,16,20,24,30,36,44,52,62,74,90,110,134,162,196,238,288,342,418,576 },
+    { 0,4,8,12,16,20,24,30,36,42,50,60,72,88,106,128,156,190,230,276,330,384,576 },
+    { 0,4,8,12,16,20,24,30,36,44,54,66,82,102,126,156,194,240,296,364,448,550,576 },
+    };
+
+static const unsigned short Short[9][14] = {
+    { 0,4,8,12,18,26,36,48,62,80,104,134,174,192 },
+    { 0,4,8,12,18,26,36,48,62,80,104,134,174,192 },
+    { 0,8,16,24,36,52,72,96,124,160,162,164,166,192 },
+    { 0,4,8,12,18,24,32,42,56,74,100,132,174,192 },
+    { 0,4,8,12,18,26,36,48,62,80,104,136,180,192 },
+    { 0,4,8,12,18,26,36,48,62,80,104,134,174,192 },
+    { 0,4,8,12,16,22,30,40,52,66,84,106,136,192 },
+    { 0,4,8,12,16,22,28,38,50,64,80,100,126,192 },
+    { 0,4,8,12,16,22,30,42,58,78,104,138,180,192 },
+    };
+
+static const unsigned char Pretab[22] = { 0,0,0,0,0,0,0,0,0,0,0,1,1,1,1,2,2,3,3,3,2,0 };
+
+static const unsigned char Slen[16][2] = {
+    {0,0}, {0,1}, {0,2}, {0,3}, {3,0}, {1,1}, {1,2}, {1,3},
+    {2,1}, {2,2}, {2,3}, {3,1}, {3,2}, {3,3}, {4,2}, {4,3},
+    };
+
+/* number of scalefactors in each of the 4 parts, for MPEG-2 (long, short, mixed blocks) */
+static const unsigned char Nsf[6][3][4] = {
+    { {6,5,5,5}, {9,9,9,9}, {6,9,9,9} },
+    { {6,5,7,3}, {9,9,12,6}, {6,9,12,6} },
+    { {11,10,0,0}, {18,18,0,0}, {15,18,0,0} },
+    { {7,7,7,0}, {12,12,12,0}, {6,15,12,0} },
+    { {6,6,6,3}, {12,9,9,6}, {6,12,9,6} },
+    { {8,8,5,0}, {15,12,9,0}, {6,18,9,0} },
+    };
+
+/* Huffman code tables of the standard, as binary trees: each node has two children,
+ * that are nodes (> 0) or leaves (-1 - value, with value = x*16 + y, or v*8+w*4+x*2+y
+ * for the count1 tables A and B). */
+static const short Tree1[6] = {
+    1, -1, 2, -17, -18, -2
+    };
+
+static const short Tree2[16] = {
+    1, -1, 3, 2, -2, -17, 4, -18, 5, 7, 6, -19, -35, -3, -34, -33
+    };
+
+static const short Tree3[16] = {
+    2, 1, -2, -1, 3, -18, 4, -17, 5, 7, 6, -19, -35, -3, -34, -33
+    };
+
+static const short Tree5[30] = {
+    1, -1, 3, 2, -2, -17, 4, -18, 7, 5, 10, 6, -3, -33, 12, 8,
+    9, 11, -20, -4, -19, -34, -49, -35, 13, -50, 14, -51, -52, -36
+    };
+
+static const short Tree6[30] = {
+    3, 1, -18, 2, -17, -1, 5, 4, 13, -2, 8, 6, 7, -19, -35, -3,
+    9, 12, 10, 14, 11, -36, -52, -4, -20, -50, -34, -33, -51, -49
+    };
+
+static const short Tree7[70] = {
+    1, -1, 3, 2, -2, -17, 7, 4, 5, -18, -34, 6, -3, -33, 13, 8,
+    9, 18, 10, 19, 12, 11, -51, -4, -5, -36, 14, 20, 22, 15, 16, 27,
+    -82, 17, -6, -53, 24, -19, -20, -50, 21, 31, 25, -21, 29, 23, 26, -22,
+    -49, -35, -37, -67, -38, -83, -81, 28, -68, -52, 32, 30, -54, -69, -66, -65,
+    33, 34, -86, -70, -85, -84
+    };
+
+static const short Tree8[70] = {
+    3, 1, 2, -1, -2, -17, 4, -18, 5, 19, 11, 6, 8, 7, -3, -33,
+    9, -35, 20, 10, -4, -49, 15, 12, 21, 13, 14, 23, -5, -65, 16, 24,
+    26, 17, 18, -22, -83, -6, -19, -34, -20, -50, 22, -66, -67, -21, -36, -51,
+    29, 25, 28, -37, 32, 27, 31, -38, -81, -52, -82, 30, -53, -68, -54, -69,
+    33, -84, 34, -70, -86, -85
+    };
+
+static const short Tree9[70] = {
+    4, 1, 3, 2, -17, -1, -18, -2, 8, 5, 6, 26, 7, -19, -35, -3,
+    12, 9, 21, 10, -50, 11, -4, -49, 13, 22, 17, 14, 32, 15, -68, 16,
+    -81, -5, 18, 24, 33, 19, -84, 20, -85, -6, 27, -20, 28, 23, -21, -66,
+    30, 25, -83, -22, -34, -33, -36, -51, 29, 31, -37, -67, -69, -38, -52, -65,
+    -82, -53, 34, -54, -86, -70
+    };
+
+static const short Tree10[126] = {
+    1, -1, 3, 2, -2, -17, 7, 4, 5, -18, 27, 6, -3, -33, 15, 8,
+    9, 28, 12, 10, 36, 11, -51, -4, 13, 30, 37, 14, -52, -5, 20, 16,
+    31, 17, 34, 18, -97, 19, -6, -81, 41, 21, 24, 22, 23, -24, -7, 51,
+    25, 46, 26, -113, -101, -8, -19, -34, 29, 35, -20, -50, -21, -66, 39, 32,
+    33, 44, 38, -22, -23, -98, -49, -35, -65, -36, -37, -67, -38, -83, -114, 40,
+    -55, -39, 48, 42, 52, 43, -40, -115, -82, 45, -53, -68, -99, 47, -70, -54,
+    54, 49, 58, 50, -102, -56, -84, -69, 53, 56, -116, -71, 59, 55, 61, -72,
+    57, -100, -86, -85, -117, -87, 62, 60, -119, -88, -118, -103, -120, -104
+    };
+
+static const short Tree11[126] = {
+    3, 1, 2, -1, -2, -17, 7, 4, 5, -18, -19, 6, -3, -33, 16, 8,
+    12, 9, 10, -34, 11, -35, -4, -49, 13, 29, 14, 34, 30, 15, -5, -65,
+    24, 17, 18, 35, 19, 22, 20, -99, 21, -22, -83, -6, 23, -23, -39, -7,
+    25, 31, 49, 26, 41, 27, -115, 28, -101, -8, -20, -50, -21, -66, 32, 38,
+    -114, 33, -24, -113, -36, -51, 44, 36, 42, 37, -37, -67, 48, 39, -97, 40,
+    -69, -38, 46, -40, -81, 43, -68, -52, -98, 45, -82, -53, 52, 47, -54, -84,
+    -55, -100, 54, 50, 51, 53, 59, -56, -70, -85, -116, -71, 60, 55, 56, 57,
+    -103, -72, -117, 58, -88, -86, -87, -102, 61, 62, -120, -104, -119, -118
+    };
+
+static const short Tree12[126] = {
+    6, 1, 2, 4, 3, -18, 5, -1, -2, -17, -3, -33, 12, 7, 8, 29,
+    9, 38, 10, -20, 11, -49, -65, -4, 18, 13, 14, 39, 31, 15, 16, 30,
+    17, -37, -81, -5, 24, 19, 20, 33, 21, 43, 52, 22, -69, 23, -7, -6,
+    44, 25, 36, 26, 27, 50, -114, 28, -8, -113, -19, -34, -67, -21, 32, 48,
+    -22, -82, 34, 41, -98, 35, -23, -97, 53, 37, -101, -24, -50, -35, 47, 40,
+    -36, -51, 49, 42, -38, -83, -39, -99, 54, 45, 51, 46, 57, -40, -52, -66,
+    -53, -68, -54, -84, -55, -100, -87, -56, -70, -85, -115, -71, 58, 55, 56, 60,
+    -103, -72, -116, -86, 61, 59, -88, -118, -117, -102, 62, -119, -120, -104
+    };
+
+static const short Tree13[510] = {
+    1, -1, 4, 2, 3, -17, -18, -2, 14, 5, 8, 6, 69, 7, -3, -33,
+    11, 9, 10, 90, -50, -4, 12, 70, -66, 13, -5, -65, 30, 15, 20, 16,
+    17, 71, 18, 73, 94, 19, -83, -6, 24, 21, 28, 22, 74, 23, -7, -97,
+    25, 95, 75, 26, -114, 27, -86, -8, -130, 29, -9, -129, 41, 31, 36, 32,
+    33, 76, 78, 34, 35, 141, -10, -145, 37, 100, 38, 118, 79, 39, 40, -161,
+    -11, -105, 52, 42, 47, 43, 44, 103, 80, 45, 46, 144, -12, -177, 48, 105,
+    49, 123, 50, 176, -194, 51, -153, -13, 58, 53, 54, 81, 84, 55, 145, 56,
+    57, 205, -14, -209, 64, 59, 60, 125, 181, 61, 62, 87, -227, 63, -47, -15,
+    130, 65, 66, 88, 67, 152, 111, 68, 184, -16, -19, -34, 91, -20, 92, 72,
+    112, -21, -22, -82, -23, -98, 98, -24, 99, 77, -131, -25, -26, -146, -27, -162,
+    -28, -178, 108, 82, 162, 83, 204, -29, 85, 163, 110, 86, -211, -30, -31, -226,
+    128, 89, -32, -242, -49, -35, -36, -51, 113, 93, -81, -37, 134, -38, 115, 96,
+    97, 114, -85, -39, -56, -40, 136, -41, 101, 138, 102, 117, -42, -147, 121, 104,
+    -43, -163, 106, 189, 107, 192, -44, 175, 147, 109, -61, -45, 197, -46, -48, -243,
+    -67, -52, -53, -68, -99, -54, 116, 135, -113, -55, 158, -57, 142, 119, 120, 174,
+    -58, -89, 122, 159, -59, -164, 124, 160, 194, -60, 149, 126, 179, 127, -199, -62,
+    129, 213, 239, -63, 185, 131, 170, 132, 154, 133, -64, 208, -84, -69, -100, -70,
+    -115, 137, -71, -101, 139, 156, -132, 140, -103, -72, -73, -133, 143, -148, -135, -74,
+    -151, -75, 146, -210, 211, -76, 148, 178, -77, -197, 166, 150, 151, 206, -200, -78,
+    168, 153, 199, -79, 155, 240, -80, -245, 157, 173, -117, -87, -88, -118, -90, -150,
+    -180, 161, -137, -91, -195, -92, 164, 195, -184, 165, -93, -198, 167, 198, -225, -94,
+    169, -172, -202, -95, 171, 222, 172, 215, -233, -96, -102, -116, -134, -104, -166, -106,
+    -193, 177, -181, -107, -108, -183, 212, 180, -170, -109, 231, 182, 207, 183, -110, -228,
+    -111, -157, 218, 186, 200, 187, 224, 188, 242, -112, 190, -179, -149, 191, -120, -119,
+    -165, 193, -121, -136, -167, -122, 196, -196, -154, -123, -212, -124, -214, -125, -126, -216,
+    209, 201, 202, -248, -143, 203, -128, -127, -182, -138, -139, -169, -140, -185, -229, -141,
+    -142, -217, 210, 216, -144, -249, -168, -152, -213, -155, -186, 214, -156, -171, -158, -218,
+    -205, 217, -175, -159, 226, 219, 220, 233, 235, 221, -236, -160, 249, 223, -173, -188,
+    -219, 225, -174, -189, 236, 227, 228, 246, 244, 229, -221, 230, -176, -234, -241, 232,
+    -187, -230, 250, 234, -190, -220, 243, -191, 247, 237, 245, 238, -223, -192, -201, -215,
+    241, -244, -203, -231, -204, -247, -251, -206, -252, -207, -239, -208, -237, -222, 251, 248,
+    -240, -224, -246, -232, -250, -235, 252, -256, 253, -238, 254, -254, -255, -253
+    };
+
+static const short Tree15[510] = {
+    7, 1, 4, 2, 3, -1, -2, -17, 5, -18, 78, 6, -3, -33, 21, 8,
+    13, 9, 10, 105, 106, 11, 12, -20, -65, -4, 17, 14, 107, 15, -66, 16,
+    -21, -5, 109, 18, 79, 19, 20, -53, -6, -81, 37, 22, 32, 23, 28, 24,
+    111, 25, 80, 26, 27, -54, -7, -97, 81, 29, 175, 30, 31, -55, -8, -113,
+    85, 33, 83, 34, 35, 129, 36, 176, -117, -9, 48, 38, 90, 39, 44, 40,
+    134, 41, 42, 178, -148, 43, -120, -10, 117, 45, 89, 46, 47, -105, -11, -161,
+    64, 49, 59, 50, 55, 51, 52, 122, 199, 53, -167, 54, -193, -12, 165, 56,
+    57, 141, -183, 58, -154, -13, 142, 60, 61, 180, 62, 200, 63, -30, -46, -14,
+    71, 65, 101, 66, 146, 67, 99, 68, 69, 183, -226, 70, -15, -225, 72, 149,
+    222, 73, 213, 74, 205, 75, 232, 76, -112, 77, -175, -16, -19, -34, -22, -82,
+    -99, -23, 113, 82, -101, -24, 114, 84, -25, -130, 86, 131, 115, 87, -146, 88,
+    -26, -145, -27, -162, 95, 91, 92, 136, 93, 190, -179, 94, -166, -28, 96, 119,
+    97, 163, 98, 208, -182, -29, 124, 100, -227, -31, 102, 170, 125, 103, 104, 220,
+    -32, -242, 127, -35, -36, -51, 108, 128, -68, -37, 153, 110, -38, -83, 155, 112,
+    -85, -39, -40, -115, -41, -131, 116, 197, -42, -104, 179, 118, -43, -163, 139, 120,
+    207, 121, -44, -91, -195, 123, -45, -92, -47, -171, 126, 195, -231, -48, -50, -49,
+    -67, -52, 130, 156, -102, -56, 158, 132, 133, 157, -57, -132, 160, 135, -149, -58,
+    161, 137, 138, -164, -136, -59, 140, -180, -60, -122, -61, -196, 167, 143, 144, 247,
+    194, 145, -199, -62, 147, 218, 210, 148, -63, -110, 186, 150, 173, 151, 152, 249,
+    -245, -64, -98, 154, -84, -69, -100, -70, -116, -71, -103, -72, 159, 177, -73, -133,
+    -135, -74, 162, 198, -151, -75, 164, 192, -194, -76, 166, 193, -169, -77, 168, 216,
+    201, 169, -78, -140, 184, 171, 202, 172, -79, -229, 231, 174, 211, -80, -86, -114,
+    -129, -87, -88, -118, -89, -134, -90, -150, 181, 209, -210, 182, -93, -209, -94, -214,
+    185, 230, -95, -172, 187, 203, 240, 188, 212, 189, -96, -158, -178, 191, -177, -106,
+    -181, -107, -197, -108, -170, -109, -243, 196, -111, -241, -119, -147, -165, -121, -123, -168,
+    -124, -184, -125, -200, -126, -216, 204, 226, -246, -127, 206, 227, -234, -128, -152, -137,
+    -138, -153, -198, -139, -141, -201, -218, -142, -143, -233, 233, 214, 215, 221, -144, -249,
+    -213, 217, -185, -155, 248, 219, -156, -186, -157, -202, -205, -159, 236, 223, 228, 224,
+    241, 225, -221, -160, -232, -173, -248, -174, 229, 235, -222, -176, -187, -230, -203, -188,
+    -219, -189, 253, 234, -190, -220, -251, -191, 244, 237, 238, 242, 250, 239, -238, -192,
+    -204, -247, -236, -206, -252, 243, -207, -237, 251, 245, -239, 246, -254, -208, -212, -211,
+    -215, -228, -244, -217, -253, -223, 254, 252, -255, -224, -250, -235, -256, -240
+    };
+
+static const short Tree16[510] = {
+    1, -1, 4, 2, 3, -17, -18, -2, 16, 5, 8, 6, 70, 7, -3, -33,
+    12, 9, 71, 10, 11, -35, -4, -49, 72, 13, 14, 87, -66, 15, -5, -65,
+    44, 17, 26, 18, 22, 19, 90, 20, -82, 21, -22, -6, 92, 23, 74, 24,
+    -98, 25, -7, -97, 35, 27, 31, 28, 95, 29, 30, -24, 154, -8, 75, 32,
+    200, 33, 34, -56, -9, -87, 40, 36, 37, 113, 99, 38, 39, -26, -119, -10,
+    139, 41, 42, 116, -27, 43, -11, -161, 128, 45, 61, 46, 56, 47, 52, 48,
+    49, 100, 50, 143, -178, 51, -12, -177, 53, 77, 54, 169, 55, 145, -194, -13,
+    57, 82, 58, 79, 59, 120, 122, 60, 158, -14, 68, 62, -242, 63, 124, 64,
+    191, 65, 66, 148, 67, 159, -15, -225, 69, -32, -48, -16, -19, -34, -20, -50,
+    88, 73, 107, -21, -99, -23, 97, 76, 136, -25, 102, 78, -179, -28, 80, 85,
+    81, 188, 157, -29, 83, 103, 105, 84, 119, -30, -227, 86, -47, -31, -36, -51,
+    108, 89, -81, -37, 109, 91, -38, -83, 111, 93, 133, 94, -85, -39, 134, 96,
+    -40, -115, 98, -131, -103, -41, -42, -147, 186, 101, 118, -43, 156, -44, 171, 104,
+    -45, 230, 106, 242, -212, -46, -67, -52, -53, -68, -84, 110, -54, -69, -114, 112,
+    -113, -55, 137, 114, 183, 115, -57, -132, 117, 155, -58, -148, -59, -90, -60, 201,
+    146, 121, 190, -61, 173, 123, -199, -62, 175, 125, 150, 126, 127, 174, -201, -63,
+    179, 129, 152, 130, 131, -243, -241, 132, -64, 160, -100, -70, -116, 135, -102, -71,
+    -72, -117, -146, 138, -145, -73, 165, 140, 141, -163, 142, -104, -74, -88, 168, 144,
+    -75, -165, -76, -181, 202, 147, -154, -77, 194, 149, -78, -140, 223, 151, -79, 203,
+    153, 253, 164, -80, -101, -86, -89, -134, -91, -166, -92, -138, -93, -198, -94, -214,
+    227, 161, 196, 162, 163, -190, 195, -95, -96, -246, 166, 184, 167, -162, -150, -105,
+    -106, -151, 170, -180, -107, -167, 172, 217, -197, -108, -155, -109, -110, 211, 205, 176,
+    177, 212, 204, 178, -217, -111, 208, 180, 181, -256, 199, 182, -112, -247, -133, -118,
+    185, -149, -135, -120, 187, -164, -121, -136, -193, 189, -153, -122, -183, -123, 218, 192,
+    193, -228, -124, 231, -125, -200, -202, -126, 225, 197, 198, -203, -127, -173, -128, -248,
+    -130, -129, -152, -137, -139, -169, -229, -141, -188, -142, 214, 206, 207, 213, -143, -233,
+    234, 209, 215, 210, 254, -144, -215, -156, -231, -157, -158, -232, -159, 232, -176, 216,
+    -251, -160, -196, -168, 221, 219, -213, 220, -185, -170, 222, -226, -186, -171, 224, 243,
+    -172, -187, -205, 226, -174, -219, 237, 228, 233, 229, 246, -175, -195, -182, -184, -209,
+    -189, -204, -191, -206, 248, 235, 241, 236, -192, -252, 238, 250, 239, 244, 240, -223,
+    -207, 247, -208, -253, -211, -210, -230, -216, -234, 245, -235, -218, -221, -220, -237, -222,
+    252, 249, -224, -254, -239, 251, -238, -236, -240, -255, -245, -244, -250, -249
+    };
+
+static const short Tree24[510] = {
+    22, 1, 5, 2, 4, 3, -17, -1, -18, -2, 12, 6, 9, 7, -34, 8,
+    -3, -33, 10, -19, 11, -35, -4, -49, 17, 13, 14, 75, 15, 103, -66, 16,
+    -5, -65, 18, 76, 19, 132, 105, 20, -22, 21, -6, -81, 68, 23, 40, 24,
+    30, 25, 134, 26, 78, 27, 28, 145, 29, -54, -7, -97, 82, 31, 36, 32,
+    33, 107, 34, -116, -24, 35, -8, -113, 80, 37, 38, 167, -130, 39, -9, -129,
+    54, 41, 42, 114, 43, 86, 48, 44, 182, 45, 195, 46, 47, -145, -161, -10,
+    155, 49, 52, 50, 51, -27, -177, -11, 53, -60, -193, -12, 61, 55, 93, 56,
+    57, 90, 157, 58, 184, 59, 60, -61, -209, -13, 62, 97, 63, 126, 64, 176,
+    213, 65, 66, -231, 67, -14, -15, -225, 162, 69, 70, -256, 130, 71, 101, 72,
+    73, 202, 74, 233, -16, 245, -20, -50, 104, 77, -52, -21, 106, 79, -23, -98,
+    81, 149, -131, -25, 83, 109, 112, 84, 193, 85, -26, -146, 118, 87, 88, 217,
+    89, 181, -166, -28, 121, 91, 171, 92, -182, -29, 123, 94, 95, 172, 96, 197,
+    -211, -30, 98, 159, 187, 99, 229, 100, -227, -31, -242, 102, -32, -241, -36, -51,
+    -37, -67, -38, -83, -39, -99, 108, -115, -56, -40, 150, 110, 137, 111, -103, -41,
+    169, 113, -42, -104, 115, 138, 141, 116, 170, 117, -43, -163, 208, 119, 120, -179,
+    -44, -91, 196, 122, -168, -45, 185, 124, 143, 125, -212, -46, 199, 127, 212, 128,
+    129, -63, -79, -47, 144, 131, -48, -243, -82, 133, -53, -68, 147, 135, 136, 146,
+    -55, -100, -57, -132, 179, 139, 152, 140, -58, -148, 153, 142, -59, -164, -199, -62,
+    -64, -244, -84, -69, -70, -85, 148, 166, -71, -101, -72, -117, 151, 168, -73, -133,
+    -74, -149, 154, -136, -75, -121, 209, 156, -194, -76, 218, 158, -77, -197, 174, 160,
+    161, 211, -200, -78, 225, 163, 191, 164, 178, 165, -80, -245, -86, -114, -87, -102,
+    -88, -118, -89, -134, -90, -150, -195, -92, 173, 210, -210, -93, 175, 198, -226, -94,
+    189, 177, -95, -187, -96, -246, 180, 194, -162, -105, -178, -106, -181, 183, -107, -167,
+    -108, -183, 219, 186, -170, -109, 188, 220, -110, -215, 190, -202, -111, -157, 206, 192,
+    -112, -247, -119, -147, -135, -120, -122, -152, -196, -123, -124, -184, -214, -125, 200, 248,
+    -230, 201, -172, -126, 222, 203, 215, 204, 205, 230, -218, -127, 207, -248, -144, -128,
+    -180, -137, -138, -153, -198, -139, -140, -185, -141, -201, 236, 214, -142, -217, 216, 221,
+    -204, -143, -151, -165, -169, -154, -213, -155, -228, -156, -233, -158, 223, 231, 238, 224,
+    -205, -159, 241, 226, 227, 254, -251, 228, -176, -160, -186, -171, -232, -173, 232, 237,
+    -234, -174, 239, 234, 244, 235, -175, -235, -203, -188, -219, -189, -190, -220, 249, 240,
+    -191, -236, 251, 242, 247, 243, -192, -252, -206, -221, 250, 246, -238, -207, -208, -253,
+    -216, -229, -237, -222, -239, -223, 253, 252, -224, -254, -240, -255, -250, -249
+    };
+
+static const short TreeA[30] = {
+    1, -1, 4, 2, 3, 7, -3, -2, 8, 5, 6, 11, -7, -4, -5, -9,
+    12, 9, 10, -10, -8, -6, -11, -13, 13, 14, -12, -16, -14, -15
+    };
+
+static const short TreeB[30] = {
+    8, 1, 5, 2, 4, 3, -2, -1, -4, -3, 7, 6, -6, -5, -8, -7,
+    12, 9, 11, 10, -10, -9, -12, -11, 14, 13, -14, -13, -16, -15
+    };
+
+static const struct { const short *tree; unsigned linbits; } Tables[32] = {
+    { NULL, 0 }, { Tree1, 0 }, { Tree2, 0 }, { Tree3, 0 }, { NULL, 0 }, { Tree5, 0 }, { Tree6, 0 }, { Tree7, 0 },
+    { Tree8, 0 }, { Tree9, 0 }, { Tree10, 0 }, { Tree11, 0 }, { Tree12, 0 }, { Tree13, 0 }, { NULL, 0 }, { Tree15, 0 },
+    { Tree16, 1 }, { Tree16, 2 }, { Tree16, 3 }, { Tree16, 4 }, { Tree16, 6 }, { Tree16, 8 }, { Tree16, 10 }, { Tree16, 13 },
+    { Tree24, 4 }, { Tree24, 5 }, { Tree24, 6 }, { Tree24, 7 }, { Tree24, 8 }, { Tree24, 9 }, { Tree24, 11 }, { Tree24, 13 },
+    };
+
+/* synthesis window D[i] of the standard, times 65536, for i = 0..256 (the other half is
+ * symmetric, with D[512-i] = -D[i] unless i is a multiple of 64) */
+static const int32_t Window[257] = {
+    0, -1, -1, -1, -1, -1, -1, -2, -2, -2, -2, -3,
+    -3, -4, -4, -5, -5, -6, -7, -7, -8, -9, -10, -11,
+    -13, -14, -16, -17, -19, -21, -24, -26, -29, -31, -35, -38,
+    -41, -45, -49, -53, -58, -63, -68, -73, -79, -85, -91, -97,
+    -104, -111, -117, -125, -132, -139, -147, -154, -161, -169, -176, -183,
+    -190, -196, -202, -208, 213, 218, 222, 225, 227, 228, 228, 227,
+    224, 221, 215, 208, 200, 189, 177, 163, 146, 127, 106, 83,
+    57, 29, -2, -36, -72, -111, -153, -197, -244, -294, -347, -401,
+    -459, -519, -581, -645, -711, -779, -848, -919, -991, -1064, -1137, -1210,
+    -1283, -1356, -1428, -1498, -1567, -1634, -1698, -1759, -1817, -1870, -1919, -1962,
+    -2001, -2032, -2057, -2075, -2085, -2087, -2080, -2063, 2037, 2000, 1952, 1893,
+    1822, 1739, 1644, 1535, 1414, 1280, 1131, 970, 794, 605, 402, 185,
+    -45, -288, -545, -814, -1095, -1388, -1692, -2006, -2330, -2663, -3004, -3351,
+    -3705, -4063, -4425, -4788, -5153, -5517, -5879, -6237, -6589, -6935, -7271, -7597,
+    -7910, -8209, -8491, -8755, -8998, -9219, -9416, -9585, -9727, -9838, -9916, -9959,
+    -9966, -9935, -9863, -9750, -9592, -9389, -9139, -8840, -8492, -8092, -7640, -7134,
+    6574, 5959, 5288, 4561, 3776, 2935, 2037, 1082, 70, -998, -2122, -3300,
+    -4533, -5818, -7154, -8540, -9975, -11455, -12980, -14548, -16155, -17799, -19478, -21189,
+    -22929, -24694, -26482, -28289, -30112, -31947, -33791, -35640, -37489, -39336, -41176, -43006,
+    -44821, -46617, -48390, -50137, -51853, -53534, -55178, -56778, -58333, -59838, -61289, -62684,
+    -64019, -65290, -66494, -67629, -68692, -69679, -70590, -71420, -72169, -72835, -73415, -73908,
+    -74313, -74630, -74856, -74992, 75038
+    };
+
+/*------------------------------------------------------------------------------*
+ | Bit reader                                                                   |
+ *------------------------------------------------------------------------------*/
+
+static void bitsinit(bits_t *b, const unsigned char *p, size_t len)
+    {
+    b->p = p;
+    b->pos = 0;
+    b->end = len * 8;
+    }
+
+static unsigned getbit(bits_t *b)
+    {
+    unsigned v = b->pos < b->end ? (b->p[b->pos >> 3] >> (7 - (b->pos & 7))) & 1 : 0;
+    b->pos++;
+    return v;
+    }
+
+static unsigned getbits(bits_t *b, unsigned n)
+/* reads n (<= 24) bits, msb first (the data must be followed by 3 spare bytes) */
+    {
+    const unsigned char *p = b->p + (b->pos >> 3);
+    uint32_t v;
+    if(n == 0) return 0;
+    if(b->pos + n > b->end)
+        {
+        for(v = 0; n > 0; n--) v = (v << 1) | getbit(b);
+        return v;
+        }
+    v = ((uint32_t)p[0] << 24) | ((uint32_t)p[1] << 16) | ((uint32_t)p[2] << 8) | p[3];
+    v = (v << (b->pos & 7)) >> (32 - n);
+    b->pos += n;
+    return v;
+    }
+
+static int huffman(bits_t *b, const short *tree)
+    {
+    int node = 0;
+    do node = tree[2*node + getbit(b)]; while(node > 0);
+    return -node - 1;
+    }
+
+/*------------------------------------------------------------------------------*
+ | Headers                                                                      |
+ *------------------------------------------------------------------------------*/
+
+static int parseheader(const unsigned char *h, header_t *fh)
+/* Returns 0 if h is a valid frame header (the size is computed only for Layer III) */
+    {
+    unsigned version, kbps;
+    if(h[0] != 0xff || (h[1] & 0xe0) != 0xe0) return -1;
+    version = (h[1] >> 3) & 3;  /* 0 = MPEG-2.5, 2 = MPEG-2, 3 = MPEG-1 */
+    fh->layer = 4 - ((h[1] >> 1) & 3);
+    if(version == 1 || fh->layer == 4 || (h[2] >> 4) == 15 || (h[2] >> 4) == 0 || ((h[2] >> 2) & 3) == 3)
+        return -1;
+    fh->lsf = version != 3;
+    fh->mpeg25 = version == 0;
+    fh->sr = (version == 3 ? 6 : version == 2 ? 3 : 0) + ((h[2] >> 2) & 3);
+    fh->crc = !(h[1] & 1);
+    fh->mode = h[3] >> 6;
+    fh->modeext = (h[3] >> 4) & 3;
+    fh->channels = fh->mode == 3 ? 1 : 2;
+    kbps = Kbps[fh->lsf][h[2] >> 4];
+    fh->size = fh->layer != 3 ? 0 :
+        (unsigned)((fh->lsf ? 72000 : 144000) * kbps / Rates[fh->sr]) + ((h[2] >> 1) & 1);
+    return 0;
+    }
+
+static int consistent(const header_t *a, const header_t *b)
+    {
+    return a->layer == b->layer && a->lsf == b->lsf && a->mpeg25 == b->mpeg25 &&
+           a->sr == b->sr && a->channels == b->channels;
+    }
+
+static int probe(decoder_t *dec, long pos, header_t *fh, const header_t *ref)
+/* Checks if there is a frame at pos, followed by another one (or by the end of the data,
+ * or by an ID3v1 tag). */
+    {
+    unsigned char h[4];
+    header_t next;
+    size_t n;
+    if(codec_seek(dec, pos) != 0 || codec_input(dec, h, 4) < 4 || parseheader(h, fh) != 0) return 0;
+    if(ref && !consistent(fh, ref)) return 0;
+    if(fh->layer != 3) return 1; /* not supported anyway */
+    if(codec_seek(dec, pos + (long)fh->size) != 0) return 1; /* truncated */
+    if((n = codec_input(dec, h, 4)) == 0) return 1;
+    if(n >= 3 && memcmp(h, "TAG", 3) == 0) return 1;
+    return n == 4 && parseheader(h, &next) == 0 && consistent(&next, fh);
+    }
+
+static int resync(decoder_t *dec, long pos, long limit, header_t *fh, const header_t *ref)
+/* Looks for the next frame from pos (up to limit bytes), and returns its position, or -1
+ * if not found. */
+    {
+    long p;
+    int c;
+    if(codec_seek(dec, pos) != 0) return -1;
+    for(;;)
+        {
+        if((c = codec_byte(dec)) < 0) return -1;
+        if(c != 0xff) continue;
+        p = codec_tell(dec) - 1;
+        if(p - pos > limit) return -1;
+        if(probe(dec, p, fh, ref)) return p;
+        if(codec_seek(dec, p + 1) != 0) return -1;
+        }
+    }
+
+static unsigned sideinfosize(const header_t *fh)
+    { return fh->lsf ? (fh->channels == 1 ? 9 : 17) : (fh->channels == 1 ? 17 : 32); }
+
+static uint32_t be32(const unsigned char *p)
+    { return ((uint32_t)p[0] << 24) | ((uint32_t)p[1] << 16) | ((uint32_t)p[2] << 8) | p[3]; }
+
+/*------------------------------------------------------------------------------*
+ | Side information and scalefactors                                            |
+ *------------------------------------------------------------------------------*/
+
+static const char *sideinfo(bits_t *b, const header_t *fh, mp3_t *st, granule_t gr[2][2], unsigned *mdb)
+    {
+    unsigned g, ch, i, ngr = fh->lsf ? 1 : 2;
+    granule_t *p;
+    if(!fh->lsf)
+        {
+        *mdb = getbits(b, 9);
+        (void)getbits(b, fh->channels == 1 ? 5 : 3);
+        for(ch = 0; ch < (unsigned)fh->channels; ch++) st->scfsi[ch] = getbits(b, 4);
+        }
+    else
+        {
+        *mdb = getbits(b, 8);
+        (void)getbits(b, fh->channels == 1 ? 1 : 2);
+        }
+    for(g = 0; g < ngr; g++)
+        for(ch = 0; ch < (unsigned)fh->channels; ch++)
+            {
+            p = &gr[g][ch];
+            memset(p, 0, sizeof(granule_t));
+            p->part23 = getbits(b, 12);
+            p->bigvalues = getbits(b, 9);
+            p->gain = getbits(b, 8);
+            p->sfcompress = getbits(b, fh->lsf ? 9 : 4);
+            if(p->bigvalues > 288) return CODEC_CORRUPT;
+            if((p->switching = getbits(b, 1)) != 0)
+                {
+                if((p->blocktype = getbits(b, 2)) == 0) return CODEC_CORRUPT;
+                p->mixed = getbits(b, 1);
+                for(i = 0; i < 2; i++) p->table[i] = getbits(b, 5);
+                for(i = 0; i < 3; i++) p->subgain[i] = getbits(b, 3);
+                }
+            else
+                {
+                for(i = 0; i < 3; i++) p->table[i] = getbits(b, 5);
+                p->region0 = getbits(b, 4);
+                p->region1 = getbits(b, 3);
+                }
+            if(!fh->lsf) p->preflag = getbits(b, 1);
+            p->sfscale = getbits(b, 1);
+            p->count1 = getbits(b, 1);
+            }
+    return NULL;
+    }
+
+static void scalefactors(mp3_t *st, bits_t *b, const header_t *fh, const granule_t *g, unsigned gr, unsigned ch)
+/* Reads the scalefactors, and sets the bands of the granule with their gains */
+    {
+    static const unsigned char Groups[5] = { 0, 6, 11, 16, 21 };
+    int l[22], s[13][3], lmax[22], smax[13][3], flat[39], fmax[39];
+    unsigned i, j, k, w, nlong = 0, first = 0, pos = 0, end, slen[4], n, blk, preflag = g->preflag;
+    unsigned sfc = g->sfcompress;
+    const unsigned short *L = Long[fh->sr], *S = Short[fh->sr];
+    band_t *band;
+    memset(l, 0, sizeof(l));
+    memset(s, 0, sizeof(s));
+    for(i = 0; i < 22; i++) lmax[i] = 7;
+    for(i = 0; i < 13; i++) smax[i][0] = smax[i][1] = smax[i][2] = 7;
+    if(!fh->lsf)
+        {
+        if(g->blocktype == 2)
+            {
+            if(g->mixed)
+                {
+                for(i = 0; i < 8; i++) l[i] = (int)getbits(b, Slen[sfc][0]);
+                nlong = 8;
+                first = 3;
+                }
+            for(i = first; i < 12; i++)
+                for(w = 0; w < 3; w++) s[i][w] = (int)getbits(b, Slen[sfc][i < 6 ? 0 : 1]);
+            }
+        else
+            {
+            nlong = 22;
+            for(k = 0; k < 4; k++)
+                for(i = Groups[k]; i < Groups[k+1]; i++)
+                    l[i] = (gr == 1 && ((st->scfsi[ch] >> (3 - k)) & 1)) ?
+                                st->scf[ch][i] : (int)getbits(b, Slen[sfc][k < 2 ? 0 : 1]);
+            memcpy(st->scf[ch], l, sizeof(st->scf[ch]));
+            }
+        }
+    else
+        {
+        blk = g->blocktype == 2 ? (g->mixed ? 2 : 1) : 0;
+        if(ch == 1 && (fh->modeext & 1)) /* intensity stereo channel */
+            {
+            sfc >>= 1;
+            if(sfc < 180) { j = 3; slen[0] = sfc / 36; slen[1] = (sfc % 36) / 6; slen[2] = sfc % 6; slen[3] = 0; }
+            else if(sfc < 244) { j = 4; sfc -= 180; slen[0] = (sfc % 64) >> 4; slen[1] = (sfc % 16) >> 2; slen[2] = sfc % 4; slen[3] = 0; }
+            else { j = 5; sfc -= 244; slen[0] = sfc / 3; slen[1] = sfc % 3; slen[2] = slen[3] = 0; }
+            }
+        else if(sfc < 400) { j = 0; slen[0] = (sfc >> 4) / 5; slen[1] = (sfc >> 4) % 5; slen[2] = (sfc % 16) >> 2; slen[3] = sfc % 4; }
+        else if(sfc < 500) { j = 1; sfc -= 400; slen[0] = (sfc >> 2) / 5; slen[1] = (sfc >> 2) % 5; slen[2] = sfc % 4; slen[3] = 0; }
+        else { j = 2; sfc -= 500; slen[0] = sfc / 3; slen[1] = sfc % 3; slen[2] = slen[3] = 0; preflag = 1; }
+        for(k = 0, n = 0; k < 4; k++)
+            for(i = 0; i < Nsf[j][blk][k]; i++, n++)
+                {
+                flat[n] = (int)getbits(b, slen[k]);
+                fmax[n] = (1 << slen[k]) - 1;
+                }
+        while(n < 39) { flat[n] = 0; fmax[n++] = 0; }
+        k = 0;
+        if(blk == 0)
+            {
+            nlong = 22;
+            for(i = 0; i < 21; i++, k++) { l[i] = flat[k]; lmax[i] = fmax[k]; }
+            }
+        else
+            {
+            if(blk == 2)
+                {
+                nlong = 6;
+                first = 3;
+                for(i = 0; i < 6; i++, k++) { l[i] = flat[k]; lmax[i] = fmax[k]; }
+                }
+            for(i = first; i < 12; i++)
+                for(w = 0; w < 3; w++, k++) { s[i][w] = flat[k]; smax[i][w] = fmax[k]; }
+            }
+        }
+    /* the last band has no scalefactor, and takes the intensity position of the previous one */
+    l[21] = 0;
+    lmax[21] = lmax[20];
+    for(w = 0; w < 3; w++) { s[12][w] = 0; smax[12][w] = smax[11][w]; }
+    band = st->bands[ch];
+    n = 0;
+    for(i = 0; i < nlong && pos < 576; i++)
+        {
+        end = (g->mixed && L[i+1] > 36) ? 36 : L[i+1];
+        band[n].start = pos;
+        band[n].width = end - pos;
+        band[n].window = -1;
+        band[n].sfb = i;
+        band[n].is = i == 21 ? l[20] : l[i];
+        band[n].ismax = lmax[i];
+        k = (unsigned)(l[i] + (preflag ? Pretab[i] : 0)) * (g->sfscale ? 4 : 2);
+        band[n].e4 = (int)g->gain - 210 - (int)k;
+        pos = end;
+        n++;
+        if(g->mixed && pos == 36) break;
+        }
+    if(g->blocktype == 2)
+        for(i = first; i < 13; i++)
+            for(w = 0; w < 3; w++)
+                {
+                band[n].start = pos;
+                band[n].width = S[i+1] - S[i];
+                band[n].window = (int)w;
+                band[n].sfb = i;
+                band[n].is = i == 12 ? s[11][w] : s[i][w];
+                band[n].ismax = smax[i][w];
+                k = (unsigned)s[i][w] * (g->sfscale ? 4 : 2) + 8 * g->subgain[w];
+                band[n].e4 = (int)g->gain - 210 - (int)k;
+                pos += band[n].width;
+                n++;
+                }
+    st->nbands[ch] = n;
+    }
+
+/*------------------------------------------------------------------------------*
+ | Huffman data and requantization                                              |
+ *------------------------------------------------------------------------------*/
+
+static int linbits(bits_t *b, int x, unsigned nlin)
+    {
+    if(x == 15 && nlin > 0) x += (int)getbits(b, nlin);
+    return (x != 0 && getbit(b)) ? -x : x;
+    }
+
+static const char *huffdecode(mp3_t *st, bits_t *b, const header_t *fh, const granule_t *g, size_t end)
+/* Decodes the quantized values of a granule into st->ix[], up to the bit position end */
+    {
+    unsigned i, t, v, k, r1, r2, big = g->bigvalues * 2;
+    int q[4];
+    size_t pos;
+    const short *tree;
+    const unsigned short *L = Long[fh->sr];
+    if(g->switching)
+        {
+        if(fh->mpeg25)
+            {
+            k = (g->blocktype == 2 && !g->mixed) ? 5 : 7;
+            r1 = L[k+1];
+            r2 = L[21];
+            }
+        else if(!fh->lsf || g->blocktype == 2)
+            { r1 = 36; r2 = 576; }
+        else
+            { r1 = 54; r2 = 576; }
+        }
+    else
+        {
+        k = g->region0 + 1;
+        r1 = L[k < 22 ? k : 22];
+        k = g->region0 + g->region1 + 2;
+        r2 = L[k < 22 ? k : 22];
+        }
+    if(r1 > big) r1 = big;
+    if(r2 > big) r2 = big;
+    for(i = 0; i < big; i += 2)
+        {
+        t = g->table[i < r1 ? 0 : i < r2 ? 1 : 2];
+        if(!(tree = Tables[t].tree))
+            {
+            if(t != 0) return CODEC_CORRUPT;
+            st->ix[i] = st->ix[i+1] = 0;
+            continue;
+            }
+        v = (unsigned)huffman(b, tree);
+        st->ix[i] = linbits(b, (int)(v >> 4), Tables[t].linbits);
+        st->ix[i+1] = linbits(b, (int)(v & 15), Tables[t].linbits);
+        }
+    tree = g->count1 ? TreeB : TreeA;
+    while(i + 4 <= 576 && b->pos < end)
+        {
+        pos = b->pos;
+        v = (unsigned)huffman(b, tree);
+        for(k = 0; k < 4; k++)
+            q[k] = ((v >> (3 - k)) & 1) ? (getbit(b) ? -1 : 1) : 0;
+        if(b->pos > end) /* the last quad overruns the data: discard it */
+            { b->pos = pos; break; }
+        for(k = 0; k < 4; k++) st->ix[i++] = q[k];
+        }
+    while(i < 576) st->ix[i++] = 0;
+    b->pos = end;
+    return NULL;
+    }
+
+static void requantize(mp3_t *st, unsigned ch)
+    {
+    static const float Pow2q[4] = { 1.0f, 1.18920711500272f, 1.41421356237310f, 1.68179283050743f };
+    const band_t *band;
+    unsigned n, i, end;
+    int e, q;
+    float f, *xr = st->xr[ch];
+    for(n = 0; n < st->nbands[ch]; n++)
+        {
+        band = &st->bands[ch][n];
+        e = band->e4;
+        q = e >= 0 ? e / 4 : -((3 - e) / 4); /* floor(e/4) */
+        f = ldexpf(Pow2q[e - 4*q], q);
+        end = band->start + band->width;
+        for(i = band->start; i < end; i++)
+            xr[i] = st->ix[i] < 0 ? -st->pow43[-st->ix[i]] * f : st->pow43[st->ix[i]] * f;
+        }
+    }
+
+/*------------------------------------------------------------------------------*
+ | Stereo processing                                                            |
+ *------------------------------------------------------------------------------*/
+
+static void midside(float *l, float *r, unsigned n)
+    {
+    unsigned i;
+    float m, s;
+    for(i = 0; i < n; i++)
+        {
+        m = l[i]; s = r[i];
+        l[i] = (m + s) * 0.70710678118655f;
+        r[i] = (m - s) * 0.70710678118655f;
+        }
+    }
+
+static int nonzero(const float *x, unsigned n)
+    {
+    unsigned i;
+    for(i = 0; i < n; i++)
+        if(x[i] != 0) return 1;
+    return 0;
+    }
+
+static void stereo(mp3_t *st, const header_t *fh, const granule_t *g)
+/* Joint stereo: g is the granule of the right channel, whose bands are used for both */
+    {
+    float *l = st->xr[0], *r = st->xr[1], kl, kr, t, io;
+    int ms = fh->modeext & 2, seen[4] = { 0, 0, 0, 0 }, isband, k;
+    unsigned n, i, w;
+    const band_t *band;
+    if(!(fh->modeext & 1))
+        {
+        if(ms) midside(l, r, 576);
+        return;
+        }
+    io = (g->sfcompress & 1) ? 0.70710678118655f : 0.84089641525371f;
+    for(n = st->nbands[1]; n-- > 0; )
+        {
+        band = &st->bands[1][n];
+        /* intensity stereo applies to the bands above the last nonzero one in the right
+         * channel (for each window, in short blocks) */
+        w = band->window < 0 ? 3 : (unsigned)band->window;
+        if(nonzero(r + band->start, band->width)) seen[w] = 1;
+        isband = w == 3 ? !(seen[0] || seen[1] || seen[2] || seen[3]) : !seen[w];
+        k = band->is;
+        if(!isband || k >= band->ismax)
+            {
+            if(ms) midside(l + band->start, r + band->start, band->width);
+            continue;
+            }
+        if(!fh->lsf)
+            {
+            if(k == 6) { kl = 1; kr = 0; }
+            else
+                {
+                t = (float)tan(k * PI / 12);
+                kl = t / (1 + t);
+                kr = 1 / (1 + t);
+                }
+            }
+        else if(k == 0) kl = kr = 1;
+        else if(k & 1) { kl = powf(io, (float)((k + 1) / 2)); kr = 1; }
+        else { kl = 1; kr = powf(io, (float)(k / 2)); }
+        for(i = band->start; i < band->start + band->width; i++)
+            {
+            r[i] = l[i] * kr;
+            l[i] = l[i] * kl;
+            }
+        }
+    }
+
+/*------------------------------------------------------------------------------*
+ | Hybrid filterbank                                                            |
+ *------------------------------------------------------------------------------*/
+
+static void reorder(mp3_t *st, unsigned ch)
+/* Reorders the short block bands so that each subband has its 6 lines for each of the
+ * 3 windows interleaved */
+    {
+    float tmp[576], *xr = st->xr[ch];
+    const band_t *band;
+    unsigned n, i, base, lo = 576;
+    for(n = 0; n < st->nbands[ch]; n++)
+        {
+        band = &st->bands[ch][n];
+        if(band->window < 0) continue;
+        if(band->start < lo) lo = band->start;
+        base = band->start - (unsigned)band->window * band->width;
+        for(i = 0; i < band->width; i++)
+            tmp[base + 3*i + (unsigned)band->window] = xr[band->start + i];
+        }
+    if(lo < 576) memcpy(xr + lo, tmp + lo, (576 - lo) * sizeof(float));
+    }
+
+static void antialias(float *xr, const granule_t *g)
+    {
+    static const float Cs[8] = {
+        0.857492925712f, 0.881741997318f, 0.949628649103f, 0.983314592492f,
+        0.995517816065f, 0.999160558175f, 0.999899195243f, 0.999993155067f };
+    static const float Ca[8] = {
+        -0.514495755427f, -0.471731968565f, -0.313377454204f, -0.181913199611f,
+        -0.094574192526f, -0.040965582885f, -0.014198568572f, -0.003699974673f };
+    unsigned sb, i, nsb = g->blocktype != 2 ? 32 : g->mixed ? 2 : 0;
+    float a, b;
+    for(sb = 1; sb < nsb; sb++)
+        for(i = 0; i < 8; i++)
+            {
+            a = xr[18*sb - 1 - i];
+            b = xr[18*sb + i];
+            xr[18*sb - 1 - i] = a * Cs[i] - b * Ca[i];
+            xr[18*sb + i] = b * Cs[i] + a * Ca[i];
+            }
+    }
+
+static void imdct(mp3_t *st, unsigned ch, const granule_t *g)
+/* Transforms each subband, and overlaps it with the previous granule into st->sub[][] */
+    {
+    float y[36], *x, *ov;
+    const float *c, *win;
+    unsigned sb, i, k, w, type;
+    for(sb = 0; sb < 32; sb++)
+        {
+        x = st->xr[ch] + 18*sb;
+        ov = st->overlap[ch] + 18*sb;
+        type = (g->mixed && sb < 2) ? 0 : g->blocktype;
+        if(type == 2)
+            {
+            memset(y, 0, sizeof(y));
+            win = st->win[2];
+            for(w = 0; w < 3; w++)
+                for(i = 0; i < 12; i++)
+                    {
+                    float s = 0;
+                    c = st->cos12 + 6*i;
+                    for(k = 0; k < 6; k++) s += x[3*k + w] * c[k];
+                    y[6 + 6*w + i] += s * win[i];
+                    }
+            }
+        else
+            {
+            win = st->win[type];
+            for(i = 0; i < 36; i++)
+                {
+                float s = 0;
+                c = st->cos36 + 18*i;
+                for(k = 0; k < 18; k++) s += x[k] * c[k];
+                y[i] = s * win[i];
+                }
+            }
+        for(i = 0; i < 18; i++)
+            {
+            st->sub[i][sb] = y[i] + ov[i];
+            ov[i] = y[i + 18];
+            }
+        if(sb & 1) /* frequency inversion */
+            for(i = 1; i < 18; i += 2) st->sub[i][sb] = -st->sub[i][sb];
+        }
+    }
+
+static void synthesis(mp3_t *st, unsigned ch, short *pcm, unsigned nch)
+/* Polyphase synthesis of the 18 time slots of a granule */
+    {
+    float *v = st->v[ch], s;
+    const float *m, *d = st->window;
+    unsigned t, i, k, j, off;
+    long x;
+    for(t = 0; t < 18; t++)
+        {
+        off = st->voff[ch] = (st->voff[ch] - 64) & 1023;
+        for(i = 0; i < 64; i++)
+            {
+            m = st->matrix + 32*i;
+            for(s = 0, k = 0; k < 32; k++) s += m[k] * st->sub[t][k];
+            v[off + i] = s;
+            }
+        for(j = 0; j < 32; j++)
+            {
+            for(s = 0, i = 0; i < 8; i++)
+                s += v[(off + 128*i + j) & 1023] * d[64*i + j] +
+                     v[(off + 128*i + 96 + j) & 1023] * d[64*i + 32 + j];
+            x = lrintf(s * 32768);
+            pcm[(32*t + j) * nch] = (short)(x > 32767 ? 32767 : x < -32768 ? -32768 : x);
+            }
+        }
+    }
+
+/*------------------------------------------------------------------------------*
+ | Frames                                                                       |
+ *------------------------------------------------------------------------------*/
+
+static long nextframe(decoder_t *dec, mp3_t *st, header_t *fh)
+/* Returns the position of the next frame, or -1 at the end of the data */
+    {
+    long pos = codec_tell(dec);
+    unsigned char h[4];
+    if(codec_input(dec, h, 4) == 4 && parseheader(h, fh) == 0 && consistent(fh, &st->first))
+        return pos;
+    return resync(dec, pos, dec->length, fh, &st->first);
+    }
+
+static const char *decodeframe(decoder_t *dec, mp3_t *st, short *pcm)
+/* Decodes the next frame into pcm (spf frames). Sets st->done at the end of the data. */
+    {
+    header_t fh;
+    granule_t gr[2][2];
+    bits_t b;
+    unsigned g, ch, ngr, nch, hlen, mdb;
+    size_t mdlen, total, end;
+    long pos;
+    const char *errmsg;
+    if((pos = nextframe(dec, st, &fh)) < 0)
+        { st->done = 1; return NULL; }
+    if(codec_seek(dec, pos) != 0 || codec_input(dec, st->frame, fh.size) < fh.size)
+        return CODEC_TRUNCATED;
+    memset(st->frame + fh.size, 0, 4);
+    nch = (unsigned)fh.channels;
+    ngr = fh.lsf ? 1 : 2;
+    hlen = 4 + (fh.crc ? 2 : 0) + sideinfosize(&fh);
+    if(fh.size < hlen) return CODEC_CORRUPT;
+    bitsinit(&b, st->frame + 4 + (fh.crc ? 2 : 0), sideinfosize(&fh));
+    if((errmsg = sideinfo(&b, &fh, st, gr, &mdb)) != NULL) return errmsg;
+    /* append the main data to the bit reservoir */
+    mdlen = fh.size - hlen;
+    memcpy(st->main + st->mainlen, st->frame + hlen, mdlen);
+    total = st->mainlen + mdlen;
+    memset(st->main + total, 0, 4);
+    if(mdb > st->mainlen) /* the reservoir is not available (e.g. after a resync) */
+        {
+        memset(st->xr, 0, sizeof(st->xr));
+        for(g = 0; g < ngr; g++)
+            for(ch = 0; ch < nch; ch++)
+                {
+                memset(st->sub, 0, sizeof(st->sub));
+                synthesis(st, ch, pcm + 576*g*nch + ch, nch);
+                }
+        }
+    else
+        {
+        bitsinit(&b, st->main + st->mainlen - mdb, mdb + mdlen);
+        for(g = 0; g < ngr; g++)
+            {
+            for(ch = 0; ch < nch; ch++)
+                {
+                end = b.pos + gr[g][ch].part23;
+                scalefactors(st, &b, &fh, &gr[g][ch], g, ch);
+                if((errmsg = huffdecode(st, &b, &fh, &gr[g][ch], end)) != NULL) return errmsg;
+                requantize(st, ch);
+                }
+            if(fh.mode == 1 && nch == 2) stereo(st, &fh, &gr[g][1]);
+            for(ch = 0; ch < nch; ch++)
+                {
+                if(gr[g][ch].blocktype == 2) reorder(st, ch);
+                antialias(st->xr[ch], &gr[g][ch]);
+                imdct(st, ch, &gr[g][ch]);
+                synthesis(st, ch, pcm + 576*g*nch + ch, nch);
+                }
+            }
+        }
+    /* keep the last bytes for the next frames */
+    if(total > RESERVOIR)
+        {
+        memmove(st->main, st->main + total - RESERVOIR, RESERVOIR);
+        total = RESERVOIR;
+        }
+    st->mainlen = total;
+    return NULL;
+    }
+
+static const char *Decode(decoder_t *dec)
+    {
+    mp3_t *st = (mp3_t*)dec->state;
+    uint64_t from, to;
+    short *pcm;
+    const char *errmsg;
+    size_t nch = (size_t)dec->channels;
+    while(!st->done)
+        {
+        if(!(pcm = codec_pcm(dec, st->spf))) return CODEC_NOMEM;
+        if((errmsg = decodeframe(dec, st, pcm)) != NULL) return errmsg;
+        if(st->done) break;
+        from = st->pos;
+        to = st->pos += st->spf;
+        if(st->gapless)
+            {
+            if(from < st->skip) from = st->skip;
+            if(to > st->skip + st->total) to = st->skip + st->total;
+            if(st->pos >= st->skip + st->total) st->done = 1;
+            }
+        if(to <= from) continue;
+        if(from > st->pos - st->spf)
+            memmove(pcm, pcm + (from - (st->pos - st->spf)) * nch, (size_t)(to - from) * nch * sizeof(short));
+        dec->npcm = (size_t)(to - from);
+        break;
+        }
+    return NULL;
+    }
+
+/*------------------------------------------------------------------------------*
+ | Stream                                                                       |
+ *------------------------------------------------------------------------------*/
+
+static void tables(mp3_t *st)
+    {
+    unsigned i, k;
+    for(i = 0; i < 8207; i++)
+        st->pow43[i] = (float)pow(i, 4.0 / 3.0);
+    for(i = 0; i < 36; i++)
+        for(k = 0; k < 18; k++)
+            st->cos36[18*i + k] = (float)cos(PI / 72 * (2*i + 1 + 18) * (2*k + 1));
+    for(i = 0; i < 12; i++)
+        for(k = 0; k < 6; k++)
+            st->cos12[6*i + k] = (float)cos(PI / 24 * (2*i + 1 + 6) * (2*k + 1));
+    for(i = 0; i < 36; i++)
+        {
+        st->win[0][i] = (float)sin(PI / 36 * (i + 0.5));
+        st->win[1][i] = i < 18 ? st->win[0][i] : i < 24 ? 1 : i < 30 ? (float)sin(PI / 12 * (i - 18 + 0.5)) : 0;
+        st->win[3][i] = i < 6 ? 0 : i < 12 ? (float)sin(PI / 12 * (i - 6 + 0.5)) : i < 18 ? 1 : st->win[0][i];
+        st->win[2][i] = i < 12 ? (float)sin(PI / 12 * (i + 0.5)) : 0;
+        }
+    for(i = 0; i < 64; i++)
+        for(k = 0; k < 32; k++)
+            st->matrix[32*i + k] = (float)cos((16 + i) * (2*k + 1) * PI / 64);
+    for(i = 0; i < 512; i++)
+        st->window[i] = i <= 256 ? Window[i] / 65536.0f :
+                        (i % 64 == 0 ? 1 : -1) * Window[512 - i] / 65536.0f;
+    }
+
+static void vbrtag(decoder_t *dec, mp3_t *st, long pos)
+/* Parses the Xing/Info (or VBRI) tag, if the first frame has one, and skips the frame */
+    {
+    const header_t *fh = &st->first;
+    const unsigned char *p = st->frame + 4 + (fh->crc ? 2 : 0) + sideinfosize(fh);
+    const unsigned char *end = st->frame + fh->size;
+    uint32_t flags, frames = 0, delay, padding;
+    if(codec_seek(dec, pos) != 0 || codec_input(dec, st->frame, fh->size) < fh->size) return;
+    if(p + 8 <= end && (memcmp(p, "Xing", 4) == 0 || memcmp(p, "Info", 4) == 0))
+        {
+        flags = be32(p + 4);
+        p += 8;
+        if(flags & 1)
+            {
+            if(p + 4 > end) return;
+            frames = be32(p);
+            p += 4;
+            }
+        if(flags & 2) p += 4;
+        if(flags & 4) p += 100;
+        if(flags & 8) p += 4;
+        st->start = pos + (long)fh->size;
+        if(frames == 0) return;
+        st->gapless = 1;
+        st->total = (uint64_t)frames * st->spf;
+        if(p + 24 <= end && (memcmp(p, "LAME", 4) == 0 || memcmp(p, "Lavf", 4) == 0 ||
+                             memcmp(p, "Lavc", 4) == 0))
+            {
+            delay = ((uint32_t)p[21] << 4) | (p[22] >> 4);
+            padding = ((uint32_t)(p[22] & 15) << 8) | p[23];
+            if(delay + padding < st->total)
+                {
+                st->skip = delay + DECODERDELAY;
+                st->total -= delay + padding;
+                }
+            }
+        dec->frames = st->total;
+        }
+    else if(st->frame + 36 + 18 <= end && memcmp(st->frame + 36, "VBRI", 4) == 0)
+        {
+        st->start = pos + (long)fh->size;
+        dec->frames = (uint64_t)be32(st->frame + 36 + 14) * st->spf;
+        }
+    }
+
+static const char *Rewind(decoder_t *dec)
+    {
+    mp3_t *st = (mp3_t*)dec->state;
+    st->done = 0;
+    st->pos = 0;
+    st->mainlen = 0;
+    st->voff[0] = st->voff[1] = 0;
+    memset(st->overlap, 0, sizeof(st->overlap));
+    memset(st->v, 0, sizeof(st->v));
+    if(codec_seek(dec, st->start) != 0) return CODEC_TRUNCATED;
+    return NULL;
+    }
+
+static const char *Open(decoder_t *dec)
+    {
+    unsigned char h[10];
+    long pos = 0;
+    mp3_t *st = (mp3_t*)calloc(1, sizeof(mp3_t));
+    if(!st) return CODEC_NOMEM;
+    dec->state = st;
+    /* skip any ID3v2 tag */
+    while(codec_seek(dec, pos) == 0 && codec_input(dec, h, 10) == 10 && memcmp(h, "ID3", 3) == 0)
+        pos += 10 + (h[5] & 0x10 ? 10 : 0) +
+               (long)(((h[6] & 0x7f) << 21) | ((h[7] & 0x7f) << 14) | ((h[8] & 0x7f) << 7) | (h[9] & 0x7f));
+    if((pos = resync(dec, pos, 65536, &st->first, NULL)) < 0) return CODEC_INVALID;
+    if(st->first.layer != 3) return CODEC_UNSUPPORTED;
+    tables(st);
+    dec->channels = st->first.channels;
+    dec->rate = Rates[st->first.sr];
+    st->spf = st->first.lsf ? 576 : 1152;
+    st->start = pos;
+    vbrtag(dec, st, pos);
+    if(dec->frames == 0)
+        dec->frames = (uint64_t)((dec->length - pos) / (long)st->first.size) * st->spf;
+    return Rewind(dec);
+    }
+
+static void Close(decoder_t *dec)
+    {
+    free(dec->state);
+    }
+
+const codec_t mp3_codec = { Open, Decode, Rewind, Close };
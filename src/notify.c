@@ -0,0 +1,143 @@
+/* The MIT License (MIT)
+ *
+ * Copyright (c) 2018 Stefano Trettel
+ *
+ * Software repository: MoonAL, https://github.com/stetre/moonal
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+
+#include "internal.h"
+#include <errno.h>
+#if defined(LINUX)
+#include <sys/eventfd.h>
+#include <unistd.h>
+#endif
+
+/*------------------------------------------------------------------------------*
+ | Pollable event descriptor                                                    |
+ *------------------------------------------------------------------------------*/
+
+/* event_fd() creates for a context an eventfd(2) that is readable whenever the context
+ * has work pending for the owning thread, i.e. native events to be drained or completed
+ * loads to be polled, so that an external event loop can wait on it instead of polling.
+ *
+ * The producers (the events callback, see events.c, and the loader workers, see loader.c)
+ * signal the descriptor after having queued their items. The consumers (drain_events()
+ * and poll_loads()) call notify_update() when they are done, which resets the descriptor
+ * and then signals it again if some items are still queued. Resetting before checking
+ * ensures that no signal is lost.
+ */
+
+struct moonal_notifier_s {
+    int fd;
+};
+
+#define NOTIFIER(context_ud) (CTXINFO(context_ud)->notifier)
+
+void notify_signal(int fd)
+/* may be called by any thread */
+    {
+#if defined(LINUX)
+    uint64_t one = 1;
+    if(fd >= 0) 
+        while(write(fd, &one, sizeof(one)) < 0 && errno == EINTR);
+#else
+    (void)fd;
+#endif
+    }
+
+int notify_fd(ud_t *context_ud)
+/* returns the event descriptor of the context, or -1 if it was not created */
+    {
+    notifier_t *n = NOTIFIER(context_ud);
+    return n ? n->fd : -1;
+    }
+
+void notify_update(ud_t *context_ud)
+    {
+#if defined(LINUX)
+    uint64_t count;
+    notifier_t *n = NOTIFIER(context_ud);
+    if(!n) return;
+    while(read(n->fd, &count, sizeof(count)) < 0 && errno == EINTR);
+    if(events_pending(context_ud) || loader_ready(context_ud))
+        notify_signal(n->fd);
+#else
+    (void)context_ud;
+#endif
+    }
+
+void notify_free(lua_State *L, ud_t *context_ud)
+/* called by freecontext(), after the producers have been stopped */
+    {
+    notifier_t *n = NOTIFIER(context_ud);
+    if(!n) return;
+#if defined(LINUX)
+    close(n->fd);
+#endif
+    Free(L, n);
+    NOTIFIER(context_ud) = NULL;
+    }
+
+/*------------------------------------------------------------------------------*
+ | Lua functions                                                                |
+ *------------------------------------------------------------------------------*/
+
+int notify_eventfd(lua_State *L)
+/* fd = event_fd(context) */
+    {
+    ud_t *ud;
+    notifier_t *n;
+    checkcontext(L, 1, &ud);
+    n = NOTIFIER(ud);
+    if(!n)
+        {
+#if defined(LINUX)
+        int fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+        if(fd < 0)
+            return luaL_error(L, "cannot create eventfd: %s", strerror(errno));
+        n = NOTIFIER(ud) = (notifier_t*)MallocNoErr(L, sizeof(notifier_t));
+        if(!n)
+            { close(fd); return luaL_error(L, errstring(ERR_MEMORY)); }
+        n->fd = fd;
+        /* let the producers know */
+        events_setfd(ud, fd);
+        loader_setfd(ud, fd);
+        notify_update(ud); /* items may be already queued */
+#else
+        return notavailable(L);
+#endif
+        }
+    lua_pushinteger(L, n->fd);
+    return 1;
+    }
+
+static const struct luaL_Reg Functions[] =
+    {
+        { "event_fd", notify_eventfd },
+        { NULL, NULL } /* sentinel */
+    };
+
+void moonal_open_notify(lua_State *L)
+    {
+    luaL_setfuncs(L, Functions, 0);
+    }
+
@@ -32,6 +32,8 @@ ud_t *newuserdata(lua_State *L, void *handle, const char *mt)
     ud = (ud_t*)udata_new(L, sizeof(ud_t), (uint64_t)(uintptr_t)handle, mt);
     memset(ud, 0, sizeof(ud_t));
     ud->handle = handle;
+    ud->objtype = mttoobjtype(mt);
+    stats_created(ud->objtype);
     MarkValid(ud);
     return ud;
     }
@@ -44,6 +46,25 @@ int freeuserdata(lua_State *L, ud_t *ud)
      * by the script, or implicitly destroyed because child of a destroyed object). */
     if(!IsValid(ud)) return 0;
     CancelValid(ud);
+    stats_deleted(ud->objtype);
+    if(IsRamped(ud))
+        ramps_forget(L, ud);
+    if(IsVirtualizable(ud))
+        virtual_forget(L, ud);
+    if(IsIndexed(ud))
+        spatial_forget(L, ud);
+    if(IsShadowed(ud))
+        shadow_forget(L, ud);
+    if(IsLoading(ud))
+        loader_forget(L, ud);
+    if(IsCached(ud))
+        bufcache_forget(L, ud);
+    if(IsManaged(ud) || IsDeferred(ud))
+        residency_forget(L, ud);
+    if(IsScheduled(ud))
+        schedule_forget(L, ud);
+    if(IsSampled(ud))
+        telemetry_forget(L, ud);
     if(ud->info) 
         Free(L, ud->info);
     udata_free(L, (uint64_t)(uintptr_t)ud->handle);
@@ -73,9 +94,9 @@ int pushuserdata(lua_State *L, ud_t *ud)
     return udata_push(L, (uint64_t)(uintptr_t)ud->handle);
     }
 
-ud_t *userdata(void *handle)
+ud_t *userdata(lua_State *L, void *handle)
     {
-    ud_t *ud = (ud_t*)udata_mem((uint64_t)(uintptr_t)handle);
+    ud_t *ud = (ud_t*)udata_mem(L, (uint64_t)(uintptr_t)handle);
     if(ud && IsValid(ud)) return ud;
     return NULL;
     }
@@ -41,6 +41,23 @@
 #define EFFECT_MT "moonal_effect"
 #define FILTER_MT "moonal_filter"
 #define AUXSLOT_MT "moonal_auxslot"
+#define VOICEPOOL_MT "moonal_voicepool"
+#define MAPPING_MT "moonal_mapping"
+#define STREAM_MT "moonal_stream"
+
+/* Object types (for statistics, see stats.c) */
+#define OBJTYPE_DEVICE      0
+#define OBJTYPE_CONTEXT     1
+#define OBJTYPE_BUFFER      2
+#define OBJTYPE_LISTENER    3
+#define OBJTYPE_SOURCE      4
+#define OBJTYPE_EFFECT      5
+#define OBJTYPE_FILTER      6
+#define OBJTYPE_AUXSLOT     7
+#define OBJTYPE_VOICEPOOL   8
+#define OBJTYPE_MAPPING     9
+#define OBJTYPE_STREAM      10
+#define OBJTYPE_COUNT       11
 
 /* Userdata memory associated with objects */
 #define ud_t moonal_ud_t
@@ -56,6 +73,7 @@ struct moonal_ud_s {
     context_dt_t *cdt; /* dispatch table */
     listener_t listener; /* context only */
     uint32_t marks;
+    int objtype; /* OBJTYPE_XXX */
     void *info; /* object specific info (ud_info_t, subject to Free() at destruction, if not NULL) */
 };
     
@@ -76,6 +94,50 @@ struct moonal_ud_s {
 #define MarkLoopbackDevice(ud)   MarkSet((ud)->marks, 2) 
 #define CancelLoopbackDevice(ud) MarkReset((ud)->marks, 2)
 
+#define IsRamped(ud)            MarkGet((ud)->marks, 3) /* has (or had) ramps, see automation.c */
+#define MarkRamped(ud)          MarkSet((ud)->marks, 3) 
+#define CancelRamped(ud)        MarkReset((ud)->marks, 3)
+
+#define IsPooled(ud)            MarkGet((ud)->marks, 4) /* source owned by a voice pool */
+#define MarkPooled(ud)          MarkSet((ud)->marks, 4) 
+#define CancelPooled(ud)        MarkReset((ud)->marks, 4)
+
+#define IsVirtualizable(ud)     MarkGet((ud)->marks, 5) /* source subject to culling, see virtual.c */
+#define MarkVirtualizable(ud)   MarkSet((ud)->marks, 5) 
+#define CancelVirtualizable(ud) MarkReset((ud)->marks, 5)
+
+#define IsIndexed(ud)           MarkGet((ud)->marks, 6) /* source in the spatial index, see spatial.c */
+#define MarkIndexed(ud)         MarkSet((ud)->marks, 6) 
+#define CancelIndexed(ud)       MarkReset((ud)->marks, 6)
+
+#define IsShadowed(ud)          MarkGet((ud)->marks, 7) /* has a shadow cache, see shadow.c */
+#define MarkShadowed(ud)        MarkSet((ud)->marks, 7) 
+#define CancelShadowed(ud)      MarkReset((ud)->marks, 7)
+
+#define IsLoading(ud)           MarkGet((ud)->marks, 8) /* buffer loaded asynchronously, see loader.c */
+#define MarkLoading(ud)         MarkSet((ud)->marks, 8) 
+#define CancelLoading(ud)       MarkReset((ud)->marks, 8)
+
+#define IsCached(ud)            MarkGet((ud)->marks, 9) /* buffer in the content cache, see bufcache.c */
+#define MarkCached(ud)          MarkSet((ud)->marks, 9) 
+#define CancelCached(ud)        MarkReset((ud)->marks, 9)
+
+#define IsManaged(ud)           MarkGet((ud)->marks, 10) /* buffer with a reload source, see residency.c */
+#define MarkManaged(ud)         MarkSet((ud)->marks, 10) 
+#define CancelManaged(ud)       MarkReset((ud)->marks, 10)
+
+#define IsScheduled(ud)         MarkGet((ud)->marks, 11) /* source with a deferred start, see schedule.c */
+#define MarkScheduled(ud)       MarkSet((ud)->marks, 11) 
+#define CancelScheduled(ud)     MarkReset((ud)->marks, 11)
+
+#define IsSampled(ud)           MarkGet((ud)->marks, 12) /* source sampled by telemetry, see telemetry.c */
+#define MarkSampled(ud)         MarkSet((ud)->marks, 12) 
+#define CancelSampled(ud)       MarkReset((ud)->marks, 12)
+
+#define IsDeferred(ud)          MarkGet((ud)->marks, 13) /* source waiting for a reload, see residency.c */
+#define MarkDeferred(ud)        MarkSet((ud)->marks, 13) 
+#define CancelDeferred(ud)      MarkReset((ud)->marks, 13)
+
 #if 0
 /* .c */
 #define  moonal_
@@ -90,9 +152,9 @@ int pushuserdata(lua_State *L, ud_t *ud);
 
 #define userdata_unref(L, handle) udata_unref((L),(handle))
 
-#define UD(handle) userdata((handle)) /* dispatchable objects only */
+#define UD(handle) userdata(L, (handle)) /* dispatchable objects only */
 #define userdata moonal_userdata
-ud_t *userdata(void *handle);
+ud_t *userdata(lua_State *L, void *handle);
 #define testxxx moonal_testxxx
 void *testxxx(lua_State *L, int arg, ud_t **udp, const char *mt);
 #define checkxxx moonal_checkxxx
@@ -139,6 +201,7 @@ int pushlistener(lua_State *L, context_t context);
 #define testsource(L, arg, udp) (source_t)testxxx((L), (arg), (udp), SOURCE_MT)
 #define pushsource(L, handle) pushxxx((L), (handle))
 #define checksourcelist(L, arg, count, err) (source_t*)checkxxxlist((L), (arg), (count), (err), SOURCE_MT)
+#define searchsource(L, name, udp) (source_t)objectsearchxxx((L), (name), (udp), SOURCE_MT)
 
 /* effect.c */
 #define checkeffect(L, arg, udp) (effect_t)checkxxx((L), (arg), (udp), EFFECT_MT)
@@ -161,6 +224,21 @@ int pushlistener(lua_State *L, context_t context);
 #define checkauxslotlist(L, arg, count, err) (auxslot_t*)checkxxxlist((L), (arg), (count), (err), AUXSLOT_MT)
 #define searchauxslot(L, name, udp) (auxslot_t)objectsearchxxx((L), (name), (udp), AUXSLOT_MT)
 
+/* voicepool.c */
+#define checkvoicepool(L, arg, udp) (voicepool_t)checkxxx((L), (arg), (udp), VOICEPOOL_MT)
+#define testvoicepool(L, arg, udp) (voicepool_t)testxxx((L), (arg), (udp), VOICEPOOL_MT)
+#define pushvoicepool(L, handle) pushxxx((L), (handle))
+
+/* mapping.c */
+#define checkmapping(L, arg, udp) (mapping_t)checkxxx((L), (arg), (udp), MAPPING_MT)
+#define testmapping(L, arg, udp) (mapping_t)testxxx((L), (arg), (udp), MAPPING_MT)
+#define pushmapping(L, handle) pushxxx((L), (handle))
+
+/* stream.c */
+#define checkstream(L, arg, udp) (stream_t)checkxxx((L), (arg), (udp), STREAM_MT)
+#define teststream(L, arg, udp) (stream_t)testxxx((L), (arg), (udp), STREAM_MT)
+#define pushstream(L, handle) pushxxx((L), (handle))
+
 #if 0 /* scaffolding 6yy */
 /* zzz.c */
 #define checkzzz(L, arg, udp) (zzz_t)checkxxx((L), (arg), (udp), ZZZ_MT)
@@ -181,6 +259,9 @@ void moonal_open_source(lua_State *L);
 void moonal_open_effect(lua_State *L);
 void moonal_open_filter(lua_State *L);
 void moonal_open_auxslot(lua_State *L);
+void moonal_open_voicepool(lua_State *L);
+void moonal_open_mapping(lua_State *L);
+void moonal_open_stream(lua_State *L);
 void moonal_open_datahandling(lua_State *L);
 void moonal_open_ranges(lua_State *L);
 
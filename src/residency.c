@@ -0,0 +1,481 @@
+/* The MIT License (MIT)
+ *
+ * Copyright (c) 2018 Stefano Trettel
+ *
+ * Software repository: MoonAL, https://github.com/stetre/moonal
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+
+#include "internal.h"
+
+/*------------------------------------------------------------------------------*
+ | Buffer residency                                                             |
+ *------------------------------------------------------------------------------*/
+
+/* A context may have a budget for the bytes stored in its managed buffers, i.e. the
+ * buffers registered with manage_buffer() together with a file to reload them from.
+ * When the budget is exceeded, the least recently used managed buffers are evicted by
+ * storing an empty payload in them (this fails, and the buffer is skipped, if the buffer
+ * is attached to a source, and the buffer is dropped from the content cache, see bufcache.c).
+ * An evicted buffer is reloaded asynchronously, through the loader (see loader.c), when
+ * ensure_resident() is called or when a source it is attached to is played. In the latter
+ * case the buffer is detached from the source (since AL refuses to store data in an
+ * attached buffer) and the start is deferred: when poll_loads() stores the reloaded data,
+ * it re-attaches the buffer and starts the source (the source is marked as 'Deferred'
+ * meanwhile, and an explicit stop, pause or rewind cancels the start but not the
+ * re-attachment).
+ *
+ * The managed buffers of a context are kept in a list in LRU order (least recently used
+ * first) and in a tree keyed by their AL name, so that sources being played can be mapped
+ * to the entries of their buffers. Use times are updated by source_play() and by
+ * ensure_resident(). The budget is enforced when it is set, when buffers are registered,
+ * and when loads are polled.
+ */
+
+struct moonal_resentry_s {
+    RB_ENTRY(moonal_resentry_s) entry;
+    ALuint name;        /* search key */
+    ud_t *ud;
+    resentry_t *prev;   /* LRU list */
+    resentry_t *next;
+    double lastuse;
+    /* reload source */
+    char *path;
+    long offset;
+    long length;
+    ALenum rawformat;   /* 0 for WAV files */
+    ALsizei rawfreq;
+};
+
+static int cmp(resentry_t *e1, resentry_t *e2)
+    { return (e1->name < e2->name ? -1 : e1->name > e2->name); }
+
+typedef struct {
+    ud_t *ud;           /* source */
+    resentry_t *e;      /* entry of the buffer detached from it */
+    int start;          /* start the source when the buffer is reloaded */
+} deferred_t;
+
+RB_HEAD(restree_s, moonal_resentry_s);
+RB_PROTOTYPE_STATIC(restree_s, moonal_resentry_s, entry, cmp)
+RB_GENERATE_STATIC(restree_s, moonal_resentry_s, entry, cmp)
+
+struct moonal_residency_s {
+    struct restree_s head;
+    resentry_t *lru;    /* least recently used */
+    resentry_t *mru;    /* most recently used */
+    size_t count;       /* managed buffers */
+    size_t budget;      /* 0 = unlimited */
+    size_t bytes;       /* resident bytes in managed buffers */
+    uint64_t evictions;
+    uint64_t reloads;
+    deferred_t *deferred; /* sources waiting for the reload of their buffers */
+    size_t ndeferred, maxdeferred;
+};
+
+#define RESIDENCY(context_ud) (CTXINFO(context_ud)->residency)
+
+static void unlink(residency_t *res, resentry_t *e)
+    {
+    if(e->prev) e->prev->next = e->next; else res->lru = e->next;
+    if(e->next) e->next->prev = e->prev; else res->mru = e->prev;
+    e->prev = e->next = NULL;
+    }
+
+static void append(residency_t *res, resentry_t *e)
+    {
+    e->prev = res->mru;
+    e->next = NULL;
+    if(res->mru) res->mru->next = e; else res->lru = e;
+    res->mru = e;
+    }
+
+static void reload(lua_State *L, residency_t *res, resentry_t *e)
+    {
+    if(loader_queue(L, e->ud, e->path, e->offset, e->length, e->rawformat, e->rawfreq))
+        res->reloads++;
+    }
+
+static void use(residency_t *res, resentry_t *e)
+/* marks the buffer as used */
+    {
+    e->lastuse = now();
+    if(e != res->mru)
+        { unlink(res, e); append(res, e); }
+    }
+
+static void touch(lua_State *L, residency_t *res, resentry_t *e)
+/* marks the buffer as used, and requests its reload if evicted */
+    {
+    use(res, e);
+    if(BUFINFO(e->ud)->size == 0)
+        reload(L, res, e);
+    }
+
+static void defer(lua_State *L, residency_t *res, resentry_t *e, ud_t *context_ud, ALuint source)
+/* detaches the evicted buffer from a static source about to be played, queues its
+ * reload, and defers the start of the source until the reload is done */
+    {
+    deferred_t *deferred;
+    size_t n;
+    ud_t *ud = spatial_source(context_ud, source);
+    if(!ud) return;
+    if(res->ndeferred == res->maxdeferred)
+        {
+        n = res->maxdeferred ? 2*res->maxdeferred : 8;
+        deferred = (deferred_t*)Malloc(L, n*sizeof(deferred_t));
+        if(res->deferred)
+            {
+            memcpy(deferred, res->deferred, res->ndeferred*sizeof(deferred_t));
+            Free(L, res->deferred);
+            }
+        res->deferred = deferred;
+        res->maxdeferred = n;
+        }
+    al.Sourcei(source, AL_BUFFER, 0);
+    if(al.GetError() != AL_NO_ERROR) return; /* the source is playing or paused */
+    deferred = &res->deferred[res->ndeferred++];
+    deferred->ud = ud;
+    deferred->e = e;
+    deferred->start = 1;
+    MarkDeferred(ud);
+    reload(L, res, e);
+    }
+
+static deferred_t *finddeferred(residency_t *res, ALuint source)
+    {
+    size_t i;
+    for(i = 0; i < res->ndeferred; i++)
+        if(((source_t)res->deferred[i].ud->handle)->name == source) return &res->deferred[i];
+    return NULL;
+    }
+
+static void dropdeferred(residency_t *res, size_t i)
+    {
+    CancelDeferred(res->deferred[i].ud);
+    if(i < --res->ndeferred) res->deferred[i] = res->deferred[res->ndeferred];
+    }
+
+static void enforce(lua_State *L, ud_t *context_ud)
+/* evicts buffers until the budget is met (the context must be current) */
+    {
+    ALenum ec;
+    bufinfo_t *info;
+    resentry_t *e, *next;
+    residency_t *res = RESIDENCY(context_ud);
+    if(!res || res->budget == 0) return;
+    for(e = res->lru; e && res->bytes > res->budget; e = next)
+        {
+        next = e->next;
+        info = BUFINFO(e->ud);
+        if(info->size == 0) continue;
+        ec = buffer_upload(e->ud, info->format, NULL, 0, info->freq); /* see residency_update() */
+        if(ec == AL_NO_ERROR)
+            {
+            res->evictions++;
+            if(IsCached(e->ud))
+                bufcache_forget(L, e->ud); /* its content no longer matches the key */
+            }
+        /* else the buffer is in use by a source, and cannot be evicted */
+        }
+    }
+
+void residency_enforce(lua_State *L, ud_t *context_ud)
+/* called by poll_loads(), with the context current */
+    {
+    enforce(L, context_ud);
+    }
+
+static void enforcecontext(lua_State *L, ud_t *context_ud)
+/* same as enforce(), making the context current if needed */
+    {
+    context_t context = (context_t)context_ud->handle;
+    context_t old_context = alc.GetCurrentContext();
+    if(old_context != context) make_context_current(L, context);
+    enforce(L, context_ud);
+    if(old_context != context)
+        {
+        if(old_context) make_context_current(L, old_context);
+        else set_current_context(NULL);
+        }
+    }
+
+void residency_update(ud_t *ud, size_t oldsize)
+/* called by buffer_upload() for managed buffers, when new data is stored */
+    {
+    residency_t *res = RESIDENCY(ud->parent_ud);
+    res->bytes = res->bytes - oldsize + BUFINFO(ud)->size;
+    }
+
+void residency_touch(lua_State *L, ud_t *context_ud, const ALuint *sources, uint32_t count)
+/* called by source_play() and source_play_at(), before the sources are played */
+    {
+    uint32_t i;
+    ALint name, type;
+    resentry_t key, *e;
+    deferred_t *deferred;
+    residency_t *res = RESIDENCY(context_ud);
+    if(!res || res->count == 0) return;
+    for(i = 0; i < count; i++)
+        {
+        al.GetSourcei(sources[i], AL_SOURCE_TYPE, &type);
+        al.GetSourcei(sources[i], AL_BUFFER, &name);
+        if(al.GetError() != AL_NO_ERROR) continue;
+        if(name == 0 && res->ndeferred > 0 && (deferred = finddeferred(res, sources[i])))
+            { deferred->start = 1; continue; } /* played again while waiting */
+        if(type != AL_STATIC || name == 0) continue;
+        key.name = (ALuint)name;
+        if(!(e = RB_FIND(restree_s, &res->head, &key))) continue;
+        use(res, e);
+        if(BUFINFO(e->ud)->size == 0)
+            defer(L, res, e, context_ud, sources[i]);
+        }
+    }
+
+void residency_cancel(lua_State *L, ud_t *context_ud, const ALuint *sources, uint32_t count)
+/* called when sources are stopped, paused or rewound explicitly */
+    {
+    uint32_t i;
+    deferred_t *deferred;
+    residency_t *res = RESIDENCY(context_ud);
+    (void)L;
+    if(!res || res->ndeferred == 0) return;
+    for(i = 0; i < count; i++)
+        if((deferred = finddeferred(res, sources[i])) != NULL)
+            deferred->start = 0;
+    }
+
+void residency_loaded(lua_State *L, ud_t *ud, int ok)
+/* called by poll_loads(), with the context current, when a load of the managed buffer
+ * ud is done: re-attaches it to the sources it was detached from, and starts them */
+    {
+    size_t i = 0;
+    ALint name;
+    ALuint source;
+    deferred_t *deferred;
+    residency_t *res = RESIDENCY(ud->parent_ud);
+    resentry_t *e = BUFINFO(ud)->resident;
+    (void)L;
+    while(i < res->ndeferred)
+        {
+        deferred = &res->deferred[i];
+        if(deferred->e != e) { i++; continue; }
+        source = ((source_t)deferred->ud->handle)->name;
+        al.GetSourcei(source, AL_BUFFER, &name);
+        if(name == 0) /* else the application has set another buffer meanwhile */
+            {
+            al.SourceRewind(source); /* played without a buffer, it may not be stopped */
+            al.Sourcei(source, AL_BUFFER, (ALint)e->name);
+            if(ok && deferred->start)
+                al.SourcePlay(source);
+            }
+        al.GetError();
+        dropdeferred(res, i);
+        }
+    }
+
+static void delentry(lua_State *L, residency_t *res, resentry_t *e)
+    {
+    size_t i = 0;
+    while(i < res->ndeferred) /* the sources stay detached */
+        {
+        if(res->deferred[i].e == e) dropdeferred(res, i);
+        else i++;
+        }
+    RB_REMOVE(restree_s, &res->head, e);
+    unlink(res, e);
+    res->count--;
+    res->bytes -= BUFINFO(e->ud)->size;
+    BUFINFO(e->ud)->resident = NULL;
+    CancelManaged(e->ud);
+    Free(L, e->path);
+    Free(L, e);
+    }
+
+void residency_forget(lua_State *L, ud_t *ud)
+/* called by freeuserdata() for managed buffers and for deferred sources */
+    {
+    size_t i;
+    resentry_t *e;
+    residency_t *res = RESIDENCY(ud->parent_ud);
+    if(IsDeferred(ud))
+        {
+        for(i = 0; i < res->ndeferred; i++)
+            if(res->deferred[i].ud == ud) { dropdeferred(res, i); return; }
+        return;
+        }
+    e = BUFINFO(ud)->resident;
+    if(e) delentry(L, res, e);
+    }
+
+void residency_free(lua_State *L, ud_t *context_ud)
+/* called by freecontext(), after its buffers have been released */
+    {
+    residency_t *res = RESIDENCY(context_ud);
+    if(!res) return;
+    if(res->deferred) Free(L, res->deferred);
+    Free(L, res);
+    RESIDENCY(context_ud) = NULL;
+    }
+
+static residency_t *getresidency(lua_State *L, ud_t *context_ud)
+    {
+    residency_t *res = RESIDENCY(context_ud);
+    if(res) return res;
+    res = (residency_t*)Malloc(L, sizeof(residency_t));
+    RB_INIT(&res->head);
+    RESIDENCY(context_ud) = res;
+    return res;
+    }
+
+/*------------------------------------------------------------------------------*
+ | Lua functions                                                                |
+ *------------------------------------------------------------------------------*/
+
+int residency_manage(lua_State *L)
+/* manage_buffer(buffer, [path, [opts]]) */
+    {
+    int err;
+    ud_t *ud;
+    residency_t *res;
+    resentry_t *e;
+    const char *path;
+    long offset = 0, length = -1, freq = 0;
+    ALenum format = 0;
+    buffer_t buffer = checkbuffer(L, 1, &ud);
+    if(lua_isnoneornil(L, 2))
+        {
+        ALsizei freq_;
+        path = loader_source(ud, &offset, &length, &format, &freq_);
+        if(!path)
+            return luaL_argerror(L, 2, "missing path (buffer not loaded from file)");
+        freq = freq_;
+        }
+    else
+        {
+        path = luaL_checkstring(L, 2);
+        if(!lua_isnoneornil(L, 3))
+            {
+            luaL_checktype(L, 3, LUA_TTABLE);
+            if(lua_getfield(L, 3, "format") != LUA_TNIL)
+                {
+                format = testformat(L, -1, &err);
+                if(err) return luaL_argerror(L, 3, "invalid field 'format'");
+                }
+            lua_pop(L, 1);
+            freq = optfield(L, 3, "frequency", 0);
+            if(format && freq == 0)
+                return luaL_argerror(L, 3, "missing field 'frequency'");
+            offset = optfield(L, 3, "offset", 0);
+            length = optfield(L, 3, "length", -1);
+            }
+        }
+    res = getresidency(L, ud->parent_ud);
+    e = BUFINFO(ud)->resident;
+    if(!e)
+        {
+        e = (resentry_t*)Malloc(L, sizeof(resentry_t));
+        e->name = buffer->name;
+        e->ud = ud;
+        e->path = NULL;
+        RB_INSERT(restree_s, &res->head, e);
+        append(res, e);
+        res->count++;
+        res->bytes += BUFINFO(ud)->size;
+        BUFINFO(ud)->resident = e;
+        MarkManaged(ud);
+        }
+    else
+        Free(L, e->path);
+    e->path = (char*)Malloc(L, strlen(path) + 1);
+    strcpy(e->path, path);
+    e->offset = offset;
+    e->length = length;
+    e->rawformat = format;
+    e->rawfreq = (ALsizei)freq;
+    e->lastuse = now();
+    enforcecontext(L, ud->parent_ud);
+    return 0;
+    }
+
+int residency_ensure(lua_State *L)
+/* resident = ensure_resident(buffer) */
+    {
+    ud_t *ud;
+    resentry_t *e;
+    checkbuffer(L, 1, &ud);
+    e = BUFINFO(ud)->resident;
+    if(!e)
+        return luaL_argerror(L, 1, "buffer is not managed");
+    touch(L, RESIDENCY(ud->parent_ud), e);
+    lua_pushboolean(L, BUFINFO(ud)->size > 0);
+    return 1;
+    }
+
+int residency_budget(lua_State *L)
+/* set_residency_budget(context, bytes) */
+    {
+    ud_t *ud;
+    lua_Integer budget;
+    checkcontext(L, 1, &ud);
+    budget = luaL_checkinteger(L, 2);
+    if(budget < 0)
+        return luaL_argerror(L, 2, "negative budget");
+    getresidency(L, ud)->budget = (size_t)budget;
+    enforcecontext(L, ud);
+    return 0;
+    }
+
+int residency_stats(lua_State *L)
+/* stats = residency_stats(context) */
+    {
+    ud_t *ud;
+    resentry_t *e;
+    size_t resident = 0;
+    residency_t *res;
+    checkcontext(L, 1, &ud);
+    res = RESIDENCY(ud);
+    if(res)
+        for(e = res->lru; e; e = e->next) if(BUFINFO(e->ud)->size > 0) resident++;
+    lua_newtable(L);
+    lua_pushinteger(L, res ? res->budget : 0); lua_setfield(L, -2, "budget");
+    lua_pushinteger(L, res ? res->bytes : 0); lua_setfield(L, -2, "bytes");
+    lua_pushinteger(L, res ? res->count : 0); lua_setfield(L, -2, "buffers");
+    lua_pushinteger(L, resident); lua_setfield(L, -2, "resident");
+    lua_pushinteger(L, res ? res->evictions : 0); lua_setfield(L, -2, "evictions");
+    lua_pushinteger(L, res ? res->reloads : 0); lua_setfield(L, -2, "reloads");
+    return 1;
+    }
+
+static const struct luaL_Reg Functions[] =
+    {
+        { "manage_buffer", residency_manage },
+        { "ensure_resident", residency_ensure },
+        { "set_residency_budget", residency_budget },
+        { "residency_stats", residency_stats },
+        { NULL, NULL } /* sentinel */
+    };
+
+void moonal_open_residency(lua_State *L)
+    {
+    luaL_setfuncs(L, Functions, 0);
+    }
+
@@ -0,0 +1,315 @@
+/* The MIT License (MIT)
+ *
+ * Copyright (c) 2018 Stefano Trettel
+ *
+ * Software repository: MoonAL, https://github.com/stetre/moonal
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+
+#include "internal.h"
+#include <pthread.h>
+#include <time.h>
+
+/*------------------------------------------------------------------------------*
+ | Scheduled playback                                                           |
+ *------------------------------------------------------------------------------*/
+
+/* source_play_at() starts one or more sources at a given time of the device clock
+ * (ALC_DEVICE_CLOCK_SOFT, in nanoseconds), so that they start in sync with the mix
+ * instead of whenever the script gets to call source_play().
+ *
+ * With AL_SOFT_source_start_delay the start is scheduled by OpenAL itself and is sample
+ * accurate. Otherwise it is deferred to a per-context scheduler thread (see ctxinfo_t),
+ * which converts the device time into a time of the monotonic clock, sleeps until shortly
+ * before it and then spins up to it, and starts all the sources of a group with a single
+ * alSourcePlayv() call. The thread makes the context current with alcSetThreadContext(),
+ * so it does not interfere with the owning thread.
+ *
+ * Pending starts are shared with the thread, so they are allocated with malloc() and
+ * accessed under the scheduler's lock. Sources are marked as 'Scheduled' when they are
+ * put in a pending start, so that they are removed from it if they are deleted before
+ * the start time (the mark is not cleared by the thread, so it may be stale).
+ * The thread does not hold the lock while it spins: the start it is about to fire is
+ * moved to 'firing', where cancellations still reach it, and it is taken from there
+ * just before alSourcePlayv().
+ */
+
+#define SPIN_NS     500000  /* spin (instead of sleeping) in the last 0.5 ms */
+
+typedef struct start_s start_t;
+struct start_s {
+    start_t *next;
+    struct timespec when;   /* monotonic clock */
+    ALsizei count;
+    ALuint names[];
+};
+
+struct moonal_scheduler_s {
+    pthread_t thread;
+    pthread_mutex_t lock;
+    pthread_cond_t wake;
+    int stop;
+    context_t context;
+    start_t *head;          /* pending starts, earliest first */
+    start_t *firing;        /* start being spun up to, out of the list */
+};
+
+#define SCHEDULER(context_ud) (CTXINFO(context_ud)->scheduler)
+
+static void *Scheduler(void *arg)
+    {
+    scheduler_t *s = (scheduler_t*)arg;
+    start_t *start;
+    struct timespec now, wakeup;
+    alc.SetThreadContext(s->context);
+    pthread_mutex_lock(&s->lock);
+    while(!s->stop)
+        {
+        if(!s->head)
+            { pthread_cond_wait(&s->wake, &s->lock); continue; }
+        clock_gettime(CLOCK_MONOTONIC, &now);
+        if(tsdiff(&s->head->when, &now) > SPIN_NS)
+            {
+            /* sleep until shortly before the start (or until woken by a new start) */
+            wakeup = s->head->when;
+            tsadd(&wakeup, -SPIN_NS);
+            pthread_cond_timedwait(&s->wake, &s->lock, &wakeup);
+            continue;
+            }
+        /* spin up to the start time without holding the lock */
+        start = s->firing = s->head;
+        s->head = start->next;
+        pthread_mutex_unlock(&s->lock);
+        while(tsdiff(&start->when, &now) > 0)
+            clock_gettime(CLOCK_MONOTONIC, &now);
+        pthread_mutex_lock(&s->lock);
+        s->firing = NULL;
+        pthread_mutex_unlock(&s->lock);
+        if(start->count > 0) /* unless all its sources were cancelled meanwhile */
+            {
+            al.SourcePlayv(start->count, start->names);
+            (void)al.GetError(); /* so that it does not end up in the owner's error state */
+            }
+        free(start);
+        pthread_mutex_lock(&s->lock);
+        }
+    pthread_mutex_unlock(&s->lock);
+    alc.SetThreadContext(NULL);
+    return NULL;
+    }
+
+static scheduler_t *getscheduler(lua_State *L, ud_t *context_ud)
+/* returns the scheduler of the context, starting it if needed (NULL on failure) */
+    {
+    pthread_condattr_t attr;
+    scheduler_t *s = SCHEDULER(context_ud);
+    if(s) return s;
+    if(!alc.SetThreadContext) return NULL;
+    s = (scheduler_t*)MallocNoErr(L, sizeof(scheduler_t));
+    if(!s) return NULL;
+    s->context = (context_t)context_ud->handle;
+    pthread_mutex_init(&s->lock, NULL);
+    pthread_condattr_init(&attr);
+    pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+    pthread_cond_init(&s->wake, &attr);
+    pthread_condattr_destroy(&attr);
+    if(pthread_create(&s->thread, NULL, Scheduler, s) != 0)
+        {
+        pthread_cond_destroy(&s->wake);
+        pthread_mutex_destroy(&s->lock);
+        Free(L, s);
+        return NULL;
+        }
+    SCHEDULER(context_ud) = s;
+    return s;
+    }
+
+static void prune(start_t *start, const ALuint *names, uint32_t count)
+/* removes the given sources from a start */
+    {
+    ALsizei i, j;
+    uint32_t k;
+    for(i = j = 0; i < start->count; i++)
+        {
+        for(k = 0; k < count; k++)
+            if(start->names[i] == names[k]) break;
+        if(k == count) start->names[j++] = start->names[i];
+        }
+    start->count = j;
+    }
+
+static void removenames(scheduler_t *s, const ALuint *names, uint32_t count)
+/* removes the given sources from the pending starts (the lock must be held) */
+    {
+    start_t **pp = &s->head, *start;
+    while((start = *pp) != NULL)
+        {
+        prune(start, names, count);
+        if(start->count == 0)
+            { *pp = start->next; free(start); }
+        else
+            pp = &start->next;
+        }
+    if(s->firing) /* freed by the thread */
+        prune(s->firing, names, count);
+    }
+
+void schedule_forget(lua_State *L, ud_t *ud)
+/* called when a scheduled source is deleted */
+    {
+    scheduler_t *s = ud->parent_ud ? SCHEDULER((ud_t*)ud->parent_ud) : NULL;
+    (void)L;
+    CancelScheduled(ud);
+    if(!s) return;
+    pthread_mutex_lock(&s->lock);
+    removenames(s, &((source_t)ud->handle)->name, 1);
+    pthread_mutex_unlock(&s->lock);
+    }
+
+void schedule_cancel(lua_State *L, ud_t *context_ud, const ALuint *sources, uint32_t count)
+/* called when sources are played, stopped, paused or rewound explicitly (the native
+ * scheduled starts are superseded by OpenAL itself) */
+    {
+    scheduler_t *s = SCHEDULER(context_ud);
+    (void)L;
+    if(!s) return;
+    pthread_mutex_lock(&s->lock);
+    removenames(s, sources, count);
+    pthread_mutex_unlock(&s->lock);
+    }
+
+void schedule_free(lua_State *L, ud_t *context_ud)
+/* called by freecontext() */
+    {
+    start_t *start;
+    scheduler_t *s = SCHEDULER(context_ud);
+    if(!s) return;
+    pthread_mutex_lock(&s->lock);
+    s->stop = 1;
+    pthread_cond_signal(&s->wake);
+    pthread_mutex_unlock(&s->lock);
+    pthread_join(s->thread, NULL);
+    while((start = s->head) != NULL)
+        { s->head = start->next; free(start); }
+    pthread_cond_destroy(&s->wake);
+    pthread_mutex_destroy(&s->lock);
+    Free(L, s);
+    SCHEDULER(context_ud) = NULL;
+    }
+
+/*------------------------------------------------------------------------------*
+ | Lua functions                                                                |
+ *------------------------------------------------------------------------------*/
+
+static const char *deferred(lua_State *L, ud_t *context_ud, source_t *sources, ALuint *names, uint32_t count, ALint64SOFT time)
+/* queues a start to the scheduler thread (returns an error message on failure) */
+    {
+    uint32_t i;
+    ALCint64SOFT clock;
+    start_t *start, **pp;
+    scheduler_t *s;
+    if(!context_ud->ddt->GetInteger64vSOFT)
+        return "ALC_SOFT_device_clock not available";
+    s = getscheduler(L, context_ud);
+    if(!s)
+        return "cannot start the scheduler thread";
+    start = (start_t*)malloc(sizeof(start_t) + count*sizeof(ALuint));
+    if(!start)
+        return errstring(ERR_MEMORY);
+    context_ud->ddt->GetInteger64vSOFT(context_ud->device, ALC_DEVICE_CLOCK_SOFT, 1, &clock);
+    clock_gettime(CLOCK_MONOTONIC, &start->when);
+    if(time > clock) tsadd(&start->when, time - clock);
+    start->count = count;
+    memcpy(start->names, names, count*sizeof(ALuint));
+    pthread_mutex_lock(&s->lock);
+    removenames(s, names, count); /* a later start supersedes a pending one */
+    pp = &s->head;
+    while(*pp && tsdiff(&(*pp)->when, &start->when) <= 0)
+        pp = &(*pp)->next;
+    start->next = *pp;
+    *pp = start;
+    pthread_cond_signal(&s->wake);
+    pthread_mutex_unlock(&s->lock);
+    for(i = 0; i < count; i++)
+        MarkScheduled(userdata(L, sources[i]));
+    return NULL;
+    }
+
+int schedule_play(lua_State *L)
+/* native = source_play_at(source | {source}, time) */
+    {
+    int err, native;
+    ALenum ec = AL_NO_ERROR;
+    const char *errmsg = NULL;
+    uint32_t count;
+    ud_t *ud, *context_ud;
+    source_t single;
+    source_t *sources;
+    ALuint *names;
+    ALint64SOFT time = luaL_checkinteger(L, 2);
+    TRACE_CALL_START;
+    if(lua_istable(L, 1))
+        {
+        sources = checksourcelist(L, 1, &count, &err);
+        if(err) return luaL_argerror(L, 1, errstring(err));
+        names = objectnamelist(L, sources, count, &err);
+        if(err) { Free(L, sources); return luaL_argerror(L, 1, errstring(err)); }
+        ud = userdata(L, sources[0]);
+        }
+    else
+        {
+        single = checksource(L, 1, &ud);
+        sources = &single;
+        names = &single->name;
+        count = 1;
+        }
+    context_ud = (ud_t*)ud->parent_ud;
+    residency_touch(L, context_ud, names, count); /* before the sources start */
+    native = context_ud->cdt->SourcePlayAtTimevSOFT != NULL;
+    if(native)
+        {
+        context_ud->cdt->SourcePlayAtTimevSOFT(count, names, time);
+        ec = al.GetError();
+        }
+    else
+        errmsg = deferred(L, context_ud, sources, names, count, time);
+    if(ec == AL_NO_ERROR && !errmsg && native)
+        schedule_cancel(L, context_ud, names, count);
+    if(sources != &single)
+        { Free(L, sources); Free(L, names); }
+    if(ec) { pushalerror(L, ec); return lua_error(L); }
+    if(errmsg) return luaL_error(L, "%s", errmsg);
+    TRACE_CALL_STOP("source_play_at", 0, count);
+    lua_pushboolean(L, native);
+    return 1;
+    }
+
+static const struct luaL_Reg Functions[] =
+    {
+        { "source_play_at", schedule_play },
+        { NULL, NULL } /* sentinel */
+    };
+
+void moonal_open_schedule(lua_State *L)
+    {
+    luaL_setfuncs(L, Functions, 0);
+    }
+
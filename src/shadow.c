@@ -0,0 +1,497 @@
+/* The MIT License (MIT)
+ *
+ * Copyright (c) 2018 Stefano Trettel
+ *
+ * Software repository: MoonAL, https://github.com/stetre/moonal
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+
+#include "internal.h"
+
+/* Shadow state of sources and listeners.
+ *
+ * When enabled on an object (object:cache(true)), the current values of its static
+ * parameters are read once from AL and then kept up to date by the setters (write
+ * through), so that the getters for these parameters are served locally without
+ * entering the AL implementation. Dynamic state (source state, offsets, queued and
+ * processed buffers, ...) is not shadowed and is always queried from AL.
+ *
+ * In coalescing mode (object:coalesce(true)), the setters for the same parameters
+ * only record the new values in the shadow, marking them as dirty if they differ
+ * from the current ones, and queue the object in a pending list. The dirty values
+ * are flushed to AL by context:commit(), in a single deferred-updates batch.
+ *
+ * The shadow is referenced by the object's ud->info (see srcinfo_t and lstinfo_t).
+ */
+
+#define KIND_FLOAT      0
+#define KIND_BOOLEAN    1
+
+typedef struct {
+    ALenum param;
+    int n;      /* number of values */
+    int kind;
+} field_t;
+
+static const field_t SourceFields[] = {
+    { AL_PITCH, 1, KIND_FLOAT },
+    { AL_GAIN, 1, KIND_FLOAT },
+    { AL_MIN_GAIN, 1, KIND_FLOAT },
+    { AL_MAX_GAIN, 1, KIND_FLOAT },
+    { AL_MAX_DISTANCE, 1, KIND_FLOAT },
+    { AL_ROLLOFF_FACTOR, 1, KIND_FLOAT },
+    { AL_REFERENCE_DISTANCE, 1, KIND_FLOAT },
+    { AL_CONE_INNER_ANGLE, 1, KIND_FLOAT },
+    { AL_CONE_OUTER_ANGLE, 1, KIND_FLOAT },
+    { AL_CONE_OUTER_GAIN, 1, KIND_FLOAT },
+    { AL_CONE_OUTER_GAINHF, 1, KIND_FLOAT },
+    { AL_AIR_ABSORPTION_FACTOR, 1, KIND_FLOAT },
+    { AL_ROOM_ROLLOFF_FACTOR, 1, KIND_FLOAT },
+    { AL_DOPPLER_FACTOR, 1, KIND_FLOAT },
+    { AL_SOURCE_RADIUS, 1, KIND_FLOAT },
+    { AL_POSITION, 3, KIND_FLOAT },
+    { AL_VELOCITY, 3, KIND_FLOAT },
+    { AL_DIRECTION, 3, KIND_FLOAT },
+    { AL_SOURCE_RELATIVE, 1, KIND_BOOLEAN },
+    { AL_LOOPING, 1, KIND_BOOLEAN },
+    { AL_DIRECT_FILTER_GAINHF_AUTO, 1, KIND_BOOLEAN },
+    { AL_AUXILIARY_SEND_FILTER_GAIN_AUTO, 1, KIND_BOOLEAN },
+    { AL_AUXILIARY_SEND_FILTER_GAINHF_AUTO, 1, KIND_BOOLEAN },
+    { AL_DIRECT_CHANNELS_SOFT, 1, KIND_BOOLEAN },
+};
+
+static const field_t ListenerFields[] = {
+    { AL_GAIN, 1, KIND_FLOAT },
+    { AL_METERS_PER_UNIT, 1, KIND_FLOAT },
+    { AL_POSITION, 3, KIND_FLOAT },
+    { AL_VELOCITY, 3, KIND_FLOAT },
+    { AL_ORIENTATION, 6, KIND_FLOAT },
+};
+
+#define NFIELDS(fields) (int)(sizeof(fields)/sizeof(field_t))
+#define MAXFIELDS 32
+#define MAXVALS 6
+
+struct moonal_shadow_s {
+    const field_t *fields;
+    int nfields;
+    uint32_t valid; /* bit i set if val[i] is known */
+    uint32_t dirty; /* bit i set if val[i] is yet to be flushed to AL */
+    int coalesce;   /* coalescing mode */
+    int pending;    /* 1 if the object is in the pending list of its context */
+    ALfloat val[MAXFIELDS][MAXVALS];
+};
+
+/* Objects with dirty values, per context (referenced by the context's info) */
+struct moonal_pendlist_s {
+    ud_t **uds;
+    size_t n;
+    size_t max;
+};
+
+#define PENDLIST(context_ud) (CTXINFO(context_ud)->pending)
+
+static shadow_t **shadowp(ud_t *ud)
+    {
+    switch(ud->objtype)
+        {
+        case OBJTYPE_SOURCE: return &SRCINFO(ud)->shadow;
+        case OBJTYPE_LISTENER: return &LSTINFO(ud)->shadow;
+        default: break;
+        }
+    return NULL;
+    }
+
+static shadow_t *getshadow(ud_t *ud)
+    {
+    shadow_t **p = IsShadowed(ud) ? shadowp(ud) : NULL;
+    return p ? *p : NULL;
+    }
+
+static int searchfield(shadow_t *sh, ALenum param)
+    {
+    int i;
+    for(i = 0; i < sh->nfields; i++)
+        if(sh->fields[i].param == param) return i;
+    return -1;
+    }
+
+static void snapshot(ud_t *ud, shadow_t *sh)
+/* reads the current values from AL (the object's context must be current) */
+    {
+    int i;
+    ALint ival;
+    const field_t *f;
+    ALuint name = ((object_t*)ud->handle)->name;
+    int issource = ud->objtype == OBJTYPE_SOURCE;
+    sh->valid = 0;
+    for(i = 0; i < sh->nfields; i++)
+        {
+        f = &sh->fields[i];
+        if(f->kind == KIND_BOOLEAN)
+            {
+            al.GetSourcei(name, f->param, &ival);
+            sh->val[i][0] = ival;
+            }
+        else if(issource)
+            al.GetSourcefv(name, f->param, sh->val[i]);
+        else
+            al.GetListenerfv(f->param, sh->val[i]);
+        /* parameters not supported by the implementation are just left unknown */
+        if(al.GetError() == AL_NO_ERROR)
+            sh->valid |= 1U << i;
+        }
+    }
+
+void shadow_store(ud_t *ud, ALenum param, const ALfloat *val)
+/* records a value successfully set on the object */
+    {
+    int i, j;
+    shadow_t *sh = getshadow(ud);
+    if(!sh) return;
+    if((i = searchfield(sh, param)) < 0) return;
+    for(j = 0; j < sh->fields[i].n; j++)
+        sh->val[i][j] = val[j];
+    sh->valid |= 1U << i;
+    sh->dirty &= ~(1U << i); /* AL has it now */
+    }
+
+static void checkvalue(lua_State *L, shadow_t *sh, int i, int arg, ALfloat val[MAXVALS])
+/* reads a value for field i from the setter's arguments (starting at arg) */
+    {
+    switch(sh->fields[i].n)
+        {
+        case 1: val[0] = sh->fields[i].kind == KIND_BOOLEAN ?
+                    checkboolean(L, arg) : luaL_checknumber(L, arg); break;
+        case 3: checkfloat3(L, arg, val); break;
+        case 6: checkfloat3(L, arg, val); checkfloat3(L, arg+1, &val[3]); break;
+        default: break;
+        }
+    }
+
+void shadow_store_arg(lua_State *L, ud_t *ud, ALenum param, int arg)
+/* same as shadow_store(), with the value in the setter's arguments (starting at arg) */
+    {
+    int i;
+    ALfloat val[MAXVALS];
+    shadow_t *sh = getshadow(ud);
+    if(!sh) return;
+    if((i = searchfield(sh, param)) < 0) return;
+    checkvalue(L, sh, i, arg, val);
+    shadow_store(ud, param, val);
+    }
+
+static void addpending(lua_State *L, ud_t *ud, shadow_t *sh)
+    {
+    ud_t **uds;
+    size_t n;
+    pendlist_t *pl;
+    if(sh->pending) return;
+    pl = PENDLIST(ud->parent_ud);
+    if(!pl)
+        pl = PENDLIST(ud->parent_ud) = (pendlist_t*)Malloc(L, sizeof(pendlist_t));
+    if(pl->n == pl->max)
+        {
+        n = pl->max ? 2*pl->max : 32;
+        uds = (ud_t**)Malloc(L, n*sizeof(ud_t*));
+        if(pl->uds)
+            {
+            memcpy(uds, pl->uds, pl->n*sizeof(ud_t*));
+            Free(L, pl->uds);
+            }
+        pl->uds = uds;
+        pl->max = n;
+        }
+    pl->uds[pl->n++] = ud;
+    sh->pending = 1;
+    }
+
+static void delpending(ud_t *ud, shadow_t *sh)
+    {
+    size_t i;
+    pendlist_t *pl;
+    if(!sh->pending) return;
+    pl = PENDLIST(ud->parent_ud);
+    for(i = 0; i < pl->n; i++)
+        {
+        if(pl->uds[i] == ud)
+            {
+            if(i < --pl->n) pl->uds[i] = pl->uds[pl->n];
+            break;
+            }
+        }
+    sh->pending = 0;
+    }
+
+int shadow_defer(lua_State *L, ud_t *ud, ALenum param, int arg)
+/* If the object is in coalescing mode and param is shadowed, records the value in
+ * the setter's arguments (starting at arg) and returns 1, otherwise returns 0
+ * (and the setter is expected to proceed as usual). */
+    {
+    int i, j, changed;
+    ALfloat val[MAXVALS];
+    shadow_t *sh = getshadow(ud);
+    if(!sh || !sh->coalesce) return 0;
+    if((i = searchfield(sh, param)) < 0 || !(sh->valid & (1U << i))) return 0;
+    checkvalue(L, sh, i, arg, val);
+    changed = 0;
+    for(j = 0; j < sh->fields[i].n; j++)
+        if(sh->val[i][j] != val[j]) { sh->val[i][j] = val[j]; changed = 1; }
+    if(changed)
+        {
+        sh->dirty |= 1U << i;
+        addpending(L, ud, sh);
+        }
+    return 1;
+    }
+
+static int flush(ud_t *ud, shadow_t *sh)
+/* flushes the dirty values to AL (the object's context must be current),
+ * and returns the number of flushed values */
+    {
+    int i, count = 0;
+    const field_t *f;
+    ALuint name = ((object_t*)ud->handle)->name;
+    int issource = ud->objtype == OBJTYPE_SOURCE;
+    for(i = 0; i < sh->nfields; i++)
+        {
+        if(!(sh->dirty & (1U << i))) continue;
+        f = &sh->fields[i];
+        if(issource)
+            {
+            if(f->kind == KIND_BOOLEAN) al.Sourcei(name, f->param, (ALint)sh->val[i][0]);
+            else if(f->n == 1) al.Sourcef(name, f->param, sh->val[i][0]);
+            else al.Sourcefv(name, f->param, sh->val[i]);
+            if(f->param == AL_POSITION) spatial_position(ud, sh->val[i]);
+            else if(f->param == AL_SOURCE_RELATIVE) spatial_relative(ud, sh->val[i][0] != 0);
+            }
+        else
+            {
+            if(f->n == 1) al.Listenerf(f->param, sh->val[i][0]);
+            else al.Listenerfv(f->param, sh->val[i]);
+            if(f->param == AL_POSITION) spatial_listener(ud->parent_ud, sh->val[i]);
+            }
+        count++;
+        }
+    sh->dirty = 0;
+    return count;
+    }
+
+int shadow_get(lua_State *L, ud_t *ud, ALenum param)
+/* if the value of param is known, pushes it and returns the number of pushed
+ * values, otherwise returns 0 */
+    {
+    int i;
+    shadow_t *sh = getshadow(ud);
+    if(!sh) return 0;
+    if((i = searchfield(sh, param)) < 0 || !(sh->valid & (1U << i))) return 0;
+    switch(sh->fields[i].n)
+        {
+        case 1: 
+            if(sh->fields[i].kind == KIND_BOOLEAN)
+                lua_pushboolean(L, sh->val[i][0] != 0);
+            else
+                lua_pushnumber(L, sh->val[i][0]);
+            return 1;
+        case 3: pushfloat3(L, sh->val[i]); return 1;
+        case 6: pushfloat3(L, sh->val[i]); pushfloat3(L, &sh->val[i][3]); return 2;
+        default: break;
+        }
+    return 0;
+    }
+
+void shadow_forget(lua_State *L, ud_t *ud)
+/* called by freeuserdata() for objects marked as shadowed */
+    {
+    shadow_t **p = shadowp(ud);
+    if(p && *p)
+        {
+        delpending(ud, *p);
+        Free(L, *p);
+        *p = NULL;
+        }
+    CancelShadowed(ud);
+    }
+
+static ud_t *checkobject(lua_State *L, int arg)
+    {
+    ud_t *ud;
+    if(testsource(L, arg, &ud)) return ud;
+    checklistener(L, arg, &ud);
+    return ud;
+    }
+
+static int flushobject(lua_State *L, ud_t *ud)
+/* flushes the pending values of a single object */
+    {
+    ALenum ec;
+    context_t old_context;
+    shadow_t *sh = getshadow(ud);
+    if(!sh || !sh->dirty) return 0;
+    old_context = alc.GetCurrentContext();
+    if(old_context != ud->context) make_context_current(L, ud->context);
+    flush(ud, sh);
+    delpending(ud, sh);
+    ec = al.GetError(); /* of the object's context, before it is switched */
+    if(old_context != ud->context)
+        {
+        if(old_context) make_context_current(L, old_context);
+        else set_current_context(NULL);
+        }
+    if(ec) { pushalerror(L, ec); return lua_error(L); }
+    return 0;
+    }
+
+int shadow_enable(lua_State *L)
+/* cache(object, boolean) */
+    {
+    shadow_t *sh, **p;
+    context_t old_context;
+    ud_t *ud = checkobject(L, 1);
+    int enable = checkboolean(L, 2);
+    if(!enable)
+        { 
+        if(IsShadowed(ud))
+            {
+            flushobject(L, ud);
+            shadow_forget(L, ud);
+            }
+        return 0;
+        }
+    if(IsShadowed(ud)) return 0;
+    p = shadowp(ud);
+    sh = (shadow_t*)Malloc(L, sizeof(shadow_t));
+    if(ud->objtype == OBJTYPE_SOURCE)
+        { sh->fields = SourceFields; sh->nfields = NFIELDS(SourceFields); }
+    else
+        { sh->fields = ListenerFields; sh->nfields = NFIELDS(ListenerFields); }
+    old_context = current_context(L);
+    make_context_current(L, ud->context);
+    snapshot(ud, sh);
+    make_context_current(L, old_context);
+    *p = sh;
+    MarkShadowed(ud);
+    return 0;
+    }
+
+int shadow_enabled(lua_State *L)
+/* boolean = is_cached(object) */
+    {
+    ud_t *ud = checkobject(L, 1);
+    lua_pushboolean(L, IsShadowed(ud));
+    return 1;
+    }
+
+int shadow_coalesce(lua_State *L)
+/* coalesce(object, boolean) */
+    {
+    shadow_t *sh;
+    ud_t *ud = checkobject(L, 1);
+    int enable = checkboolean(L, 2);
+    if(enable)
+        {
+        if(!IsShadowed(ud))
+            {
+            lua_settop(L, 1);
+            lua_pushboolean(L, 1);
+            shadow_enable(L);
+            }
+        getshadow(ud)->coalesce = 1;
+        return 0;
+        }
+    if((sh = getshadow(ud)) == NULL) return 0;
+    flushobject(L, ud);
+    sh->coalesce = 0;
+    return 0;
+    }
+
+int shadow_coalesced(lua_State *L)
+/* boolean = is_coalesced(object) */
+    {
+    shadow_t *sh;
+    ud_t *ud = checkobject(L, 1);
+    sh = getshadow(ud);
+    lua_pushboolean(L, sh && sh->coalesce);
+    return 1;
+    }
+
+int shadow_commit(lua_State *L)
+/* count = commit(context) */
+    {
+    ud_t *ud, *obj_ud;
+    shadow_t *sh;
+    size_t i = 0;
+    int window, count = 0;
+    ALenum ec;
+    context_t context = checkcontext(L, 1, &ud);
+    context_t old_context = alc.GetCurrentContext();
+    pendlist_t *pl = PENDLIST(ud);
+    TRACE_CALL_START;
+    if(!pl || pl->n == 0)
+        { lua_pushinteger(L, 0); return 1; }
+    if(old_context != context) make_context_current(L, context);
+    window = begin_deferred(ud);
+    for(i = 0; i < pl->n; i++)
+        {
+        obj_ud = pl->uds[i];
+        sh = getshadow(obj_ud);
+        count += flush(obj_ud, sh);
+        sh->pending = 0;
+        }
+    pl->n = 0;
+    end_deferred(ud, window);
+    ec = al.GetError(); /* of the committed context, before it is switched */
+    if(old_context != context)
+        {
+        if(old_context) make_context_current(L, old_context);
+        else set_current_context(NULL);
+        }
+    TRACE_CALL_STOP("commit", context, count);
+    if(ec) { pushalerror(L, ec); return lua_error(L); }
+    lua_pushinteger(L, count);
+    return 1;
+    }
+
+static const struct luaL_Reg Functions[] =
+    {
+        { "cache", shadow_enable },
+        { "is_cached", shadow_enabled },
+        { "coalesce", shadow_coalesce },
+        { "is_coalesced", shadow_coalesced },
+        { "commit", shadow_commit },
+        { NULL, NULL } /* sentinel */
+    };
+
+void moonal_open_shadow(lua_State *L)
+    {
+    luaL_setfuncs(L, Functions, 0);
+    }
+
+void shadow_free(lua_State *L, ud_t *context_ud)
+/* called by freecontext(), after its sources and listener have been released */
+    {
+    pendlist_t *pl = PENDLIST(context_ud);
+    if(!pl) return;
+    if(pl->uds) Free(L, pl->uds);
+    Free(L, pl);
+    PENDLIST(context_ud) = NULL;
+    }
+
@@ -28,6 +28,9 @@
 static int freesource(lua_State *L, ud_t *ud)
     {
     source_t source = (source_t)ud->handle;
+    if(IsValid(ud) && IsPooled(ud))
+        return luaL_error(L, "source is owned by a voice pool");
+    freechildren(L, STREAM_MT, ud);
     if(!freeuserdata(L, ud)) return 0;
     TRACE_DELETE(source, "source");
     al.DeleteSources(1, &source->name);
@@ -36,34 +39,44 @@ static int freesource(lua_State *L, ud_t *ud)
     return 0;
     }
 
-static int Create(lua_State *L)
+source_t newsource(lua_State *L, ud_t *context_ud, ALuint name)
+/* Binds the AL source 'name' (already generated in the context of context_ud)
+ * to a new source object, and pushes it on the stack. */
     {
-    ALuint name;
-    ud_t *ud, *context_ud;
-    source_t source;
-    context_t old_context = current_context(L);
-    context_t context = checkcontext(L, 1, &context_ud);
-    
-    al.GenSources(1, &name);
-    CheckErrorRestoreAl(L, old_context);
-
-    source = (object_t*)MallocNoErr(L, sizeof(object_t));
+    ud_t *ud;
+    source_t source = (object_t*)MallocNoErr(L, sizeof(object_t));
     if(!source)
         {
-        make_context_current(L, old_context);
         al.DeleteSources(1, &name);
-        return luaL_error(L, errstring(ERR_MEMORY));
+        luaL_error(L, errstring(ERR_MEMORY));
+        return NULL;
         }
-    
     source->name = name;
     ud = newuserdata(L, source, SOURCE_MT);
-    ud->context = context;
+    ud->context = (context_t)context_ud->handle;
     ud->device = context_ud->device;
     ud->parent_ud = context_ud;
     ud->destructor = freesource;
     ud->ddt = context_ud->ddt;
     ud->cdt = context_ud->cdt;
+    ud->info = MallocNoErr(L, sizeof(srcinfo_t));
+    if(!ud->info)
+        { luaL_error(L, errstring(ERR_MEMORY)); return NULL; }
+    spatial_add(L, ud);
     TRACE_CREATE(source, "source");
+    return source;
+    }
+
+static int Create(lua_State *L)
+    {
+    ALuint name;
+    ud_t *context_ud;
+    context_t old_context = current_context(L);
+    (void)checkcontext(L, 1, &context_ud);
+    
+    al.GenSources(1, &name);
+    CheckErrorRestoreAl(L, old_context);
+    newsource(L, context_ud, name);
     make_context_current(L, old_context);
     return 1;
     }
@@ -78,7 +91,8 @@ static ALuint *CheckSources(lua_State *L, int arg, uint32_t *count, ud_t **ud)
     names = objectnamelist(L, sources, *count, &err);
     if(err)
         { Free(L, sources); luaL_argerror(L, arg, errstring(err)); return NULL; }
-    if(ud) *ud = userdata(sources[1]);
+    if(ud) *ud = userdata(L, sources[0]);
+    Free(L, sources);
     return names;
     }
 
@@ -92,35 +106,60 @@ static ALuint *CheckBuffers(lua_State *L, int arg, uint32_t *count, ud_t **ud)
     names = objectnamelist(L, buffers, *count, &err);
     if(err)
         { Free(L, buffers); luaL_argerror(L, arg, errstring(err)); return NULL; }
-    if(ud) *ud = userdata(buffers[1]);
+    if(ud) *ud = userdata(L, buffers[0]);
+    Free(L, buffers);
     return names;
     }
 
-#define SOURCE_FUNC(what)                           \
+static void NoHook(lua_State *L, ud_t *context_ud, const ALuint *sources, uint32_t count)
+    { (void)L; (void)context_ud; (void)sources; (void)count; }
+
+static void CancelStarts(lua_State *L, ud_t *context_ud, const ALuint *sources, uint32_t count)
+/* explicit stops, pauses and rewinds supersede scheduled and deferred starts */
+    {
+    schedule_cancel(L, context_ud, sources, count);
+    residency_cancel(L, context_ud, sources, count);
+    }
+
+#define SOURCE_FUNC(what, tracename, prehook, hook) \
 static int Source##what(lua_State *L)               \
     {                                               \
     ud_t *ud;                                       \
+    ALenum ec;                                      \
     uint32_t count;                                 \
     ALuint *sources;                                \
     source_t source;                                \
+    TRACE_CALL_START;                               \
     if(lua_istable(L, 1))                           \
         {                                           \
         sources = CheckSources(L, 1, &count, &ud);  \
+        prehook(L, ud->parent_ud, sources, count);  \
         al.Source##what##v(count, sources);         \
+        ec = al.GetError();                         \
+        if(ec == AL_NO_ERROR)                       \
+            hook(L, ud->parent_ud, sources, count); \
         Free(L, sources);                           \
-        CheckErrorAl(L);                            \
+        if(ec)                                      \
+            {                                       \
+            pushalerror(L, ec);                     \
+            return lua_error(L);                    \
+            }                                       \
+        TRACE_CALL_STOP(tracename, 0, count);       \
         return 0;                                   \
         }                                           \
     source = checksource(L, 1, &ud);                \
+    prehook(L, ud->parent_ud, &source->name, 1);    \
     al.Source##what(source->name);                  \
     CheckErrorAl(L);                                \
+    hook(L, ud->parent_ud, &source->name, 1);       \
+    TRACE_CALL_STOP(tracename, source, 1);          \
     return 0;                                       \
     }
 
-SOURCE_FUNC(Play)
-SOURCE_FUNC(Stop)
-SOURCE_FUNC(Pause)
-SOURCE_FUNC(Rewind)
+SOURCE_FUNC(Play, "source_play", residency_touch, schedule_cancel)
+SOURCE_FUNC(Stop, "source_stop", NoHook, CancelStarts)
+SOURCE_FUNC(Pause, "source_pause", NoHook, CancelStarts)
+SOURCE_FUNC(Rewind, "source_rewind", NoHook, CancelStarts)
 
 #undef SOURCE_FUNC
 
@@ -130,8 +169,10 @@ static int SourceQueueBuffers(lua_State *L)
     uint32_t count;
     source_t source = checksource(L, 1, &ud);
     ALuint *buffers = CheckBuffers(L, 2, &count, NULL);
+    TRACE_CALL_START;
     al.SourceQueueBuffers(source->name, count, buffers);
     CheckErrorAl(L);
+    TRACE_CALL_STOP("source_queue_buffers", source, count);
     return 0;
     }
 
@@ -143,6 +184,7 @@ static int SourceUnqueueBuffers(lua_State *L)
     buffer_t buffer;
     source_t source = checksource(L, 1, &ud);
     uint32_t i, count = luaL_checkinteger(L, 2);
+    TRACE_CALL_START;
     if(count == 0)
         return luaL_argerror(L, 2, errstring(ERR_VALUE));
     buffers = (ALuint*)Malloc(L, count * sizeof(ALuint));
@@ -175,6 +217,7 @@ static int SourceUnqueueBuffers(lua_State *L)
             lua_rawseti(L, -2, i+1);
             }
         Free(L, buffers);
+        TRACE_CALL_STOP("source_unqueue_buffers", source, count);
         return 1;
         }
     CheckErrorAl(L);
@@ -207,6 +250,8 @@ static int SetBoolean(lua_State *L, source_t source, ALenum param)
     val = checkboolean(L, 3);
     al.Sourcei(source->name, param, val);
     CheckErrorAl(L);
+    if(param == AL_SOURCE_RELATIVE)
+        spatial_relative(userdata(L, source), val);
     return 0;
     }
 
@@ -243,13 +288,15 @@ static int SetFloat3(lua_State *L, source_t source, ALenum param)
     checkfloat3(L, 3, val);
     al.Sourcefv(source->name, param, val);
     CheckErrorAl(L);
+    if(param == AL_POSITION)
+        spatial_position(userdata(L, source), val);
     return 0;
     }
 
 static int GetDouble2(lua_State *L, source_t source, ALenum param)
     {
     ALdouble val[2];
-    ud_t *ud = userdata(source);
+    ud_t *ud = userdata(L, source);
     CheckContextPfn(L, ud, GetSourcedvSOFT);
     ud->cdt->GetSourcedvSOFT(source->name, param, val);
     CheckErrorAl(L);
@@ -261,7 +308,7 @@ static int GetDouble2(lua_State *L, source_t source, ALenum param)
 static int GetI64_2(lua_State *L, source_t source, ALenum param)
     {
     ALint64SOFT val[2];
-    ud_t *ud = userdata(source);
+    ud_t *ud = userdata(L, source);
     CheckContextPfn(L, ud, GetSourcei64vSOFT);
     ud->cdt->GetSourcei64vSOFT(source->name, param, val);
     CheckErrorAl(L);
@@ -411,10 +458,8 @@ static int SetAuxiliarySendFilter(lua_State *L, source_t source)
     return 0;
     }
 
-static int GetSource(lua_State *L)
+static int getsource(lua_State *L, source_t source, ALenum param)
     {
-    source_t source = checksource(L, 1, NULL);
-    ALenum param = checkalparam(L, 2);
     switch(param)
         {
         case AL_PITCH:
@@ -476,10 +521,8 @@ static int GetSource(lua_State *L)
     return 0;
     }
 
-static int SetSource(lua_State *L)
+static int setsource(lua_State *L, source_t source, ALenum param)
     {
-    source_t source = checksource(L, 1, NULL);
-    ALenum param = checkalparam(L, 2);
     switch(param)
         {
         case AL_PITCH:
@@ -537,12 +580,55 @@ static int SetSource(lua_State *L)
     return 0;
     }
 
+static int GetSource(lua_State *L)
+    {
+    int nres = 0;
+    ud_t *ud;
+    source_t source = checksource(L, 1, &ud);
+    ALenum param = checkalparam(L, 2);
+    TRACE_CALL_START;
+    if(IsShadowed(ud))
+        nres = shadow_get(L, ud, param);
+    if(nres == 0)
+        nres = getsource(L, source, param);
+    TRACE_CALL_STOP("source_get", source, param);
+    return nres;
+    }
+
+static int SetSource(lua_State *L)
+    {
+    int nres;
+    ud_t *ud;
+    source_t source = checksource(L, 1, &ud);
+    ALenum param = checkalparam(L, 2);
+    TRACE_CALL_START;
+    if(IsShadowed(ud) && shadow_defer(L, ud, param, 3))
+        nres = 0;
+    else
+        {
+        nres = setsource(L, source, param);
+        if(IsShadowed(ud))
+            shadow_store_arg(L, ud, param, 3);
+        }
+    TRACE_CALL_STOP("source_set", source, param);
+    return nres;
+    }
 
 RAW_FUNC(source)
 TYPE_FUNC(source)
 PARENT_FUNC(source)
 DELETE_FUNC(source)
 
+static int Gc(lua_State *L)
+/* Pooled sources are released by their voice pool, so the finalizer skips
+ * them silently instead of raising like delete() does. */
+    {
+    ud_t *ud;
+    (void)testsource(L, 1, &ud);
+    if(!ud || (IsValid(ud) && IsPooled(ud))) return 0;
+    return ud->destructor(L, ud);
+    }
+
 static const struct luaL_Reg Methods[] = 
     {
         { "raw", Raw },
@@ -552,17 +638,27 @@ static const struct luaL_Reg Methods[] =
         { "get", GetSource },
         { "set", SetSource },
         { "play", SourcePlay },
+        { "play_at", schedule_play },
+        { "open_stream", stream_open },
         { "stop", SourceStop },
         { "pause", SourcePause },
         { "rewind", SourceRewind },
         { "queue_buffers", SourceQueueBuffers },
         { "unqueue_buffers", SourceUnqueueBuffers },
+        { "ramp", ramps_start },
+        { "cancel_ramps", ramps_cancel },
+        { "set_virtual", virtual_set },
+        { "is_virtual", virtual_is },
+        { "cache", shadow_enable },
+        { "is_cached", shadow_enabled },
+        { "coalesce", shadow_coalesce },
+        { "is_coalesced", shadow_coalesced },
         { NULL, NULL } /* sentinel */
     };
 
 static const struct luaL_Reg MetaMethods[] = 
     {
-        { "__gc",  Delete },
+        { "__gc",  Gc },
         { NULL, NULL } /* sentinel */
     };
 
@@ -0,0 +1,513 @@
+/* The MIT License (MIT)
+ *
+ * Copyright (c) 2018 Stefano Trettel
+ *
+ * Software repository: MoonAL, https://github.com/stetre/moonal
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+
+#include "internal.h"
+#include <math.h>
+#include <limits.h>
+
+/* Spatial index over sources.
+ *
+ * The positions of the sources of a context, as set through MoonAL, are shadowed
+ * in a per-context store (SoA arrays, referenced by the context's info), and indexed with
+ * a hashed uniform grid that is lazily rebuilt (by counting sort) at the first
+ * query after a change. Queries are thus resolved without any AL call.
+ *
+ * Each source knows its slot in the store (SRCINFO(ud)->slot), so that updates
+ * and removals are O(1).
+ *
+ * The store also indexes the sources by their AL name, with a tree of their srcinfo,
+ * so that the names reported by AL (e.g. in native events) can be mapped back to the
+ * source objects of the context, without scanning all the objects.
+ */
+
+#define DEFAULT_CELLSIZE 10.0
+
+static int cmp(srcinfo_t *s1, srcinfo_t *s2)
+    { return (s1->name < s2->name ? -1 : s1->name > s2->name); }
+
+RB_HEAD(srctree_s, moonal_srcinfo_s);
+RB_PROTOTYPE_STATIC(srctree_s, moonal_srcinfo_s, entry, cmp)
+RB_GENERATE_STATIC(srctree_s, moonal_srcinfo_s, entry, cmp)
+
+struct moonal_spatial_s {
+    size_t n, max;
+    float *x, *y, *z;       /* positions, as set */
+    unsigned char *relative;
+    ud_t **uds;
+    struct srctree_s names; /* name index */
+    float listener[3];      /* listener position */
+    /* grid */
+    int dirty;
+    double cellsize;
+    size_t nbuckets;        /* power of 2 */
+    size_t maxbuckets;
+    size_t *start;          /* bucket b has items[start[b]..start[b+1]-1] */
+    size_t *items;          /* slots, sorted by bucket */
+    long *cells;            /* cell coordinates of each slot (3 per slot) */
+    float *wx, *wy, *wz;    /* world positions of each slot */
+    float lo[3], hi[3];     /* bounding box */
+};
+
+#define SPATIAL(context_ud) (CTXINFO(context_ud)->spatial)
+
+void spatial_init(lua_State *L, ud_t *context_ud)
+/* creates the (empty) store of a new context */
+    {
+    spatial_t *sp = (spatial_t*)Malloc(L, sizeof(spatial_t));
+    sp->cellsize = DEFAULT_CELLSIZE;
+    sp->dirty = 1;
+    RB_INIT(&sp->names);
+    SPATIAL(context_ud) = sp;
+    }
+
+static void *growarray(lua_State *L, void *p, size_t oldn, size_t newn, size_t size)
+    {
+    void *q = Malloc(L, newn*size);
+    if(p)
+        {
+        memcpy(q, p, oldn*size);
+        Free(L, p);
+        }
+    return q;
+    }
+
+static void freearrays(lua_State *L, spatial_t *sp)
+    {
+    if(sp->x) Free(L, sp->x);
+    if(sp->y) Free(L, sp->y);
+    if(sp->z) Free(L, sp->z);
+    if(sp->relative) Free(L, sp->relative);
+    if(sp->uds) Free(L, sp->uds);
+    if(sp->items) Free(L, sp->items);
+    if(sp->cells) Free(L, sp->cells);
+    if(sp->wx) Free(L, sp->wx);
+    if(sp->wy) Free(L, sp->wy);
+    if(sp->wz) Free(L, sp->wz);
+    if(sp->start) Free(L, sp->start);
+    }
+
+void spatial_add(lua_State *L, ud_t *ud)
+/* adds a newly created source to the store of its context, at the origin */
+    {
+    size_t i, m;
+    spatial_t *sp = SPATIAL(ud->parent_ud);
+    if(sp->n == sp->max)
+        {
+        m = sp->max ? 2*sp->max : 64;
+        sp->x = (float*)growarray(L, sp->x, sp->n, m, sizeof(float));
+        sp->y = (float*)growarray(L, sp->y, sp->n, m, sizeof(float));
+        sp->z = (float*)growarray(L, sp->z, sp->n, m, sizeof(float));
+        sp->relative = (unsigned char*)growarray(L, sp->relative, sp->n, m, sizeof(unsigned char));
+        sp->uds = (ud_t**)growarray(L, sp->uds, sp->n, m, sizeof(ud_t*));
+        /* grid arrays are rebuilt from scratch, so there is no need to copy them */
+        if(sp->items) Free(L, sp->items);
+        if(sp->cells) Free(L, sp->cells);
+        if(sp->wx) Free(L, sp->wx);
+        if(sp->wy) Free(L, sp->wy);
+        if(sp->wz) Free(L, sp->wz);
+        sp->items = (size_t*)Malloc(L, m*sizeof(size_t));
+        sp->cells = (long*)Malloc(L, 3*m*sizeof(long));
+        sp->wx = (float*)Malloc(L, m*sizeof(float));
+        sp->wy = (float*)Malloc(L, m*sizeof(float));
+        sp->wz = (float*)Malloc(L, m*sizeof(float));
+        sp->max = m;
+        }
+    i = sp->n++;
+    sp->x[i] = sp->y[i] = sp->z[i] = 0;
+    sp->relative[i] = 0;
+    sp->uds[i] = ud;
+    SRCINFO(ud)->slot = i;
+    SRCINFO(ud)->name = ((source_t)ud->handle)->name;
+    SRCINFO(ud)->ud = ud;
+    RB_INSERT(srctree_s, &sp->names, SRCINFO(ud));
+    sp->dirty = 1;
+    MarkIndexed(ud);
+    }
+
+void spatial_forget(lua_State *L, ud_t *ud)
+/* called by freeuserdata() for sources marked as indexed */
+    {
+    size_t i, last;
+    spatial_t *sp = SPATIAL(ud->parent_ud);
+    (void)L;
+    if(!sp) return;
+    i = SRCINFO(ud)->slot;
+    if(i >= sp->n || sp->uds[i] != ud) return;
+    RB_REMOVE(srctree_s, &sp->names, SRCINFO(ud));
+    last = --sp->n;
+    if(i < last)
+        {
+        sp->x[i] = sp->x[last];
+        sp->y[i] = sp->y[last];
+        sp->z[i] = sp->z[last];
+        sp->relative[i] = sp->relative[last];
+        sp->uds[i] = sp->uds[last];
+        SRCINFO(sp->uds[i])->slot = i;
+        }
+    sp->dirty = 1;
+    CancelIndexed(ud);
+    }
+
+ud_t *spatial_source(ud_t *context_ud, ALuint name)
+/* returns the source of the context with the given AL name, or NULL */
+    {
+    srcinfo_t key, *info;
+    spatial_t *sp = SPATIAL(context_ud);
+    if(!sp) return NULL;
+    key.name = name;
+    info = RB_FIND(srctree_s, &sp->names, &key);
+    return info ? info->ud : NULL;
+    }
+
+void spatial_free(lua_State *L, ud_t *context_ud)
+/* releases the store of a context (called by freecontext() after its sources are gone) */
+    {
+    spatial_t *sp = SPATIAL(context_ud);
+    if(!sp) return;
+    freearrays(L, sp);
+    Free(L, sp);
+    SPATIAL(context_ud) = NULL;
+    }
+
+void spatial_position(ud_t *ud, const ALfloat pos[3])
+/* shadows the position of a source */
+    {
+    size_t i;
+    spatial_t *sp;
+    if(!IsIndexed(ud)) return;
+    sp = SPATIAL(ud->parent_ud);
+    i = SRCINFO(ud)->slot;
+    sp->x[i] = pos[0];
+    sp->y[i] = pos[1];
+    sp->z[i] = pos[2];
+    sp->dirty = 1;
+    }
+
+void spatial_relative(ud_t *ud, int relative)
+/* shadows the AL_SOURCE_RELATIVE flag of a source */
+    {
+    spatial_t *sp;
+    if(!IsIndexed(ud)) return;
+    sp = SPATIAL(ud->parent_ud);
+    sp->relative[SRCINFO(ud)->slot] = relative ? 1 : 0;
+    sp->dirty = 1;
+    }
+
+void spatial_listener(ud_t *context_ud, const ALfloat pos[3])
+/* shadows the position of the listener */
+    {
+    spatial_t *sp = SPATIAL(context_ud);
+    if(!sp) return;
+    sp->listener[0] = pos[0];
+    sp->listener[1] = pos[1];
+    sp->listener[2] = pos[2];
+    sp->dirty = 1;
+    }
+
+/*------------------------------------------------------------------------------*
+ | Grid                                                                         |
+ *------------------------------------------------------------------------------*/
+
+static size_t hashcell(long cx, long cy, long cz, size_t nbuckets)
+    {
+    unsigned long h = ((unsigned long)cx*73856093UL) ^ ((unsigned long)cy*19349663UL)
+                        ^ ((unsigned long)cz*83492791UL);
+    return (size_t)(h & (nbuckets - 1));
+    }
+
+/* Cell coordinates are clamped to +/-CELLMAX, so that huge or infinite positions do
+ * not overflow the conversion to long (such positions share the border cells). */
+#define CELLMAX ((double)(LONG_MAX/4))
+
+static long cellof(double v, double cellsize)
+    {
+    double q = floor(v/cellsize);
+    if(q != q) return 0; /* NaN */
+    if(q < -CELLMAX) return -(long)CELLMAX;
+    if(q > CELLMAX) return (long)CELLMAX;
+    return (long)q;
+    }
+
+static void rebuild(lua_State *L, spatial_t *sp)
+    {
+    size_t i, b, nb, sum, cnt;
+    long *c;
+    if(!sp->dirty) return;
+    for(nb = 16; nb < sp->n; nb *= 2);
+    if(nb > sp->maxbuckets)
+        {
+        if(sp->start) Free(L, sp->start);
+        sp->start = (size_t*)Malloc(L, (nb+1)*sizeof(size_t));
+        sp->maxbuckets = nb;
+        }
+    sp->nbuckets = nb;
+    memset(sp->start, 0, (nb+1)*sizeof(size_t));
+    for(i = 0; i < sp->n; i++)
+        {
+        /* relative sources are placed at the listener position plus their offset */
+        sp->wx[i] = sp->x[i] + (sp->relative[i] ? sp->listener[0] : 0);
+        sp->wy[i] = sp->y[i] + (sp->relative[i] ? sp->listener[1] : 0);
+        sp->wz[i] = sp->z[i] + (sp->relative[i] ? sp->listener[2] : 0);
+        c = &sp->cells[3*i];
+        c[0] = cellof(sp->wx[i], sp->cellsize);
+        c[1] = cellof(sp->wy[i], sp->cellsize);
+        c[2] = cellof(sp->wz[i], sp->cellsize);
+        sp->start[hashcell(c[0], c[1], c[2], nb)]++;
+        if(i == 0)
+            {
+            sp->lo[0] = sp->hi[0] = sp->wx[i];
+            sp->lo[1] = sp->hi[1] = sp->wy[i];
+            sp->lo[2] = sp->hi[2] = sp->wz[i];
+            }
+        else
+            {
+            if(sp->wx[i] < sp->lo[0]) sp->lo[0] = sp->wx[i];
+            if(sp->wx[i] > sp->hi[0]) sp->hi[0] = sp->wx[i];
+            if(sp->wy[i] < sp->lo[1]) sp->lo[1] = sp->wy[i];
+            if(sp->wy[i] > sp->hi[1]) sp->hi[1] = sp->wy[i];
+            if(sp->wz[i] < sp->lo[2]) sp->lo[2] = sp->wz[i];
+            if(sp->wz[i] > sp->hi[2]) sp->hi[2] = sp->wz[i];
+            }
+        }
+    /* exclusive prefix sum, then scatter */
+    for(sum = 0, b = 0; b <= nb; b++)
+        { cnt = sp->start[b]; sp->start[b] = sum; sum += cnt; }
+    for(i = 0; i < sp->n; i++)
+        {
+        c = &sp->cells[3*i];
+        b = hashcell(c[0], c[1], c[2], nb);
+        sp->items[sp->start[b]++] = i;
+        }
+    /* the scatter shifted each start to the next bucket's one */
+    for(b = nb; b > 0; b--) sp->start[b] = sp->start[b-1];
+    sp->start[0] = 0;
+    sp->dirty = 0;
+    }
+
+typedef struct {
+    size_t slot;
+    double d2;
+} hit_t;
+
+typedef struct {
+    hit_t *hits;
+    size_t n, max;
+} hits_t;
+
+static void addhit(lua_State *L, hits_t *h, size_t slot, double d2)
+    {
+    size_t m;
+    if(h->n == h->max)
+        {
+        m = h->max ? 2*h->max : 64;
+        h->hits = (hit_t*)growarray(L, h->hits, h->n, m, sizeof(hit_t));
+        h->max = m;
+        }
+    h->hits[h->n].slot = slot;
+    h->hits[h->n].d2 = d2;
+    h->n++;
+    }
+
+static double dist2(spatial_t *sp, size_t i, const double c[3])
+    {
+    double dx = sp->wx[i] - c[0], dy = sp->wy[i] - c[1], dz = sp->wz[i] - c[2];
+    return dx*dx + dy*dy + dz*dz;
+    }
+
+static void query(lua_State *L, spatial_t *sp, const double c[3], double r, hits_t *h)
+/* collects in h the sources within distance r from c (the grid must be up to date) */
+    {
+    long lo[3], hi[3], cx, cy, cz;
+    size_t i, j, b;
+    double qlo[3], qhi[3], ncells, r2 = r*r;
+    h->n = 0;
+    for(i = 0; i < 3; i++)
+        {
+        qlo[i] = floor((c[i] - r)/sp->cellsize);
+        qhi[i] = floor((c[i] + r)/sp->cellsize);
+        }
+    ncells = (qhi[0]-qlo[0]+1) * (qhi[1]-qlo[1]+1) * (qhi[2]-qlo[2]+1);
+    for(i = 0; i < 3; i++) /* the border cells also hold the clamped positions */
+        if(!(qlo[i] > -CELLMAX && qhi[i] < CELLMAX)) ncells = HUGE_VAL;
+    if(ncells > (double)sp->n)
+        { /* a linear scan is cheaper (or the box exceeds the grid) */
+        for(i = 0; i < sp->n; i++)
+            if(dist2(sp, i, c) <= r2) addhit(L, h, i, dist2(sp, i, c));
+        return;
+        }
+    for(i = 0; i < 3; i++)
+        { lo[i] = (long)qlo[i]; hi[i] = (long)qhi[i]; }
+    for(cx = lo[0]; cx <= hi[0]; cx++)
+        for(cy = lo[1]; cy <= hi[1]; cy++)
+            for(cz = lo[2]; cz <= hi[2]; cz++)
+                {
+                b = hashcell(cx, cy, cz, sp->nbuckets);
+                for(j = sp->start[b]; j < sp->start[b+1]; j++)
+                    {
+                    i = sp->items[j];
+                    /* skip hash collisions with other cells (this also avoids duplicates) */
+                    if(sp->cells[3*i] != cx || sp->cells[3*i+1] != cy || sp->cells[3*i+2] != cz)
+                        continue;
+                    if(dist2(sp, i, c) <= r2) addhit(L, h, i, dist2(sp, i, c));
+                    }
+                }
+    }
+
+static int cmphits(const void *a_, const void *b_)
+    {
+    const hit_t *a = (const hit_t*)a_, *b = (const hit_t*)b_;
+    return (a->d2 < b->d2) ? -1 : (a->d2 > b->d2);
+    }
+
+static double farthest(spatial_t *sp, const double c[3])
+/* distance from c to the farthest corner of the bounding box */
+    {
+    int i;
+    double d, s = 0;
+    for(i = 0; i < 3; i++)
+        {
+        d = fabs(c[i] - sp->lo[i]);
+        if(fabs(c[i] - sp->hi[i]) > d) d = fabs(c[i] - sp->hi[i]);
+        s += d*d;
+        }
+    return sqrt(s);
+    }
+
+static int pushhits(lua_State *L, spatial_t *sp, hits_t *h, size_t count)
+    {
+    size_t i;
+    lua_newtable(L);
+    for(i = 0; i < count; i++)
+        {
+        pushsource(L, (source_t)sp->uds[h->hits[i].slot]->handle);
+        lua_rawseti(L, -2, i+1);
+        }
+    lua_newtable(L);
+    for(i = 0; i < count; i++)
+        {
+        lua_pushnumber(L, sqrt(h->hits[i].d2));
+        lua_rawseti(L, -2, i+1);
+        }
+    if(h->hits) Free(L, h->hits);
+    return 2;
+    }
+
+static void checkcenter(lua_State *L, int arg, double c[3])
+    {
+    ALfloat v[3];
+    checkfloat3(L, arg, v);
+    c[0] = v[0]; c[1] = v[1]; c[2] = v[2];
+    if(!isfinite(c[0]) || !isfinite(c[1]) || !isfinite(c[2]))
+        luaL_argerror(L, arg, errstring(ERR_VALUE));
+    }
+
+/*------------------------------------------------------------------------------*
+ | Lua functions                                                                |
+ *------------------------------------------------------------------------------*/
+
+int spatial_query(lua_State *L)
+/* {source}, {distance} = query_sources(context, center, radius) */
+    {
+    ud_t *ud;
+    spatial_t *sp;
+    double c[3], r;
+    hits_t h = { NULL, 0, 0 };
+    checkcontext(L, 1, &ud);
+    checkcenter(L, 2, c);
+    r = luaL_checknumber(L, 3);
+    if(!(r >= 0) || !isfinite(r)) return luaL_argerror(L, 3, errstring(ERR_VALUE));
+    sp = SPATIAL(ud);
+    rebuild(L, sp);
+    query(L, sp, c, r, &h);
+    if(h.n > 1) qsort(h.hits, h.n, sizeof(hit_t), cmphits);
+    return pushhits(L, sp, &h, h.n);
+    }
+
+int spatial_nearest(lua_State *L)
+/* {source}, {distance} = nearest_sources(context, k, [center]) */
+    {
+    ud_t *ud;
+    spatial_t *sp;
+    double c[3], r, rmax;
+    size_t k;
+    lua_Integer kk;
+    hits_t h = { NULL, 0, 0 };
+    checkcontext(L, 1, &ud);
+    kk = luaL_checkinteger(L, 2);
+    if(kk < 0) return luaL_argerror(L, 2, errstring(ERR_VALUE));
+    k = (size_t)kk;
+    sp = SPATIAL(ud);
+    if(lua_isnoneornil(L, 3))
+        { c[0] = sp->listener[0]; c[1] = sp->listener[1]; c[2] = sp->listener[2]; }
+    else
+        checkcenter(L, 3, c);
+    rebuild(L, sp);
+    if(k > 0 && sp->n > 0)
+        {
+        /* grow the search radius until it contains k sources or the whole box */
+        rmax = farthest(sp, c);
+        if(!(rmax < HUGE_VAL)) rmax = HUGE_VAL; /* sources at infinity (or NaN) */
+        r = sp->cellsize;
+        for(;;)
+            {
+            if(r >= rmax) r = rmax;
+            query(L, sp, c, r, &h);
+            if(h.n >= k || r >= rmax) break;
+            r *= 2;
+            }
+        qsort(h.hits, h.n, sizeof(hit_t), cmphits);
+        }
+    return pushhits(L, sp, &h, h.n < k ? h.n : k);
+    }
+
+int spatial_grid(lua_State *L)
+/* set_spatial_grid(context, cellsize) */
+    {
+    ud_t *ud;
+    spatial_t *sp;
+    double cellsize;
+    checkcontext(L, 1, &ud);
+    cellsize = luaL_checknumber(L, 2);
+    if(!(cellsize > 0)) return luaL_argerror(L, 2, errstring(ERR_VALUE));
+    sp = SPATIAL(ud);
+    sp->cellsize = cellsize;
+    sp->dirty = 1;
+    return 0;
+    }
+
+static const struct luaL_Reg Functions[] =
+    {
+        { "query_sources", spatial_query },
+        { "nearest_sources", spatial_nearest },
+        { "set_spatial_grid", spatial_grid },
+        { NULL, NULL } /* sentinel */
+    };
+
+void moonal_open_spatial(lua_State *L)
+    {
+    luaL_setfuncs(L, Functions, 0);
+    }
+
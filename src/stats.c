@@ -0,0 +1,179 @@
+/* The MIT License (MIT)
+ *
+ * Copyright (c) 2017 Stefano Trettel
+ *
+ * Software repository: MoonAL, https://github.com/stetre/moonal
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "internal.h"
+
+/* Objects and memory statistics */
+
+static const char *TypeName[OBJTYPE_COUNT] = {
+    "device", "context", "buffer", "listener", "source", "effect", "filter", "auxslot",
+    "voicepool", "mapping", "stream",
+};
+
+static const char *TypeMt[OBJTYPE_COUNT] = {
+    DEVICE_MT, CONTEXT_MT, BUFFER_MT, LISTENER_MT, SOURCE_MT, EFFECT_MT, FILTER_MT, AUXSLOT_MT,
+    VOICEPOOL_MT, MAPPING_MT, STREAM_MT,
+};
+
+typedef struct {
+    uint64_t live;
+    uint64_t peak;
+    uint64_t created;
+    uint64_t deleted;
+} counters_t;
+
+static counters_t Counters[OBJTYPE_COUNT];
+static uint64_t BufferBytes = 0;    /* bytes currently stored in buffers */
+static uint64_t BufferUploaded = 0; /* total bytes uploaded with buffer_data() */
+
+/* The counters are process-wide, while the rates are computed over the interval since
+ * the previous call of stats() in the same state: each state keeps the values at its
+ * previous call in a snapshot_t, anchored in its registry. */
+typedef struct {
+    double time;
+    uint64_t created[OBJTYPE_COUNT];
+    uint64_t deleted[OBJTYPE_COUNT];
+} snapshot_t;
+
+static int SnapshotKey; /* registry key (its address) */
+
+static snapshot_t *snapshot(lua_State *L)
+    {
+    snapshot_t *s;
+    if(lua_rawgetp(L, LUA_REGISTRYINDEX, &SnapshotKey) == LUA_TUSERDATA)
+        {
+        s = (snapshot_t*)lua_touserdata(L, -1);
+        lua_pop(L, 1);
+        return s;
+        }
+    lua_pop(L, 1);
+    s = (snapshot_t*)lua_newuserdata(L, sizeof(snapshot_t));
+    memset(s, 0, sizeof(snapshot_t));
+    s->time = -1;
+    lua_rawsetp(L, LUA_REGISTRYINDEX, &SnapshotKey);
+    return s;
+    }
+
+static void takesnapshot(snapshot_t *s, double t)
+    {
+    int i;
+    s->time = t;
+    for(i = 0; i < OBJTYPE_COUNT; i++)
+        {
+        s->created[i] = ATOMIC_LOAD(Counters[i].created);
+        s->deleted[i] = ATOMIC_LOAD(Counters[i].deleted);
+        }
+    }
+
+int mttoobjtype(const char *mt)
+    {
+    int i;
+    for(i = 0; i < OBJTYPE_COUNT; i++)
+        if(strcmp(mt, TypeMt[i]) == 0) return i;
+    return -1;
+    }
+
+void stats_created(int type)
+    {
+    counters_t *c;
+    uint64_t live, peak;
+    if(type < 0) return;
+    c = &Counters[type];
+    ATOMIC_ADD(c->created, 1);
+    live = ATOMIC_ADD(c->live, 1);
+    peak = ATOMIC_LOAD(c->peak);
+    while(live > peak && !ATOMIC_CAS(c->peak, peak, live));
+    }
+
+void stats_deleted(int type)
+    {
+    counters_t *c;
+    if(type < 0) return;
+    c = &Counters[type];
+    ATOMIC_ADD(c->deleted, 1);
+    ATOMIC_SUB(c->live, 1);
+    }
+
+void stats_buffer_bytes(size_t oldsize, size_t newsize)
+/* a buffer's content changed from oldsize to newsize bytes */
+    {
+    ATOMIC_SUB(BufferBytes, oldsize);
+    ATOMIC_ADD(BufferBytes, newsize);
+    if(newsize > 0) ATOMIC_ADD(BufferUploaded, newsize);
+    }
+
+static int Stats(lua_State *L)
+    {
+    int i;
+    snapshot_t last;
+    size_t bytes, peak, blocks;
+    uint64_t live = 0, n, created, deleted;
+    snapshot_t *s = snapshot(L);
+    double t = now();
+    double dt = s->time < 0 ? 0 : t - s->time;
+    last = *s;
+    takesnapshot(s, t);
+
+    lua_newtable(L);
+    for(i = 0; i < OBJTYPE_COUNT; i++)
+        {
+        created = s->created[i];
+        deleted = s->deleted[i];
+        n = ATOMIC_LOAD(Counters[i].live);
+        live += n;
+        lua_newtable(L);
+        lua_pushinteger(L, n); lua_setfield(L, -2, "live");
+        lua_pushinteger(L, ATOMIC_LOAD(Counters[i].peak)); lua_setfield(L, -2, "peak");
+        lua_pushinteger(L, created); lua_setfield(L, -2, "created");
+        lua_pushinteger(L, deleted); lua_setfield(L, -2, "deleted");
+        lua_pushnumber(L, dt > 0 ? (created - last.created[i])/dt : 0);
+        lua_setfield(L, -2, "create_rate");
+        lua_pushnumber(L, dt > 0 ? (deleted - last.deleted[i])/dt : 0);
+        lua_setfield(L, -2, "delete_rate");
+        lua_setfield(L, -2, TypeName[i]);
+        }
+    lua_pushinteger(L, ATOMIC_LOAD(BufferBytes)); lua_setfield(L, -2, "buffer_bytes");
+    lua_pushinteger(L, ATOMIC_LOAD(BufferUploaded)); lua_setfield(L, -2, "buffer_bytes_uploaded");
+    malloc_stats(&bytes, &peak, &blocks);
+    lua_pushinteger(L, bytes); lua_setfield(L, -2, "alloc_bytes");
+    lua_pushinteger(L, peak); lua_setfield(L, -2, "alloc_peak");
+    lua_pushinteger(L, blocks); lua_setfield(L, -2, "alloc_blocks");
+    lua_pushinteger(L, live * sizeof(ud_t)); lua_setfield(L, -2, "userdata_bytes");
+    lua_pushnumber(L, load_time); lua_setfield(L, -2, "load_time");
+    return 1;
+    }
+
+static const struct luaL_Reg Functions[] = 
+    {
+        { "stats", Stats },
+        { NULL, NULL } /* sentinel */
+    };
+
+void moonal_open_stats(lua_State *L)
+    {
+    takesnapshot(snapshot(L), now());
+    luaL_setfuncs(L, Functions, 0);
+    }
+
@@ -0,0 +1,547 @@
+/* The MIT License (MIT)
+ *
+ * Copyright (c) 2018 Stefano Trettel
+ *
+ * Software repository: MoonAL, https://github.com/stetre/moonal
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+
+#include "internal.h"
+
+/* Streams: a source fed from a file through a small ring of buffers.
+ *
+ * The file (a WAV file, a compressed file, or raw data in a given format) is read in chunks
+ * of a fixed duration, each one uploaded to one of the stream's buffers and queued on the
+ * source. Compressed files are decoded a chunk at a time (see codec.c).
+ * The script calls update_streams() periodically (say, once per frame): the buffers the
+ * source has finished with are unqueued, refilled with the next chunk, and queued again,
+ * so that only nbuffers chunks of the file are in memory at any time. If the source ran
+ * dry because the updates came too late, it is restarted and the underrun is counted.
+ *
+ * The stream is a child of the source and owns its buffers, which are plain AL buffers
+ * not exposed to the script. Everything is done on the main thread, in update().
+ */
+
+struct moonal_stream_s {
+    FILE *f;
+    char *path;
+    decoder_t *dec;     /* compressed files only */
+    const char *error;  /* decoding failed (a message with a '%s' for the path) */
+    int reported;       /* the error was raised */
+    ALenum format;      /* AL format of the uploaded data */
+    ALsizei freq;
+    int convert;        /* 24 or 32 if the samples are to be converted to float, 0 otherwise */
+    long start;         /* position in the file where the data starts */
+    size_t size;        /* length of the data, in bytes (decoded, and 0 if unknown, if compressed) */
+    size_t pos;         /* read position, relative to start (bytes decoded, if compressed) */
+    size_t chunk;       /* bytes read per buffer (a whole number of frames) */
+    unsigned char *raw; /* read buffer (chunk bytes) */
+    float *conv;        /* conversion buffer (24 bit PCM only) */
+    int loop;
+    int playing;        /* the script wants the source to be playing */
+    int nbuffers;
+    ALuint *buffers;
+    unsigned long chunks;
+    unsigned long underruns;
+};
+
+static void closestream(lua_State *L, stream_t stream)
+    {
+    if(stream->dec) codec_close(stream->dec);
+    if(stream->f) fclose(stream->f);
+    if(stream->path) Free(L, stream->path);
+    if(stream->raw) Free(L, stream->raw);
+    if(stream->conv) Free(L, stream->conv);
+    if(stream->buffers) Free(L, stream->buffers);
+    Free(L, stream);
+    }
+
+/*------------------------------------------------------------------------------*
+ | Queue management (with the source's context current)                         |
+ *------------------------------------------------------------------------------*/
+
+static int seekstart(stream_t stream)
+/* Moves the read position to the start of the data. Returns 0 on success. */
+    {
+    stream->pos = 0;
+    if(stream->dec) return codec_rewind(stream->dec);
+    return fseek(stream->f, stream->start, SEEK_SET);
+    }
+
+static size_t readchunk(stream_t stream)
+/* Reads (or decodes) the next chunk into stream->raw, and returns its size. A decoding
+ * error ends the data, and is recorded in stream->error. */
+    {
+    size_t n, got;
+    const char *errmsg;
+    if(stream->dec)
+        {
+        got = codec_read(stream->dec, stream->raw, stream->chunk, &errmsg);
+        if(errmsg && !stream->error) stream->error = errmsg;
+        }
+    else
+        {
+        n = stream->size - stream->pos;
+        if(n > stream->chunk) n = stream->chunk;
+        if(n == 0) return 0;
+        got = fread(stream->raw, 1, n, stream->f);
+        if(got < n) /* truncated file: end the data here */
+            stream->size = stream->pos + got;
+        }
+    stream->pos += got;
+    return got;
+    }
+
+static int fill(stream_t stream, ALuint buffer)
+/* Uploads the next chunk to the buffer, wrapping around at the end of the data if the
+ * stream loops. Returns 0 if there is nothing left to read (or the data is corrupt). */
+    {
+    const void *data = stream->raw;
+    size_t got = readchunk(stream);
+    if(got == 0 && stream->loop && stream->pos > 0 && !stream->error)
+        {
+        if(seekstart(stream) != 0) return 0;
+        got = readchunk(stream);
+        }
+    if(got == 0) return 0;
+    if(stream->convert)
+        {
+        float *dst = stream->convert == 32 ? (float*)stream->raw : stream->conv;
+        got = loader_tofloat(stream->raw, got, stream->convert, dst);
+        data = dst;
+        }
+    al.BufferData(buffer, stream->format, data, (ALsizei)got, stream->freq);
+    stream->chunks++;
+    return 1;
+    }
+
+static int prime(stream_t stream, ALuint source)
+/* Fills and queues the stream's buffers from the current read position. The source's
+ * queue is expected to be empty. Returns the number of buffers queued. */
+    {
+    int i;
+    for(i = 0; i < stream->nbuffers; i++)
+        {
+        if(!fill(stream, stream->buffers[i])) break;
+        al.SourceQueueBuffers(source, 1, &stream->buffers[i]);
+        }
+    return i;
+    }
+
+static void rewind_(stream_t stream, ALuint source)
+/* Stops the source, detaches its queue, and refills it from the start of the data. */
+    {
+    al.SourceStop(source);
+    al.Sourcei(source, AL_BUFFER, 0);
+    if(seekstart(stream) != 0) stream->pos = stream->size;
+    prime(stream, source);
+    }
+
+static int update(stream_t stream, ALuint source)
+/* Refills and requeues the processed buffers, and restarts the source after an
+ * underrun. Returns the number of buffers refilled. */
+    {
+    ALint processed = 0, queued = 0, state = AL_STOPPED;
+    ALuint buffer;
+    int count = 0;
+    al.GetSourcei(source, AL_BUFFERS_PROCESSED, &processed);
+    while(processed-- > 0)
+        {
+        al.SourceUnqueueBuffers(source, 1, &buffer);
+        if(!fill(stream, buffer)) continue; /* end of data: leave it idle */
+        al.SourceQueueBuffers(source, 1, &buffer);
+        count++;
+        }
+    if(!stream->playing) return count;
+    al.GetSourcei(source, AL_SOURCE_STATE, &state);
+    if(state == AL_PLAYING || state == AL_PAUSED) return count;
+    al.GetSourcei(source, AL_BUFFERS_QUEUED, &queued);
+    if(queued > 0)
+        {
+        al.SourcePlay(source);
+        stream->underruns++;
+        }
+    else
+        stream->playing = 0; /* played to the end */
+    return count;
+    }
+
+static int raiseerror(lua_State *L, stream_t stream)
+/* Raises the decoding error of the stream, the first time it is seen */
+    {
+    stream->reported = 1;
+    return luaL_error(L, stream->error, stream->path);
+    }
+
+#define Unreported(stream) ((stream)->error && !(stream)->reported)
+
+/*------------------------------------------------------------------------------*
+ | Creation and deletion                                                        |
+ *------------------------------------------------------------------------------*/
+
+static int freestream(lua_State *L, ud_t *ud)
+    {
+    stream_t stream = (stream_t)ud->handle;
+    ud_t *source_ud = (ud_t*)ud->parent_ud;
+    ALuint source = ((source_t)source_ud->handle)->name;
+    context_t old_context;
+    if(!freeuserdata(L, ud)) return 0;
+    TRACE_DELETE(stream, "stream");
+    old_context = alc.GetCurrentContext();
+    if(old_context != ud->context) set_current_context(ud->context);
+    al.SourceStop(source);
+    al.Sourcei(source, AL_BUFFER, 0);
+    al.DeleteBuffers(stream->nbuffers, stream->buffers);
+    (void)al.GetError();
+    if(old_context != ud->context) set_current_context(old_context);
+    closestream(L, stream);
+    return 0;
+    }
+
+static int findstream(lua_State *L, const void *mem, const char *mt, const void *info)
+/* callback for udata_scan: stops at the first valid stream of the source */
+    {
+    const ud_t *ud = (const ud_t*)mem;
+    (void)L; (void)mt;
+    return IsValid(ud) && ud->parent_ud == info;
+    }
+
+int stream_open(lua_State *L)
+/* stream = open_stream(source, filename, [opts]) */
+    {
+    int err, nbuffers = 4, loop = 0;
+    ud_t *ud, *source_ud;
+    ALenum ec, format = 0;
+    ALsizei freq = 0;
+    long offset = 0, length = -1;
+    double duration = 0.25;
+    size_t framesize = 0, frames;
+    const char *errmsg;
+    context_t old_context;
+    stream_t stream;
+    source_t source = checksource(L, 1, &source_ud);
+    const char *path = luaL_checkstring(L, 2);
+    TRACE_CALL_START;
+    if(!lua_isnoneornil(L, 3))
+        {
+        luaL_checktype(L, 3, LUA_TTABLE);
+        if(lua_getfield(L, 3, "format") != LUA_TNIL)
+            {
+            format = testformat(L, -1, &err);
+            if(err) return luaL_argerror(L, 3, "invalid field 'format'");
+            framesize = formatframesize(L, format, 0);
+            }
+        lua_pop(L, 1);
+        freq = (ALsizei)optfield(L, 3, "frequency", 0);
+        if(format && freq == 0)
+            return luaL_argerror(L, 3, "missing field 'frequency'");
+        offset = optfield(L, 3, "offset", 0);
+        length = optfield(L, 3, "length", -1);
+        nbuffers = (int)optfield(L, 3, "buffers", nbuffers);
+        if(nbuffers < 2 || nbuffers > 64)
+            return luaL_argerror(L, 3, "invalid field 'buffers'");
+        if(lua_getfield(L, 3, "duration") != LUA_TNIL)
+            {
+            duration = lua_tonumber(L, -1);
+            if(!(duration > 0 && duration <= 10))
+                return luaL_argerror(L, 3, "invalid field 'duration'");
+            }
+        lua_pop(L, 1);
+        lua_getfield(L, 3, "loop");
+        loop = lua_toboolean(L, -1);
+        lua_pop(L, 1);
+        }
+    if(udata_scan(L, STREAM_MT, source_ud, findstream))
+        return luaL_argerror(L, 1, "source already has a stream");
+
+    stream = (stream_t)Malloc(L, sizeof(struct moonal_stream_s));
+    stream->f = fopen(path, "rb");
+    if(!stream->f)
+        { closestream(L, stream); return luaL_error(L, "cannot open '%s'", path); }
+    if(fseek(stream->f, offset, SEEK_SET) != 0)
+        { closestream(L, stream); return luaL_error(L, "cannot seek '%s'", path); }
+    if(format)
+        {
+        stream->format = format;
+        stream->freq = freq;
+        if(length < 0)
+            {
+            if(fseek(stream->f, 0, SEEK_END) != 0 || (length = ftell(stream->f) - offset) < 0 ||
+               fseek(stream->f, offset, SEEK_SET) != 0)
+                { closestream(L, stream); return luaL_error(L, "cannot seek '%s'", path); }
+            }
+        stream->size = (size_t)length;
+        }
+    else if(codec_probe(stream->f))
+        {
+        stream->dec = codec_open(stream->f, length, &stream->format, &stream->freq,
+                    &stream->size, &errmsg);
+        if(!stream->dec)
+            { closestream(L, stream); return luaL_error(L, errmsg, path); }
+        framesize = formatframesize(L, stream->format, 0);
+        }
+    else
+        {
+        errmsg = loader_wavheader(stream->f, &stream->format, &stream->freq,
+                    &stream->size, &framesize, &stream->convert);
+        if(errmsg)
+            { closestream(L, stream); return luaL_error(L, errmsg, path); }
+        }
+    stream->start = ftell(stream->f);
+    stream->loop = loop;
+    frames = (size_t)(duration * stream->freq);
+    stream->chunk = (frames > 0 ? frames : 1) * framesize;
+    stream->nbuffers = nbuffers;
+    stream->raw = (unsigned char*)MallocNoErr(L, stream->chunk);
+    stream->buffers = (ALuint*)MallocNoErr(L, nbuffers * sizeof(ALuint));
+    stream->path = (char*)MallocNoErr(L, strlen(path) + 1);
+    if(stream->convert == 24)
+        stream->conv = (float*)MallocNoErr(L, stream->chunk / 3 * sizeof(float));
+    if(!stream->raw || !stream->buffers || !stream->path || (stream->convert == 24 && !stream->conv))
+        { closestream(L, stream); return luaL_error(L, errstring(ERR_MEMORY)); }
+    strcpy(stream->path, path);
+
+    old_context = current_context(L);
+    make_context_current(L, source_ud->context);
+    al.GenBuffers(nbuffers, stream->buffers);
+    if((ec = al.GetError()) != AL_NO_ERROR)
+        {
+        make_context_current(L, old_context);
+        Free(L, stream->buffers); stream->buffers = NULL;
+        closestream(L, stream);
+        pushalerror(L, ec);
+        return lua_error(L);
+        }
+    al.Sourcei(source->name, AL_BUFFER, 0); /* fails if the source is playing or paused */
+    if((ec = al.GetError()) == AL_NO_ERROR)
+        {
+        prime(stream, source->name);
+        ec = al.GetError();
+        }
+    if(ec != AL_NO_ERROR || stream->error)
+        {
+        al.Sourcei(source->name, AL_BUFFER, 0);
+        al.DeleteBuffers(nbuffers, stream->buffers);
+        (void)al.GetError();
+        make_context_current(L, old_context);
+        if(ec == AL_NO_ERROR)
+            {
+            lua_pushfstring(L, stream->error, path);
+            closestream(L, stream);
+            return lua_error(L);
+            }
+        closestream(L, stream);
+        pushalerror(L, ec);
+        return lua_error(L);
+        }
+    make_context_current(L, old_context);
+
+    ud = newuserdata(L, stream, STREAM_MT);
+    ud->context = source_ud->context;
+    ud->device = source_ud->device;
+    ud->parent_ud = source_ud;
+    ud->destructor = freestream;
+    ud->ddt = source_ud->ddt;
+    ud->cdt = source_ud->cdt;
+    TRACE_CREATE(stream, "stream");
+    TRACE_CALL_STOP("open_stream", source, stream->chunk);
+    return 1;
+    }
+
+/*------------------------------------------------------------------------------*
+ | Control                                                                      |
+ *------------------------------------------------------------------------------*/
+
+#define SOURCENAME(ud) (((source_t)((ud_t*)(ud)->parent_ud)->handle)->name)
+
+static int Play(lua_State *L)
+/* stream:play() */
+    {
+    ud_t *ud;
+    ALint queued = 0;
+    stream_t stream = checkstream(L, 1, &ud);
+    ALuint source = SOURCENAME(ud);
+    context_t old_context = current_context(L);
+    make_context_current(L, ud->context);
+    al.GetSourcei(source, AL_BUFFERS_QUEUED, &queued);
+    if(queued == 0) rewind_(stream, source); /* played to the end: start over */
+    al.SourcePlay(source);
+    stream->playing = 1;
+    CheckErrorRestoreAl(L, old_context);
+    make_context_current(L, old_context);
+    return 0;
+    }
+
+static int Stop(lua_State *L)
+/* stream:stop() */
+    {
+    ud_t *ud;
+    stream_t stream = checkstream(L, 1, &ud);
+    context_t old_context = current_context(L);
+    make_context_current(L, ud->context);
+    stream->playing = 0;
+    rewind_(stream, SOURCENAME(ud));
+    CheckErrorRestoreAl(L, old_context);
+    make_context_current(L, old_context);
+    return 0;
+    }
+
+static int Update(lua_State *L)
+/* count, playing = stream:update() */
+    {
+    ud_t *ud;
+    int count;
+    stream_t stream = checkstream(L, 1, &ud);
+    context_t old_context = current_context(L);
+    make_context_current(L, ud->context);
+    count = update(stream, SOURCENAME(ud));
+    CheckErrorRestoreAl(L, old_context);
+    make_context_current(L, old_context);
+    if(Unreported(stream)) return raiseerror(L, stream);
+    lua_pushinteger(L, count);
+    lua_pushboolean(L, stream->playing);
+    return 2;
+    }
+
+typedef struct {
+    ud_t *context_ud;
+    int count;
+    int nstreams;
+    stream_t failed;    /* the first stream with an unreported decoding error */
+} updateinfo_t;
+
+static int updateifchild(lua_State *L, const void *mem, const char *mt, const void *info)
+/* callback for udata_scan */
+    {
+    ud_t *ud = (ud_t*)mem;
+    updateinfo_t *p = (updateinfo_t*)info;
+    (void)L; (void)mt;
+    if(IsValid(ud) && ((ud_t*)ud->parent_ud)->parent_ud == p->context_ud)
+        {
+        p->count += update((stream_t)ud->handle, SOURCENAME(ud));
+        p->nstreams++;
+        if(!p->failed && Unreported((stream_t)ud->handle)) p->failed = (stream_t)ud->handle;
+        }
+    return 0;
+    }
+
+int stream_updateall(lua_State *L)
+/* count, nstreams = update_streams(context) */
+    {
+    updateinfo_t info;
+    context_t context = checkcontext(L, 1, &info.context_ud);
+    context_t old_context = current_context(L);
+    TRACE_CALL_START;
+    info.count = info.nstreams = 0;
+    info.failed = NULL;
+    make_context_current(L, context);
+    udata_scan(L, STREAM_MT, &info, updateifchild);
+    CheckErrorRestoreAl(L, old_context);
+    make_context_current(L, old_context);
+    if(info.failed) return raiseerror(L, info.failed);
+    TRACE_CALL_STOP("update_streams", context, info.count);
+    lua_pushinteger(L, info.count);
+    lua_pushinteger(L, info.nstreams);
+    return 2;
+    }
+
+static int Info(lua_State *L)
+/* info = stream:info() */
+    {
+    ud_t *ud;
+    ALint queued = 0;
+    stream_t stream = checkstream(L, 1, &ud);
+    context_t old_context = current_context(L);
+    make_context_current(L, ud->context);
+    al.GetSourcei(SOURCENAME(ud), AL_BUFFERS_QUEUED, &queued);
+    CheckErrorRestoreAl(L, old_context);
+    make_context_current(L, old_context);
+    lua_newtable(L);
+    pushformat(L, stream->format); lua_setfield(L, -2, "format");
+    lua_pushinteger(L, stream->freq); lua_setfield(L, -2, "frequency");
+    lua_pushinteger(L, stream->size); lua_setfield(L, -2, "length");
+    lua_pushinteger(L, stream->pos); lua_setfield(L, -2, "position");
+    lua_pushinteger(L, stream->chunk); lua_setfield(L, -2, "chunk");
+    lua_pushinteger(L, stream->nbuffers); lua_setfield(L, -2, "buffers");
+    lua_pushinteger(L, queued); lua_setfield(L, -2, "queued");
+    lua_pushinteger(L, stream->chunks); lua_setfield(L, -2, "chunks");
+    lua_pushinteger(L, stream->underruns); lua_setfield(L, -2, "underruns");
+    lua_pushboolean(L, stream->loop); lua_setfield(L, -2, "loop");
+    lua_pushboolean(L, stream->playing); lua_setfield(L, -2, "playing");
+    if(stream->error)
+        { lua_pushfstring(L, stream->error, stream->path); lua_setfield(L, -2, "error"); }
+    return 1;
+    }
+
+static int SetLoop(lua_State *L)
+/* stream:set_loop(boolean) */
+    {
+    stream_t stream = checkstream(L, 1, NULL);
+    stream->loop = lua_toboolean(L, 2);
+    return 0;
+    }
+
+RAW_FUNC(stream)
+TYPE_FUNC(stream)
+PARENT_FUNC(stream)
+DELETE_FUNC(stream)
+
+static const struct luaL_Reg Methods[] =
+    {
+        { "raw", Raw },
+        { "type", Type },
+        { "parent", Parent },
+        { "delete", Delete },
+        { "close", Delete },
+        { "play", Play },
+        { "stop", Stop },
+        { "update", Update },
+        { "info", Info },
+        { "set_loop", SetLoop },
+        { NULL, NULL } /* sentinel */
+    };
+
+static const struct luaL_Reg MetaMethods[] =
+    {
+        { "__gc",  Delete },
+        { NULL, NULL } /* sentinel */
+    };
+
+static const struct luaL_Reg Functions[] =
+    {
+        { "open_stream", stream_open },
+        { "close_stream", Delete },
+        { "stream_play", Play },
+        { "stream_stop", Stop },
+        { "stream_update", Update },
+        { "stream_info", Info },
+        { "stream_set_loop", SetLoop },
+        { "update_streams", stream_updateall },
+        { NULL, NULL } /* sentinel */
+    };
+
+
+void moonal_open_stream(lua_State *L)
+    {
+    udata_define(L, STREAM_MT, Methods, MetaMethods);
+    luaL_setfuncs(L, Functions, 0);
+    }
+
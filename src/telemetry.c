@@ -0,0 +1,455 @@
+/* The MIT License (MIT)
+ *
+ * Copyright (c) 2018 Stefano Trettel
+ *
+ * Software repository: MoonAL, https://github.com/stetre/moonal
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+
+#include "internal.h"
+#include <pthread.h>
+#include <time.h>
+#include <math.h>
+
+/*------------------------------------------------------------------------------*
+ | Clock and latency telemetry                                                  |
+ *------------------------------------------------------------------------------*/
+
+/* start_telemetry() starts a per-context sampler thread (see ctxinfo_t) that, at a fixed
+ * rate, reads the device clock and output latency (ALC_DEVICE_CLOCK_LATENCY_SOFT) and the
+ * playback offsets of a set of sources (AL_SEC_OFFSET_LATENCY_SOFT), and stores them in a
+ * ring of samples, together with the time of the monotonic clock.
+ *
+ * The statistics are computed on the owning thread, on a copy of the ring, by
+ * telemetry_stats(): the drift is the deviation of the device clock's rate from that of
+ * the monotonic clock (least squares fit), and the jitter is the RMS deviation of the
+ * device clock from the fitted line. The jitter thus reflects the granularity of the
+ * device clock, which typically advances one mixing period at a time.
+ *
+ * The ring is shared with the sampler, so it is allocated with malloc() and accessed
+ * under the telemetry's lock. Sampled sources are marked as 'Sampled', so that they are
+ * removed from the set if they are deleted while the sampler is running.
+ */
+
+#define DEFAULT_CAPACITY 1024
+#define MAX_CAPACITY (1024*1024)
+#define MAX_RATE 10000
+
+typedef struct {
+    double time;            /* monotonic clock (seconds) */
+    ALCint64SOFT clock;     /* device clock (nanoseconds) */
+    ALCint64SOFT latency;   /* output latency (nanoseconds) */
+} tsample_t;
+
+struct moonal_telemetry_s {
+    pthread_t thread;
+    pthread_mutex_t lock;
+    pthread_cond_t wake;
+    int stop;
+    context_t context;
+    device_t device;
+    LPALCGETINTEGER64VSOFT GetInteger64vSOFT;
+    LPALGETSOURCEDVSOFT GetSourcedvSOFT;
+    int64_t period;         /* nanoseconds */
+    uint64_t total;         /* samples taken since the start */
+    uint64_t overruns;      /* sampling times missed */
+    size_t capacity;
+    size_t count;           /* samples in the ring */
+    size_t next;            /* next slot to write */
+    tsample_t *ring;
+    uint32_t nsources;
+    ALuint *names;          /* sampled sources (0 if deleted) */
+    double *offsets;        /* capacity x nsources offsets (seconds) */
+};
+
+#define TELEMETRY(context_ud) (CTXINFO(context_ud)->telemetry)
+
+static double monotonic(struct timespec *ts)
+    {
+    clock_gettime(CLOCK_MONOTONIC, ts);
+    return ts->tv_sec + ts->tv_nsec*1.0e-9;
+    }
+
+static void takesample(telemetry_t *t)
+/* the lock must be held */
+    {
+    uint32_t i;
+    struct timespec ts;
+    ALCint64SOFT values[2];
+    ALdouble offset[2];
+    tsample_t *sample = &t->ring[t->next];
+    double *offsets = &t->offsets[t->next * t->nsources];
+    t->GetInteger64vSOFT(t->device, ALC_DEVICE_CLOCK_LATENCY_SOFT, 2, values);
+    sample->time = monotonic(&ts);
+    sample->clock = values[0];
+    sample->latency = values[1];
+    for(i = 0; i < t->nsources; i++)
+        {
+        if(t->names[i] == 0) { offsets[i] = NAN; continue; }
+        t->GetSourcedvSOFT(t->names[i], AL_SEC_OFFSET_LATENCY_SOFT, offset);
+        offsets[i] = offset[0];
+        }
+    t->next = (t->next + 1) % t->capacity;
+    if(t->count < t->capacity) t->count++;
+    t->total++;
+    }
+
+static void *Sampler(void *arg)
+    {
+    telemetry_t *t = (telemetry_t*)arg;
+    struct timespec due, now;
+    int64_t late;
+    if(t->nsources > 0) alc.SetThreadContext(t->context);
+    clock_gettime(CLOCK_MONOTONIC, &due);
+    pthread_mutex_lock(&t->lock);
+    while(!t->stop)
+        {
+        takesample(t);
+        tsadd(&due, t->period);
+        clock_gettime(CLOCK_MONOTONIC, &now);
+        late = tsdiff(&now, &due);
+        if(late > 0)
+            { /* skip the missed sampling times */
+            t->overruns += late / t->period + 1;
+            tsadd(&due, (late / t->period + 1) * t->period);
+            }
+        while(!t->stop && pthread_cond_timedwait(&t->wake, &t->lock, &due) == 0);
+        }
+    pthread_mutex_unlock(&t->lock);
+    if(t->nsources > 0) alc.SetThreadContext(NULL);
+    return NULL;
+    }
+
+static void freetelemetry(telemetry_t *t)
+    {
+    pthread_cond_destroy(&t->wake);
+    pthread_mutex_destroy(&t->lock);
+    free(t->ring);
+    free(t->names);
+    free(t->offsets);
+    free(t);
+    }
+
+static void stop(ud_t *context_ud)
+    {
+    uint32_t i;
+    ud_t *ud;
+    telemetry_t *t = TELEMETRY(context_ud);
+    if(!t) return;
+    pthread_mutex_lock(&t->lock);
+    t->stop = 1;
+    pthread_cond_signal(&t->wake);
+    pthread_mutex_unlock(&t->lock);
+    pthread_join(t->thread, NULL);
+    for(i = 0; i < t->nsources; i++)
+        if(t->names[i] && (ud = spatial_source(context_ud, t->names[i])))
+            CancelSampled(ud);
+    freetelemetry(t);
+    TELEMETRY(context_ud) = NULL;
+    }
+
+void telemetry_forget(lua_State *L, ud_t *ud)
+/* called when a sampled source is deleted */
+    {
+    uint32_t i;
+    telemetry_t *t = ud->parent_ud ? TELEMETRY((ud_t*)ud->parent_ud) : NULL;
+    ALuint name = ((source_t)ud->handle)->name;
+    (void)L;
+    CancelSampled(ud);
+    if(!t) return;
+    pthread_mutex_lock(&t->lock);
+    for(i = 0; i < t->nsources; i++)
+        if(t->names[i] == name) t->names[i] = 0;
+    pthread_mutex_unlock(&t->lock);
+    }
+
+void telemetry_free(lua_State *L, ud_t *context_ud)
+/* called by freecontext() */
+    {
+    (void)L;
+    stop(context_ud);
+    }
+
+/*------------------------------------------------------------------------------*
+ | Lua functions                                                                |
+ *------------------------------------------------------------------------------*/
+
+int telemetry_start(lua_State *L)
+/* start_telemetry(context, rate, [{source}], [capacity]) */
+    {
+    int err;
+    uint32_t i, count = 0;
+    ud_t *ud;
+    source_t *sources = NULL;
+    telemetry_t *t;
+    pthread_condattr_t attr;
+    context_t context = checkcontext(L, 1, &ud);
+    lua_Number rate = luaL_checknumber(L, 2);
+    lua_Integer capacity = luaL_optinteger(L, 4, DEFAULT_CAPACITY);
+    if(!(rate > 0) || rate > MAX_RATE)
+        return luaL_argerror(L, 2, errstring(ERR_VALUE));
+    if(capacity < 2 || capacity > MAX_CAPACITY)
+        return luaL_argerror(L, 4, errstring(ERR_VALUE));
+    CheckDevicePfn(L, ud, GetInteger64vSOFT);
+    if(!lua_isnoneornil(L, 3))
+        {
+        CheckContextPfn(L, ud, GetSourcedvSOFT);
+        if(!alc.SetThreadContext)
+            return luaL_error(L, "cannot sample sources (ALC_EXT_thread_local_context not available)");
+        sources = checksourcelist(L, 3, &count, &err);
+        if(err) return luaL_argerror(L, 3, errstring(err));
+        if((size_t)capacity > SIZE_MAX / sizeof(double) / count) /* count x capacity offsets */
+            { Free(L, sources); return luaL_argerror(L, 4, errstring(ERR_VALUE)); }
+        }
+    stop(ud); /* restart, if already running */
+
+    t = (telemetry_t*)calloc(1, sizeof(telemetry_t));
+    if(t)
+        {
+        t->ring = (tsample_t*)malloc(capacity * sizeof(tsample_t));
+        t->names = (ALuint*)malloc((count > 0 ? count : 1) * sizeof(ALuint));
+        t->offsets = (double*)malloc((count > 0 ? count * capacity : 1) * sizeof(double));
+        }
+    if(!t || !t->ring || !t->names || !t->offsets)
+        {
+        if(t) { free(t->ring); free(t->names); free(t->offsets); free(t); }
+        if(sources) Free(L, sources);
+        return luaL_error(L, errstring(ERR_MEMORY));
+        }
+    t->context = context;
+    t->device = ud->device;
+    t->GetInteger64vSOFT = ud->ddt->GetInteger64vSOFT;
+    t->GetSourcedvSOFT = ud->cdt->GetSourcedvSOFT;
+    t->period = (int64_t)(1.0e9 / rate);
+    t->capacity = capacity;
+    t->nsources = count;
+    for(i = 0; i < count; i++)
+        {
+        t->names[i] = sources[i]->name;
+        MarkSampled(userdata(L, sources[i]));
+        }
+    if(sources) Free(L, sources);
+    pthread_mutex_init(&t->lock, NULL);
+    pthread_condattr_init(&attr);
+    pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+    pthread_cond_init(&t->wake, &attr);
+    pthread_condattr_destroy(&attr);
+    TELEMETRY(ud) = t;
+    if(pthread_create(&t->thread, NULL, Sampler, t) != 0)
+        {
+        TELEMETRY(ud) = NULL;
+        freetelemetry(t);
+        return luaL_error(L, "cannot start the sampler thread");
+        }
+    return 0;
+    }
+
+int telemetry_stop(lua_State *L)
+/* stop_telemetry(context) */
+    {
+    ud_t *ud;
+    checkcontext(L, 1, &ud);
+    stop(ud);
+    return 0;
+    }
+
+static tsample_t *snapshot(lua_State *L, telemetry_t *t, size_t max, size_t *count, double **offsets)
+/* copies the last max samples (and their offsets) in chronological order */
+    {
+    size_t i, first, n;
+    tsample_t *samples;
+    pthread_mutex_lock(&t->lock);
+    n = t->count < max ? t->count : max;
+    samples = (tsample_t*)MallocNoErr(L, (n > 0 ? n : 1) * sizeof(tsample_t));
+    *offsets = (double*)MallocNoErr(L, (n * t->nsources > 0 ? n * t->nsources : 1) * sizeof(double));
+    if(!samples || !*offsets)
+        {
+        pthread_mutex_unlock(&t->lock);
+        if(samples) Free(L, samples);
+        if(*offsets) Free(L, *offsets);
+        luaL_error(L, errstring(ERR_MEMORY));
+        return NULL;
+        }
+    first = (t->next + t->capacity - n) % t->capacity;
+    for(i = 0; i < n; i++)
+        {
+        samples[i] = t->ring[(first + i) % t->capacity];
+        memcpy(*offsets + i * t->nsources, t->offsets + ((first + i) % t->capacity) * t->nsources,
+                    t->nsources * sizeof(double));
+        }
+    pthread_mutex_unlock(&t->lock);
+    *count = n;
+    return samples;
+    }
+
+static int cmpdouble(const void *a, const void *b)
+    {
+    double x = *(const double*)a, y = *(const double*)b;
+    return x < y ? -1 : x > y;
+    }
+
+static double percentile(const double *sorted, size_t n, double p)
+/* nearest rank */
+    {
+    size_t rank = (size_t)ceil(p * n);
+    return sorted[rank > 0 ? rank - 1 : 0];
+    }
+
+int telemetry_stats(lua_State *L)
+/* stats = telemetry_stats(context) */
+    {
+    ud_t *ud;
+    size_t i, n;
+    uint32_t k;
+    tsample_t *samples;
+    double *offsets, *lat;
+    double x, y, sx = 0, sy = 0, sxx = 0, sxy = 0, slope, icpt, r, sum = 0, max = 0;
+    telemetry_t *t;
+    checkcontext(L, 1, &ud);
+    t = TELEMETRY(ud);
+    lua_newtable(L);
+    lua_pushboolean(L, t != NULL); lua_setfield(L, -2, "running");
+    if(!t) return 1;
+    samples = snapshot(L, t, t->capacity, &n, &offsets);
+    lua_pushnumber(L, 1.0e9 / t->period); lua_setfield(L, -2, "rate");
+    pthread_mutex_lock(&t->lock);
+    lua_pushinteger(L, t->total); lua_setfield(L, -2, "total");
+    lua_pushinteger(L, t->overruns); lua_setfield(L, -2, "overruns");
+    pthread_mutex_unlock(&t->lock);
+    lua_pushinteger(L, n); lua_setfield(L, -2, "samples");
+    if(n > 0)
+        { lua_pushnumber(L, samples[n-1].time - samples[0].time); lua_setfield(L, -2, "window"); }
+
+    if(n >= 2)
+        {
+        /* least squares fit of the device clock against the monotonic clock,
+         * with both relative to the first sample to preserve precision */
+        for(i = 0; i < n; i++)
+            {
+            x = samples[i].time - samples[0].time;
+            y = (samples[i].clock - samples[0].clock) * 1.0e-9;
+            sx += x; sy += y; sxx += x*x; sxy += x*y;
+            }
+        if(n*sxx - sx*sx > 0)
+            {
+            slope = (n*sxy - sx*sy) / (n*sxx - sx*sx);
+            icpt = (sy - slope*sx) / n;
+            for(i = 0; i < n; i++)
+                {
+                x = samples[i].time - samples[0].time;
+                r = (samples[i].clock - samples[0].clock) * 1.0e-9 - (icpt + slope*x);
+                sum += r*r;
+                if(fabs(r) > max) max = fabs(r);
+                }
+            lua_pushnumber(L, (slope - 1.0) * 1.0e6); lua_setfield(L, -2, "drift");
+            lua_pushnumber(L, sqrt(sum / n)); lua_setfield(L, -2, "jitter");
+            lua_pushnumber(L, max); lua_setfield(L, -2, "jitter_max");
+            }
+        }
+
+    if(n > 0)
+        {
+        lat = (double*)MallocNoErr(L, n * sizeof(double));
+        if(!lat)
+            { Free(L, samples); Free(L, offsets); return luaL_error(L, errstring(ERR_MEMORY)); }
+        sum = 0;
+        for(i = 0; i < n; i++)
+            { lat[i] = samples[i].latency * 1.0e-9; sum += lat[i]; }
+        qsort(lat, n, sizeof(double), cmpdouble);
+        lua_newtable(L);
+        lua_pushnumber(L, lat[0]); lua_setfield(L, -2, "min");
+        lua_pushnumber(L, sum / n); lua_setfield(L, -2, "mean");
+        lua_pushnumber(L, percentile(lat, n, 0.50)); lua_setfield(L, -2, "p50");
+        lua_pushnumber(L, percentile(lat, n, 0.90)); lua_setfield(L, -2, "p90");
+        lua_pushnumber(L, percentile(lat, n, 0.99)); lua_setfield(L, -2, "p99");
+        lua_pushnumber(L, lat[n-1]); lua_setfield(L, -2, "max");
+        lua_setfield(L, -2, "latency");
+        Free(L, lat);
+
+        /* last offsets of the sampled sources */
+        lua_newtable(L);
+        for(k = 0; k < t->nsources; k++)
+            {
+            if(isnan(offsets[(n-1) * t->nsources + k])) continue;
+            lua_pushnumber(L, offsets[(n-1) * t->nsources + k]);
+            lua_rawseti(L, -2, k+1);
+            }
+        lua_setfield(L, -2, "offsets");
+        }
+    Free(L, samples);
+    Free(L, offsets);
+    return 1;
+    }
+
+int telemetry_samples(lua_State *L)
+/* {sample} = telemetry_samples(context, [max]) */
+    {
+    ud_t *ud;
+    size_t i, n;
+    uint32_t k;
+    tsample_t *samples;
+    double *offsets;
+    telemetry_t *t;
+    lua_Integer max;
+    checkcontext(L, 1, &ud);
+    max = luaL_optinteger(L, 2, -1);
+    t = TELEMETRY(ud);
+    lua_newtable(L);
+    if(!t) return 1;
+    samples = snapshot(L, t, max < 0 ? t->capacity : (size_t)max, &n, &offsets);
+    for(i = 0; i < n; i++)
+        {
+        lua_newtable(L);
+        lua_pushnumber(L, samples[i].time); lua_setfield(L, -2, "time");
+        lua_pushinteger(L, samples[i].clock); lua_setfield(L, -2, "clock");
+        lua_pushinteger(L, samples[i].latency); lua_setfield(L, -2, "latency");
+        if(t->nsources > 0)
+            {
+            lua_newtable(L);
+            for(k = 0; k < t->nsources; k++)
+                {
+                if(isnan(offsets[i * t->nsources + k])) continue;
+                lua_pushnumber(L, offsets[i * t->nsources + k]);
+                lua_rawseti(L, -2, k+1);
+                }
+            lua_setfield(L, -2, "offsets");
+            }
+        lua_rawseti(L, -2, i+1);
+        }
+    Free(L, samples);
+    Free(L, offsets);
+    return 1;
+    }
+
+static const struct luaL_Reg Functions[] =
+    {
+        { "start_telemetry", telemetry_start },
+        { "stop_telemetry", telemetry_stop },
+        { "telemetry_stats", telemetry_stats },
+        { "telemetry_samples", telemetry_samples },
+        { NULL, NULL } /* sentinel */
+    };
+
+void moonal_open_telemetry(lua_State *L)
+    {
+    luaL_setfuncs(L, Functions, 0);
+    }
+
@@ -23,7 +23,18 @@
  * SOFTWARE.
  */
 
+#if defined(LINUX)
+#define _GNU_SOURCE /* see man syscall(2) */
+#endif
 #include "internal.h"
+#include <stdio.h>
+#include <pthread.h>
+#if defined(LINUX)
+#include <unistd.h>
+#include <sys/syscall.h>
+#elif defined(MINGW)
+#include <windows.h>
+#endif
     
 static int Type(lua_State *L)
     {
@@ -44,10 +55,188 @@ int trace_objects = 0;
 
 static int TraceObjects(lua_State *L)
     {
-    trace_objects = checkboolean(L, 1);
+    ATOMIC_RELEASE(trace_objects, checkboolean(L, 1));
     return 0;
     }
 
+/*------------------------------------------------------------------------------*
+ | Call tracing (Chrome trace-event format)                                     |
+ *------------------------------------------------------------------------------*/
+
+/* Events are recorded in a ring preallocated by trace_begin(), so that tracing
+ * does not allocate in the traced calls. If the ring wraps, the oldest events
+ * are overwritten. The ring is written out to file by trace_end().
+ *
+ * Tracing is process-wide, and events may come from states in other threads: the
+ * ring and its lifecycle are guarded by TraceLock, and an event that comes after
+ * trace_end() (by a thread that saw trace_calls still set) is simply dropped.
+ */
+
+typedef struct {
+    const char *name; /* static string */
+    char ph; /* 'X' = complete event, 'i' = instant event */
+    double ts; /* start time (seconds, as from now()) */
+    double dur; /* duration (seconds) */
+    uint64_t tid; /* thread id */
+    uint64_t id; /* object handle */
+    double arg;
+} trace_event_t;
+
+int trace_calls = 0;
+static pthread_mutex_t TraceLock = PTHREAD_MUTEX_INITIALIZER;
+static lua_State *RingL = NULL; /* the state that started tracing (owns the ring) */
+static trace_event_t *Ring = NULL;
+static size_t RingSize = 0;
+static size_t RingCount = 0; /* total no. of recorded events (may exceed RingSize) */
+static double RingT0 = 0;
+static FILE *TraceFile = NULL;
+
+static uint64_t threadid(void)
+    {
+#if defined(LINUX)
+    return (uint64_t)syscall(SYS_gettid);
+#elif defined(MINGW)
+    return (uint64_t)GetCurrentThreadId();
+#else
+    return 0;
+#endif
+    }
+
+static void traceevent(const char *name, char ph, double ts, double dur, uint64_t id, double arg)
+    {
+    trace_event_t *ev;
+    uint64_t tid = threadid();
+    pthread_mutex_lock(&TraceLock);
+    if(!Ring)
+        { pthread_mutex_unlock(&TraceLock); return; }
+    ev = &Ring[RingCount++ % RingSize];
+    ev->name = name;
+    ev->ph = ph;
+    ev->ts = ts;
+    ev->dur = dur;
+    ev->tid = tid;
+    ev->id = id;
+    ev->arg = arg;
+    pthread_mutex_unlock(&TraceLock);
+    }
+
+void trace_call(const char *name, double t0, uint64_t id, double arg)
+    { traceevent(name, 'X', t0, since(t0), id, arg); }
+
+void trace_instant(const char *name, uint64_t id)
+    { traceevent(name, 'i', now(), 0, id, 0); }
+
+static void tracefree(lua_State *L)
+/* (with TraceLock held) */
+    {
+    ATOMIC_RELEASE(trace_calls, 0);
+    if(TraceFile) { fclose(TraceFile); TraceFile = NULL; }
+    if(Ring) { Free(L, Ring); Ring = NULL; }
+    RingL = NULL;
+    RingSize = RingCount = 0;
+    }
+
+static size_t tracewrite(void)
+/* (with TraceLock held) */
+    {
+    size_t i, first, n;
+    trace_event_t *ev;
+    int pid = 0;
+#if defined(LINUX)
+    pid = (int)getpid();
+#elif defined(MINGW)
+    pid = (int)GetCurrentProcessId();
+#endif
+    n = RingCount < RingSize ? RingCount : RingSize;
+    first = RingCount - n;
+    fprintf(TraceFile, "{\"traceEvents\":[\n");
+    for(i = 0; i < n; i++)
+        {
+        ev = &Ring[(first + i) % RingSize];
+        fprintf(TraceFile, "{\"name\":\"%s\",\"cat\":\"moonal\",\"ph\":\"%c\","
+            "\"ts\":%.3f,", ev->name, ev->ph, (ev->ts - RingT0)*1e6);
+        if(ev->ph == 'X')
+            fprintf(TraceFile, "\"dur\":%.3f,", ev->dur*1e6);
+        else
+            fprintf(TraceFile, "\"s\":\"t\",");
+        fprintf(TraceFile, "\"pid\":%d,\"tid\":%llu,\"args\":{\"id\":\"0x%llx\",\"arg\":%.17g}}%s\n",
+            pid, (unsigned long long)ev->tid, (unsigned long long)ev->id, ev->arg,
+            (i + 1 < n) ? "," : "");
+        }
+    fprintf(TraceFile, "],\"displayTimeUnit\":\"ms\"}\n");
+    return n;
+    }
+
+static int TraceBegin(lua_State *L)
+    {
+    const char *filename = luaL_checkstring(L, 1);
+    lua_Integer maxevents = luaL_optinteger(L, 2, 65536);
+    if(maxevents <= 0)
+        return luaL_argerror(L, 2, errstring(ERR_VALUE));
+    pthread_mutex_lock(&TraceLock);
+    if(TraceFile)
+        {
+        pthread_mutex_unlock(&TraceLock);
+        return luaL_error(L, "tracing already started");
+        }
+    Ring = (trace_event_t*)MallocNoErr(L, maxevents * sizeof(trace_event_t));
+    if(!Ring)
+        {
+        pthread_mutex_unlock(&TraceLock);
+        return luaL_error(L, errstring(ERR_MEMORY));
+        }
+    TraceFile = fopen(filename, "w");
+    if(!TraceFile)
+        {
+        Free(L, Ring); Ring = NULL;
+        pthread_mutex_unlock(&TraceLock);
+        return luaL_error(L, "cannot open file '%s'", filename);
+        }
+    RingL = L;
+    RingSize = maxevents;
+    RingCount = 0;
+    RingT0 = now();
+    ATOMIC_RELEASE(trace_calls, 1);
+    pthread_mutex_unlock(&TraceLock);
+    return 0;
+    }
+
+static int TraceEnd(lua_State *L)
+    {
+    size_t n, dropped;
+    pthread_mutex_lock(&TraceLock);
+    if(!TraceFile || L != RingL)
+        {
+        pthread_mutex_unlock(&TraceLock);
+        if(!TraceFile) return luaL_error(L, "tracing not started");
+        return luaL_error(L, "tracing was started by another Lua state");
+        }
+    n = tracewrite();
+    dropped = RingCount - n;
+    tracefree(L);
+    pthread_mutex_unlock(&TraceLock);
+    lua_pushinteger(L, n);
+    lua_pushinteger(L, dropped);
+    return 2;
+    }
+
+void moonal_atexit_tracing(void)
+/* If tracing is still active at exit, the trace is written out anyway (the ring is
+ * not released, since the state that owns it may be already closed) */
+    {
+    pthread_mutex_lock(&TraceLock);
+    if(TraceFile)
+        {
+        ATOMIC_RELEASE(trace_calls, 0);
+        tracewrite();
+        fclose(TraceFile);
+        TraceFile = NULL;
+        }
+    pthread_mutex_unlock(&TraceLock);
+    }
+
+/*------------------------------------------------------------------------------*/
+
 static int Now(lua_State *L)
     {
     lua_pushnumber(L, now());
@@ -74,6 +263,8 @@ static const struct luaL_Reg Functions[] =
     {
         { "type", Type }, //@@DOC
         { "trace_objects", TraceObjects },
+        { "trace_begin", TraceBegin },
+        { "trace_end", TraceEnd },
         { "now", Now },
         { "since", Since },
         { "sleep", Sleep },
@@ -45,31 +45,66 @@ struct moonal_udata_s {
 static int cmp(udata_t *udata1, udata_t *udata2) /* the compare function */
     { return (udata1->id < udata2->id ? -1 : udata1->id > udata2->id); } 
 
-static RB_HEAD(udatatree_s, udata_s) Head = RB_INITIALIZER(&Head);
+/* The database is per lua_State: its head is kept in a userdata anchored in the Lua
+ * registry (see udata_init()), so that independent Lua states - possibly running in
+ * different threads - do not share it.
+ */
+RB_HEAD(udatatree_s, udata_s);
 
 RB_PROTOTYPE_STATIC(udatatree_s, udata_s, entry, cmp) 
 RB_GENERATE_STATIC(udatatree_s, udata_s, entry, cmp) 
+
+static const char Key = 0; /* address used as key in the Lua registry */
+
+static struct udatatree_s *gethead(lua_State *L)
+    {
+    struct udatatree_s *head;
+    lua_rawgetp(L, LUA_REGISTRYINDEX, &Key);
+    head = (struct udatatree_s*)lua_touserdata(L, -1);
+    lua_pop(L, 1);
+    return head;
+    }
  
-static udata_t *udata_remove(udata_t *udata) 
+#define Head (*gethead(L))
+static udata_t *udata_remove(lua_State *L, udata_t *udata) 
     { return RB_REMOVE(udatatree_s, &Head, udata); }
-static udata_t *udata_insert(udata_t *udata) 
+static udata_t *udata_insert(lua_State *L, udata_t *udata) 
     { return RB_INSERT(udatatree_s, &Head, udata); }
-static udata_t *udata_search(uint64_t id) 
+static udata_t *udata_search(lua_State *L, uint64_t id) 
     { udata_t tmp; tmp.id = id; return RB_FIND(udatatree_s, &Head, &tmp); }
-static udata_t *udata_first(uint64_t id) 
+static udata_t *udata_first(lua_State *L, uint64_t id) 
     { udata_t tmp; tmp.id = id; return RB_NFIND(udatatree_s, &Head, &tmp); }
-#if 0
-static udata_t *udata_next(udata_t *udata)
-    { return RB_NEXT(udatatree_s, &Head, udata); }
-static udata_t *udata_prev(udata_t *udata)
-    { return RB_PREV(udatatree_s, &Head, udata); }
-static udata_t *udata_min(void)
-    { return RB_MIN(udatatree_s, &Head); }
-static udata_t *udata_max(void)
-    { return RB_MAX(udatatree_s, &Head); }
-static udata_t *udata_root(void)
-    { return RB_ROOT(&Head); }
-#endif
+#undef Head
+
+static int FreeAll(lua_State *L)
+/* __gc metamethod for the database: releases the remaining entries when the Lua state
+ * is closed (the objects, created later, have already been finalized) */
+    {
+    udata_t *udata;
+    struct udatatree_s *head = (struct udatatree_s*)lua_touserdata(L, 1);
+    while((udata = RB_MIN(udatatree_s, head)))
+        {
+        RB_REMOVE(udatatree_s, head, udata);
+        Free(L, udata);
+        }
+    return 0;
+    }
+
+void udata_init(lua_State *L)
+/* creates the database for this Lua state (if it does not exist yet) */
+    {
+    struct udatatree_s *head;
+    if(lua_rawgetp(L, LUA_REGISTRYINDEX, &Key) == LUA_TUSERDATA)
+        { lua_pop(L, 1); return; }
+    lua_pop(L, 1);
+    head = (struct udatatree_s*)lua_newuserdata(L, sizeof(struct udatatree_s));
+    RB_INIT(head);
+    lua_newtable(L);
+    lua_pushcfunction(L, FreeAll);
+    lua_setfield(L, -2, "__gc");
+    lua_setmetatable(L, -2);
+    lua_rawsetp(L, LUA_REGISTRYINDEX, &Key);
+    }
 
 void *udata_new(lua_State *L, size_t size, uint64_t id_, const char *mt)
 /* Creates a new Lua userdata, optionally sets its metatable to mt (if != NULL),
@@ -94,7 +129,7 @@ void *udata_new(lua_State *L, size_t size, uint64_t id_, const char *mt)
         return NULL;
         }
     udata->id = id_ != 0 ? id_ : (uint64_t)(uintptr_t)(udata->mem);
-    if(udata_search(udata->id))
+    if(udata_search(L, udata->id))
         { 
         Free(L, udata);
         luaL_error(L, "duplicated object %I", id_); 
@@ -103,7 +138,7 @@ void *udata_new(lua_State *L, size_t size, uint64_t id_, const char *mt)
     /* create a reference for later push's */
     lua_pushvalue(L, -1); /* the newly created userdata */
     udata->ref = luaL_ref(L, LUA_REGISTRYINDEX);
-    udata_insert(udata);
+    udata_insert(L, udata);
     if(mt)
         {
         udata->mt = mt;
@@ -113,9 +148,9 @@ void *udata_new(lua_State *L, size_t size, uint64_t id_, const char *mt)
     return udata->mem;
     }
 
-void *udata_mem(uint64_t id)
+void *udata_mem(lua_State *L, uint64_t id)
     {
-    udata_t *udata = udata_search(id);
+    udata_t *udata = udata_search(L, id);
     return udata ? udata->mem : NULL;
     }
 
@@ -123,7 +158,7 @@ int udata_unref(lua_State *L, uint64_t id)
 /* unreference udata so that it will be garbage collected */
     {
 //  printf("unref object %lu\n", id);
-    udata_t *udata = udata_search(id);
+    udata_t *udata = udata_search(L, id);
     if(!udata) 
         return luaL_error(L, "invalid object identifier %I", id);
     if(udata->ref != LUA_NOREF)
@@ -138,14 +173,14 @@ int udata_free(lua_State *L, uint64_t id)
 /* this should be called in the __gc metamethod
  */
     {
-    udata_t *udata = udata_search(id);
+    udata_t *udata = udata_search(L, id);
 //  printf("free object %lu\n", id);
     if(!udata) 
         return luaL_error(L, "invalid object identifier %I", id);
     /* release all references */
     if(udata->ref != LUA_NOREF)
         luaL_unref(L, LUA_REGISTRYINDEX, udata->ref);
-    udata_remove(udata);
+    udata_remove(L, udata);
     Free(L, udata);
     /* mem is released by Lua at garbage collection */
     return 0;
@@ -154,7 +189,7 @@ int udata_free(lua_State *L, uint64_t id)
 
 int udata_push(lua_State *L, uint64_t id)
     {
-    udata_t *udata = udata_search(id);
+    udata_t *udata = udata_search(L, id);
     if(!udata) 
         return luaL_error(L, "invalid object identifier %I", id);
     if(udata->ref == LUA_NOREF)
@@ -164,17 +199,6 @@ int udata_push(lua_State *L, uint64_t id)
     return 1; /* one value pushed */
     }
 
-void udata_free_all(lua_State *L)
-/* free all without unreferencing (for atexit()) */
-    {
-    udata_t *udata;
-    while((udata = udata_first(0)))
-        {
-        udata_remove(udata);
-        Free(L, udata);
-        }
-    }
-
 int udata_scan(lua_State *L, const char *mt,  
             void *info, int (*func)(lua_State *L, const void *mem, const char* mt, const void *info))
 /* scans the udata database, and calls the func callback for every 'mt' object found
@@ -186,7 +210,7 @@ int udata_scan(lua_State *L, const char *mt,
     int stop = 0;
     uint64_t id = 0;
     udata_t *udata;
-    while((udata = udata_first(id)))
+    while((udata = udata_first(L, id)))
         {
         id = udata->id + 1;
         if(mt == udata->mt)
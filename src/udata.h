@@ -44,6 +44,8 @@ void Free(lua_State *L, void *ptr);
 #define udata_s  moonal_udata_s
 #define moonal_udata_t struct moonal_udata_s
 
+#define udata_init moonal_udata_init
+void udata_init(lua_State *L);
 #define udata_new moonal_udata_new
 void *udata_new(lua_State*, size_t, uint64_t, const char*);
 #define udata_unref moonal_udata_unref
@@ -51,11 +53,9 @@ int udata_unref(lua_State *L, uint64_t);
 #define udata_free moonal_udata_free
 int udata_free(lua_State*, uint64_t);
 #define udata_mem moonal_udata_mem
-void *udata_mem(uint64_t);
+void *udata_mem(lua_State*, uint64_t);
 #define udata_push moonal_udata_push
 int udata_push(lua_State*, uint64_t);
-#define udata_free_all moonal_udata_free_all
-void udata_free_all(lua_State *L);
 #define udata_scan moonal_udata_scan
 int udata_scan(lua_State *L, const char *mt,  
             void *info, int (*func)(lua_State *L, const void *mem, const char* mt, const void *info));
@@ -142,7 +142,7 @@ void sleeep(double seconds)
 #endif
     }
 
-#define time_init(L) do { /* do nothing */ } while(0)
+#define time_init(L) (void)(L) /* do nothing */
 
 #elif defined(MINGW)
 
@@ -171,6 +171,23 @@ static void time_init(lua_State *L)
 
 #endif
 
+/* timespec arithmetics, for absolute timeouts (see schedule.c and telemetry.c) */
+
+void tsadd(struct timespec *ts, int64_t ns)
+/* ts += ns, keeping tv_nsec in [0, 1e9) */
+    {
+    ns += ts->tv_nsec;
+    ts->tv_sec += ns / 1000000000;
+    ts->tv_nsec = ns % 1000000000;
+    if(ts->tv_nsec < 0) { ts->tv_nsec += 1000000000; ts->tv_sec--; }
+    }
+
+int64_t tsdiff(const struct timespec *a, const struct timespec *b)
+/* a - b, in nanoseconds */
+    {
+    return (int64_t)(a->tv_sec - b->tv_sec)*1000000000 + (a->tv_nsec - b->tv_nsec);
+    }
+
 
 
 /*------------------------------------------------------------------------------*
@@ -178,31 +195,68 @@ static void time_init(lua_State *L)
  *------------------------------------------------------------------------------*/
 
 /* We do not use malloc(), free() etc directly. Instead, we inherit the memory 
- * allocator from the main Lua state instead (see lua_getallocf in the Lua manual)
- * and use that.
+ * allocator from the Lua state (see lua_getallocf in the Lua manual) and use that.
  *
  * By doing so, we can use an alternative malloc() implementation without recompiling
  * this library (we have needs to recompile lua only, or execute it with LD_PRELOAD
  * set to the path to the malloc library we want to use).
+ *
+ * The allocator is retrieved from the lua_State passed to each call, so that memory
+ * owned by a state is always allocated and released with that state's allocator (the
+ * module can be loaded in several independent states, possibly in different threads).
  */
-static lua_Alloc Alloc = NULL;
-static void* AllocUd = NULL;
 
-static void malloc_init(lua_State *L)
+/* Each memory block is prefixed with a header containing its size, so that
+ * Free() can keep count of the allocated bytes (see malloc_stats()).
+ */
+typedef union {
+    size_t size;
+    long double align1_;
+    void *align2_;
+    long long align3_;
+} mheader_t;
+
+/* Process-wide counters, updated atomically */
+static size_t AllocBytes = 0;   /* currently allocated bytes */
+static size_t AllocPeak = 0;    /* peak value of AllocBytes */
+static size_t AllocBlocks = 0;  /* currently allocated blocks */
+
+static void* Malloc_(lua_State *L, size_t size)
     {
-    if(Alloc) unexpected(L);
-    Alloc = lua_getallocf(L, &AllocUd);
+    void *ud;
+    size_t bytes, peak;
+    mheader_t *h;
+    lua_Alloc alloc = lua_getallocf(L, &ud);
+    h = (mheader_t*)alloc(ud, NULL, 0, sizeof(mheader_t) + size);
+    if(!h) return NULL;
+    h->size = size;
+    bytes = ATOMIC_ADD(AllocBytes, size);
+    ATOMIC_ADD(AllocBlocks, 1);
+    peak = ATOMIC_LOAD(AllocPeak);
+    while(bytes > peak && !ATOMIC_CAS(AllocPeak, peak, bytes));
+    return h + 1;
     }
 
-static void* Malloc_(size_t size)
-    { return Alloc ? Alloc(AllocUd, NULL, 0, size) : NULL; }
+static void Free_(lua_State *L, void *ptr)
+    {
+    void *ud;
+    mheader_t *h = ((mheader_t*)ptr) - 1;
+    lua_Alloc alloc = lua_getallocf(L, &ud);
+    ATOMIC_SUB(AllocBytes, h->size);
+    ATOMIC_SUB(AllocBlocks, 1);
+    alloc(ud, h, sizeof(mheader_t) + h->size, 0);
+    }
 
-static void Free_(void *ptr)
-    { if(Alloc) Alloc(AllocUd, ptr, 0, 0); }
+void malloc_stats(size_t *bytes, size_t *peak, size_t *blocks)
+    {
+    *bytes = ATOMIC_LOAD(AllocBytes);
+    *peak = ATOMIC_LOAD(AllocPeak);
+    *blocks = ATOMIC_LOAD(AllocBlocks);
+    }
 
 void *Malloc(lua_State *L, size_t size)
     {
-    void *ptr = Malloc_(size);
+    void *ptr = Malloc_(L, size);
     if(ptr==NULL)
         { luaL_error(L, errstring(ERR_MEMORY)); return NULL; }
     memset(ptr, 0, size);
@@ -212,8 +266,7 @@ void *Malloc(lua_State *L, size_t size)
 
 void *MallocNoErr(lua_State *L, size_t size) /* do not raise errors (check the retval) */
     {
-    void *ptr = Malloc_(size);
-    (void)L;
+    void *ptr = Malloc_(L, size);
     if(ptr==NULL)
         return NULL;
     memset(ptr, 0, size);
@@ -234,9 +287,8 @@ char *Strdup(lua_State *L, const char *s)
 
 void Free(lua_State *L, void *ptr)
     {
-    (void)L;
     //DBG("Free %p\n", ptr);
-    if(ptr) Free_(ptr);
+    if(ptr) Free_(L, ptr);
     }
 
 /*------------------------------------------------------------------------------*
@@ -285,6 +337,24 @@ int optboolean(lua_State *L, int arg, int d)
     return lua_toboolean(L, arg);
     }
 
+long optfield(lua_State *L, int arg, const char *name, long defval)
+/* returns the non-negative integer field t[name] of the table at arg, or defval if nil */
+    {
+    int isnum;
+    long val = defval;
+    if(lua_getfield(L, arg, name) != LUA_TNIL)
+        {
+        val = (long)lua_tointegerx(L, -1, &isnum);
+        if(!isnum || val < 0)
+            {
+            lua_pushfstring(L, "invalid field '%s'", name);
+            luaL_argerror(L, arg, lua_tostring(L, -1));
+            }
+        }
+    lua_pop(L, 1);
+    return val;
+    }
+
 #if 0
 /* 1-based index to 0-based ------------------------------------------*/
 
@@ -552,7 +622,6 @@ size_t formatframesize(lua_State *L, ALenum fmt, ALsizei align)
 
 void moonal_utils_init(lua_State *L)
     {
-    malloc_init(L);
     time_init(L);
     }
 
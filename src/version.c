@@ -37,7 +37,7 @@ static int GetAlcVersion(lua_State *L)
     {
     ALCint major, minor;
     context_t context = current_context(L);
-    device_t device = userdata(context)->device;
+    device_t device = userdata(L, context)->device;
     alc.GetIntegerv(device, ALC_MAJOR_VERSION, 1, &major);
     CheckErrorAlc(L, device);
     alc.GetIntegerv(device, ALC_MINOR_VERSION, 1, &minor);
@@ -50,7 +50,7 @@ static int GetEfxVersion(lua_State *L)
     {
     ALCint major, minor;
     context_t context = current_context(L);
-    device_t device = userdata(context)->device;
+    device_t device = userdata(L, context)->device;
     alc.GetIntegerv(device, ALC_EFX_MAJOR_VERSION, 1, &major);
     CheckErrorAlc(L, device);
     alc.GetIntegerv(device, ALC_EFX_MINOR_VERSION, 1, &minor);
@@ -0,0 +1,373 @@
+/* The MIT License (MIT)
+ *
+ * Copyright (c) 2018 Stefano Trettel
+ *
+ * Software repository: MoonAL, https://github.com/stetre/moonal
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "internal.h"
+#include <math.h>
+
+/*------------------------------------------------------------------------------*
+ | Attenuation                                                                  |
+ *------------------------------------------------------------------------------*/
+
+static double distancegain(ALenum model, double d, double ref, double rolloff, double maxdist)
+/* distance attenuation, as per the OpenAL 1.1 specification */
+    {
+    double g;
+    switch(model)
+        {
+        case AL_INVERSE_DISTANCE_CLAMPED:
+        case AL_LINEAR_DISTANCE_CLAMPED:
+        case AL_EXPONENT_DISTANCE_CLAMPED:
+            if(d < ref) d = ref;
+            if(d > maxdist) d = maxdist;
+            break;
+        default: break;
+        }
+    switch(model)
+        {
+        case AL_INVERSE_DISTANCE:
+        case AL_INVERSE_DISTANCE_CLAMPED:
+            g = ref + rolloff*(d - ref);
+            return g > 0 ? ref/g : 1.0;
+        case AL_LINEAR_DISTANCE:
+        case AL_LINEAR_DISTANCE_CLAMPED:
+            if(maxdist <= ref) return 1.0;
+            g = 1.0 - rolloff*(d - ref)/(maxdist - ref);
+            return g < 0 ? 0 : (g > 1 ? 1 : g);
+        case AL_EXPONENT_DISTANCE:
+        case AL_EXPONENT_DISTANCE_CLAMPED:
+            if(d <= 0 || ref <= 0) return 1.0;
+            return pow(d/ref, -rolloff);
+        case AL_NONE:
+        default:
+            return 1.0;
+        }
+    return 1.0;
+    }
+
+double source_attenuation(source_t source, const ALfloat listener[3], ALenum model)
+/* Computes the gain of the source as heard by the listener (source gain times distance
+ * and cone attenuation), from the source parameters. The source's context must be
+ * current, and listener[] must contain the listener position.
+ */
+    {
+    ALint relative;
+    ALfloat gain, pos[3], dir[3], ref, rolloff, maxdist, inner, outer, outergain;
+    double v[3], d, dl, cosangle, angle, g;
+    ALuint name = source->name;
+    al.GetSourcef(name, AL_GAIN, &gain);
+    al.GetSourcefv(name, AL_POSITION, pos);
+    al.GetSourcei(name, AL_SOURCE_RELATIVE, &relative);
+    al.GetSourcef(name, AL_REFERENCE_DISTANCE, &ref);
+    al.GetSourcef(name, AL_ROLLOFF_FACTOR, &rolloff);
+    al.GetSourcef(name, AL_MAX_DISTANCE, &maxdist);
+    al.GetSourcefv(name, AL_DIRECTION, dir);
+    /* source -> listener vector */
+    v[0] = -pos[0]; v[1] = -pos[1]; v[2] = -pos[2];
+    if(!relative)
+        { v[0] += listener[0]; v[1] += listener[1]; v[2] += listener[2]; }
+    d = sqrt(v[0]*v[0] + v[1]*v[1] + v[2]*v[2]);
+    g = gain * distancegain(model, d, ref, rolloff, maxdist);
+
+    dl = sqrt(dir[0]*dir[0] + dir[1]*dir[1] + dir[2]*dir[2]);
+    if(dl > 0 && d > 0)
+        { /* directional source */
+        al.GetSourcef(name, AL_CONE_INNER_ANGLE, &inner);
+        al.GetSourcef(name, AL_CONE_OUTER_ANGLE, &outer);
+        al.GetSourcef(name, AL_CONE_OUTER_GAIN, &outergain);
+        cosangle = (dir[0]*v[0] + dir[1]*v[1] + dir[2]*v[2])/(dl*d);
+        if(cosangle > 1) cosangle = 1;
+        if(cosangle < -1) cosangle = -1;
+        angle = acos(cosangle)*360.0/3.14159265358979323846; /* full cone angle, degrees */
+        if(angle > inner)
+            {
+            if(angle >= outer || outer <= inner)
+                g *= outergain;
+            else
+                g *= 1.0 + (outergain - 1.0)*(angle - inner)/(outer - inner);
+            }
+        }
+    return g;
+    }
+
+/*------------------------------------------------------------------------------*
+ | Virtual voices                                                               |
+ *------------------------------------------------------------------------------*/
+
+/* Sources enabled for virtualization are kept in a flat array per context (referenced
+ * by the context's info, see ctxinfo_t). cull() pauses the
+ * playing ones whose attenuation falls below a threshold, keeps track of their
+ * playback position while they are paused, and resumes them at the right offset
+ * when they become audible again.
+ */
+
+typedef struct {
+    ud_t *ud;           /* ud of the source */
+    ud_t *context_ud;
+    ALuint name;
+    int isvirtual;      /* 1 if paused by cull() */
+    double t0;          /* time when it was virtualized */
+    double offset;      /* playback position (seconds) at t0 */
+    double length;      /* length of the buffer (seconds) */
+    int looping;
+    double pitch;
+} vsource_t;
+
+struct moonal_vlist_s {
+    vsource_t *vsources;
+    size_t n;
+    size_t max;
+};
+
+#define VLIST(context_ud) (CTXINFO(context_ud)->vsources)
+
+static vsource_t *searchvsource(ud_t *ud)
+    {
+    size_t i;
+    vlist_t *vl = VLIST(ud->parent_ud);
+    if(!vl) return NULL;
+    for(i = 0; i < vl->n; i++)
+        if(vl->vsources[i].ud == ud) return &vl->vsources[i];
+    return NULL;
+    }
+
+static vsource_t *newvsource(lua_State *L, ud_t *context_ud)
+    {
+    vsource_t *vsources;
+    size_t n;
+    vlist_t *vl = VLIST(context_ud);
+    if(!vl)
+        vl = VLIST(context_ud) = (vlist_t*)Malloc(L, sizeof(vlist_t));
+    if(vl->n == vl->max)
+        {
+        n = vl->max ? 2*vl->max : 32;
+        vsources = (vsource_t*)Malloc(L, n*sizeof(vsource_t));
+        if(vl->vsources)
+            {
+            memcpy(vsources, vl->vsources, vl->n*sizeof(vsource_t));
+            Free(L, vl->vsources);
+            }
+        vl->vsources = vsources;
+        vl->max = n;
+        }
+    memset(&vl->vsources[vl->n], 0, sizeof(vsource_t));
+    return &vl->vsources[vl->n++];
+    }
+
+void virtual_forget(lua_State *L, ud_t *ud)
+/* called by freeuserdata() for sources marked as virtualizable */
+    {
+    size_t i;
+    vlist_t *vl = VLIST(ud->parent_ud);
+    (void)L;
+    if(!vl) return;
+    for(i = 0; i < vl->n; i++)
+        {
+        if(vl->vsources[i].ud == ud)
+            {
+            if(i < --vl->n) vl->vsources[i] = vl->vsources[vl->n];
+            return;
+            }
+        }
+    }
+
+void virtual_free(lua_State *L, ud_t *context_ud)
+/* called by freecontext(), after its sources have been released */
+    {
+    vlist_t *vl = VLIST(context_ud);
+    if(!vl) return;
+    if(vl->vsources) Free(L, vl->vsources);
+    Free(L, vl);
+    VLIST(context_ud) = NULL;
+    }
+
+static double bufferlength(ALuint source)
+/* length in seconds of the buffer attached to a static source (0 if unknown) */
+    {
+    ALint buffer, size, freq, channels, bits;
+    al.GetSourcei(source, AL_BUFFER, &buffer);
+    if(buffer == 0) return 0;
+    al.GetBufferi(buffer, AL_SIZE, &size);
+    al.GetBufferi(buffer, AL_FREQUENCY, &freq);
+    al.GetBufferi(buffer, AL_CHANNELS, &channels);
+    al.GetBufferi(buffer, AL_BITS, &bits);
+    if(freq <= 0 || channels <= 0 || bits <= 0) return 0;
+    return (double)size/(channels*(bits/8))/freq;
+    }
+
+static void virtualize(vsource_t *vs, double t)
+    {
+    ALint looping;
+    ALfloat offset, pitch;
+    ALuint name = vs->name;
+    al.GetSourcef(name, AL_SEC_OFFSET, &offset);
+    al.GetSourcef(name, AL_PITCH, &pitch);
+    al.GetSourcei(name, AL_LOOPING, &looping);
+    vs->length = bufferlength(name);
+    vs->offset = offset;
+    vs->pitch = pitch;
+    vs->looping = looping;
+    vs->t0 = t;
+    vs->isvirtual = 1;
+    al.SourcePause(name);
+    }
+
+static void devirtualize(vsource_t *vs, double t)
+/* resumes the source at the position it would have reached if it had kept playing */
+    {
+    double pos = vs->offset + (t - vs->t0)*vs->pitch;
+    vs->isvirtual = 0;
+    if(vs->length > 0 && pos >= vs->length)
+        {
+        if(!vs->looping)
+            { al.SourceStop(vs->name); return; }
+        pos = fmod(pos, vs->length);
+        }
+    al.Sourcef(vs->name, AL_SEC_OFFSET, pos);
+    al.SourcePlay(vs->name);
+    }
+
+int virtual_set(lua_State *L)
+/* set_virtual(source, boolean) */
+    {
+    ud_t *ud;
+    vsource_t *vs;
+    context_t old_context;
+    source_t source = checksource(L, 1, &ud);
+    int enable = checkboolean(L, 2);
+    vs = IsVirtualizable(ud) ? searchvsource(ud) : NULL;
+    if(enable)
+        {
+        if(vs) return 0;
+        vs = newvsource(L, ud->parent_ud);
+        vs->ud = ud;
+        vs->context_ud = ud->parent_ud;
+        vs->name = source->name;
+        MarkVirtualizable(ud);
+        return 0;
+        }
+    if(!vs) return 0;
+    if(vs->isvirtual)
+        {
+        old_context = current_context(L);
+        make_context_current(L, ud->context);
+        devirtualize(vs, now());
+        make_context_current(L, old_context);
+        }
+    virtual_forget(L, ud);
+    CancelVirtualizable(ud);
+    CheckErrorAl(L);
+    return 0;
+    }
+
+int virtual_is(lua_State *L)
+    {
+    ud_t *ud;
+    vsource_t *vs;
+    checksource(L, 1, &ud);
+    vs = IsVirtualizable(ud) ? searchvsource(ud) : NULL;
+    lua_pushboolean(L, vs && vs->isvirtual);
+    return 1;
+    }
+
+int virtual_cull(lua_State *L)
+/* nvirtual, paused, resumed = cull(context, threshold) */
+    {
+    ud_t *ud;
+    vsource_t *vs;
+    size_t i;
+    int window, nvirtual = 0, paused = 0, resumed = 0;
+    ALint state, type;
+    ALenum model, ec;
+    ALfloat listener[3];
+    double t, att;
+    context_t context = checkcontext(L, 1, &ud);
+    double threshold = luaL_checknumber(L, 2);
+    context_t old_context = alc.GetCurrentContext();
+    vlist_t *vl = VLIST(ud);
+    TRACE_CALL_START;
+    if(!vl || vl->n == 0)
+        {
+        lua_pushinteger(L, 0);
+        lua_pushinteger(L, 0);
+        lua_pushinteger(L, 0);
+        return 3;
+        }
+    if(old_context != context) make_context_current(L, context);
+    window = begin_deferred(ud);
+    t = now();
+    model = al.GetInteger(AL_DISTANCE_MODEL);
+    al.GetListenerfv(AL_POSITION, listener);
+    for(i = 0; i < vl->n; i++)
+        {
+        vs = &vl->vsources[i];
+        al.GetSourcei(vs->name, AL_SOURCE_STATE, &state);
+        if(vs->isvirtual)
+            {
+            if(state != AL_PAUSED) /* the application changed its state */
+                { vs->isvirtual = 0; continue; }
+            att = source_attenuation((source_t)vs->ud->handle, listener, model);
+            if(att >= threshold)
+                { devirtualize(vs, t); resumed++; }
+            else
+                nvirtual++;
+            }
+        else if(state == AL_PLAYING)
+            {
+            al.GetSourcei(vs->name, AL_SOURCE_TYPE, &type);
+            if(type != AL_STATIC) continue; /* streaming sources can't be tracked */
+            att = source_attenuation((source_t)vs->ud->handle, listener, model);
+            if(att < threshold)
+                { virtualize(vs, t); paused++; nvirtual++; }
+            }
+        }
+    end_deferred(ud, window);
+    ec = al.GetError(); /* of the culled context, before it is switched */
+    if(old_context != context)
+        {
+        if(old_context) make_context_current(L, old_context);
+        else set_current_context(NULL);
+        }
+    TRACE_CALL_STOP("cull", context, nvirtual);
+    if(ec) { pushalerror(L, ec); return lua_error(L); }
+    lua_pushinteger(L, nvirtual);
+    lua_pushinteger(L, paused);
+    lua_pushinteger(L, resumed);
+    return 3;
+    }
+
+static const struct luaL_Reg Functions[] =
+    {
+        { "source_set_virtual", virtual_set },
+        { "source_is_virtual", virtual_is },
+        { "cull", virtual_cull },
+        { NULL, NULL } /* sentinel */
+    };
+
+void moonal_open_virtual(lua_State *L)
+    {
+    luaL_setfuncs(L, Functions, 0);
+    }
+
+
@@ -0,0 +1,481 @@
+/* The MIT License (MIT)
+ *
+ * Copyright (c) 2018 Stefano Trettel
+ *
+ * Software repository: MoonAL, https://github.com/stetre/moonal
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "internal.h"
+
+/* Voice pool: a fixed set of sources, generated once at creation, that are handed
+ * out by importance (priority, then audibility, then age) and stolen from the least
+ * important voice when the pool is full.
+ *
+ * Busy voices are kept in a binary min-heap ordered by importance (the root is the
+ * next candidate for stealing), free voices in a stack, and the voices are also
+ * indexed by source name for lookups. All operations on a single voice are O(log n).
+ */
+
+typedef struct {
+    source_t source;
+    ud_t *ud;           /* the source's ud */
+    int priority;
+    double audibility;
+    uint64_t age;       /* acquisition serial no. (higher = younger) */
+    int heappos;        /* position in the heap, or -1 if free */
+} voice_t;
+
+typedef struct {
+    ALuint name;        /* source name */
+    int index;          /* voice index */
+} byname_t;
+
+struct moonal_voicepool_s {
+    voice_t *voices;
+    int count;
+    byname_t *byname;   /* voices sorted by source name */
+    int *heap;          /* busy voices (indices), least important first */
+    int nbusy;
+    int *freelist;      /* free voices (indices) */
+    int nfree;
+    uint64_t serial;
+};
+
+/*------------------------------------------------------------------------------*
+ | Heap                                                                         |
+ *------------------------------------------------------------------------------*/
+
+static int lessimportant(const voice_t *a, const voice_t *b)
+    {
+    if(a->priority != b->priority) return a->priority < b->priority;
+    if(a->audibility != b->audibility) return a->audibility < b->audibility;
+    return a->age < b->age;
+    }
+
+#define V(pool, pos) (&(pool)->voices[(pool)->heap[(pos)]])
+
+static void heapswap(voicepool_t pool, int i, int j)
+    {
+    int tmp = pool->heap[i];
+    pool->heap[i] = pool->heap[j];
+    pool->heap[j] = tmp;
+    pool->voices[pool->heap[i]].heappos = i;
+    pool->voices[pool->heap[j]].heappos = j;
+    }
+
+static void siftup(voicepool_t pool, int i)
+    {
+    int parent;
+    while(i > 0)
+        {
+        parent = (i - 1)/2;
+        if(!lessimportant(V(pool, i), V(pool, parent))) break;
+        heapswap(pool, i, parent);
+        i = parent;
+        }
+    }
+
+static void siftdown(voicepool_t pool, int i)
+    {
+    int l, r, min;
+    for(;;)
+        {
+        l = 2*i + 1; r = l + 1; min = i;
+        if(l < pool->nbusy && lessimportant(V(pool, l), V(pool, min))) min = l;
+        if(r < pool->nbusy && lessimportant(V(pool, r), V(pool, min))) min = r;
+        if(min == i) break;
+        heapswap(pool, i, min);
+        i = min;
+        }
+    }
+
+static void heapfix(voicepool_t pool, int i)
+    {
+    siftup(pool, i);
+    siftdown(pool, pool->voices[pool->heap[i]].heappos);
+    }
+
+static void heappush(voicepool_t pool, int index)
+    {
+    int i = pool->nbusy++;
+    pool->heap[i] = index;
+    pool->voices[index].heappos = i;
+    siftup(pool, i);
+    }
+
+static void heapremove(voicepool_t pool, int i)
+    {
+    int last = --pool->nbusy;
+    pool->voices[pool->heap[i]].heappos = -1;
+    if(i == last) return;
+    pool->heap[i] = pool->heap[last];
+    pool->voices[pool->heap[i]].heappos = i;
+    heapfix(pool, i);
+    }
+
+/*------------------------------------------------------------------------------*
+ | Voices                                                                       |
+ *------------------------------------------------------------------------------*/
+
+static int cmpname(const void *a, const void *b)
+    {
+    ALuint na = ((const byname_t*)a)->name;
+    ALuint nb = ((const byname_t*)b)->name;
+    return (na < nb) ? -1 : (na > nb);
+    }
+
+static voice_t *searchvoice(voicepool_t pool, source_t source)
+    {
+    int lo = 0, hi = pool->count - 1, mid;
+    ALuint name;
+    while(lo <= hi)
+        {
+        mid = (lo + hi)/2;
+        name = pool->byname[mid].name;
+        if(name == source->name) return &pool->voices[pool->byname[mid].index];
+        if(name < source->name) lo = mid + 1; else hi = mid - 1;
+        }
+    return NULL;
+    }
+
+static voice_t *checkvoice(lua_State *L, int arg, voicepool_t pool)
+    {
+    voice_t *voice = searchvoice(pool, checksource(L, arg, NULL));
+    if(!voice)
+        { luaL_argerror(L, arg, "source does not belong to the pool"); return NULL; }
+    return voice;
+    }
+
+static void resetvoice(lua_State *L, voice_t *voice)
+/* silences the voice (with its context current) and drops its ramps */
+    {
+    al.SourceStop(voice->source->name);
+    al.Sourcei(voice->source->name, AL_BUFFER, 0);
+    if(IsRamped(voice->ud)) ramps_forget(L, voice->ud);
+    }
+
+static void releasevoice(lua_State *L, voicepool_t pool, voice_t *voice)
+    {
+    resetvoice(L, voice);
+    heapremove(pool, voice->heappos);
+    pool->freelist[pool->nfree++] = voice - pool->voices;
+    }
+
+/*------------------------------------------------------------------------------*
+ | Create/delete                                                                |
+ *------------------------------------------------------------------------------*/
+
+static void freepool(lua_State *L, voicepool_t pool)
+    {
+    if(pool->voices) Free(L, pool->voices);
+    if(pool->byname) Free(L, pool->byname);
+    if(pool->heap) Free(L, pool->heap);
+    if(pool->freelist) Free(L, pool->freelist);
+    Free(L, pool);
+    }
+
+static int freevoicepool(lua_State *L, ud_t *ud)
+    {
+    int i;
+    voicepool_t pool = (voicepool_t)ud->handle;
+    if(!freeuserdata(L, ud)) return 0;
+    TRACE_DELETE(pool, "voicepool");
+    for(i = 0; i < pool->count; i++)
+        {
+        CancelPooled(pool->voices[i].ud);
+        pool->voices[i].ud->destructor(L, pool->voices[i].ud);
+        }
+    freepool(L, pool);
+    return 0;
+    }
+
+static int Create(lua_State *L)
+    {
+    int i, n;
+    ALCint mono = 0, stereo = 0;
+    ALuint *names;
+    ud_t *ud, *context_ud;
+    voicepool_t pool;
+    context_t old_context = current_context(L);
+    context_t context = checkcontext(L, 1, &context_ud);
+
+    /* default to all the sources the device can mix */
+    make_context_current(L, context);
+    alc.GetIntegerv(context_ud->device, ALC_MONO_SOURCES, 1, &mono);
+    alc.GetIntegerv(context_ud->device, ALC_STEREO_SOURCES, 1, &stereo);
+    CheckErrorRestoreAlc(L, context_ud->device, old_context);
+    n = mono + stereo;
+    if(!lua_isnoneornil(L, 2))
+        {
+        i = luaL_checkinteger(L, 2);
+        if(i <= 0)
+            { make_context_current(L, old_context); return luaL_argerror(L, 2, errstring(ERR_VALUE)); }
+        if(n == 0 || i < n) n = i;
+        }
+    if(n <= 0)
+        {
+        make_context_current(L, old_context);
+        return luaL_error(L, "cannot determine the number of sources (pass maxvoices)");
+        }
+
+    names = (ALuint*)MallocNoErr(L, n*sizeof(ALuint));
+    pool = (voicepool_t)MallocNoErr(L, sizeof(struct moonal_voicepool_s));
+    if(pool)
+        {
+        pool->voices = (voice_t*)MallocNoErr(L, n*sizeof(voice_t));
+        pool->byname = (byname_t*)MallocNoErr(L, n*sizeof(byname_t));
+        pool->heap = (int*)MallocNoErr(L, n*sizeof(int));
+        pool->freelist = (int*)MallocNoErr(L, n*sizeof(int));
+        }
+    if(!names || !pool || !pool->voices || !pool->byname || !pool->heap || !pool->freelist)
+        {
+        if(names) Free(L, names);
+        if(pool) freepool(L, pool);
+        make_context_current(L, old_context);
+        return luaL_error(L, errstring(ERR_MEMORY));
+        }
+
+    al.GenSources(n, names);
+    if(al.GetError() != AL_NO_ERROR)
+        {
+        Free(L, names);
+        freepool(L, pool);
+        make_context_current(L, old_context);
+        return luaL_error(L, "cannot generate %d sources", n);
+        }
+
+    ud = newuserdata(L, pool, VOICEPOOL_MT);
+    ud->context = context;
+    ud->device = context_ud->device;
+    ud->parent_ud = context_ud;
+    ud->destructor = freevoicepool;
+    ud->ddt = context_ud->ddt;
+    ud->cdt = context_ud->cdt;
+    TRACE_CREATE(pool, "voicepool");
+
+    pool->count = n;
+    for(i = 0; i < n; i++)
+        {
+        voice_t *voice = &pool->voices[i];
+        voice->source = newsource(L, context_ud, names[i]);
+        voice->ud = userdata(L, voice->source);
+        voice->heappos = -1;
+        MarkPooled(voice->ud);
+        lua_pop(L, 1);
+        pool->byname[i].name = names[i];
+        pool->byname[i].index = i;
+        pool->freelist[n - 1 - i] = i;
+        }
+    pool->nfree = n;
+    Free(L, names);
+    qsort(pool->byname, n, sizeof(byname_t), cmpname);
+    make_context_current(L, old_context);
+    return 1;
+    }
+
+/*------------------------------------------------------------------------------*
+ | Acquire/release                                                              |
+ *------------------------------------------------------------------------------*/
+
+static int Acquire(lua_State *L)
+/* source, stolen = acquire(pool, priority, [audibility]) */
+    {
+    ud_t *ud;
+    voice_t *voice, tmp;
+    int index, stolen = 0;
+    ALenum ec;
+    context_t old_context;
+    voicepool_t pool = checkvoicepool(L, 1, &ud);
+    TRACE_CALL_START;
+    tmp.priority = luaL_checkinteger(L, 2);
+    tmp.audibility = luaL_optnumber(L, 3, 1.0);
+    tmp.age = pool->serial + 1;
+    if(pool->nfree > 0)
+        {
+        index = pool->freelist[--pool->nfree];
+        voice = &pool->voices[index];
+        voice->priority = tmp.priority;
+        voice->audibility = tmp.audibility;
+        voice->age = ++pool->serial;
+        heappush(pool, index);
+        }
+    else
+        {
+        voice = V(pool, 0);
+        if(lessimportant(&tmp, voice))
+            { lua_pushnil(L); return 1; } /* nothing less important to steal */
+        old_context = current_context(L);
+        make_context_current(L, ud->context);
+        resetvoice(L, voice);
+        ec = al.GetError(); /* of the pool's context, before it is switched */
+        make_context_current(L, old_context);
+        voice->priority = tmp.priority;
+        voice->audibility = tmp.audibility;
+        voice->age = ++pool->serial;
+        siftdown(pool, 0);
+        stolen = 1;
+        if(ec) { pushalerror(L, ec); return lua_error(L); }
+        }
+    TRACE_CALL_STOP("voicepool_acquire", voice->source, stolen);
+    pushsource(L, voice->source);
+    lua_pushboolean(L, stolen);
+    return 2;
+    }
+
+static int Release(lua_State *L)
+    {
+    ud_t *ud;
+    context_t old_context;
+    voicepool_t pool = checkvoicepool(L, 1, &ud);
+    voice_t *voice = checkvoice(L, 2, pool);
+    if(voice->heappos < 0) return 0; /* already free */
+    old_context = current_context(L);
+    make_context_current(L, ud->context);
+    releasevoice(L, pool, voice);
+    CheckErrorRestoreAl(L, old_context);
+    make_context_current(L, old_context);
+    return 0;
+    }
+
+static int Update(lua_State *L)
+/* update(pool, source, priority, [audibility]) */
+    {
+    voicepool_t pool = checkvoicepool(L, 1, NULL);
+    voice_t *voice = checkvoice(L, 2, pool);
+    int priority = luaL_checkinteger(L, 3);
+    if(voice->heappos < 0)
+        return luaL_argerror(L, 2, "voice is not acquired");
+    voice->priority = priority;
+    if(!lua_isnoneornil(L, 4)) voice->audibility = luaL_checknumber(L, 4);
+    heapfix(pool, voice->heappos);
+    return 0;
+    }
+
+static int Refresh(lua_State *L)
+/* reclaimed = refresh(pool) */
+    {
+    ud_t *ud;
+    int i, reclaimed = 0;
+    ALint state;
+    ALenum model;
+    ALfloat listener[3];
+    ALenum ec;
+    voice_t *voice;
+    context_t old_context;
+    voicepool_t pool = checkvoicepool(L, 1, &ud);
+    TRACE_CALL_START;
+    old_context = current_context(L);
+    make_context_current(L, ud->context);
+    model = al.GetInteger(AL_DISTANCE_MODEL);
+    al.GetListenerfv(AL_POSITION, listener);
+    for(i = 0; i < pool->count; i++)
+        {
+        voice = &pool->voices[i];
+        if(voice->heappos < 0) continue;
+        al.GetSourcei(voice->source->name, AL_SOURCE_STATE, &state);
+        if(state == AL_STOPPED)
+            {
+            releasevoice(L, pool, voice);
+            reclaimed++;
+            }
+        else
+            voice->audibility = source_attenuation(voice->source, listener, model);
+        }
+    ec = al.GetError(); /* of the pool's context, before it is switched */
+    make_context_current(L, old_context);
+    /* re-heapify */
+    for(i = pool->nbusy/2 - 1; i >= 0; i--)
+        siftdown(pool, i);
+    TRACE_CALL_STOP("voicepool_refresh", pool, reclaimed);
+    if(ec) { pushalerror(L, ec); return lua_error(L); }
+    lua_pushinteger(L, reclaimed);
+    return 1;
+    }
+
+static int Size(lua_State *L)
+/* size, busy = size(pool) */
+    {
+    voicepool_t pool = checkvoicepool(L, 1, NULL);
+    lua_pushinteger(L, pool->count);
+    lua_pushinteger(L, pool->nbusy);
+    return 2;
+    }
+
+static int Voices(lua_State *L)
+/* {source} = voices(pool) */
+    {
+    int i;
+    voicepool_t pool = checkvoicepool(L, 1, NULL);
+    lua_newtable(L);
+    for(i = 0; i < pool->count; i++)
+        {
+        pushsource(L, pool->voices[i].source);
+        lua_rawseti(L, -2, i+1);
+        }
+    return 1;
+    }
+
+RAW_FUNC(voicepool)
+TYPE_FUNC(voicepool)
+PARENT_FUNC(voicepool)
+DELETE_FUNC(voicepool)
+
+static const struct luaL_Reg Methods[] =
+    {
+        { "raw", Raw },
+        { "type", Type },
+        { "parent", Parent },
+        { "delete", Delete },
+        { "acquire", Acquire },
+        { "release", Release },
+        { "update", Update },
+        { "refresh", Refresh },
+        { "size", Size },
+        { "voices", Voices },
+        { NULL, NULL } /* sentinel */
+    };
+
+static const struct luaL_Reg MetaMethods[] =
+    {
+        { "__gc",  Delete },
+        { NULL, NULL } /* sentinel */
+    };
+
+static const struct luaL_Reg Functions[] =
+    {
+        { "create_voicepool", Create},
+        { "delete_voicepool", Delete },
+        { "voicepool_acquire", Acquire },
+        { "voicepool_release", Release },
+        { "voicepool_update", Update },
+        { "voicepool_refresh", Refresh },
+        { "voicepool_size", Size },
+        { "voicepool_voices", Voices },
+        { NULL, NULL } /* sentinel */
+    };
+
+
+void moonal_open_voicepool(lua_State *L)
+    {
+    udata_define(L, VOICEPOOL_MT, Methods, MetaMethods);
+    luaL_setfuncs(L, Functions, 0);
+    }
+
@@ -0,0 +1,1141 @@
+/* The MIT License (MIT)
+ *
+ * Copyright (c) 2018 Stefano Trettel
+ *
+ * Software repository: MoonAL, https://github.com/stetre/moonal
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "internal.h"
+#include "codec.h"
+#include <math.h>
+
+/*------------------------------------------------------------------------------*
+ | Ogg Vorbis decoder                                                           |
+ *------------------------------------------------------------------------------*/
+
+/* Decodes the first Vorbis stream of an Ogg file, as specified in the Vorbis I
+ * specification, except for floor type 0 (which no encoder has produced since the
+ * first beta versions). Pages are checked with their CRC. The count of frames comes
+ * from the granule position of the last page, and the decoded data is trimmed to it.
+ * Chained streams are not supported: the decoding stops at the end of the first one.
+ */
+
+#define MAXPACKET   (16*1024*1024)
+#define PI          3.14159265358979323846
+#define FASTBITS    10
+#define MAXVALUES   (1 << 22)   /* limit on the size of a codebook's VQ table */
+
+typedef struct {
+    unsigned dimensions, entries;
+    unsigned char *lengths;     /* codeword lengths (0 = unused entry) */
+    int32_t *fast;              /* entry for the next FASTBITS bits, or -1 */
+    int32_t *tree;              /* nodes for the longer codewords (2 children each) */
+    int single;                 /* the only used entry, or -1 */
+    float *values;              /* entries x dimensions, or NULL if no VQ lookup */
+} codebook_t;
+
+typedef struct {
+    unsigned partitions, values;
+    unsigned char pclass[32];
+    unsigned char cdim[16], cbits[16];
+    int cmaster[16];
+    int subbooks[16][8];
+    int multiplier;
+    int X[65];
+    unsigned char sorted[65], low[65], high[65];
+} floor1_t;
+
+typedef struct {
+    unsigned type, begin, end, psize, nclass, classbook;
+    int books[64][8];
+    unsigned char *classes;     /* classifications, for each vector */
+    unsigned stride;
+} residue_t;
+
+typedef struct {
+    unsigned submaps, steps;
+    unsigned char magnitude[256], angle[256];
+    unsigned char mux[256];
+    unsigned char sfloor[16], sresidue[16];
+} map_t;
+
+typedef struct {
+    int blockflag;
+    unsigned mapping;
+} blockmode_t;
+
+typedef struct {
+    const unsigned char *p;
+    size_t len, pos;
+    uint64_t acc;
+    int nacc;
+    int eop;    /* read past the end of the packet */
+} bits_t;
+
+typedef struct {
+    uint32_t crc[256];
+    /* Ogg */
+    uint32_t serial;
+    int haveserial;
+    unsigned char lacing[255];
+    unsigned char *body;
+    unsigned nsegs, seg;
+    size_t bodypos;
+    int flags;                  /* of the current page (1 = continued, 2 = first, 4 = last) */
+    int64_t granule;
+    long pagepos;               /* position of the current page */
+    unsigned char *packet;
+    size_t plen, pmax;
+    int lastpage;               /* the packet ended in the last page */
+    int done;                   /* end of the stream */
+    long audiopos;              /* where the audio packets start (page, segment, offset) */
+    unsigned audioseg;
+    size_t audiobody;
+    /* setup */
+    unsigned blocksize[2];
+    unsigned nbooks, nfloors, nresidues, nmappings, nmodes;
+    codebook_t *books;
+    floor1_t *floors;
+    residue_t *residues;
+    map_t *mappings;
+    blockmode_t modes[64];
+    /* decoding */
+    float *coef;                /* channels x blocksize[1]/2 */
+    float *prev;                /* right half of the previous block, channels x blocksize[1]/2 */
+    unsigned prevn;             /* size of the previous block (0 = none) */
+    float *block;               /* blocksize[1] */
+    float *work;                /* blocksize[1] */
+    float *big;                 /* channels x blocksize[1]/2, for residue type 2 */
+    float *slope[2];            /* window slopes (blocksize[i]/2) */
+    float *twiddle[2];          /* IMDCT twiddles (blocksize[i]/4 complex) */
+    float *roots[2];            /* FFT twiddles (blocksize[i]/8 complex) */
+    float **vectors;            /* channels */
+    int *hasfloor, *nonzero, *dnd; /* channels */
+    int *fy;                    /* channels x 65 */
+    unsigned char *step2;       /* channels x 65 */
+    float db[256];
+    uint64_t out;               /* frames decoded so far */
+} vorbis_t;
+
+static unsigned ilog(uint32_t x)
+    {
+    unsigned n = 0;
+    while(x) { n++; x >>= 1; }
+    return n;
+    }
+
+/*------------------------------------------------------------------------------*
+ | Ogg pages and packets                                                        |
+ *------------------------------------------------------------------------------*/
+
+static void crcinit(vorbis_t *st)
+    {
+    uint32_t r;
+    int i, j;
+    for(i = 0; i < 256; i++)
+        {
+        r = (uint32_t)i << 24;
+        for(j = 0; j < 8; j++)
+            r = (r & 0x80000000) ? (r << 1) ^ 0x04c11db7 : (r << 1);
+        st->crc[i] = r;
+        }
+    }
+
+static uint32_t crc(const vorbis_t *st, uint32_t r, const unsigned char *p, size_t n)
+    {
+    while(n-- > 0)
+        r = (r << 8) ^ st->crc[((r >> 24) ^ *p++) & 0xff];
+    return r;
+    }
+
+static uint32_t pagecrc(const vorbis_t *st, const unsigned char *h, const unsigned char *lacing, const unsigned char *body, size_t len)
+/* CRC of a page, computed with its CRC field set to 0 */
+    {
+    static const unsigned char zero[4] = { 0, 0, 0, 0 };
+    uint32_t r = crc(st, 0, h, 22);
+    r = crc(st, r, zero, 4);
+    r = crc(st, r, h + 26, 1);
+    r = crc(st, r, lacing, h[26]);
+    return crc(st, r, body, len);
+    }
+
+static uint32_t le32(const unsigned char *p)
+    { return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24); }
+
+static const char *page(decoder_t *dec, vorbis_t *st)
+/* Reads the next page of the stream (skipping the pages of other streams), or sets
+ * st->done if there are no more pages. */
+    {
+    unsigned char h[27];
+    size_t n, len;
+    unsigned i;
+    for(;;)
+        {
+        st->pagepos = codec_tell(dec);
+        n = codec_input(dec, h, 27);
+        if(n == 0) { st->done = 1; return NULL; }
+        if(n < 27) return CODEC_TRUNCATED;
+        if(memcmp(h, "OggS", 4) != 0 || h[4] != 0) return CODEC_CORRUPT;
+        if(codec_input(dec, st->lacing, h[26]) < h[26]) return CODEC_TRUNCATED;
+        for(i = 0, len = 0; i < h[26]; i++) len += st->lacing[i];
+        if(codec_input(dec, st->body, len) < len) return CODEC_TRUNCATED;
+        if(pagecrc(st, h, st->lacing, st->body, len) != le32(h + 22)) return CODEC_CORRUPT;
+        if(st->haveserial && le32(h + 14) != st->serial) continue;
+        st->serial = le32(h + 14);
+        st->flags = h[5];
+        st->granule = (int64_t)((uint64_t)le32(h + 6) | ((uint64_t)le32(h + 10) << 32));
+        st->nsegs = h[26];
+        st->seg = 0;
+        st->bodypos = 0;
+        return NULL;
+        }
+    }
+
+static const char *packet(decoder_t *dec, vorbis_t *st)
+/* Assembles the next packet in st->packet, or sets st->done at the end of the stream. */
+    {
+    unsigned k;
+    int partial = 0, skip = 0;
+    const char *errmsg;
+    st->plen = 0;
+    for(;;)
+        {
+        while(st->seg < st->nsegs)
+            {
+            k = st->lacing[st->seg++];
+            if(skip) /* the rest of a packet begun on a page we did not read */
+                { st->bodypos += k; skip = k == 255; continue; }
+            if(st->plen + k > st->pmax)
+                {
+                unsigned char *p;
+                if(st->plen + k > MAXPACKET) return CODEC_CORRUPT;
+                if(!(p = (unsigned char*)realloc(st->packet, st->pmax + 65536))) return CODEC_NOMEM;
+                st->packet = p;
+                st->pmax += 65536;
+                }
+            memcpy(st->packet + st->plen, st->body + st->bodypos, k);
+            st->plen += k;
+            st->bodypos += k;
+            if(k < 255)
+                { st->lastpage = st->flags & 4; return NULL; }
+            partial = 1;
+            }
+        if(st->done || (st->flags & 4)) /* end of the stream (a partial packet is dropped) */
+            { st->done = 1; st->plen = 0; return NULL; }
+        if((errmsg = page(dec, st)) != NULL) return errmsg;
+        if(st->done) { st->plen = 0; return NULL; }
+        if(st->flags & 1)
+            { if(!partial) skip = 1; }
+        else if(partial) /* the continuation is missing */
+            { st->plen = 0; partial = 0; }
+        }
+    }
+
+/*------------------------------------------------------------------------------*
+ | Bit reader                                                                   |
+ *------------------------------------------------------------------------------*/
+
+static void bitsinit(bits_t *b, const unsigned char *p, size_t len)
+    {
+    b->p = p;
+    b->len = len;
+    b->pos = 0;
+    b->acc = 0;
+    b->nacc = 0;
+    b->eop = 0;
+    }
+
+static void fill(bits_t *b)
+    {
+    while(b->nacc <= 56 && b->pos < b->len)
+        {
+        b->acc |= (uint64_t)b->p[b->pos++] << b->nacc;
+        b->nacc += 8;
+        }
+    }
+
+static uint32_t getbits(bits_t *b, int n)
+/* reads n (<= 32) bits, lsb first */
+    {
+    uint32_t v;
+    if(n == 0) return 0;
+    if(b->nacc < n) fill(b);
+    if(b->nacc < n)
+        { b->eop = 1; b->acc = 0; b->nacc = 0; return 0; }
+    v = (uint32_t)(b->acc & ((((uint64_t)1) << n) - 1));
+    b->acc >>= n;
+    b->nacc -= n;
+    return v;
+    }
+
+static int decode(bits_t *b, const codebook_t *c)
+/* reads a codeword, and returns its entry (-1 at the end of the packet, or if invalid) */
+    {
+    int32_t e, node = 0;
+    fill(b);
+    e = c->single >= 0 ? c->single : c->fast[b->acc & ((1 << FASTBITS) - 1)];
+    if(e >= 0)
+        {
+        if(c->lengths[e] > b->nacc) { b->eop = 1; b->nacc = 0; return -1; }
+        b->acc >>= c->lengths[e];
+        b->nacc -= c->lengths[e];
+        return e;
+        }
+    for(;;)
+        {
+        if(b->nacc == 0) { b->eop = 1; return -1; }
+        node = c->tree[2*node + (b->acc & 1)];
+        b->acc >>= 1;
+        b->nacc--;
+        if(node < 0) return -node - 1;
+        if(node == 0) { b->eop = 1; return -1; }
+        }
+    }
+
+/*------------------------------------------------------------------------------*
+ | Setup                                                                        |
+ *------------------------------------------------------------------------------*/
+
+static float unpackfloat(uint32_t x)
+    {
+    double mantissa = x & 0x1fffff;
+    int exponent = (x & 0x7fe00000) >> 21;
+    if(x & 0x80000000) mantissa = -mantissa;
+    return (float)ldexp(mantissa, exponent - 788);
+    }
+
+static unsigned lookup1values(unsigned entries, unsigned dimensions)
+/* the greatest r such that r^dimensions <= entries */
+    {
+    unsigned r = (unsigned)floor(exp(log((double)entries) / dimensions));
+    double p;
+    unsigned i;
+    for(;;) /* fix floating point errors */
+        {
+        for(p = 1, i = 0; i < dimensions; i++) p *= r + 1;
+        if(p <= entries) r++; else break;
+        }
+    for(;;)
+        {
+        for(p = 1, i = 0; i < dimensions; i++) p *= r;
+        if(p > entries && r > 0) r--; else break;
+        }
+    return r;
+    }
+
+static const char *huffman(codebook_t *c)
+/* Assigns the codewords to the entries (see the specification, and libvorbis), and
+ * builds the decoding tables. */
+    {
+    uint32_t marker[33], code, e;
+    unsigned i, j, k, len, used = 0, nodes = 1, maxnodes = 1;
+    int32_t node, *child;
+    memset(marker, 0, sizeof(marker));
+    for(i = 0; i < c->entries; i++)
+        if(c->lengths[i]) { used++; maxnodes += c->lengths[i]; c->single = (int)i; }
+    if(used != 1) c->single = -1;
+    if(!(c->fast = (int32_t*)malloc((1 << FASTBITS) * sizeof(int32_t))) ||
+       !(c->tree = (int32_t*)calloc(2 * maxnodes, sizeof(int32_t))))
+        return CODEC_NOMEM;
+    for(i = 0; i < (1 << FASTBITS); i++) c->fast[i] = -1;
+    if(used <= 1) return NULL;
+    for(i = 0; i < c->entries; i++)
+        {
+        if((len = c->lengths[i]) == 0) continue;
+        code = e = marker[len];
+        if(len < 32 && (code >> len)) return CODEC_INVALID; /* overpopulated tree */
+        for(j = len; j > 0; j--)
+            {
+            if(marker[j] & 1)
+                {
+                if(j == 1) marker[1]++; else marker[j] = marker[j-1] << 1;
+                break;
+                }
+            marker[j]++;
+            }
+        for(j = len + 1; j < 33; j++)
+            {
+            if((marker[j] >> 1) != e) break;
+            e = marker[j];
+            marker[j] = marker[j-1] << 1;
+            }
+        /* codewords are read msb first, with the bits of the packet read lsb first */
+        if(len <= FASTBITS)
+            {
+            for(e = 0, j = 0; j < len; j++) e |= ((code >> j) & 1) << (len - 1 - j);
+            for(k = e; k < (1 << FASTBITS); k += 1 << len) c->fast[k] = (int32_t)i;
+            }
+        for(node = 0, j = len - 1; j > 0; j--)
+            {
+            child = &c->tree[2*node + ((code >> j) & 1)];
+            if(*child < 0) return CODEC_INVALID;
+            if(*child == 0) *child = (int32_t)nodes++;
+            node = *child;
+            }
+        child = &c->tree[2*node + (code & 1)];
+        if(*child != 0) return CODEC_INVALID;
+        *child = -(int32_t)i - 1;
+        }
+    return NULL;
+    }
+
+static const char *codebook(bits_t *b, codebook_t *c)
+    {
+    unsigned i, j, n, len, type, bits, sequence, lookups;
+    uint64_t div;
+    uint16_t *mult;
+    float minimum, delta, last, v;
+    const char *errmsg;
+    if(getbits(b, 24) != 0x564342) return CODEC_INVALID;
+    c->dimensions = getbits(b, 16);
+    c->entries = getbits(b, 24);
+    if(!(c->lengths = (unsigned char*)calloc(c->entries + 1, 1))) return CODEC_NOMEM;
+    if(getbits(b, 1)) /* ordered */
+        {
+        len = getbits(b, 5) + 1;
+        for(i = 0; i < c->entries; len++)
+            {
+            n = getbits(b, (int)ilog(c->entries - i));
+            if(n > c->entries - i || (n > 0 && len > 32) || b->eop) return CODEC_INVALID;
+            memset(c->lengths + i, (int)len, n);
+            i += n;
+            }
+        }
+    else
+        {
+        n = getbits(b, 1); /* sparse */
+        for(i = 0; i < c->entries; i++)
+            if(!n || getbits(b, 1)) c->lengths[i] = (unsigned char)(getbits(b, 5) + 1);
+        }
+    if(b->eop) return CODEC_INVALID;
+    if((errmsg = huffman(c)) != NULL) return errmsg;
+    if((type = getbits(b, 4)) == 0) return NULL; /* no VQ lookup */
+    if(type > 2 || c->dimensions == 0) return CODEC_INVALID;
+    minimum = unpackfloat(getbits(b, 32));
+    delta = unpackfloat(getbits(b, 32));
+    bits = getbits(b, 4) + 1;
+    sequence = getbits(b, 1);
+    if((uint64_t)c->entries * c->dimensions > MAXVALUES) return CODEC_UNSUPPORTED;
+    lookups = type == 1 ? lookup1values(c->entries, c->dimensions) : c->entries * c->dimensions;
+    if(lookups == 0) return CODEC_INVALID;
+    if(!(mult = (uint16_t*)malloc(lookups * sizeof(uint16_t)))) return CODEC_NOMEM;
+    for(i = 0; i < lookups; i++) mult[i] = (uint16_t)getbits(b, (int)bits);
+    if(b->eop) { free(mult); return CODEC_INVALID; }
+    if(!(c->values = (float*)malloc(c->entries * c->dimensions * sizeof(float))))
+        { free(mult); return CODEC_NOMEM; }
+    for(i = 0; i < c->entries; i++)
+        {
+        last = 0;
+        div = 1;
+        for(j = 0; j < c->dimensions; j++)
+            {
+            if(type == 1)
+                {
+                v = mult[(i / div) % lookups] * delta + minimum + last;
+                if(div <= c->entries) div *= lookups;
+                }
+            else
+                v = mult[i * c->dimensions + j] * delta + minimum + last;
+            if(sequence) last = v;
+            c->values[i * c->dimensions + j] = v;
+            }
+        }
+    free(mult);
+    return NULL;
+    }
+
+static const char *floorsetup(vorbis_t *st, bits_t *b, floor1_t *f)
+    {
+    unsigned i, j, k, nclasses = 0, rangebits;
+    int t;
+    f->partitions = getbits(b, 5);
+    for(i = 0; i < f->partitions; i++)
+        {
+        f->pclass[i] = (unsigned char)getbits(b, 4);
+        if(f->pclass[i] + 1u > nclasses) nclasses = f->pclass[i] + 1;
+        }
+    for(i = 0; i < nclasses; i++)
+        {
+        f->cdim[i] = (unsigned char)(getbits(b, 3) + 1);
+        f->cbits[i] = (unsigned char)getbits(b, 2);
+        if(f->cbits[i])
+            {
+            f->cmaster[i] = (int)getbits(b, 8);
+            if((unsigned)f->cmaster[i] >= st->nbooks) return CODEC_INVALID;
+            }
+        for(j = 0; j < (1u << f->cbits[i]); j++)
+            {
+            f->subbooks[i][j] = (int)getbits(b, 8) - 1;
+            if(f->subbooks[i][j] >= (int)st->nbooks) return CODEC_INVALID;
+            }
+        }
+    f->multiplier = (int)getbits(b, 2) + 1;
+    rangebits = getbits(b, 4);
+    f->X[0] = 0;
+    f->X[1] = 1 << rangebits;
+    f->values = 2;
+    for(i = 0; i < f->partitions; i++)
+        for(j = 0; j < f->cdim[f->pclass[i]]; j++)
+            {
+            if(f->values >= 65) return CODEC_INVALID;
+            f->X[f->values++] = (int)getbits(b, (int)rangebits);
+            }
+    if(b->eop) return CODEC_INVALID;
+    for(i = 0; i < f->values; i++) /* sort, and find the neighbors */
+        {
+        f->sorted[i] = (unsigned char)i;
+        for(j = 0; j < i; j++)
+            if(f->X[j] == f->X[i]) return CODEC_INVALID;
+        }
+    for(i = 1; i < f->values; i++)
+        for(j = i; j > 0 && f->X[f->sorted[j-1]] > f->X[f->sorted[j]]; j--)
+            { k = f->sorted[j]; f->sorted[j] = f->sorted[j-1]; f->sorted[j-1] = (unsigned char)k; }
+    for(i = 2; i < f->values; i++)
+        {
+        for(j = 0, t = -1; j < i; j++) /* the greatest X less than X[i] */
+            if(f->X[j] < f->X[i] && (t < 0 || f->X[j] > f->X[t])) t = (int)j;
+        f->low[i] = (unsigned char)t;
+        for(j = 0, t = -1; j < i; j++) /* the smallest X greater than X[i] */
+            if(f->X[j] > f->X[i] && (t < 0 || f->X[j] < f->X[t])) t = (int)j;
+        f->high[i] = (unsigned char)t;
+        }
+    return NULL;
+    }
+
+static const char *residuesetup(vorbis_t *st, bits_t *b, residue_t *r)
+    {
+    unsigned i, j, cascade[64];
+    r->begin = getbits(b, 24);
+    r->end = getbits(b, 24);
+    r->psize = getbits(b, 24) + 1;
+    r->nclass = getbits(b, 6) + 1;
+    r->classbook = getbits(b, 8);
+    if(r->classbook >= st->nbooks || st->books[r->classbook].dimensions == 0) return CODEC_INVALID;
+    for(i = 0; i < r->nclass; i++)
+        {
+        cascade[i] = getbits(b, 3);
+        if(getbits(b, 1)) cascade[i] |= getbits(b, 5) << 3;
+        }
+    for(i = 0; i < r->nclass; i++)
+        for(j = 0; j < 8; j++)
+            {
+            r->books[i][j] = -1;
+            if(!(cascade[i] & (1 << j))) continue;
+            r->books[i][j] = (int)getbits(b, 8);
+            if((unsigned)r->books[i][j] >= st->nbooks || !st->books[r->books[i][j]].values)
+                return CODEC_INVALID;
+            }
+    return b->eop ? CODEC_INVALID : NULL;
+    }
+
+static const char *mappingsetup(vorbis_t *st, bits_t *b, map_t *m, unsigned channels)
+    {
+    unsigned i, bits = ilog(channels - 1);
+    if(getbits(b, 16) != 0) return CODEC_INVALID;
+    m->submaps = getbits(b, 1) ? getbits(b, 4) + 1 : 1;
+    m->steps = getbits(b, 1) ? getbits(b, 8) + 1 : 0;
+    for(i = 0; i < m->steps; i++)
+        {
+        m->magnitude[i] = (unsigned char)getbits(b, (int)bits);
+        m->angle[i] = (unsigned char)getbits(b, (int)bits);
+        if(m->magnitude[i] == m->angle[i] || m->magnitude[i] >= channels || m->angle[i] >= channels)
+            return CODEC_INVALID;
+        }
+    if(getbits(b, 2) != 0) return CODEC_INVALID;
+    for(i = 0; i < channels; i++)
+        {
+        m->mux[i] = (unsigned char)(m->submaps > 1 ? getbits(b, 4) : 0);
+        if(m->mux[i] >= m->submaps) return CODEC_INVALID;
+        }
+    for(i = 0; i < m->submaps; i++)
+        {
+        (void)getbits(b, 8); /* time configuration (unused) */
+        m->sfloor[i] = (unsigned char)getbits(b, 8);
+        m->sresidue[i] = (unsigned char)getbits(b, 8);
+        if(m->sfloor[i] >= st->nfloors || m->sresidue[i] >= st->nresidues) return CODEC_INVALID;
+        }
+    return b->eop ? CODEC_INVALID : NULL;
+    }
+
+static const char *setup(vorbis_t *st, bits_t *b, unsigned channels)
+/* Parses the setup header */
+    {
+    unsigned i, type;
+    const char *errmsg;
+    st->nbooks = getbits(b, 8) + 1;
+    if(!(st->books = (codebook_t*)calloc(st->nbooks, sizeof(codebook_t)))) return CODEC_NOMEM;
+    for(i = 0; i < st->nbooks; i++)
+        if((errmsg = codebook(b, &st->books[i])) != NULL) return errmsg;
+    type = getbits(b, 6) + 1; /* time domain transforms (placeholders) */
+    for(i = 0; i < type; i++)
+        if(getbits(b, 16) != 0) return CODEC_INVALID;
+    st->nfloors = getbits(b, 6) + 1;
+    if(!(st->floors = (floor1_t*)calloc(st->nfloors, sizeof(floor1_t)))) return CODEC_NOMEM;
+    for(i = 0; i < st->nfloors; i++)
+        {
+        type = getbits(b, 16);
+        if(type == 0) return CODEC_UNSUPPORTED;
+        if(type != 1) return CODEC_INVALID;
+        if((errmsg = floorsetup(st, b, &st->floors[i])) != NULL) return errmsg;
+        }
+    st->nresidues = getbits(b, 6) + 1;
+    if(!(st->residues = (residue_t*)calloc(st->nresidues, sizeof(residue_t)))) return CODEC_NOMEM;
+    for(i = 0; i < st->nresidues; i++)
+        {
+        if((st->residues[i].type = getbits(b, 16)) > 2) return CODEC_INVALID;
+        if((errmsg = residuesetup(st, b, &st->residues[i])) != NULL) return errmsg;
+        }
+    st->nmappings = getbits(b, 6) + 1;
+    if(!(st->mappings = (map_t*)calloc(st->nmappings, sizeof(map_t)))) return CODEC_NOMEM;
+    for(i = 0; i < st->nmappings; i++)
+        if((errmsg = mappingsetup(st, b, &st->mappings[i], channels)) != NULL) return errmsg;
+    st->nmodes = getbits(b, 6) + 1;
+    for(i = 0; i < st->nmodes; i++)
+        {
+        st->modes[i].blockflag = (int)getbits(b, 1);
+        if(getbits(b, 16) != 0 || getbits(b, 16) != 0) return CODEC_INVALID;
+        if((st->modes[i].mapping = getbits(b, 8)) >= st->nmappings) return CODEC_INVALID;
+        }
+    if(getbits(b, 1) != 1 || b->eop) return CODEC_INVALID; /* framing bit */
+    return NULL;
+    }
+
+/*------------------------------------------------------------------------------*
+ | Audio packets                                                                |
+ *------------------------------------------------------------------------------*/
+
+static int floordecode(vorbis_t *st, bits_t *b, const floor1_t *f, int *fy, unsigned char *step2)
+/* Decodes the floor of a channel. Returns 0 if it is unused. */
+    {
+    static const int Range[4] = { 256, 128, 86, 64 };
+    int range = Range[f->multiplier - 1], nbits = (int)ilog(range - 1), cval, book, v;
+    int lo, hi, pred, room, lowroom, highroom, dy, adx, err;
+    unsigned i, j, cls, offset = 2;
+    if(getbits(b, 1) == 0) return 0;
+    fy[0] = (int)getbits(b, nbits);
+    fy[1] = (int)getbits(b, nbits);
+    for(i = 0; i < f->partitions; i++)
+        {
+        cls = f->pclass[i];
+        cval = 0;
+        if(f->cbits[cls] && (cval = decode(b, &st->books[f->cmaster[cls]])) < 0) return 0;
+        for(j = 0; j < f->cdim[cls]; j++)
+            {
+            book = f->subbooks[cls][cval & ((1 << f->cbits[cls]) - 1)];
+            cval >>= f->cbits[cls];
+            v = 0;
+            if(book >= 0 && (v = decode(b, &st->books[book])) < 0) return 0;
+            fy[offset + j] = v;
+            }
+        offset += f->cdim[cls];
+        }
+    if(b->eop) return 0;
+    step2[0] = step2[1] = 1;
+    for(i = 2; i < f->values; i++) /* amplitude value synthesis */
+        {
+        lo = f->low[i];
+        hi = f->high[i];
+        dy = fy[hi] - fy[lo];
+        adx = f->X[hi] - f->X[lo];
+        err = abs(dy) * (f->X[i] - f->X[lo]);
+        pred = dy < 0 ? fy[lo] - err / adx : fy[lo] + err / adx;
+        v = fy[i];
+        highroom = range - pred;
+        lowroom = pred;
+        room = (highroom < lowroom ? highroom : lowroom) * 2;
+        if(v == 0)
+            { step2[i] = 0; fy[i] = pred; continue; }
+        step2[lo] = step2[hi] = step2[i] = 1;
+        if(v >= room)
+            fy[i] = highroom > lowroom ? v - lowroom + pred : pred - v + highroom - 1;
+        else
+            fy[i] = (v & 1) ? pred - (v + 1) / 2 : pred + v / 2;
+        }
+    return 1;
+    }
+
+static void line(const vorbis_t *st, int x0, int y0, int x1, int y1, float *v, int n)
+/* multiplies v[x0..x1-1] by the floor line from (x0, y0) to (x1, y1) */
+    {
+    int dy = y1 - y0, adx = x1 - x0, ady = abs(dy), base = dy / adx;
+    int sy = dy < 0 ? base - 1 : base + 1, x = x0, y = y0, err = 0;
+    ady -= abs(base) * adx;
+    if(x1 > n) x1 = n;
+    if(x < x1) v[x] *= st->db[y < 0 ? 0 : y > 255 ? 255 : y];
+    for(x++; x < x1; x++)
+        {
+        err += ady;
+        if(err >= adx) { err -= adx; y += sy; } else y += base;
+        v[x] *= st->db[y < 0 ? 0 : y > 255 ? 255 : y];
+        }
+    }
+
+static void floorcurve(const vorbis_t *st, const floor1_t *f, const int *fy, const unsigned char *step2, float *v, int n)
+/* multiplies the spectrum v[0..n-1] by the floor curve */
+    {
+    unsigned i, j;
+    int lx = 0, ly = fy[f->sorted[0]] * f->multiplier, hx = 0, hy = 0;
+    for(i = 1; i < f->values; i++)
+        {
+        j = f->sorted[i];
+        if(!step2[j]) continue;
+        hx = f->X[j];
+        hy = fy[j] * f->multiplier;
+        if(hx > lx) line(st, lx, ly, hx, hy, v, n);
+        lx = hx;
+        ly = hy;
+        }
+    if(lx < n) line(st, lx, ly, n, ly, v, n);
+    }
+
+static void partitions(vorbis_t *st, bits_t *b, const residue_t *r, float **v, const int *dnd, unsigned nch, unsigned size)
+/* decodes the partitions of residue vectors, of the given size, in format 0 or 1 */
+    {
+    const codebook_t *cb = &st->books[r->classbook], *book;
+    const float *vals;
+    unsigned cpc = cb->dimensions, begin, end, parts, p, pass, i, j, k, m, dims, step, off;
+    int t;
+    begin = r->begin < size ? r->begin : size;
+    end = r->end < size ? r->end : size;
+    if(end <= begin) return;
+    parts = (end - begin) / r->psize;
+    if(parts + cpc > r->stride) parts = r->stride - cpc;
+    for(pass = 0; pass < 8; pass++)
+        for(p = 0; p < parts; )
+            {
+            if(pass == 0)
+                for(j = 0; j < nch; j++)
+                    {
+                    if(dnd[j]) continue;
+                    if((t = decode(b, cb)) < 0) return;
+                    for(i = cpc; i-- > 0; )
+                        {
+                        r->classes[j * r->stride + p + i] = (unsigned char)(t % r->nclass);
+                        t /= r->nclass;
+                        }
+                    }
+            for(i = 0; i < cpc && p < parts; i++, p++)
+                for(j = 0; j < nch; j++)
+                    {
+                    if(dnd[j] || (t = r->books[r->classes[j * r->stride + p]][pass]) < 0) continue;
+                    book = &st->books[t];
+                    dims = book->dimensions;
+                    off = begin + p * r->psize;
+                    if(r->type == 0)
+                        {
+                        step = r->psize / dims;
+                        for(k = 0; k < step; k++)
+                            {
+                            if((t = decode(b, book)) < 0) return;
+                            vals = book->values + t * dims;
+                            for(m = 0; m < dims; m++) v[j][off + k + m * step] += vals[m];
+                            }
+                        }
+                    else
+                        {
+                        for(k = 0; k < r->psize; )
+                            {
+                            if((t = decode(b, book)) < 0) return;
+                            vals = book->values + t * dims;
+                            for(m = 0; m < dims && k < r->psize; m++) v[j][off + k++] += vals[m];
+                            }
+                        }
+                    }
+            }
+    }
+
+static void residue(vorbis_t *st, bits_t *b, const residue_t *r, unsigned nch, unsigned half)
+/* decodes the residue vectors st->vectors[0..nch-1] */
+    {
+    static const int zero = 0;
+    unsigned i, ch;
+    if(r->type != 2)
+        { partitions(st, b, r, st->vectors, st->dnd, nch, half); return; }
+    for(ch = 0; ch < nch && st->dnd[ch]; ch++);
+    if(ch == nch) return;
+    memset(st->big, 0, nch * half * sizeof(float));
+    partitions(st, b, r, &st->big, &zero, 1, nch * half);
+    for(i = 0; i < half; i++) /* the channels are interleaved */
+        for(ch = 0; ch < nch; ch++)
+            st->vectors[ch][i] = st->big[i * nch + ch];
+    }
+
+static void fft(float *z, unsigned n, const float *w)
+/* in place complex FFT, with w[k] = exp(-2 pi i k / n), k = 0 .. n/2-1 */
+    {
+    unsigned i, j, bit, len, half, step, k, a, c;
+    float t, tr, ti;
+    for(i = 1, j = 0; i < n; i++) /* bit reversal */
+        {
+        for(bit = n >> 1; j & bit; bit >>= 1) j ^= bit;
+        j ^= bit;
+        if(i < j)
+            {
+            t = z[2*i]; z[2*i] = z[2*j]; z[2*j] = t;
+            t = z[2*i+1]; z[2*i+1] = z[2*j+1]; z[2*j+1] = t;
+            }
+        }
+    for(len = 2; len <= n; len <<= 1)
+        {
+        half = len >> 1;
+        step = n / len;
+        for(i = 0; i < n; i += len)
+            for(k = 0; k < half; k++)
+                {
+                a = i + k;
+                c = a + half;
+                tr = z[2*c] * w[2*k*step] - z[2*c+1] * w[2*k*step+1];
+                ti = z[2*c] * w[2*k*step+1] + z[2*c+1] * w[2*k*step];
+                z[2*c] = z[2*a] - tr;
+                z[2*c+1] = z[2*a+1] - ti;
+                z[2*a] += tr;
+                z[2*a+1] += ti;
+                }
+        }
+    }
+
+static void imdct(vorbis_t *st, int blockflag, const float *X, float *y)
+/* Inverse MDCT of the n/2 coefficients X into the n samples y. It is computed from a
+ * DCT-IV of size n/2 (c), which in turn is computed with a complex FFT of size n/4. */
+    {
+    unsigned n = st->blocksize[blockflag], m = n / 2, h = n / 4, k;
+    const float *tw = st->twiddle[blockflag];
+    float *z = st->work, *c = st->work + m, re, im;
+    for(k = 0; k < h; k++)
+        {
+        re = X[2*k];
+        im = X[m - 1 - 2*k];
+        z[2*k] = re * tw[2*k] - im * tw[2*k+1];
+        z[2*k+1] = re * tw[2*k+1] + im * tw[2*k];
+        }
+    fft(z, h, st->roots[blockflag]);
+    for(k = 0; k < h; k++)
+        {
+        re = z[2*k] * tw[2*k] - z[2*k+1] * tw[2*k+1];
+        im = z[2*k] * tw[2*k+1] + z[2*k+1] * tw[2*k];
+        c[2*k] = re;
+        c[m - 1 - 2*k] = -im;
+        }
+    for(k = 0; k < m/2; k++) y[k] = c[k + m/2];
+    for(; k < 3*m/2; k++) y[k] = -c[3*m/2 - 1 - k];
+    for(; k < n; k++) y[k] = -c[k - 3*m/2];
+    }
+
+static const char *audio(decoder_t *dec, vorbis_t *st)
+/* Decodes the audio packet in st->packet, and overlaps it with the previous one */
+    {
+    bits_t b;
+    const blockmode_t *mode;
+    const map_t *map;
+    unsigned nch = (unsigned)dec->channels, half1 = st->blocksize[1] / 2;
+    unsigned n, half, ch, s, i, k, lws, lwe, rws, rwe, len;
+    int prevflag = 0, nextflag = 0, left, right, start, t;
+    float *v, *p, *y = st->block, m, a, x;
+    short *pcm = NULL;
+    bitsinit(&b, st->packet, st->plen);
+    if(getbits(&b, 1) != 0) return NULL; /* not an audio packet */
+    i = getbits(&b, (int)ilog(st->nmodes - 1));
+    if(b.eop) return NULL;
+    if(i >= st->nmodes) return CODEC_CORRUPT;
+    mode = &st->modes[i];
+    map = &st->mappings[mode->mapping];
+    n = st->blocksize[mode->blockflag];
+    half = n / 2;
+    if(mode->blockflag)
+        {
+        prevflag = (int)getbits(&b, 1);
+        nextflag = (int)getbits(&b, 1);
+        }
+    for(ch = 0; ch < nch; ch++)
+        {
+        memset(st->coef + ch * half1, 0, half * sizeof(float));
+        st->hasfloor[ch] = st->nonzero[ch] = floordecode(st, &b, &st->floors[map->sfloor[map->mux[ch]]],
+                                    st->fy + 65 * ch, st->step2 + 65 * ch);
+        }
+    for(i = 0; i < map->steps; i++)
+        if(st->nonzero[map->magnitude[i]] || st->nonzero[map->angle[i]])
+            st->nonzero[map->magnitude[i]] = st->nonzero[map->angle[i]] = 1;
+    for(s = 0; s < map->submaps; s++)
+        {
+        for(ch = 0, k = 0; ch < nch; ch++)
+            {
+            if(map->mux[ch] != s) continue;
+            st->vectors[k] = st->coef + ch * half1;
+            st->dnd[k++] = !st->nonzero[ch];
+            }
+        residue(st, &b, &st->residues[map->sresidue[s]], k, half);
+        }
+    for(i = map->steps; i-- > 0; ) /* inverse coupling */
+        {
+        float *M = st->coef + map->magnitude[i] * half1, *A = st->coef + map->angle[i] * half1;
+        for(k = 0; k < half; k++)
+            {
+            m = M[k];
+            a = A[k];
+            if(m > 0)
+                { if(a > 0) A[k] = m - a; else { A[k] = m; M[k] = m + a; } }
+            else
+                { if(a > 0) A[k] = m + a; else { A[k] = m; M[k] = m - a; } }
+            }
+        }
+    /* windows */
+    if(mode->blockflag && !prevflag)
+        { lws = n/4 - st->blocksize[0]/4; lwe = n/4 + st->blocksize[0]/4; left = 0; }
+    else
+        { lws = 0; lwe = half; left = mode->blockflag; }
+    if(mode->blockflag && !nextflag)
+        { rws = 3*n/4 - st->blocksize[0]/4; rwe = 3*n/4 + st->blocksize[0]/4; right = 0; }
+    else
+        { rws = half; rwe = n; right = mode->blockflag; }
+    /* the decoded frames go from the center of the previous block to the center of this one */
+    len = st->prevn ? st->prevn/4 + n/4 : 0;
+    start = (int)(n/4) - (int)(st->prevn/4);
+    if(st->lastpage && st->granule >= 0 && st->out + len > (uint64_t)st->granule) /* trim the end */
+        len = st->out < (uint64_t)st->granule ? (unsigned)((uint64_t)st->granule - st->out) : 0;
+    if(len > 0 && !(pcm = codec_pcm(dec, len))) return CODEC_NOMEM;
+    for(ch = 0; ch < nch; ch++)
+        {
+        v = st->coef + ch * half1;
+        p = st->prev + ch * half1;
+        if(st->hasfloor[ch])
+            floorcurve(st, &st->floors[map->sfloor[map->mux[ch]]], st->fy + 65 * ch, st->step2 + 65 * ch, v, (int)half);
+        else
+            memset(v, 0, half * sizeof(float));
+        imdct(st, mode->blockflag, v, y);
+        for(i = 0; i < lws; i++) y[i] = 0;
+        for(; i < lwe; i++) y[i] *= st->slope[left][i - lws];
+        for(i = rws; i < rwe; i++) y[i] *= st->slope[right][rwe - 1 - i];
+        for(; i < n; i++) y[i] = 0;
+        for(i = 0; i < len; i++)
+            {
+            t = start + (int)i;
+            x = (i < st->prevn/2 ? p[i] : 0) + (t >= 0 ? y[t] : 0);
+            x *= 32767.0f;
+            pcm[i * nch + ch] = (short)(x >= 32767.0f ? 32767 : x <= -32768.0f ? -32768 : lrintf(x));
+            }
+        memcpy(p, y + half, half * sizeof(float));
+        }
+    st->prevn = n;
+    st->out += len;
+    dec->npcm = len;
+    return NULL;
+    }
+
+static const char *Decode(decoder_t *dec)
+    {
+    vorbis_t *st = (vorbis_t*)dec->state;
+    const char *errmsg;
+    while(!st->done)
+        {
+        if((errmsg = packet(dec, st)) != NULL) return errmsg;
+        if(st->plen == 0) continue;
+        if((errmsg = audio(dec, st)) != NULL) return errmsg;
+        if(dec->npcm > 0) break;
+        }
+    return NULL;
+    }
+
+/*------------------------------------------------------------------------------*
+ | Stream                                                                       |
+ *------------------------------------------------------------------------------*/
+
+static const char *header(decoder_t *dec, vorbis_t *st, int type, bits_t *b)
+/* reads the next header packet, of the given type */
+    {
+    const char *errmsg;
+    if((errmsg = packet(dec, st)) != NULL) return errmsg;
+    if(st->plen < 7 || st->packet[0] != type || memcmp(st->packet + 1, "vorbis", 6) != 0)
+        return st->done ? CODEC_TRUNCATED : CODEC_INVALID;
+    bitsinit(b, st->packet + 7, st->plen - 7);
+    return NULL;
+    }
+
+static uint64_t lastgranule(decoder_t *dec, vorbis_t *st)
+/* Returns the granule position of the last page of the stream (i.e. the count of
+ * frames), or 0 if it cannot be found. */
+    {
+    size_t n, i, k, len, chunk = 65536 + 512;
+    long start = dec->length > (long)chunk ? dec->length - (long)chunk : 0;
+    unsigned char *buf, *h;
+    uint64_t granule = 0;
+    if(codec_seek(dec, start) != 0 || !(buf = (unsigned char*)malloc(chunk))) return 0;
+    n = codec_input(dec, buf, chunk);
+    for(i = 0; i + 27 <= n; i++)
+        {
+        h = buf + i;
+        if(memcmp(h, "OggS", 4) != 0 || h[4] != 0 || le32(h + 14) != st->serial) continue;
+        if(i + 27 + h[26] > n) break;
+        for(k = 0, len = 0; k < h[26]; k++) len += h[27 + k];
+        if(i + 27 + h[26] + len > n) break;
+        if(pagecrc(st, h, h + 27, h + 27 + h[26], len) != le32(h + 22)) continue;
+        if(le32(h + 6) != 0xffffffff || le32(h + 10) != 0xffffffff)
+            granule = (uint64_t)le32(h + 6) | ((uint64_t)le32(h + 10) << 32);
+        i += 27 + h[26] + len - 1;
+        }
+    free(buf);
+    return granule;
+    }
+
+static const char *Rewind(decoder_t *dec)
+    {
+    vorbis_t *st = (vorbis_t*)dec->state;
+    const char *errmsg;
+    st->done = 0;
+    st->prevn = 0;
+    st->out = 0;
+    if(codec_seek(dec, st->audiopos) != 0) return CODEC_TRUNCATED;
+    if((errmsg = page(dec, st)) != NULL) return errmsg;
+    if(st->done) return CODEC_TRUNCATED;
+    st->seg = st->audioseg;
+    st->bodypos = st->audiobody;
+    return NULL;
+    }
+
+static const char *Open(decoder_t *dec)
+    {
+    bits_t b;
+    unsigned i, k, ch, n, half1, parts;
+    double w;
+    const char *errmsg;
+    vorbis_t *st = (vorbis_t*)calloc(1, sizeof(vorbis_t));
+    if(!st) return CODEC_NOMEM;
+    dec->state = st;
+    crcinit(st);
+    if(!(st->body = (unsigned char*)malloc(255 * 255))) return CODEC_NOMEM;
+    for(;;) /* look for the first page of a Vorbis stream */
+        {
+        if((errmsg = page(dec, st)) != NULL) return errmsg;
+        if(st->done || !(st->flags & 2)) return CODEC_INVALID;
+        if(st->nsegs > 0 && st->lacing[0] >= 7 && memcmp(st->body, "\001vorbis", 7) == 0) break;
+        }
+    st->haveserial = 1;
+    /* identification header */
+    if((errmsg = header(dec, st, 1, &b)) != NULL) return errmsg;
+    if(getbits(&b, 32) != 0) return CODEC_UNSUPPORTED; /* version */
+    dec->channels = (int)getbits(&b, 8);
+    dec->rate = (long)getbits(&b, 32);
+    (void)getbits(&b, 32); (void)getbits(&b, 32); (void)getbits(&b, 32); /* bitrates */
+    st->blocksize[0] = 1u << getbits(&b, 4);
+    st->blocksize[1] = 1u << getbits(&b, 4);
+    if(getbits(&b, 1) != 1 || b.eop || dec->channels == 0 || dec->rate == 0 ||
+       st->blocksize[0] < 64 || st->blocksize[1] > 8192 || st->blocksize[0] > st->blocksize[1])
+        return CODEC_INVALID;
+    /* comment and setup headers */
+    if((errmsg = header(dec, st, 3, &b)) != NULL) return errmsg;
+    if((errmsg = header(dec, st, 5, &b)) != NULL) return errmsg;
+    ch = (unsigned)dec->channels;
+    if((errmsg = setup(st, &b, ch)) != NULL) return errmsg;
+    st->audiopos = st->pagepos;
+    st->audioseg = st->seg;
+    st->audiobody = st->bodypos;
+    /* decoding buffers and tables */
+    half1 = st->blocksize[1] / 2;
+    if(!(st->coef = (float*)calloc(ch * half1, sizeof(float))) ||
+       !(st->prev = (float*)calloc(ch * half1, sizeof(float))) ||
+       !(st->big = (float*)calloc(ch * half1, sizeof(float))) ||
+       !(st->block = (float*)malloc(st->blocksize[1] * sizeof(float))) ||
+       !(st->work = (float*)malloc(st->blocksize[1] * sizeof(float))) ||
+       !(st->vectors = (float**)calloc(ch, sizeof(float*))) ||
+       !(st->hasfloor = (int*)calloc(ch, sizeof(int))) ||
+       !(st->nonzero = (int*)calloc(ch, sizeof(int))) ||
+       !(st->dnd = (int*)calloc(ch, sizeof(int))) ||
+       !(st->fy = (int*)calloc(ch * 65, sizeof(int))) ||
+       !(st->step2 = (unsigned char*)calloc(ch * 65, 1)))
+        return CODEC_NOMEM;
+    for(k = 0; k < 2; k++)
+        {
+        n = st->blocksize[k];
+        if(!(st->slope[k] = (float*)malloc(n / 2 * sizeof(float))) ||
+           !(st->twiddle[k] = (float*)malloc(n / 2 * sizeof(float))) ||
+           !(st->roots[k] = (float*)malloc(n / 4 * sizeof(float))))
+            return CODEC_NOMEM;
+        for(i = 0; i < n / 2; i++)
+            {
+            w = sin((i + 0.5) / (n / 2) * PI / 2);
+            st->slope[k][i] = (float)sin(PI / 2 * w * w);
+            }
+        for(i = 0; i < n / 4; i++)
+            {
+            w = -PI * (i + 0.125) / (n / 2);
+            st->twiddle[k][2*i] = (float)cos(w);
+            st->twiddle[k][2*i+1] = (float)sin(w);
+            }
+        for(i = 0; i < n / 8; i++)
+            {
+            w = -2 * PI * i / (n / 4);
+            st->roots[k][2*i] = (float)cos(w);
+            st->roots[k][2*i+1] = (float)sin(w);
+            }
+        }
+    for(i = 0; i < st->nresidues; i++)
+        {
+        residue_t *r = &st->residues[i];
+        parts = (r->type == 2 ? ch * half1 : half1) / r->psize;
+        r->stride = parts + st->books[r->classbook].dimensions;
+        if(!(r->classes = (unsigned char*)calloc(ch, r->stride))) return CODEC_NOMEM;
+        }
+    for(i = 0; i < 256; i++) /* floor1 inverse dB table */
+        st->db[i] = (float)exp(log(1.0649863e-07) * (255 - i) / 255.0);
+    dec->frames = lastgranule(dec, st);
+    return Rewind(dec);
+    }
+
+static void Close(decoder_t *dec)
+    {
+    vorbis_t *st = (vorbis_t*)dec->state;
+    unsigned i;
+    if(!st) return;
+    for(i = 0; st->books && i < st->nbooks; i++)
+        {
+        free(st->books[i].lengths);
+        free(st->books[i].fast);
+        free(st->books[i].tree);
+        free(st->books[i].values);
+        }
+    for(i = 0; st->residues && i < st->nresidues; i++)
+        free(st->residues[i].classes);
+    for(i = 0; i < 2; i++)
+        {
+        free(st->slope[i]);
+        free(st->twiddle[i]);
+        free(st->roots[i]);
+        }
+    free(st->books);
+    free(st->floors);
+    free(st->residues);
+    free(st->mappings);
+    free(st->body);
+    free(st->packet);
+    free(st->coef);
+    free(st->prev);
+    free(st->big);
+    free(st->block);
+    free(st->work);
+    free(st->vectors);
+    free(st->hasfloor);
+    free(st->nonzero);
+    free(st->dnd);
+    free(st->fy);
+    free(st->step2);
+    free(st);
+    }
+
+const codec_t vorbis_codec = { Open, Decode, Rewind, Close };
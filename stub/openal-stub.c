@@ -0,0 +1,1621 @@
+/* The MIT License (MIT)
+ *
+ * Copyright (c) 2017 Stefano Trettel
+ *
+ * Software repository: MoonAL, https://github.com/stetre/moonal
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/********************************************************************************
+ * Stub OpenAL implementation                                                   *
+ ********************************************************************************/
+
+/* This is a stand-in for libopenal.so that implements the AL/ALC entry points
+ * used by MoonAL as cheap, deterministic bookkeeping: object names are allocated
+ * from a table, parameters are stored and read back as they are, sources change
+ * state when played/stopped but do not advance, and rendering/capturing yield
+ * silence. The device clock of loopback devices advances only with the rendered
+ * frames.
+ *
+ * It is meant to measure the overhead of the bindings without the noise of an
+ * actual mixer and audio hardware (see ../bench/). To use it, build it with 'make'
+ * in this directory and set MOONAL_LIBOPENAL to the path of the resulting library.
+ *
+ * No attempt is made at validating parameters other than object names, and at
+ * emulating OpenAL's behaviour where not needed by the bindings.
+ *
+ * AL extensions listed in the MOONAL_STUB_DISABLE environment variable are reported
+ * as not present, so that the bindings' fallbacks can be exercised.
+ */
+
+#define AL_ALEXT_PROTOTYPES
+#include <stdlib.h>
+#include <string.h>
+#include <float.h>
+#include <time.h>
+#include <pthread.h>
+#include "../src/include/al.h"
+#include "../src/include/alc.h"
+#include "../src/include/alext.h"
+#include "../src/include/efx.h"
+
+static pthread_mutex_t Mutex = PTHREAD_MUTEX_INITIALIZER;
+#define Lock()      pthread_mutex_lock(&Mutex)
+#define Unlock()    pthread_mutex_unlock(&Mutex)
+
+static double now(void)
+    {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec*1.0e-9;
+    }
+
+/*------------------------------------------------------------------------------*
+ | Parameters store                                                             |
+ *------------------------------------------------------------------------------*/
+
+#define MAXVALS 6
+
+typedef struct {
+    ALenum param;
+    ALdouble val[MAXVALS];
+} param_t;
+
+typedef struct {
+    param_t *p;
+    int count;
+    int size;
+} params_t;
+
+static int paramcount(ALenum param)
+/* number of values for the given parameter */
+    {
+    switch(param)
+        {
+        case AL_POSITION:
+        case AL_VELOCITY:
+        case AL_DIRECTION:
+        case AL_AUXILIARY_SEND_FILTER:
+        case AL_EAXREVERB_REFLECTIONS_PAN:
+        case AL_EAXREVERB_LATE_REVERB_PAN: return 3;
+        case AL_ORIENTATION: return 6;
+        case AL_STEREO_ANGLES:
+        case AL_SEC_OFFSET_LATENCY_SOFT:
+        case AL_SAMPLE_OFFSET_LATENCY_SOFT:
+        case AL_SEC_OFFSET_CLOCK_SOFT:
+        case AL_SAMPLE_OFFSET_CLOCK_SOFT: return 2;
+        default: return 1;
+        }
+    }
+
+static void paramdefault(ALenum param, ALdouble *val)
+    {
+    memset(val, 0, MAXVALS*sizeof(ALdouble));
+    switch(param)
+        {
+        case AL_GAIN:
+        case AL_PITCH:
+        case AL_MAX_GAIN:
+        case AL_ROLLOFF_FACTOR:
+        case AL_REFERENCE_DISTANCE:
+        case AL_CONE_OUTER_GAINHF:
+        case AL_DOPPLER_FACTOR:
+        case AL_METERS_PER_UNIT:
+        case AL_DIRECT_FILTER_GAINHF_AUTO:
+        case AL_AUXILIARY_SEND_FILTER_GAIN_AUTO:
+        case AL_AUXILIARY_SEND_FILTER_GAINHF_AUTO:
+        case AL_EFFECTSLOT_GAIN:
+        case AL_EFFECTSLOT_AUXILIARY_SEND_AUTO: val[0] = 1; break;
+        case AL_CONE_INNER_ANGLE:
+        case AL_CONE_OUTER_ANGLE: val[0] = 360; break;
+        case AL_MAX_DISTANCE: val[0] = FLT_MAX; break;
+        case AL_DISTANCE_MODEL: val[0] = AL_INVERSE_DISTANCE_CLAMPED; break;
+        case AL_ORIENTATION: val[2] = -1; val[4] = 1; break;
+        case AL_STEREO_ANGLES: val[0] = 0.5235987755982988; val[1] = -0.5235987755982988; /* pi/6 */ break;
+        default: break;
+        }
+    }
+
+static param_t *paramsearch(params_t *params, ALenum param)
+    {
+    int i;
+    for(i = 0; i < params->count; i++)
+        if(params->p[i].param == param) return &params->p[i];
+    return NULL;
+    }
+
+static void paramset(params_t *params, ALenum param, const ALdouble *val, int n)
+    {
+    param_t *p = paramsearch(params, param);
+    if(!p)
+        {
+        if(params->count == params->size)
+            {
+            params->size = params->size ? params->size*2 : 8;
+            params->p = (param_t*)realloc(params->p, params->size*sizeof(param_t));
+            }
+        p = &params->p[params->count++];
+        p->param = param;
+        paramdefault(param, p->val);
+        }
+    if(n > MAXVALS) n = MAXVALS;
+    memcpy(p->val, val, n*sizeof(ALdouble));
+    }
+
+static void paramget(params_t *params, ALenum param, ALdouble *val)
+    {
+    param_t *p = paramsearch(params, param);
+    if(p)
+        memcpy(val, p->val, MAXVALS*sizeof(ALdouble));
+    else
+        paramdefault(param, val);
+    }
+
+/*------------------------------------------------------------------------------*
+ | Devices and contexts                                                         |
+ *------------------------------------------------------------------------------*/
+
+#define PLAYBACK    0
+#define CAPTURE     1
+#define LOOPBACK    2
+
+struct ALCdevice_struct {
+    int kind;
+    ALCenum error;
+    ALCint frequency;
+    ALCenum channels; /* loopback: ALC_XXX_SOFT */
+    ALCenum type;     /* loopback: ALC_XXX_SOFT */
+    ALCsizei framesize; /* capture */
+    ALCboolean capturing;
+    ALCboolean paused;
+    double t0; /* open time */
+    ALCint64SOFT rendered; /* loopback: total rendered frames */
+    int contexts; /* no. of contexts on this device */
+};
+
+struct ALCcontext_struct {
+    ALCdevice *device;
+    ALenum error;
+    int deferred;
+    params_t params; /* listener and global state */
+    ALboolean source_distance_model;
+    ALEVENTPROCSOFT callback; /* AL_SOFT_events */
+    void *userparam;
+    ALboolean events[3]; /* enabled event types */
+};
+
+static ALCcontext *CurrentContext = NULL;
+static __thread ALCcontext *ThreadContext = NULL;
+static ALCenum NullDeviceError = ALC_NO_ERROR;
+
+static ALCcontext *current(void)
+    { return ThreadContext ? ThreadContext : CurrentContext; }
+
+static void seterror(ALenum err)
+    {
+    ALCcontext *context = current();
+    if(context && context->error == AL_NO_ERROR)
+        context->error = err;
+    }
+
+static void setalcerror(ALCdevice *device, ALCenum err)
+    {
+    if(device)
+        { if(device->error == ALC_NO_ERROR) device->error = err; }
+    else
+        { if(NullDeviceError == ALC_NO_ERROR) NullDeviceError = err; }
+    }
+
+static ALCsizei typesize(ALCenum type)
+    {
+    switch(type)
+        {
+        case ALC_BYTE_SOFT:
+        case ALC_UNSIGNED_BYTE_SOFT: return 1;
+        case ALC_SHORT_SOFT:
+        case ALC_UNSIGNED_SHORT_SOFT: return 2;
+        default: return 4;
+        }
+    }
+
+static ALCsizei channelcount(ALCenum channels)
+    {
+    switch(channels)
+        {
+        case ALC_MONO_SOFT: return 1;
+        case ALC_QUAD_SOFT: return 4;
+        case ALC_5POINT1_SOFT: return 6;
+        case ALC_6POINT1_SOFT: return 7;
+        case ALC_7POINT1_SOFT: return 8;
+        default: return 2;
+        }
+    }
+
+static ALCdevice *newdevice(int kind)
+    {
+    ALCdevice *device = (ALCdevice*)calloc(1, sizeof(ALCdevice));
+    if(!device) return NULL;
+    device->kind = kind;
+    device->frequency = 44100;
+    device->channels = ALC_STEREO_SOFT;
+    device->type = ALC_FLOAT_SOFT;
+    device->t0 = now();
+    return device;
+    }
+
+/*------------------------------------------------------------------------------*
+ | Objects                                                                      |
+ *------------------------------------------------------------------------------*/
+
+/* Sources, buffers, effects, filters and auxiliary effect slots share the same
+ * namespace. The name of an object is its index in the Objects table plus one.
+ */
+
+#define FREE        0
+#define SOURCE      1
+#define BUFFER      2
+#define EFFECT      3
+#define FILTER      4
+#define AUXSLOT     5
+
+typedef struct {
+    int kind;
+    params_t params;
+    /* source */
+    ALenum state;
+    ALuint *queue;
+    ALsizei queued;
+    ALsizei queuesize;
+    ALenum type;
+    ALint64SOFT starttime; /* AL_SOFT_source_start_delay (device clock, ns) */
+    /* buffer */
+    ALsizei size;
+    ALsizei frequency;
+    ALsizei channels;
+    ALsizei bits;
+    ALbitfieldSOFT flags; /* AL_SOFT_map_buffer */
+    unsigned char *storage; /* mappable buffers only */
+    ALbitfieldSOFT mapped; /* access of the current mapping (0 if not mapped) */
+} object_t;
+
+static object_t *Objects = NULL;
+static ALuint ObjectsSize = 0;
+static ALuint *FreeNames = NULL;
+static ALuint FreeCount = 0;
+
+static object_t *object(ALuint name, int kind)
+    {
+    object_t *obj;
+    if(name == 0 || name > ObjectsSize) return NULL;
+    obj = &Objects[name-1];
+    return obj->kind == kind ? obj : NULL;
+    }
+
+static ALuint newobject(int kind)
+    {
+    ALuint name, i;
+    if(FreeCount == 0)
+        {
+        ALuint oldsize = ObjectsSize;
+        ObjectsSize = ObjectsSize ? ObjectsSize*2 : 256;
+        Objects = (object_t*)realloc(Objects, ObjectsSize*sizeof(object_t));
+        FreeNames = (ALuint*)realloc(FreeNames, ObjectsSize*sizeof(ALuint));
+        memset(&Objects[oldsize], 0, (ObjectsSize-oldsize)*sizeof(object_t));
+        /* push the new names so that the lowest is popped first */
+        for(i = ObjectsSize; i > oldsize; i--)
+            FreeNames[FreeCount++] = i;
+        }
+    name = FreeNames[--FreeCount];
+    Objects[name-1].kind = kind;
+    if(kind == SOURCE)
+        {
+        Objects[name-1].state = AL_INITIAL;
+        Objects[name-1].type = AL_UNDETERMINED;
+        }
+    return name;
+    }
+
+static void deleteobject(ALuint name)
+    {
+    object_t *obj = &Objects[name-1];
+    free(obj->params.p);
+    free(obj->queue);
+    free(obj->storage);
+    memset(obj, 0, sizeof(object_t));
+    FreeNames[FreeCount++] = name;
+    }
+
+static void genobjects(int kind, ALsizei n, ALuint *names)
+    {
+    ALsizei i;
+    if(n < 0) { seterror(AL_INVALID_VALUE); return; }
+    Lock();
+    for(i = 0; i < n; i++)
+        names[i] = newobject(kind);
+    Unlock();
+    }
+
+static void deleteobjects(int kind, ALsizei n, const ALuint *names)
+    {
+    ALsizei i;
+    if(n < 0) { seterror(AL_INVALID_VALUE); return; }
+    Lock();
+    for(i = 0; i < n; i++)
+        if(names[i] != 0 && !object(names[i], kind))
+            { Unlock(); seterror(AL_INVALID_NAME); return; }
+    for(i = 0; i < n; i++)
+        if(names[i] != 0) deleteobject(names[i]);
+    Unlock();
+    }
+
+static ALboolean isobject(int kind, ALuint name)
+    {
+    ALboolean res;
+    Lock();
+    res = object(name, kind) != NULL;
+    Unlock();
+    return res;
+    }
+
+static void getspecial(object_t *obj, ALenum param, ALdouble *val)
+/* computed parameters */
+    {
+    ALsizei i;
+    if(obj->kind == SOURCE)
+        {
+        switch(param)
+            {
+            case AL_SOURCE_STATE: val[0] = obj->state; return;
+            case AL_SOURCE_TYPE: val[0] = obj->type; return;
+            case AL_BUFFERS_QUEUED: val[0] = obj->queued; return;
+            case AL_BUFFERS_PROCESSED: /* sources do not advance */
+                val[0] = (obj->state == AL_PLAYING || obj->state == AL_PAUSED) ? 0 : obj->queued;
+                return;
+            case AL_BUFFER: val[0] = obj->queued > 0 ? obj->queue[0] : 0; return;
+            case AL_BYTE_LENGTH_SOFT:
+            case AL_SAMPLE_LENGTH_SOFT:
+            case AL_SEC_LENGTH_SOFT:
+                val[0] = 0;
+                for(i = 0; i < obj->queued; i++)
+                    {
+                    object_t *buf = object(obj->queue[i], BUFFER);
+                    ALsizei framesize;
+                    if(!buf || buf->size == 0) continue;
+                    framesize = buf->channels*buf->bits/8;
+                    if(param == AL_BYTE_LENGTH_SOFT) val[0] += buf->size;
+                    else if(param == AL_SAMPLE_LENGTH_SOFT) val[0] += buf->size/framesize;
+                    else val[0] += (ALdouble)(buf->size/framesize)/buf->frequency;
+                    }
+                return;
+            default: break;
+            }
+        }
+    else if(obj->kind == BUFFER)
+        {
+        switch(param)
+            {
+            case AL_FREQUENCY: val[0] = obj->frequency; return;
+            case AL_SIZE: val[0] = obj->size; return;
+            case AL_BITS: val[0] = obj->bits; return;
+            case AL_CHANNELS: val[0] = obj->channels; return;
+            default: break;
+            }
+        }
+    paramget(&obj->params, param, val);
+    }
+
+static void setspecial(object_t *obj, ALenum param, const ALdouble *val, int n)
+    {
+    if(obj->kind == SOURCE && param == AL_BUFFER)
+        {
+        ALuint buffer = (ALuint)val[0];
+        if(obj->state == AL_PLAYING || obj->state == AL_PAUSED)
+            { seterror(AL_INVALID_OPERATION); return; }
+        if(buffer != 0 && !object(buffer, BUFFER))
+            { seterror(AL_INVALID_VALUE); return; }
+        obj->queued = 0;
+        if(buffer != 0)
+            {
+            if(obj->queuesize == 0)
+                {
+                obj->queuesize = 8;
+                obj->queue = (ALuint*)realloc(obj->queue, obj->queuesize*sizeof(ALuint));
+                }
+            obj->queue[obj->queued++] = buffer;
+            obj->type = AL_STATIC;
+            }
+        else
+            obj->type = AL_UNDETERMINED;
+        return;
+        }
+    if(obj->kind == SOURCE && (param == AL_SOURCE_STATE || param == AL_SOURCE_TYPE ||
+        param == AL_BUFFERS_QUEUED || param == AL_BUFFERS_PROCESSED))
+        { seterror(AL_INVALID_OPERATION); return; }
+    paramset(&obj->params, param, val, n);
+    }
+
+static void setv(int kind, ALuint name, ALenum param, const ALdouble *val, int n)
+    {
+    object_t *obj;
+    Lock();
+    obj = object(name, kind);
+    if(!obj)
+        seterror(AL_INVALID_NAME);
+    else
+        setspecial(obj, param, val, n);
+    Unlock();
+    }
+
+static int getv(int kind, ALuint name, ALenum param, ALdouble *val)
+    {
+    object_t *obj;
+    Lock();
+    obj = object(name, kind);
+    if(!obj)
+        { Unlock(); seterror(AL_INVALID_NAME); return -1; }
+    getspecial(obj, param, val);
+    Unlock();
+    return 0;
+    }
+
+/* Typed setters/getters, for each object kind --------------------------------*/
+
+#define SETTERS(Kind, KIND)                                                                 \
+static void Set##Kind##f(ALuint name, ALenum param, ALfloat v)                              \
+    { ALdouble val[1]; val[0] = v; setv(KIND, name, param, val, 1); }                       \
+static void Set##Kind##fv(ALuint name, ALenum param, const ALfloat *v)                      \
+    {                                                                                       \
+    int i, n = paramcount(param); ALdouble val[MAXVALS];                                    \
+    for(i = 0; i < n; i++) val[i] = v[i];                                                   \
+    setv(KIND, name, param, val, n);                                                        \
+    }                                                                                       \
+static void Set##Kind##i(ALuint name, ALenum param, ALint v)                                \
+    { ALdouble val[1]; val[0] = v; setv(KIND, name, param, val, 1); }                       \
+static void Set##Kind##iv(ALuint name, ALenum param, const ALint *v)                        \
+    {                                                                                       \
+    int i, n = paramcount(param); ALdouble val[MAXVALS];                                    \
+    for(i = 0; i < n; i++) val[i] = v[i];                                                   \
+    setv(KIND, name, param, val, n);                                                        \
+    }                                                                                       \
+static void Get##Kind##f(ALuint name, ALenum param, ALfloat *v)                             \
+    { ALdouble val[MAXVALS]; if(getv(KIND, name, param, val) == 0) *v = val[0]; }           \
+static void Get##Kind##fv(ALuint name, ALenum param, ALfloat *v)                            \
+    {                                                                                       \
+    int i, n = paramcount(param); ALdouble val[MAXVALS];                                    \
+    if(getv(KIND, name, param, val) == 0) for(i = 0; i < n; i++) v[i] = val[i];             \
+    }                                                                                       \
+static void Get##Kind##i(ALuint name, ALenum param, ALint *v)                               \
+    { ALdouble val[MAXVALS]; if(getv(KIND, name, param, val) == 0) *v = (ALint)val[0]; }    \
+static void Get##Kind##iv(ALuint name, ALenum param, ALint *v)                              \
+    {                                                                                       \
+    int i, n = paramcount(param); ALdouble val[MAXVALS];                                    \
+    if(getv(KIND, name, param, val) == 0) for(i = 0; i < n; i++) v[i] = (ALint)val[i];      \
+    }
+
+#define SETTERS3(Kind, KIND) /* 3f and 3i variants */                                       \
+static void Set##Kind##3f(ALuint name, ALenum param, ALfloat v1, ALfloat v2, ALfloat v3)    \
+    { ALdouble val[3]; val[0] = v1; val[1] = v2; val[2] = v3; setv(KIND, name, param, val, 3); } \
+static void Set##Kind##3i(ALuint name, ALenum param, ALint v1, ALint v2, ALint v3)          \
+    { ALdouble val[3]; val[0] = v1; val[1] = v2; val[2] = v3; setv(KIND, name, param, val, 3); } \
+static void Get##Kind##3f(ALuint name, ALenum param, ALfloat *v1, ALfloat *v2, ALfloat *v3) \
+    {                                                                                       \
+    ALdouble val[MAXVALS];                                                                  \
+    if(getv(KIND, name, param, val) == 0) { *v1 = val[0]; *v2 = val[1]; *v3 = val[2]; }     \
+    }                                                                                       \
+static void Get##Kind##3i(ALuint name, ALenum param, ALint *v1, ALint *v2, ALint *v3)       \
+    {                                                                                       \
+    ALdouble val[MAXVALS];                                                                  \
+    if(getv(KIND, name, param, val) == 0)                                                   \
+        { *v1 = (ALint)val[0]; *v2 = (ALint)val[1]; *v3 = (ALint)val[2]; }                  \
+    }
+
+SETTERS(Source, SOURCE)
+SETTERS3(Source, SOURCE)
+SETTERS(Buffer, BUFFER)
+SETTERS3(Buffer, BUFFER)
+SETTERS(Effect, EFFECT)
+SETTERS(Filter, FILTER)
+SETTERS(Slot, AUXSLOT)
+
+#undef SETTERS
+#undef SETTERS3
+
+/*------------------------------------------------------------------------------*
+ | AL entry points                                                              |
+ *------------------------------------------------------------------------------*/
+
+/* State --------------------------------------------------------------------*/
+
+#define CONTEXT_OR_RETURN(context, retval) do {                             \
+    (context) = current();                                                  \
+    if(!(context)) { seterror(AL_INVALID_OPERATION); return retval; }       \
+} while(0)
+
+static void setctxstate(ALenum param, ALdouble v)
+    {
+    ALCcontext *context;
+    CONTEXT_OR_RETURN(context, );
+    Lock();
+    paramset(&context->params, param, &v, 1);
+    Unlock();
+    }
+
+static ALdouble getctxstate(ALenum param)
+    {
+    ALdouble val[MAXVALS];
+    ALCcontext *context;
+    CONTEXT_OR_RETURN(context, 0);
+    Lock();
+    paramget(&context->params, param, val);
+    Unlock();
+    return val[0];
+    }
+
+AL_API void AL_APIENTRY alEnable(ALenum capability)
+    {
+    if(capability == AL_SOURCE_DISTANCE_MODEL) setctxstate(capability, 1);
+    else seterror(AL_INVALID_ENUM);
+    }
+
+AL_API void AL_APIENTRY alDisable(ALenum capability)
+    {
+    if(capability == AL_SOURCE_DISTANCE_MODEL) setctxstate(capability, 0);
+    else seterror(AL_INVALID_ENUM);
+    }
+
+AL_API ALboolean AL_APIENTRY alIsEnabled(ALenum capability)
+    {
+    if(capability == AL_SOURCE_DISTANCE_MODEL) return getctxstate(capability) != 0;
+    seterror(AL_INVALID_ENUM);
+    return AL_FALSE;
+    }
+
+static const char *Resamplers[] = { "Point", "Linear", "Cubic" };
+
+AL_API const ALchar* AL_APIENTRY alGetString(ALenum param)
+    {
+    switch(param)
+        {
+        case AL_VENDOR: return "MoonAL";
+        case AL_VERSION: return "1.1 MoonAL stub";
+        case AL_RENDERER: return "MoonAL stub";
+        case AL_EXTENSIONS: return "AL_EXT_FLOAT32 AL_SOFT_deferred_updates "
+                                   "AL_SOFT_source_latency AL_SOFT_source_resampler AL_SOFT_events "
+                                   "AL_SOFT_map_buffer AL_SOFT_source_start_delay";
+        case AL_NO_ERROR: return "No Error";
+        case AL_INVALID_NAME: return "Invalid Name";
+        case AL_INVALID_ENUM: return "Invalid Enum";
+        case AL_INVALID_VALUE: return "Invalid Value";
+        case AL_INVALID_OPERATION: return "Invalid Operation";
+        case AL_OUT_OF_MEMORY: return "Out of Memory";
+        default: seterror(AL_INVALID_VALUE); return NULL;
+        }
+    }
+
+AL_API const ALchar* AL_APIENTRY alGetStringiSOFT(ALenum param, ALsizei index)
+    {
+    if(param != AL_RESAMPLER_NAME_SOFT || index < 0 || index >= 3)
+        { seterror(AL_INVALID_VALUE); return NULL; }
+    return Resamplers[index];
+    }
+
+static ALdouble getglobal(ALenum param)
+    {
+    switch(param)
+        {
+        case AL_DOPPLER_FACTOR:
+        case AL_DOPPLER_VELOCITY: 
+        case AL_SPEED_OF_SOUND:
+        case AL_DISTANCE_MODEL:
+        case AL_DEFERRED_UPDATES_SOFT: break;
+        case AL_NUM_RESAMPLERS_SOFT: return 3;
+        case AL_DEFAULT_RESAMPLER_SOFT: return 1;
+        case AL_GAIN_LIMIT_SOFT: return 16;
+        default: seterror(AL_INVALID_ENUM); return 0;
+        }
+    if(param == AL_DEFERRED_UPDATES_SOFT)
+        {
+        ALCcontext *context;
+        CONTEXT_OR_RETURN(context, 0);
+        return context->deferred;
+        }
+    if(param == AL_DOPPLER_VELOCITY && getctxstate(param) == 0) return 1;
+    if(param == AL_SPEED_OF_SOUND && getctxstate(param) == 0) return 343.3;
+    return getctxstate(param);
+    }
+
+AL_API void AL_APIENTRY alGetBooleanv(ALenum param, ALboolean *values)
+    { *values = getglobal(param) != 0; }
+AL_API void AL_APIENTRY alGetIntegerv(ALenum param, ALint *values)
+    { *values = (ALint)getglobal(param); }
+AL_API void AL_APIENTRY alGetFloatv(ALenum param, ALfloat *values)
+    { *values = getglobal(param); }
+AL_API void AL_APIENTRY alGetDoublev(ALenum param, ALdouble *values)
+    { *values = getglobal(param); }
+AL_API ALboolean AL_APIENTRY alGetBoolean(ALenum param)
+    { return getglobal(param) != 0; }
+AL_API ALint AL_APIENTRY alGetInteger(ALenum param)
+    { return (ALint)getglobal(param); }
+AL_API ALfloat AL_APIENTRY alGetFloat(ALenum param)
+    { return getglobal(param); }
+AL_API ALdouble AL_APIENTRY alGetDouble(ALenum param)
+    { return getglobal(param); }
+
+AL_API ALenum AL_APIENTRY alGetError(void)
+    {
+    ALenum err;
+    ALCcontext *context = current();
+    if(!context)
+        return AL_INVALID_OPERATION; /* as OpenAL Soft does */
+    err = context->error;
+    context->error = AL_NO_ERROR;
+    return err;
+    }
+
+AL_API ALboolean AL_APIENTRY alIsExtensionPresent(const ALchar *extname)
+    {
+    const char *p = alGetString(AL_EXTENSIONS);
+    const char *disabled = getenv("MOONAL_STUB_DISABLE");
+    size_t len = strlen(extname);
+    if(disabled && strstr(disabled, extname)) return AL_FALSE;
+    while((p = strstr(p, extname)) != NULL)
+        {
+        if(p[len] == ' ' || p[len] == '\0') return AL_TRUE;
+        p += len;
+        }
+    return AL_FALSE;
+    }
+
+AL_API ALenum AL_APIENTRY alGetEnumValue(const ALchar *ename)
+    { (void)ename; return 0; }
+
+AL_API void AL_APIENTRY alDopplerFactor(ALfloat value)
+    { setctxstate(AL_DOPPLER_FACTOR, value); }
+AL_API void AL_APIENTRY alDopplerVelocity(ALfloat value)
+    { setctxstate(AL_DOPPLER_VELOCITY, value); }
+AL_API void AL_APIENTRY alSpeedOfSound(ALfloat value)
+    { setctxstate(AL_SPEED_OF_SOUND, value); }
+AL_API void AL_APIENTRY alDistanceModel(ALenum distanceModel)
+    { setctxstate(AL_DISTANCE_MODEL, distanceModel); }
+
+AL_API ALvoid AL_APIENTRY alDeferUpdatesSOFT(void)
+    {
+    ALCcontext *context;
+    CONTEXT_OR_RETURN(context, );
+    context->deferred = 1;
+    }
+
+AL_API ALvoid AL_APIENTRY alProcessUpdatesSOFT(void)
+    {
+    ALCcontext *context;
+    CONTEXT_OR_RETURN(context, );
+    context->deferred = 0;
+    }
+
+/* Listener -----------------------------------------------------------------*/
+
+static void listenerset(ALenum param, const ALdouble *val, int n)
+    {
+    ALCcontext *context;
+    CONTEXT_OR_RETURN(context, );
+    Lock();
+    paramset(&context->params, param, val, n);
+    Unlock();
+    }
+
+static int listenerget(ALenum param, ALdouble *val)
+    {
+    ALCcontext *context;
+    CONTEXT_OR_RETURN(context, -1);
+    Lock();
+    paramget(&context->params, param, val);
+    Unlock();
+    return 0;
+    }
+
+AL_API void AL_APIENTRY alListenerf(ALenum param, ALfloat value)
+    { ALdouble val[1]; val[0] = value; listenerset(param, val, 1); }
+AL_API void AL_APIENTRY alListener3f(ALenum param, ALfloat v1, ALfloat v2, ALfloat v3)
+    { ALdouble val[3]; val[0] = v1; val[1] = v2; val[2] = v3; listenerset(param, val, 3); }
+AL_API void AL_APIENTRY alListenerfv(ALenum param, const ALfloat *values)
+    {
+    int i, n = paramcount(param);
+    ALdouble val[MAXVALS];
+    for(i = 0; i < n; i++) val[i] = values[i];
+    listenerset(param, val, n);
+    }
+AL_API void AL_APIENTRY alListeneri(ALenum param, ALint value)
+    { ALdouble val[1]; val[0] = value; listenerset(param, val, 1); }
+AL_API void AL_APIENTRY alListener3i(ALenum param, ALint v1, ALint v2, ALint v3)
+    { ALdouble val[3]; val[0] = v1; val[1] = v2; val[2] = v3; listenerset(param, val, 3); }
+AL_API void AL_APIENTRY alListeneriv(ALenum param, const ALint *values)
+    {
+    int i, n = paramcount(param);
+    ALdouble val[MAXVALS];
+    for(i = 0; i < n; i++) val[i] = values[i];
+    listenerset(param, val, n);
+    }
+AL_API void AL_APIENTRY alGetListenerf(ALenum param, ALfloat *value)
+    { ALdouble val[MAXVALS]; if(listenerget(param, val) == 0) *value = val[0]; }
+AL_API void AL_APIENTRY alGetListener3f(ALenum param, ALfloat *v1, ALfloat *v2, ALfloat *v3)
+    {
+    ALdouble val[MAXVALS];
+    if(listenerget(param, val) == 0) { *v1 = val[0]; *v2 = val[1]; *v3 = val[2]; }
+    }
+AL_API void AL_APIENTRY alGetListenerfv(ALenum param, ALfloat *values)
+    {
+    int i, n = paramcount(param);
+    ALdouble val[MAXVALS];
+    if(listenerget(param, val) == 0) for(i = 0; i < n; i++) values[i] = val[i];
+    }
+AL_API void AL_APIENTRY alGetListeneri(ALenum param, ALint *value)
+    { ALdouble val[MAXVALS]; if(listenerget(param, val) == 0) *value = (ALint)val[0]; }
+AL_API void AL_APIENTRY alGetListener3i(ALenum param, ALint *v1, ALint *v2, ALint *v3)
+    {
+    ALdouble val[MAXVALS];
+    if(listenerget(param, val) == 0) { *v1 = (ALint)val[0]; *v2 = (ALint)val[1]; *v3 = (ALint)val[2]; }
+    }
+AL_API void AL_APIENTRY alGetListeneriv(ALenum param, ALint *values)
+    {
+    int i, n = paramcount(param);
+    ALdouble val[MAXVALS];
+    if(listenerget(param, val) == 0) for(i = 0; i < n; i++) values[i] = (ALint)val[i];
+    }
+
+/* Sources ------------------------------------------------------------------*/
+
+AL_API void AL_APIENTRY alGenSources(ALsizei n, ALuint *sources)
+    { genobjects(SOURCE, n, sources); }
+AL_API void AL_APIENTRY alDeleteSources(ALsizei n, const ALuint *sources)
+    { deleteobjects(SOURCE, n, sources); }
+AL_API ALboolean AL_APIENTRY alIsSource(ALuint source)
+    { return isobject(SOURCE, source); }
+
+AL_API void AL_APIENTRY alSourcef(ALuint source, ALenum param, ALfloat value)
+    { SetSourcef(source, param, value); }
+AL_API void AL_APIENTRY alSource3f(ALuint source, ALenum param, ALfloat v1, ALfloat v2, ALfloat v3)
+    { SetSource3f(source, param, v1, v2, v3); }
+AL_API void AL_APIENTRY alSourcefv(ALuint source, ALenum param, const ALfloat *values)
+    { SetSourcefv(source, param, values); }
+AL_API void AL_APIENTRY alSourcei(ALuint source, ALenum param, ALint value)
+    { SetSourcei(source, param, value); }
+AL_API void AL_APIENTRY alSource3i(ALuint source, ALenum param, ALint v1, ALint v2, ALint v3)
+    { SetSource3i(source, param, v1, v2, v3); }
+AL_API void AL_APIENTRY alSourceiv(ALuint source, ALenum param, const ALint *values)
+    { SetSourceiv(source, param, values); }
+AL_API void AL_APIENTRY alGetSourcef(ALuint source, ALenum param, ALfloat *value)
+    { GetSourcef(source, param, value); }
+AL_API void AL_APIENTRY alGetSource3f(ALuint source, ALenum param, ALfloat *v1, ALfloat *v2, ALfloat *v3)
+    { GetSource3f(source, param, v1, v2, v3); }
+AL_API void AL_APIENTRY alGetSourcefv(ALuint source, ALenum param, ALfloat *values)
+    { GetSourcefv(source, param, values); }
+AL_API void AL_APIENTRY alGetSourcei(ALuint source,  ALenum param, ALint *value)
+    { GetSourcei(source, param, value); }
+AL_API void AL_APIENTRY alGetSource3i(ALuint source, ALenum param, ALint *v1, ALint *v2, ALint *v3)
+    { GetSource3i(source, param, v1, v2, v3); }
+AL_API void AL_APIENTRY alGetSourceiv(ALuint source,  ALenum param, ALint *values)
+    { GetSourceiv(source, param, values); }
+
+/* AL_SOFT_source_latency */
+AL_API void AL_APIENTRY alSourcedSOFT(ALuint source, ALenum param, ALdouble value)
+    { setv(SOURCE, source, param, &value, 1); }
+AL_API void AL_APIENTRY alSource3dSOFT(ALuint source, ALenum param, ALdouble v1, ALdouble v2, ALdouble v3)
+    { ALdouble val[3]; val[0] = v1; val[1] = v2; val[2] = v3; setv(SOURCE, source, param, val, 3); }
+AL_API void AL_APIENTRY alSourcedvSOFT(ALuint source, ALenum param, const ALdouble *values)
+    { setv(SOURCE, source, param, values, paramcount(param)); }
+AL_API void AL_APIENTRY alGetSourcedSOFT(ALuint source, ALenum param, ALdouble *value)
+    { ALdouble val[MAXVALS]; if(getv(SOURCE, source, param, val) == 0) *value = val[0]; }
+AL_API void AL_APIENTRY alGetSource3dSOFT(ALuint source, ALenum param, ALdouble *v1, ALdouble *v2, ALdouble *v3)
+    {
+    ALdouble val[MAXVALS];
+    if(getv(SOURCE, source, param, val) == 0) { *v1 = val[0]; *v2 = val[1]; *v3 = val[2]; }
+    }
+AL_API void AL_APIENTRY alGetSourcedvSOFT(ALuint source, ALenum param, ALdouble *values)
+    {
+    int i, n = paramcount(param);
+    ALdouble val[MAXVALS];
+    if(getv(SOURCE, source, param, val) == 0) for(i = 0; i < n; i++) values[i] = val[i];
+    }
+AL_API void AL_APIENTRY alSourcei64SOFT(ALuint source, ALenum param, ALint64SOFT value)
+    { ALdouble val[1]; val[0] = (ALdouble)value; setv(SOURCE, source, param, val, 1); }
+AL_API void AL_APIENTRY alSource3i64SOFT(ALuint source, ALenum param, ALint64SOFT v1, ALint64SOFT v2, ALint64SOFT v3)
+    {
+    ALdouble val[3];
+    val[0] = (ALdouble)v1; val[1] = (ALdouble)v2; val[2] = (ALdouble)v3;
+    setv(SOURCE, source, param, val, 3);
+    }
+AL_API void AL_APIENTRY alSourcei64vSOFT(ALuint source, ALenum param, const ALint64SOFT *values)
+    {
+    int i, n = paramcount(param);
+    ALdouble val[MAXVALS];
+    for(i = 0; i < n; i++) val[i] = (ALdouble)values[i];
+    setv(SOURCE, source, param, val, n);
+    }
+AL_API void AL_APIENTRY alGetSourcei64SOFT(ALuint source, ALenum param, ALint64SOFT *value)
+    { ALdouble val[MAXVALS]; if(getv(SOURCE, source, param, val) == 0) *value = (ALint64SOFT)val[0]; }
+AL_API void AL_APIENTRY alGetSource3i64SOFT(ALuint source, ALenum param, ALint64SOFT *v1, ALint64SOFT *v2, ALint64SOFT *v3)
+    {
+    ALdouble val[MAXVALS];
+    if(getv(SOURCE, source, param, val) == 0)
+        { *v1 = (ALint64SOFT)val[0]; *v2 = (ALint64SOFT)val[1]; *v3 = (ALint64SOFT)val[2]; }
+    }
+AL_API void AL_APIENTRY alGetSourcei64vSOFT(ALuint source, ALenum param, ALint64SOFT *values)
+    {
+    int i, n = paramcount(param);
+    ALdouble val[MAXVALS];
+    if(getv(SOURCE, source, param, val) == 0) for(i = 0; i < n; i++) values[i] = (ALint64SOFT)val[i];
+    }
+
+#define PLAY    0
+#define STOP    1
+#define REWIND  2
+#define PAUSE   3
+
+#define EVENTINDEX(type) ((type) - AL_EVENT_TYPE_BUFFER_COMPLETED_SOFT)
+
+static void event(ALenum type, ALuint object, ALuint param, const char *message)
+/* events are delivered synchronously, on the thread causing them */
+    {
+    ALCcontext *context = current();
+    if(!context || !context->callback || !context->events[EVENTINDEX(type)]) return;
+    context->callback(type, object, param, (ALsizei)strlen(message), message, context->userparam);
+    }
+
+static void sourcecontrol(ALsizei n, const ALuint *sources, int what)
+    {
+    ALsizei i;
+    object_t *obj;
+    ALenum *oldstate, *newstate;
+    ALsizei *completed;
+    oldstate = (ALenum*)calloc(n > 0 ? n : 1, 2*sizeof(ALenum) + sizeof(ALsizei));
+    if(!oldstate) { seterror(AL_OUT_OF_MEMORY); return; }
+    newstate = oldstate + n;
+    completed = (ALsizei*)(newstate + n);
+    Lock();
+    for(i = 0; i < n; i++)
+        if(!object(sources[i], SOURCE))
+            { Unlock(); free(oldstate); seterror(AL_INVALID_NAME); return; }
+    for(i = 0; i < n; i++)
+        {
+        obj = object(sources[i], SOURCE);
+        oldstate[i] = obj->state;
+        switch(what)
+            {
+            case PLAY: obj->state = AL_PLAYING; break;
+            case STOP: if(obj->state != AL_INITIAL) obj->state = AL_STOPPED; break;
+            case REWIND: obj->state = AL_INITIAL; break;
+            case PAUSE: if(obj->state == AL_PLAYING) obj->state = AL_PAUSED; break;
+            }
+        newstate[i] = obj->state;
+        /* stopping a streaming source completes its queued buffers */
+        if(newstate[i] == AL_STOPPED && oldstate[i] != AL_STOPPED && obj->type == AL_STREAMING)
+            completed[i] = obj->queued;
+        }
+    Unlock();
+    for(i = 0; i < n; i++)
+        {
+        if(completed[i] > 0)
+            event(AL_EVENT_TYPE_BUFFER_COMPLETED_SOFT, sources[i], completed[i], "Buffer completed");
+        if(newstate[i] != oldstate[i])
+            event(AL_EVENT_TYPE_SOURCE_STATE_CHANGED_SOFT, sources[i], newstate[i], "Source state changed");
+        }
+    free(oldstate);
+    }
+
+AL_API void AL_APIENTRY alEventControlSOFT(ALsizei count, const ALenum *types, ALboolean enable)
+    {
+    ALsizei i;
+    ALCcontext *context = current();
+    if(!context) { seterror(AL_INVALID_OPERATION); return; }
+    for(i = 0; i < count; i++)
+        if(types[i] < AL_EVENT_TYPE_BUFFER_COMPLETED_SOFT || types[i] > AL_EVENT_TYPE_DISCONNECTED_SOFT)
+            { seterror(AL_INVALID_ENUM); return; }
+    for(i = 0; i < count; i++)
+        context->events[EVENTINDEX(types[i])] = enable;
+    }
+
+AL_API void AL_APIENTRY alEventCallbackSOFT(ALEVENTPROCSOFT callback, void *userParam)
+    {
+    ALCcontext *context = current();
+    if(!context) { seterror(AL_INVALID_OPERATION); return; }
+    context->callback = callback;
+    context->userparam = userParam;
+    }
+
+AL_API void AL_APIENTRY alSourcePlayv(ALsizei n, const ALuint *sources)
+    { sourcecontrol(n, sources, PLAY); }
+AL_API void AL_APIENTRY alSourceStopv(ALsizei n, const ALuint *sources)
+    { sourcecontrol(n, sources, STOP); }
+AL_API void AL_APIENTRY alSourceRewindv(ALsizei n, const ALuint *sources)
+    { sourcecontrol(n, sources, REWIND); }
+AL_API void AL_APIENTRY alSourcePausev(ALsizei n, const ALuint *sources)
+    { sourcecontrol(n, sources, PAUSE); }
+AL_API void AL_APIENTRY alSourcePlay(ALuint source)
+    { sourcecontrol(1, &source, PLAY); }
+AL_API void AL_APIENTRY alSourcePlayAtTimevSOFT(ALsizei n, const ALuint *sources, ALint64SOFT start_time)
+/* the source is set playing at once, since it would not advance anyway */
+    {
+    ALsizei i;
+    if(start_time <= 0) { seterror(AL_INVALID_VALUE); return; }
+    sourcecontrol(n, sources, PLAY);
+    Lock();
+    for(i = 0; i < n; i++)
+        if(object(sources[i], SOURCE)) object(sources[i], SOURCE)->starttime = start_time;
+    Unlock();
+    }
+AL_API void AL_APIENTRY alSourcePlayAtTimeSOFT(ALuint source, ALint64SOFT start_time)
+    { alSourcePlayAtTimevSOFT(1, &source, start_time); }
+AL_API void AL_APIENTRY alSourceStop(ALuint source)
+    { sourcecontrol(1, &source, STOP); }
+AL_API void AL_APIENTRY alSourceRewind(ALuint source)
+    { sourcecontrol(1, &source, REWIND); }
+AL_API void AL_APIENTRY alSourcePause(ALuint source)
+    { sourcecontrol(1, &source, PAUSE); }
+
+AL_API void AL_APIENTRY alSourceQueueBuffers(ALuint source, ALsizei nb, const ALuint *buffers)
+    {
+    ALsizei i;
+    object_t *obj;
+    Lock();
+    obj = object(source, SOURCE);
+    if(!obj)
+        { Unlock(); seterror(AL_INVALID_NAME); return; }
+    if(obj->type == AL_STATIC)
+        { Unlock(); seterror(AL_INVALID_OPERATION); return; }
+    for(i = 0; i < nb; i++)
+        if(buffers[i] != 0 && !object(buffers[i], BUFFER))
+            { Unlock(); seterror(AL_INVALID_NAME); return; }
+    if(obj->queued + nb > obj->queuesize)
+        {
+        obj->queuesize = obj->queued + nb;
+        obj->queue = (ALuint*)realloc(obj->queue, obj->queuesize*sizeof(ALuint));
+        }
+    memcpy(&obj->queue[obj->queued], buffers, nb*sizeof(ALuint));
+    obj->queued += nb;
+    obj->type = AL_STREAMING;
+    Unlock();
+    }
+
+AL_API void AL_APIENTRY alSourceUnqueueBuffers(ALuint source, ALsizei nb, ALuint *buffers)
+    {
+    object_t *obj;
+    ALsizei processed;
+    Lock();
+    obj = object(source, SOURCE);
+    if(!obj)
+        { Unlock(); seterror(AL_INVALID_NAME); return; }
+    processed = (obj->state == AL_PLAYING || obj->state == AL_PAUSED) ? 0 : obj->queued;
+    if(obj->type != AL_STREAMING || nb > processed)
+        { Unlock(); seterror(AL_INVALID_VALUE); return; }
+    memcpy(buffers, obj->queue, nb*sizeof(ALuint));
+    memmove(obj->queue, &obj->queue[nb], (obj->queued - nb)*sizeof(ALuint));
+    obj->queued -= nb;
+    Unlock();
+    }
+
+/* Buffers ------------------------------------------------------------------*/
+
+AL_API void AL_APIENTRY alGenBuffers(ALsizei n, ALuint *buffers)
+    { genobjects(BUFFER, n, buffers); }
+AL_API void AL_APIENTRY alDeleteBuffers(ALsizei n, const ALuint *buffers)
+    { deleteobjects(BUFFER, n, buffers); }
+AL_API ALboolean AL_APIENTRY alIsBuffer(ALuint buffer)
+    { return isobject(BUFFER, buffer); }
+
+static int formatinfo(ALenum format, ALsizei *channels, ALsizei *bits)
+    {
+    switch(format)
+        {
+        case AL_FORMAT_MONO8: *channels = 1; *bits = 8; return 0;
+        case AL_FORMAT_MONO16: *channels = 1; *bits = 16; return 0;
+        case AL_FORMAT_STEREO8: *channels = 2; *bits = 8; return 0;
+        case AL_FORMAT_STEREO16: *channels = 2; *bits = 16; return 0;
+        case AL_FORMAT_MONO_FLOAT32: *channels = 1; *bits = 32; return 0;
+        case AL_FORMAT_STEREO_FLOAT32: *channels = 2; *bits = 32; return 0;
+        case AL_FORMAT_QUAD8: *channels = 4; *bits = 8; return 0;
+        case AL_FORMAT_QUAD16: *channels = 4; *bits = 16; return 0;
+        case AL_FORMAT_QUAD32: *channels = 4; *bits = 32; return 0;
+        case AL_FORMAT_51CHN8: *channels = 6; *bits = 8; return 0;
+        case AL_FORMAT_51CHN16: *channels = 6; *bits = 16; return 0;
+        case AL_FORMAT_51CHN32: *channels = 6; *bits = 32; return 0;
+        case AL_FORMAT_61CHN8: *channels = 7; *bits = 8; return 0;
+        case AL_FORMAT_61CHN16: *channels = 7; *bits = 16; return 0;
+        case AL_FORMAT_61CHN32: *channels = 7; *bits = 32; return 0;
+        case AL_FORMAT_71CHN8: *channels = 8; *bits = 8; return 0;
+        case AL_FORMAT_71CHN16: *channels = 8; *bits = 16; return 0;
+        case AL_FORMAT_71CHN32: *channels = 8; *bits = 32; return 0;
+        default: return -1;
+        }
+    }
+
+static int attached(ALuint buffer)
+/* AL refuses to store data in a buffer attached to (or queued on) a source */
+    {
+    ALuint i;
+    ALsizei j;
+    for(i = 0; i < ObjectsSize; i++)
+        if(Objects[i].kind == SOURCE)
+            for(j = 0; j < Objects[i].queued; j++)
+                if(Objects[i].queue[j] == buffer) return 1;
+    return 0;
+    }
+
+#define MAPBITS (AL_MAP_READ_BIT_SOFT | AL_MAP_WRITE_BIT_SOFT | AL_MAP_PERSISTENT_BIT_SOFT)
+
+AL_API void AL_APIENTRY alBufferStorageSOFT(ALuint buffer, ALenum format, const ALvoid *data, ALsizei size, ALsizei freq, ALbitfieldSOFT flags)
+/* only mappable buffers keep their data (so that it can be read back) */
+    {
+    object_t *obj;
+    ALsizei channels, bits;
+    unsigned char *storage = NULL;
+    if(formatinfo(format, &channels, &bits) != 0)
+        { seterror(AL_INVALID_ENUM); return; }
+    if(size < 0 || freq <= 0 || (size % (channels*bits/8)) != 0 ||
+        (flags & ~(MAPBITS | AL_PRESERVE_DATA_BIT_SOFT)) != 0)
+        { seterror(AL_INVALID_VALUE); return; }
+    if(flags & MAPBITS)
+        {
+        if((storage = (unsigned char*)calloc(1, size > 0 ? size : 1)) == NULL)
+            { seterror(AL_OUT_OF_MEMORY); return; }
+        if(data) memcpy(storage, data, size);
+        }
+    Lock();
+    obj = object(buffer, BUFFER);
+    if(!obj)
+        { Unlock(); free(storage); seterror(AL_INVALID_NAME); return; }
+    if(obj->mapped || attached(buffer))
+        { Unlock(); free(storage); seterror(AL_INVALID_OPERATION); return; }
+    free(obj->storage);
+    obj->storage = storage;
+    obj->flags = flags;
+    obj->size = size;
+    obj->frequency = freq;
+    obj->channels = channels;
+    obj->bits = bits;
+    Unlock();
+    }
+
+AL_API void AL_APIENTRY alBufferData(ALuint buffer, ALenum format, const ALvoid *data, ALsizei size, ALsizei freq)
+    { alBufferStorageSOFT(buffer, format, data, size, freq, 0); }
+
+AL_API void* AL_APIENTRY alMapBufferSOFT(ALuint buffer, ALsizei offset, ALsizei length, ALbitfieldSOFT access)
+    {
+    object_t *obj;
+    void *ptr;
+    Lock();
+    obj = object(buffer, BUFFER);
+    if(!obj)
+        { Unlock(); seterror(AL_INVALID_NAME); return NULL; }
+    if(obj->mapped || (access & ~MAPBITS) != 0 || (access & (AL_MAP_READ_BIT_SOFT | AL_MAP_WRITE_BIT_SOFT)) == 0 ||
+        (access & ~obj->flags) != 0)
+        { Unlock(); seterror(AL_INVALID_OPERATION); return NULL; }
+    if(offset < 0 || length <= 0 || offset >= obj->size || length > obj->size - offset)
+        { Unlock(); seterror(AL_INVALID_VALUE); return NULL; }
+    obj->mapped = access;
+    ptr = obj->storage + offset;
+    Unlock();
+    return ptr;
+    }
+
+AL_API void AL_APIENTRY alUnmapBufferSOFT(ALuint buffer)
+    {
+    object_t *obj;
+    Lock();
+    obj = object(buffer, BUFFER);
+    if(!obj)
+        { Unlock(); seterror(AL_INVALID_NAME); return; }
+    if(!obj->mapped)
+        { Unlock(); seterror(AL_INVALID_OPERATION); return; }
+    obj->mapped = 0;
+    Unlock();
+    }
+
+AL_API void AL_APIENTRY alFlushMappedBufferSOFT(ALuint buffer, ALsizei offset, ALsizei length)
+    {
+    object_t *obj;
+    Lock();
+    obj = object(buffer, BUFFER);
+    if(!obj)
+        { Unlock(); seterror(AL_INVALID_NAME); return; }
+    if(!(obj->mapped & AL_MAP_WRITE_BIT_SOFT))
+        { Unlock(); seterror(AL_INVALID_OPERATION); return; }
+    if(offset < 0 || length <= 0 || offset >= obj->size || length > obj->size - offset)
+        { Unlock(); seterror(AL_INVALID_VALUE); return; }
+    Unlock();
+    }
+
+AL_API void AL_APIENTRY alBufferf(ALuint buffer, ALenum param, ALfloat value)
+    { SetBufferf(buffer, param, value); }
+AL_API void AL_APIENTRY alBuffer3f(ALuint buffer, ALenum param, ALfloat v1, ALfloat v2, ALfloat v3)
+    { SetBuffer3f(buffer, param, v1, v2, v3); }
+AL_API void AL_APIENTRY alBufferfv(ALuint buffer, ALenum param, const ALfloat *values)
+    { SetBufferfv(buffer, param, values); }
+AL_API void AL_APIENTRY alBufferi(ALuint buffer, ALenum param, ALint value)
+    { SetBufferi(buffer, param, value); }
+AL_API void AL_APIENTRY alBuffer3i(ALuint buffer, ALenum param, ALint v1, ALint v2, ALint v3)
+    { SetBuffer3i(buffer, param, v1, v2, v3); }
+AL_API void AL_APIENTRY alBufferiv(ALuint buffer, ALenum param, const ALint *values)
+    { SetBufferiv(buffer, param, values); }
+AL_API void AL_APIENTRY alGetBufferf(ALuint buffer, ALenum param, ALfloat *value)
+    { GetBufferf(buffer, param, value); }
+AL_API void AL_APIENTRY alGetBuffer3f(ALuint buffer, ALenum param, ALfloat *v1, ALfloat *v2, ALfloat *v3)
+    { GetBuffer3f(buffer, param, v1, v2, v3); }
+AL_API void AL_APIENTRY alGetBufferfv(ALuint buffer, ALenum param, ALfloat *values)
+    { GetBufferfv(buffer, param, values); }
+AL_API void AL_APIENTRY alGetBufferi(ALuint buffer, ALenum param, ALint *value)
+    { GetBufferi(buffer, param, value); }
+AL_API void AL_APIENTRY alGetBuffer3i(ALuint buffer, ALenum param, ALint *v1, ALint *v2, ALint *v3)
+    { GetBuffer3i(buffer, param, v1, v2, v3); }
+AL_API void AL_APIENTRY alGetBufferiv(ALuint buffer, ALenum param, ALint *values)
+    { GetBufferiv(buffer, param, values); }
+
+/* EFX ----------------------------------------------------------------------*/
+
+AL_API ALvoid AL_APIENTRY alGenEffects(ALsizei n, ALuint *effects)
+    { genobjects(EFFECT, n, effects); }
+AL_API ALvoid AL_APIENTRY alDeleteEffects(ALsizei n, const ALuint *effects)
+    { deleteobjects(EFFECT, n, effects); }
+AL_API ALboolean AL_APIENTRY alIsEffect(ALuint effect)
+    { return isobject(EFFECT, effect); }
+AL_API ALvoid AL_APIENTRY alEffecti(ALuint effect, ALenum param, ALint value)
+    { SetEffecti(effect, param, value); }
+AL_API ALvoid AL_APIENTRY alEffectiv(ALuint effect, ALenum param, const ALint *values)
+    { SetEffectiv(effect, param, values); }
+AL_API ALvoid AL_APIENTRY alEffectf(ALuint effect, ALenum param, ALfloat value)
+    { SetEffectf(effect, param, value); }
+AL_API ALvoid AL_APIENTRY alEffectfv(ALuint effect, ALenum param, const ALfloat *values)
+    { SetEffectfv(effect, param, values); }
+AL_API ALvoid AL_APIENTRY alGetEffecti(ALuint effect, ALenum param, ALint *value)
+    { GetEffecti(effect, param, value); }
+AL_API ALvoid AL_APIENTRY alGetEffectiv(ALuint effect, ALenum param, ALint *values)
+    { GetEffectiv(effect, param, values); }
+AL_API ALvoid AL_APIENTRY alGetEffectf(ALuint effect, ALenum param, ALfloat *value)
+    { GetEffectf(effect, param, value); }
+AL_API ALvoid AL_APIENTRY alGetEffectfv(ALuint effect, ALenum param, ALfloat *values)
+    { GetEffectfv(effect, param, values); }
+
+AL_API ALvoid AL_APIENTRY alGenFilters(ALsizei n, ALuint *filters)
+    { genobjects(FILTER, n, filters); }
+AL_API ALvoid AL_APIENTRY alDeleteFilters(ALsizei n, const ALuint *filters)
+    { deleteobjects(FILTER, n, filters); }
+AL_API ALboolean AL_APIENTRY alIsFilter(ALuint filter)
+    { return isobject(FILTER, filter); }
+AL_API ALvoid AL_APIENTRY alFilteri(ALuint filter, ALenum param, ALint value)
+    { SetFilteri(filter, param, value); }
+AL_API ALvoid AL_APIENTRY alFilteriv(ALuint filter, ALenum param, const ALint *values)
+    { SetFilteriv(filter, param, values); }
+AL_API ALvoid AL_APIENTRY alFilterf(ALuint filter, ALenum param, ALfloat value)
+    { SetFilterf(filter, param, value); }
+AL_API ALvoid AL_APIENTRY alFilterfv(ALuint filter, ALenum param, const ALfloat *values)
+    { SetFilterfv(filter, param, values); }
+AL_API ALvoid AL_APIENTRY alGetFilteri(ALuint filter, ALenum param, ALint *value)
+    { GetFilteri(filter, param, value); }
+AL_API ALvoid AL_APIENTRY alGetFilteriv(ALuint filter, ALenum param, ALint *values)
+    { GetFilteriv(filter, param, values); }
+AL_API ALvoid AL_APIENTRY alGetFilterf(ALuint filter, ALenum param, ALfloat *value)
+    { GetFilterf(filter, param, value); }
+AL_API ALvoid AL_APIENTRY alGetFilterfv(ALuint filter, ALenum param, ALfloat *values)
+    { GetFilterfv(filter, param, values); }
+
+AL_API ALvoid AL_APIENTRY alGenAuxiliaryEffectSlots(ALsizei n, ALuint *slots)
+    { genobjects(AUXSLOT, n, slots); }
+AL_API ALvoid AL_APIENTRY alDeleteAuxiliaryEffectSlots(ALsizei n, const ALuint *slots)
+    { deleteobjects(AUXSLOT, n, slots); }
+AL_API ALboolean AL_APIENTRY alIsAuxiliaryEffectSlot(ALuint slot)
+    { return isobject(AUXSLOT, slot); }
+AL_API ALvoid AL_APIENTRY alAuxiliaryEffectSloti(ALuint slot, ALenum param, ALint value)
+    { SetSloti(slot, param, value); }
+AL_API ALvoid AL_APIENTRY alAuxiliaryEffectSlotiv(ALuint slot, ALenum param, const ALint *values)
+    { SetSlotiv(slot, param, values); }
+AL_API ALvoid AL_APIENTRY alAuxiliaryEffectSlotf(ALuint slot, ALenum param, ALfloat value)
+    { SetSlotf(slot, param, value); }
+AL_API ALvoid AL_APIENTRY alAuxiliaryEffectSlotfv(ALuint slot, ALenum param, const ALfloat *values)
+    { SetSlotfv(slot, param, values); }
+AL_API ALvoid AL_APIENTRY alGetAuxiliaryEffectSloti(ALuint slot, ALenum param, ALint *value)
+    { GetSloti(slot, param, value); }
+AL_API ALvoid AL_APIENTRY alGetAuxiliaryEffectSlotiv(ALuint slot, ALenum param, ALint *values)
+    { GetSlotiv(slot, param, values); }
+AL_API ALvoid AL_APIENTRY alGetAuxiliaryEffectSlotf(ALuint slot, ALenum param, ALfloat *value)
+    { GetSlotf(slot, param, value); }
+AL_API ALvoid AL_APIENTRY alGetAuxiliaryEffectSlotfv(ALuint slot, ALenum param, ALfloat *values)
+    { GetSlotfv(slot, param, values); }
+
+/*------------------------------------------------------------------------------*
+ | ALC entry points                                                             |
+ *------------------------------------------------------------------------------*/
+
+#define DEVICENAME "MoonAL Stub"
+
+static void parseattributes(ALCdevice *device, const ALCint *attrlist)
+    {
+    int i;
+    if(!attrlist) return;
+    for(i = 0; attrlist[i] != 0; i += 2)
+        {
+        switch(attrlist[i])
+            {
+            case ALC_FREQUENCY: device->frequency = attrlist[i+1]; break;
+            case ALC_FORMAT_CHANNELS_SOFT: device->channels = attrlist[i+1]; break;
+            case ALC_FORMAT_TYPE_SOFT: device->type = attrlist[i+1]; break;
+            default: break;
+            }
+        }
+    }
+
+ALC_API ALCcontext* ALC_APIENTRY alcCreateContext(ALCdevice *device, const ALCint *attrlist)
+    {
+    ALCcontext *context;
+    if(!device || device->kind == CAPTURE)
+        { setalcerror(device, ALC_INVALID_DEVICE); return NULL; }
+    context = (ALCcontext*)calloc(1, sizeof(ALCcontext));
+    if(!context)
+        { setalcerror(device, ALC_OUT_OF_MEMORY); return NULL; }
+    context->device = device;
+    parseattributes(device, attrlist);
+    device->contexts++;
+    return context;
+    }
+
+ALC_API ALCboolean ALC_APIENTRY alcMakeContextCurrent(ALCcontext *context)
+    {
+    CurrentContext = context;
+    ThreadContext = NULL; /* the thread falls back to the global context */
+    return ALC_TRUE;
+    }
+
+ALC_API ALCboolean ALC_APIENTRY alcSetThreadContext(ALCcontext *context)
+    {
+    ThreadContext = context;
+    return ALC_TRUE;
+    }
+
+ALC_API ALCcontext* ALC_APIENTRY alcGetThreadContext(void)
+    { return ThreadContext; }
+
+ALC_API void ALC_APIENTRY alcProcessContext(ALCcontext *context)
+    { (void)context; }
+
+ALC_API void ALC_APIENTRY alcSuspendContext(ALCcontext *context)
+    { (void)context; }
+
+ALC_API void ALC_APIENTRY alcDestroyContext(ALCcontext *context)
+    {
+    if(!context) return;
+    if(CurrentContext == context) CurrentContext = NULL;
+    if(ThreadContext == context) ThreadContext = NULL;
+    context->device->contexts--;
+    free(context->params.p);
+    free(context);
+    }
+
+ALC_API ALCcontext* ALC_APIENTRY alcGetCurrentContext(void)
+    { return ThreadContext ? ThreadContext : CurrentContext; }
+
+ALC_API ALCdevice* ALC_APIENTRY alcGetContextsDevice(ALCcontext *context)
+    { return context ? context->device : NULL; }
+
+ALC_API ALCdevice* ALC_APIENTRY alcOpenDevice(const ALCchar *devicename)
+    {
+    ALCdevice *device;
+    if(devicename && strcmp(devicename, DEVICENAME) != 0)
+        { setalcerror(NULL, ALC_INVALID_VALUE); return NULL; }
+    device = newdevice(PLAYBACK);
+    if(!device) setalcerror(NULL, ALC_OUT_OF_MEMORY);
+    return device;
+    }
+
+ALC_API ALCboolean ALC_APIENTRY alcCloseDevice(ALCdevice *device)
+    {
+    if(!device || device->kind == CAPTURE)
+        { setalcerror(device, ALC_INVALID_DEVICE); return ALC_FALSE; }
+    if(device->contexts > 0)
+        { setalcerror(device, ALC_INVALID_DEVICE); return ALC_FALSE; }
+    free(device);
+    return ALC_TRUE;
+    }
+
+ALC_API ALCenum ALC_APIENTRY alcGetError(ALCdevice *device)
+    {
+    ALCenum err;
+    if(!device)
+        { err = NullDeviceError; NullDeviceError = ALC_NO_ERROR; return err; }
+    err = device->error;
+    device->error = ALC_NO_ERROR;
+    return err;
+    }
+
+static const char *AlcExtensions = 
+    "ALC_ENUMERATE_ALL_EXT ALC_ENUMERATION_EXT ALC_EXT_CAPTURE ALC_EXT_EFX "
+    "ALC_EXT_thread_local_context ALC_SOFT_device_clock ALC_SOFT_loopback "
+    "ALC_SOFT_pause_device";
+
+ALC_API ALCboolean ALC_APIENTRY alcIsExtensionPresent(ALCdevice *device, const ALCchar *extname)
+    {
+    const char *p = AlcExtensions;
+    size_t len = strlen(extname);
+    (void)device;
+    while((p = strstr(p, extname)) != NULL)
+        {
+        if(p[len] == ' ' || p[len] == '\0') return ALC_TRUE;
+        p += len;
+        }
+    return ALC_FALSE;
+    }
+
+ALC_API ALCenum ALC_APIENTRY alcGetEnumValue(ALCdevice *device, const ALCchar *enumname)
+    { (void)device; (void)enumname; return 0; }
+
+ALC_API const ALCchar* ALC_APIENTRY alcGetString(ALCdevice *device, ALCenum param)
+    {
+    switch(param)
+        {
+        case ALC_DEFAULT_DEVICE_SPECIFIER:
+        case ALC_DEFAULT_ALL_DEVICES_SPECIFIER:
+        case ALC_CAPTURE_DEFAULT_DEVICE_SPECIFIER: return DEVICENAME;
+        case ALC_DEVICE_SPECIFIER:
+        case ALC_ALL_DEVICES_SPECIFIER:
+        case ALC_CAPTURE_DEVICE_SPECIFIER: /* list, if device=NULL */
+            return device ? DEVICENAME : DEVICENAME "\0";
+        case ALC_EXTENSIONS: return AlcExtensions;
+        case ALC_NO_ERROR: return "No Error";
+        case ALC_INVALID_DEVICE: return "Invalid Device";
+        case ALC_INVALID_CONTEXT: return "Invalid Context";
+        case ALC_INVALID_ENUM: return "Invalid Enum";
+        case ALC_INVALID_VALUE: return "Invalid Value";
+        case ALC_OUT_OF_MEMORY: return "Out of Memory";
+        default: setalcerror(device, ALC_INVALID_ENUM); return NULL;
+        }
+    }
+
+static ALCint64SOFT deviceclock(ALCdevice *device)
+/* nanoseconds */
+    {
+    if(device->kind == LOOPBACK)
+        return device->rendered * 1000000000 / device->frequency;
+    return (ALCint64SOFT)((now() - device->t0)*1.0e9);
+    }
+
+ALC_API void ALC_APIENTRY alcGetIntegerv(ALCdevice *device, ALCenum param, ALCsizei size, ALCint *values)
+    {
+    ALCint attr[] = {
+        ALC_FREQUENCY, 0,
+        ALC_REFRESH, 50,
+        ALC_SYNC, ALC_FALSE,
+        ALC_MONO_SOURCES, 255,
+        ALC_STEREO_SOURCES, 1,
+        ALC_MAX_AUXILIARY_SENDS, 2,
+        0 };
+    ALCsizei nattr = sizeof(attr)/sizeof(ALCint);
+    if(size <= 0 || !values)
+        { setalcerror(device, ALC_INVALID_VALUE); return; }
+    switch(param)
+        {
+        case ALC_MAJOR_VERSION: values[0] = 1; return;
+        case ALC_MINOR_VERSION: values[0] = 1; return;
+        case ALC_EFX_MAJOR_VERSION: values[0] = 1; return;
+        case ALC_EFX_MINOR_VERSION: values[0] = 0; return;
+        default: break;
+        }
+    if(!device)
+        { setalcerror(device, ALC_INVALID_DEVICE); return; }
+    switch(param)
+        {
+        case ALC_ATTRIBUTES_SIZE: values[0] = nattr; return;
+        case ALC_ALL_ATTRIBUTES:
+            if(size < nattr) { setalcerror(device, ALC_INVALID_VALUE); return; }
+            attr[1] = device->frequency;
+            memcpy(values, attr, sizeof(attr));
+            return;
+        case ALC_FREQUENCY: values[0] = device->frequency; return;
+        case ALC_REFRESH: values[0] = 50; return;
+        case ALC_SYNC: values[0] = ALC_FALSE; return;
+        case ALC_MONO_SOURCES: values[0] = 255; return;
+        case ALC_STEREO_SOURCES: values[0] = 1; return;
+        case ALC_MAX_AUXILIARY_SENDS: values[0] = 2; return;
+        case ALC_CONNECTED: values[0] = ALC_TRUE; return;
+        case ALC_CAPTURE_SAMPLES: /* capture never runs out of (silent) samples */
+            values[0] = device->capturing ? 0x7fffffff : 0;
+            return;
+        default: setalcerror(device, ALC_INVALID_ENUM); return;
+        }
+    }
+
+ALC_API void ALC_APIENTRY alcGetInteger64vSOFT(ALCdevice *device, ALCenum param, ALsizei size, ALCint64SOFT *values)
+    {
+    if(!device)
+        { setalcerror(device, ALC_INVALID_DEVICE); return; }
+    if(size <= 0 || !values)
+        { setalcerror(device, ALC_INVALID_VALUE); return; }
+    switch(param)
+        {
+        case ALC_DEVICE_CLOCK_SOFT: values[0] = deviceclock(device); return;
+        case ALC_DEVICE_LATENCY_SOFT: values[0] = 0; return;
+        case ALC_DEVICE_CLOCK_LATENCY_SOFT:
+            if(size < 2) { setalcerror(device, ALC_INVALID_VALUE); return; }
+            values[0] = deviceclock(device);
+            values[1] = 0;
+            return;
+        default:
+            {
+            ALCint val;
+            alcGetIntegerv(device, param, 1, &val);
+            values[0] = val;
+            }
+        }
+    }
+
+/* Capture ------------------------------------------------------------------*/
+
+ALC_API ALCdevice* ALC_APIENTRY alcCaptureOpenDevice(const ALCchar *devicename, ALCuint frequency, ALCenum format, ALCsizei buffersize)
+    {
+    ALCdevice *device;
+    ALsizei channels, bits;
+    if(devicename && strcmp(devicename, DEVICENAME) != 0)
+        { setalcerror(NULL, ALC_INVALID_VALUE); return NULL; }
+    if(formatinfo(format, &channels, &bits) != 0 || buffersize <= 0)
+        { setalcerror(NULL, ALC_INVALID_VALUE); return NULL; }
+    device = newdevice(CAPTURE);
+    if(!device)
+        { setalcerror(NULL, ALC_OUT_OF_MEMORY); return NULL; }
+    device->frequency = frequency;
+    device->framesize = channels*bits/8;
+    return device;
+    }
+
+ALC_API ALCboolean ALC_APIENTRY alcCaptureCloseDevice(ALCdevice *device)
+    {
+    if(!device || device->kind != CAPTURE)
+        { setalcerror(device, ALC_INVALID_DEVICE); return ALC_FALSE; }
+    free(device);
+    return ALC_TRUE;
+    }
+
+ALC_API void ALC_APIENTRY alcCaptureStart(ALCdevice *device)
+    { if(device) device->capturing = ALC_TRUE; }
+
+ALC_API void ALC_APIENTRY alcCaptureStop(ALCdevice *device)
+    { if(device) device->capturing = ALC_FALSE; }
+
+ALC_API void ALC_APIENTRY alcCaptureSamples(ALCdevice *device, ALCvoid *buffer, ALCsizei samples)
+    {
+    if(!device || device->kind != CAPTURE)
+        { setalcerror(device, ALC_INVALID_DEVICE); return; }
+    memset(buffer, 0, samples*device->framesize);
+    }
+
+/* Loopback -----------------------------------------------------------------*/
+
+ALC_API ALCdevice* ALC_APIENTRY alcLoopbackOpenDeviceSOFT(const ALCchar *devicename)
+    {
+    ALCdevice *device;
+    if(devicename && strcmp(devicename, DEVICENAME) != 0)
+        { setalcerror(NULL, ALC_INVALID_VALUE); return NULL; }
+    device = newdevice(LOOPBACK);
+    if(!device) setalcerror(NULL, ALC_OUT_OF_MEMORY);
+    return device;
+    }
+
+ALC_API ALCboolean ALC_APIENTRY alcIsRenderFormatSupportedSOFT(ALCdevice *device, ALCsizei freq, ALCenum channels, ALCenum type)
+    {
+    (void)channels; (void)type;
+    if(!device || device->kind != LOOPBACK)
+        { setalcerror(device, ALC_INVALID_DEVICE); return ALC_FALSE; }
+    return freq > 0;
+    }
+
+ALC_API void ALC_APIENTRY alcRenderSamplesSOFT(ALCdevice *device, ALCvoid *buffer, ALCsizei samples)
+    {
+    if(!device || device->kind != LOOPBACK)
+        { setalcerror(device, ALC_INVALID_DEVICE); return; }
+    memset(buffer, 0, samples*channelcount(device->channels)*typesize(device->type));
+    device->rendered += samples;
+    }
+
+/* ALC_SOFT_pause_device ----------------------------------------------------*/
+
+ALC_API void ALC_APIENTRY alcDevicePauseSOFT(ALCdevice *device)
+    { if(device) device->paused = ALC_TRUE; }
+
+ALC_API void ALC_APIENTRY alcDeviceResumeSOFT(ALCdevice *device)
+    { if(device) device->paused = ALC_FALSE; }
+
+/*------------------------------------------------------------------------------*
+ | alGetProcAddress, alcGetProcAddress                                          |
+ *------------------------------------------------------------------------------*/
+
+typedef void (*fn_t)(void);
+
+typedef struct {
+    const char *name;
+    fn_t fn;
+} procaddr_t;
+
+#define F(name) { #name, (fn_t)name }
+static const procaddr_t ProcAddr[] = {
+    F(alEnable), F(alDisable), F(alIsEnabled), F(alGetString), F(alGetBooleanv),
+    F(alGetIntegerv), F(alGetFloatv), F(alGetDoublev), F(alGetBoolean), F(alGetInteger),
+    F(alGetFloat), F(alGetDouble), F(alGetError), F(alIsExtensionPresent), F(alGetProcAddress),
+    F(alGetEnumValue), F(alListenerf), F(alListener3f), F(alListenerfv), F(alListeneri),
+    F(alListener3i), F(alListeneriv), F(alGetListenerf), F(alGetListener3f), F(alGetListenerfv),
+    F(alGetListeneri), F(alGetListener3i), F(alGetListeneriv), F(alGenSources), F(alDeleteSources),
+    F(alIsSource), F(alSourcef), F(alSource3f), F(alSourcefv), F(alSourcei), F(alSource3i),
+    F(alSourceiv), F(alGetSourcef), F(alGetSource3f), F(alGetSourcefv), F(alGetSourcei),
+    F(alGetSource3i), F(alGetSourceiv), F(alSourcePlayv), F(alSourceStopv), F(alSourceRewindv),
+    F(alSourcePausev), F(alSourcePlay), F(alSourceStop), F(alSourceRewind), F(alSourcePause),
+    F(alSourceQueueBuffers), F(alSourceUnqueueBuffers), F(alGenBuffers), F(alDeleteBuffers),
+    F(alIsBuffer), F(alBufferData), F(alBufferf), F(alBuffer3f), F(alBufferfv), F(alBufferi),
+    F(alBuffer3i), F(alBufferiv), F(alGetBufferf), F(alGetBuffer3f), F(alGetBufferfv),
+    F(alGetBufferi), F(alGetBuffer3i), F(alGetBufferiv), F(alDopplerFactor), F(alDopplerVelocity),
+    F(alSpeedOfSound), F(alDistanceModel),
+    /* AL_SOFT_source_latency */
+    F(alSourcedSOFT), F(alSource3dSOFT), F(alSourcedvSOFT), F(alGetSourcedSOFT),
+    F(alGetSource3dSOFT), F(alGetSourcedvSOFT), F(alSourcei64SOFT), F(alSource3i64SOFT),
+    F(alSourcei64vSOFT), F(alGetSourcei64SOFT), F(alGetSource3i64SOFT), F(alGetSourcei64vSOFT),
+    /* AL_SOFT_deferred_updates, AL_SOFT_source_resampler */
+    F(alDeferUpdatesSOFT), F(alProcessUpdatesSOFT), F(alGetStringiSOFT),
+    /* AL_SOFT_events */
+    F(alEventControlSOFT), F(alEventCallbackSOFT),
+    /* AL_SOFT_map_buffer */
+    F(alBufferStorageSOFT), F(alMapBufferSOFT), F(alUnmapBufferSOFT), F(alFlushMappedBufferSOFT),
+    F(alSourcePlayAtTimeSOFT), F(alSourcePlayAtTimevSOFT),
+    /* EFX */
+    F(alGenEffects), F(alDeleteEffects), F(alIsEffect), F(alEffecti), F(alEffectiv),
+    F(alEffectf), F(alEffectfv), F(alGetEffecti), F(alGetEffectiv), F(alGetEffectf),
+    F(alGetEffectfv), F(alGenFilters), F(alDeleteFilters), F(alIsFilter), F(alFilteri),
+    F(alFilteriv), F(alFilterf), F(alFilterfv), F(alGetFilteri), F(alGetFilteriv),
+    F(alGetFilterf), F(alGetFilterfv), F(alGenAuxiliaryEffectSlots),
+    F(alDeleteAuxiliaryEffectSlots), F(alIsAuxiliaryEffectSlot), F(alAuxiliaryEffectSloti),
+    F(alAuxiliaryEffectSlotiv), F(alAuxiliaryEffectSlotf), F(alAuxiliaryEffectSlotfv),
+    F(alGetAuxiliaryEffectSloti), F(alGetAuxiliaryEffectSlotiv), F(alGetAuxiliaryEffectSlotf),
+    F(alGetAuxiliaryEffectSlotfv),
+    /* ALC */
+    F(alcCreateContext), F(alcMakeContextCurrent), F(alcProcessContext), F(alcSuspendContext),
+    F(alcDestroyContext), F(alcGetCurrentContext), F(alcGetContextsDevice), F(alcOpenDevice),
+    F(alcCloseDevice), F(alcGetError), F(alcIsExtensionPresent), F(alcGetProcAddress),
+    F(alcGetEnumValue), F(alcGetString), F(alcGetIntegerv), F(alcCaptureOpenDevice),
+    F(alcCaptureCloseDevice), F(alcCaptureStart), F(alcCaptureStop), F(alcCaptureSamples),
+    F(alcLoopbackOpenDeviceSOFT), F(alcIsRenderFormatSupportedSOFT), F(alcRenderSamplesSOFT),
+    F(alcSetThreadContext), F(alcGetThreadContext), F(alcDevicePauseSOFT),
+    F(alcDeviceResumeSOFT), F(alcGetInteger64vSOFT),
+    { NULL, NULL }
+};
+#undef F
+
+static void *procaddress(const char *name)
+    {
+    const procaddr_t *p;
+    for(p = ProcAddr; p->name != NULL; p++)
+        {
+        if(strcmp(p->name, name) == 0)
+            {
+            void *addr;
+            memcpy(&addr, &p->fn, sizeof(addr)); /* -Wpedantic */
+            return addr;
+            }
+        }
+    return NULL;
+    }
+
+AL_API void* AL_APIENTRY alGetProcAddress(const ALchar *fname)
+    { return procaddress(fname); }
+
+ALC_API void* ALC_APIENTRY alcGetProcAddress(ALCdevice *device, const ALCchar *funcname)
+    { (void)device; return procaddress(funcname); }
+